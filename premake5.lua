@@ -41,6 +41,7 @@ function sample(projectName, sourceFolder)
         "usdSkel",
         "usdUtils",
         "vt",
+        "work",
     })
     connect_build.use_connect_core()
 
@@ -68,3 +69,6 @@ sample("omnicli", "omnicli")
 sample("omniUsdaWatcher", "omniUsdaWatcher")
 sample("omniSimpleSensor", "omniSimpleSensor")
 sample("omniSensorThread", "omniSensorThread")
+sample("omniStageOptimizer", "omniStageOptimizer")
+sample("omniGeometryImporter", "omniGeometryImporter")
+sample("omniStageValidator", "omniStageValidator")
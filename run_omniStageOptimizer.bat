@@ -0,0 +1,10 @@
+@echo off
+
+set CARB_APP_PATH=%~dp0\_build\windows-x86_64\release
+
+pushd "%~dp0"
+call "%CARB_APP_PATH%\omniStageOptimizer.exe" %*
+if errorlevel 1 ( echo Error running omniStageOptimizer )
+popd
+
+EXIT /B %ERRORLEVEL%
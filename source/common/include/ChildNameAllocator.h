@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <omni/connect/core/PrimAlgo.h>
+
+#include <pxr/pxr.h>
+#include <pxr/base/tf/token.h>
+#include <pxr/usd/usd/prim.h>
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/*
+Hands out valid, unique child prim names for one parent in amortized constant time.
+
+* omni::connect::core::getValidChildNames looks at the parent's existing children on every call, so creating N siblings
+    one call at a time costs O(N^2). The allocator snapshots the children into a hash set once and then only checks
+    and records the names it hands out.
+* Names are made valid with omni::connect::core::getValidPrimName and made unique with a `_1`, `_2`, ... suffix, like
+    getValidChildNames. The next suffix to try is remembered per base name, so handing out "Box" 100k times does
+    not retry the taken suffixes each time.
+* The snapshot is not updated when children are added some other way. Use one allocator per parent while it is
+    filled, and add any names created outside of it with reserve().
+*/
+class ChildNameAllocator
+{
+public:
+
+    explicit ChildNameAllocator(const PXR_NS::UsdPrim& parent)
+    {
+        if (parent)
+        {
+            const PXR_NS::TfTokenVector children = parent.GetAllChildrenNames();
+            m_used.reserve(children.size());
+            m_used.insert(children.begin(), children.end());
+        }
+    }
+
+    PXR_NS::TfToken allocate(const std::string& name)
+    {
+        const std::string base = omni::connect::core::getValidPrimName(name);
+        PXR_NS::TfToken candidate(base);
+        if (m_used.insert(candidate).second)
+        {
+            return candidate;
+        }
+        size_t& suffix = m_nextSuffix[base];
+        do
+        {
+            candidate = PXR_NS::TfToken(base + "_" + std::to_string(++suffix));
+        } while (!m_used.insert(candidate).second);
+        return candidate;
+    }
+
+    // Record a child that was named without the allocator
+    void reserve(const PXR_NS::TfToken& name)
+    {
+        m_used.insert(name);
+    }
+
+    bool isUsed(const PXR_NS::TfToken& name) const
+    {
+        return m_used.count(name) != 0;
+    }
+
+private:
+
+    std::unordered_set<PXR_NS::TfToken, PXR_NS::TfToken::HashFunctor> m_used;
+    std::unordered_map<std::string, size_t> m_nextSuffix;
+};
@@ -0,0 +1,225 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <omni/connect/core/MeshAlgo.h>
+#include <omni/connect/core/XformAlgo.h>
+
+#include <pxr/pxr.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/tf/token.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/usd/attribute.h>
+#include <pxr/usd/usd/prim.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/pointBased.h>
+#include <pxr/usd/usdGeom/xform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+Streams a deforming mesh into a live session by rewriting only the parts of it that moved.
+
+* A points attribute is a single value, so moving one vertex sends the whole array again. The stream splits the mesh
+    into chunk meshes of at most `facesPerChunk` consecutive faces under one Xform. Each chunk has its own copy of
+    the vertices its faces use, so vertices on chunk borders are duplicated.
+* A GeomSubset can only group the faces of a mesh, all of its subsets still share the mesh's one points array. That
+    is why the chunks are separate meshes and not subsets.
+* write() takes the points of the whole mesh. It rewrites the points and extent of only the chunks where a point
+    moved more than the tolerance since the chunk was last written, inside one SdfChangeBlock, and returns how many
+    bytes of values that authored.
+* Topology whose counts don't add up to the number of indices, or with indices outside the points, gives an invalid
+    stream without authoring anything.
+* Faces are chunked in their order, so chunks are compact when the mesh's faces are ordered spatially, like the
+    rows of a grid or the output of most exporters.
+*/
+class DeltaPointStream
+{
+public:
+
+    struct FrameStats
+    {
+        size_t changedChunks = 0;
+        size_t bytes = 0; // points and extents authored
+    };
+
+    DeltaPointStream(
+        const PXR_NS::UsdPrim& parent,
+        const PXR_NS::TfToken& name,
+        const PXR_NS::VtIntArray& faceVertexCounts,
+        const PXR_NS::VtIntArray& faceVertexIndices,
+        const PXR_NS::VtVec3fArray& points,
+        size_t facesPerChunk
+    )
+    {
+        using namespace PXR_NS;
+
+        if (!isValidTopology(faceVertexCounts, faceVertexIndices, points.size()))
+        {
+            return;
+        }
+        m_root = omni::connect::core::defineXform(parent, name);
+        if (!m_root)
+        {
+            return;
+        }
+        m_pointCount = points.size();
+        facesPerChunk = std::max<size_t>(1, facesPerChunk);
+        size_t offset = 0;
+        for (size_t firstFace = 0; firstFace < faceVertexCounts.size(); firstFace += facesPerChunk)
+        {
+            Chunk chunk;
+            VtIntArray chunkCounts;
+            VtIntArray chunkIndices;
+            std::unordered_map<int, int> localIndices;
+            const size_t endFace = std::min(firstFace + facesPerChunk, faceVertexCounts.size());
+            for (size_t face = firstFace; face < endFace; face++)
+            {
+                chunkCounts.push_back(faceVertexCounts[face]);
+                for (int corner = 0; corner < faceVertexCounts[face]; corner++)
+                {
+                    const int vertex = faceVertexIndices[offset++];
+                    auto inserted = localIndices.emplace(vertex, (int)chunk.vertices.size());
+                    if (inserted.second)
+                    {
+                        chunk.vertices.push_back(vertex);
+                    }
+                    chunkIndices.push_back(inserted.first->second);
+                }
+            }
+            chunk.written = gather(chunk, points);
+            UsdGeomMesh mesh = omni::connect::core::definePolyMesh(
+                m_root.GetPrim(),
+                TfToken("Chunk_" + std::to_string(m_chunks.size())),
+                chunkCounts,
+                chunkIndices,
+                chunk.written
+            );
+            if (!mesh)
+            {
+                m_chunks.clear();
+                return;
+            }
+            chunk.pointsAttr = mesh.GetPointsAttr();
+            chunk.extentAttr = mesh.GetExtentAttr();
+            m_chunks.push_back(std::move(chunk));
+        }
+    }
+
+    explicit operator bool() const
+    {
+        return !m_chunks.empty();
+    }
+
+    size_t chunkCount() const
+    {
+        return m_chunks.size();
+    }
+
+    PXR_NS::UsdGeomXform root() const
+    {
+        return m_root;
+    }
+
+    // Author the chunks whose points moved, `points` holds the whole mesh in the order it was built with
+    FrameStats write(const PXR_NS::VtVec3fArray& points, float tolerance = 1e-5f)
+    {
+        using namespace PXR_NS;
+
+        FrameStats stats;
+        if (points.size() != m_pointCount)
+        {
+            return stats;
+        }
+        SdfChangeBlock changeBlock;
+        for (Chunk& chunk : m_chunks)
+        {
+            if (!hasMoved(chunk, points, tolerance))
+            {
+                continue;
+            }
+            chunk.written = gather(chunk, points);
+            VtVec3fArray extent;
+            chunk.pointsAttr.Set(chunk.written);
+            if (UsdGeomPointBased::ComputeExtent(chunk.written, &extent))
+            {
+                chunk.extentAttr.Set(extent);
+            }
+            stats.changedChunks++;
+            stats.bytes += chunk.written.size() * sizeof(GfVec3f) + extent.size() * sizeof(GfVec3f);
+        }
+        return stats;
+    }
+
+private:
+
+    struct Chunk
+    {
+        std::vector<int> vertices; // the mesh's vertex index of each chunk vertex
+        PXR_NS::VtVec3fArray written;
+        PXR_NS::UsdAttribute pointsAttr;
+        PXR_NS::UsdAttribute extentAttr;
+    };
+
+    // The counts add up to the number of indices and every index is a point of the mesh
+    static bool isValidTopology(const PXR_NS::VtIntArray& faceVertexCounts, const PXR_NS::VtIntArray& faceVertexIndices, size_t pointCount)
+    {
+        size_t cornerCount = 0;
+        for (int count : faceVertexCounts)
+        {
+            if (count < 0)
+            {
+                return false;
+            }
+            cornerCount += (size_t)count;
+        }
+        if (cornerCount != faceVertexIndices.size())
+        {
+            return false;
+        }
+        for (int index : faceVertexIndices)
+        {
+            if (index < 0 || (size_t)index >= pointCount)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static PXR_NS::VtVec3fArray gather(const Chunk& chunk, const PXR_NS::VtVec3fArray& points)
+    {
+        PXR_NS::VtVec3fArray chunkPoints(chunk.vertices.size());
+        for (size_t i = 0; i < chunk.vertices.size(); i++)
+        {
+            chunkPoints[i] = points[chunk.vertices[i]];
+        }
+        return chunkPoints;
+    }
+
+    static bool hasMoved(const Chunk& chunk, const PXR_NS::VtVec3fArray& points, float tolerance)
+    {
+        const PXR_NS::GfVec3f* written = chunk.written.cdata();
+        for (size_t i = 0; i < chunk.vertices.size(); i++)
+        {
+            const PXR_NS::GfVec3f& point = points[chunk.vertices[i]];
+            if (std::abs(point[0] - written[i][0]) > tolerance || std::abs(point[1] - written[i][1]) > tolerance ||
+                std::abs(point[2] - written[i][2]) > tolerance)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    PXR_NS::UsdGeomXform m_root;
+    std::vector<Chunk> m_chunks;
+    size_t m_pointCount = 0;
+};
@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <OmniClient.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// File sizes for the reports the samples print after writing stages and layers: the
+// size of a file at any URL the client library can stat, and byte counts formatted
+// for reading.
+///////////////////////////////////////////////////////////////////////////////////////
+
+// Human readable byte counts for the reports
+inline std::string formatBytes(double bytes)
+{
+    const char* units[] = { "B", "KB", "MB", "GB" };
+    int unit = 0;
+    while (bytes >= 1000.0 && unit < 3)
+    {
+        bytes /= 1000.0;
+        unit++;
+    }
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), unit == 0 ? "%.0f %s" : "%.2f %s", bytes, units[unit]);
+    return buffer;
+}
+
+// Size in bytes of the file at a URL (Nucleus or local), 0 if it could not be found
+inline uint64_t getFileSize(const std::string& url)
+{
+    uint64_t size = 0;
+    omniClientWait(omniClientStat(
+        url.c_str(),
+        &size,
+        [](void* userData, OmniClientResult result, struct OmniClientListEntry const* entry) noexcept
+        {
+            if (result == eOmniClientResult_Ok && entry)
+            {
+                *(uint64_t*)userData = entry->size;
+            }
+        }
+    ));
+    return size;
+}
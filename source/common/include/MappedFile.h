@@ -0,0 +1,164 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////
+// A read-only memory mapping of a local file.
+//
+// Mapping lets the OS page in only the bytes that are actually touched, so readers
+// that seek to a header or table of contents never pull the whole file from disk,
+// and streaming parsers avoid a second copy of very large inputs.
+///////////////////////////////////////////////////////////////////////////////////////
+class MappedFile
+{
+public:
+
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path)
+    {
+        open(path);
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path)
+    {
+        close();
+#ifdef _WIN32
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        m_size = (size_t)fileSize.QuadPart;
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping)
+        {
+            close();
+            return false;
+        }
+        m_data = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        m_fd = ::open(path.c_str(), O_RDONLY);
+        if (m_fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (fstat(m_fd, &st) != 0 || st.st_size == 0)
+        {
+            close();
+            return false;
+        }
+        m_size = (size_t)st.st_size;
+        void* addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        m_data = (addr == MAP_FAILED) ? nullptr : (const uint8_t*)addr;
+#endif
+        if (!m_data)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // Tell the OS the mapping will be read front to back (a hint, it may be ignored)
+    void adviseSequential() const
+    {
+#ifndef _WIN32
+        if (m_data)
+        {
+            madvise((void*)m_data, m_size, MADV_SEQUENTIAL);
+        }
+#endif
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping)
+        {
+            CloseHandle(m_mapping);
+        }
+        if (m_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_file);
+        }
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data)
+        {
+            munmap((void*)m_data, m_size);
+        }
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+        }
+        m_fd = -1;
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    bool isOpen() const
+    {
+        return m_data != nullptr;
+    }
+
+    const uint8_t* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
@@ -0,0 +1,402 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "Stopwatch.h"
+
+#include <pxr/pxr.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/gf/vec3h.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/base/vt/value.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/types.h>
+#include <pxr/usd/usd/attribute.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Records streamed attribute values as time samples, so a live edit can be played back afterwards.
+
+* A live edit only authors the current default value. While the recorder runs, every streamed value is also copied,
+    with the wall clock time it was streamed at, into per-attribute buffers that are allocated when recording
+    starts. Recording a value is a copy into memory, it does not touch the stage.
+* stop() hands the buffers to a background thread, which writes them as time samples into a new layer and saves it.
+    That layer is not part of any stage, so it can be authored while the main thread keeps editing the stage.
+    The layer sublayers the stage's root layer, opening it plays the stage back with the recorded motion.
+* With a tolerance above zero, samples that linear interpolation between the kept samples reproduces within the
+    tolerance are dropped. USD interpolates 3-vectors and their arrays linearly per component, so playback is
+    within the tolerance of every recorded value. The tolerance applies to every component alike, in the units of
+    the attribute (scene units for translations, degrees for rotations).
+* Tracks are 3-vectors (double3, float3, half3) or fixed-length arrays of them (double3[], float3[]). Once a
+    track's buffer is full, further values are counted as dropped.
+* Values playback needs that are not in the stage's root layer, like the xformOpOrder a live session authored for
+    the recorded ops, are copied into the layer with addConstant().
+*/
+class MotionRecorder
+{
+public:
+
+    static constexpr size_t kInvalidTrack = std::numeric_limits<size_t>::max();
+
+    struct FlushReport
+    {
+        std::string layerPath;
+        size_t capturedSamples = 0;
+        size_t keptSamples = 0;
+        size_t droppedSamples = 0; // streamed after a track's buffer was full
+        size_t capturedBytes = 0;
+        size_t keptBytes = 0;
+        double captureSeconds = 0.0;
+        double flushMs = 0.0;
+        bool saved = false;
+
+        // Samples reduced and written per second on the background thread
+        double samplesPerSecond() const
+        {
+            return flushMs > 0.0 ? capturedSamples * 1000.0 / flushMs : 0.0;
+        }
+
+        double savedPercent() const
+        {
+            return capturedBytes > 0 ? 100.0 * (1.0 - (double)keptBytes / (double)capturedBytes) : 0.0;
+        }
+    };
+
+    using FlushCallback = std::function<void(const FlushReport&)>;
+
+    // `capacity` is the number of samples each track can hold
+    explicit MotionRecorder(size_t capacity = 8192) : m_capacity(capacity)
+    {
+    }
+
+    ~MotionRecorder()
+    {
+        wait();
+    }
+
+    MotionRecorder(const MotionRecorder&) = delete;
+    MotionRecorder& operator=(const MotionRecorder&) = delete;
+
+    // Add an attribute to record before start(), `width` is the array length for array types and 1 otherwise
+    size_t addTrack(const PXR_NS::UsdAttribute& attribute, size_t width = 1)
+    {
+        using namespace PXR_NS;
+
+        if (m_recording || !attribute)
+        {
+            return kInvalidTrack;
+        }
+        Track track;
+        track.path = attribute.GetPath();
+        track.type = attribute.GetTypeName();
+        track.width = track.type.IsArray() ? width : 1;
+        track.componentBytes = componentBytes(track.type);
+        if (track.componentBytes == 0 || track.width == 0)
+        {
+            return kInvalidTrack;
+        }
+        m_tracks.push_back(std::move(track));
+        return m_tracks.size() - 1;
+    }
+
+    // Copy an attribute's current value into the recording layer as its default, before start()
+    bool addConstant(const PXR_NS::UsdAttribute& attribute)
+    {
+        using namespace PXR_NS;
+
+        Constant constant;
+        if (m_recording || !attribute || !attribute.Get(&constant.value))
+        {
+            return false;
+        }
+        constant.path = attribute.GetPath();
+        constant.type = attribute.GetTypeName();
+        constant.variability = attribute.GetVariability();
+        m_constants.push_back(std::move(constant));
+        return true;
+    }
+
+    // Allocate the buffers of the added tracks and start the clock
+    void start(double timeCodesPerSecond)
+    {
+        for (Track& track : m_tracks)
+        {
+            track.times.reserve(m_capacity);
+            track.values.reserve(m_capacity * track.width);
+        }
+        m_timeCodesPerSecond = timeCodesPerSecond;
+        m_dropped = 0;
+        m_clock.reset();
+        m_recording = true;
+    }
+
+    bool isRecording() const
+    {
+        return m_recording;
+    }
+
+    // Copy the track's `width` values, stamped with the time since start()
+    template <typename Vec3>
+    bool record(size_t track, const Vec3* values)
+    {
+        if (!m_recording || track >= m_tracks.size())
+        {
+            return false;
+        }
+        Track& target = m_tracks[track];
+        if (target.times.size() == m_capacity)
+        {
+            m_dropped++;
+            return false;
+        }
+        target.times.push_back(m_clock.seconds() * m_timeCodesPerSecond);
+        for (size_t i = 0; i < target.width; i++)
+        {
+            target.values.push_back(PXR_NS::GfVec3d(values[i][0], values[i][1], values[i][2]));
+        }
+        return true;
+    }
+
+    // Stop recording and write the samples to a new layer at `layerPath`, sublayering `stageRootLayer`, on a
+    // background thread. `done` is called on that thread. The tracks and constants are cleared, add them again to
+    // record again.
+    void stop(const std::string& layerPath, const std::string& stageRootLayer, double tolerance, FlushCallback done)
+    {
+        if (!m_recording)
+        {
+            return;
+        }
+        m_recording = false;
+        wait();
+
+        FlushReport report;
+        report.layerPath = layerPath;
+        report.droppedSamples = m_dropped;
+        report.captureSeconds = m_clock.seconds();
+        m_flushThread = std::thread(
+            [tracks = std::move(m_tracks), constants = std::move(m_constants), report, stageRootLayer, tolerance, tcps = m_timeCodesPerSecond, done]() mutable
+            {
+                flush(tracks, constants, report, stageRootLayer, tolerance, tcps);
+                if (done)
+                {
+                    done(report);
+                }
+            }
+        );
+        m_tracks.clear();
+        m_constants.clear();
+    }
+
+    // The recording layer next to a stage, "<stem>_recording.usd"
+    static std::string layerPathFor(const std::string& stageRootLayer)
+    {
+        return PXR_NS::TfStringGetBeforeSuffix(stageRootLayer) + "_recording.usd";
+    }
+
+    // Wait for the last stop() to finish writing
+    void wait()
+    {
+        if (m_flushThread.joinable())
+        {
+            m_flushThread.join();
+        }
+    }
+
+private:
+
+    struct Track
+    {
+        PXR_NS::SdfPath path;
+        PXR_NS::SdfValueTypeName type;
+        size_t width = 1;
+        size_t componentBytes = 0;
+        std::vector<double> times;
+        std::vector<PXR_NS::GfVec3d> values; // `width` per sample
+    };
+
+    struct Constant
+    {
+        PXR_NS::SdfPath path;
+        PXR_NS::SdfValueTypeName type;
+        PXR_NS::SdfVariability variability = PXR_NS::SdfVariabilityVarying;
+        PXR_NS::VtValue value;
+    };
+
+    // The size of one vector of the type, 0 for the types that can't be recorded
+    static size_t componentBytes(const PXR_NS::SdfValueTypeName& type)
+    {
+        using namespace PXR_NS;
+
+        if (type == SdfValueTypeNames->Double3 || type == SdfValueTypeNames->Double3Array)
+        {
+            return sizeof(GfVec3d);
+        }
+        if (type == SdfValueTypeNames->Float3 || type == SdfValueTypeNames->Float3Array)
+        {
+            return sizeof(GfVec3f);
+        }
+        if (type == SdfValueTypeNames->Half3)
+        {
+            return sizeof(GfVec3h);
+        }
+        return 0;
+    }
+
+    // True when the samples between `first` and `last` are within `tolerance` of the line between them
+    static bool fitsLine(const Track& track, size_t first, size_t last, double tolerance)
+    {
+        const double span = track.times[last] - track.times[first];
+        for (size_t sample = first + 1; sample < last; sample++)
+        {
+            const double t = span > 0.0 ? (track.times[sample] - track.times[first]) / span : 0.0;
+            for (size_t i = 0; i < track.width; i++)
+            {
+                const PXR_NS::GfVec3d& a = track.values[first * track.width + i];
+                const PXR_NS::GfVec3d& b = track.values[last * track.width + i];
+                const PXR_NS::GfVec3d& value = track.values[sample * track.width + i];
+                for (size_t c = 0; c < 3; c++)
+                {
+                    if (std::abs(a[c] + (b[c] - a[c]) * t - value[c]) > tolerance)
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // The samples to keep: the first, the last, and each one the line from the previous kept sample can't skip
+    static std::vector<size_t> keyframes(const Track& track, double tolerance)
+    {
+        const size_t count = track.times.size();
+        std::vector<size_t> keys;
+        if (count == 0)
+        {
+            return keys;
+        }
+        keys.push_back(0);
+        size_t anchor = 0;
+        for (size_t sample = 1; sample + 1 < count; sample++)
+        {
+            if (tolerance <= 0.0 || !fitsLine(track, anchor, sample + 1, tolerance))
+            {
+                keys.push_back(sample);
+                anchor = sample;
+            }
+        }
+        if (count > 1)
+        {
+            keys.push_back(count - 1);
+        }
+        return keys;
+    }
+
+    static PXR_NS::VtValue sampleValue(const Track& track, size_t sample)
+    {
+        using namespace PXR_NS;
+
+        const GfVec3d* values = track.values.data() + sample * track.width;
+        if (track.type == SdfValueTypeNames->Double3)
+        {
+            return VtValue(values[0]);
+        }
+        if (track.type == SdfValueTypeNames->Float3)
+        {
+            return VtValue(GfVec3f(values[0]));
+        }
+        if (track.type == SdfValueTypeNames->Half3)
+        {
+            return VtValue(GfVec3h(values[0]));
+        }
+        if (track.type == SdfValueTypeNames->Double3Array)
+        {
+            return VtValue(VtVec3dArray(values, values + track.width));
+        }
+        VtVec3fArray array(track.width);
+        std::transform(values, values + track.width, array.begin(), [](const GfVec3d& value) { return GfVec3f(value); });
+        return VtValue(array);
+    }
+
+    static void flush(
+        const std::vector<Track>& tracks,
+        const std::vector<Constant>& constants,
+        FlushReport& report,
+        const std::string& stageRootLayer,
+        double tolerance,
+        double tcps
+    )
+    {
+        using namespace PXR_NS;
+
+        Stopwatch timer;
+        SdfLayerRefPtr layer = SdfLayer::CreateAnonymous("." + TfGetExtension(report.layerPath));
+        layer->SetDocumentation("Motion recorded over " + stageRootLayer);
+        layer->SetSubLayerPaths({ stageRootLayer });
+        layer->SetTimeCodesPerSecond(tcps);
+        double endTime = 0.0;
+        {
+            SdfChangeBlock changeBlock;
+            for (const Track& track : tracks)
+            {
+                const size_t sampleBytes = sizeof(double) + track.width * track.componentBytes;
+                report.capturedSamples += track.times.size();
+                report.capturedBytes += track.times.size() * sampleBytes;
+                if (track.times.empty())
+                {
+                    continue;
+                }
+                SdfPrimSpecHandle primSpec = SdfCreatePrimInLayer(layer, track.path.GetPrimPath());
+                if (!primSpec || !SdfAttributeSpec::New(primSpec, track.path.GetNameToken(), track.type))
+                {
+                    continue;
+                }
+                for (size_t sample : keyframes(track, tolerance))
+                {
+                    layer->SetTimeSample(track.path, track.times[sample], sampleValue(track, sample));
+                    report.keptSamples++;
+                    report.keptBytes += sampleBytes;
+                }
+                endTime = std::max(endTime, track.times.back());
+            }
+            for (const Constant& constant : constants)
+            {
+                SdfPrimSpecHandle primSpec = SdfCreatePrimInLayer(layer, constant.path.GetPrimPath());
+                SdfAttributeSpecHandle attrSpec =
+                    primSpec ? SdfAttributeSpec::New(primSpec, constant.path.GetNameToken(), constant.type, constant.variability) : SdfAttributeSpecHandle();
+                if (attrSpec)
+                {
+                    attrSpec->SetDefaultValue(constant.value);
+                }
+            }
+        }
+        layer->SetStartTimeCode(0.0);
+        layer->SetEndTimeCode(std::ceil(endTime));
+        report.saved = layer->Export(report.layerPath);
+        report.flushMs = timer.milliseconds();
+    }
+
+    size_t m_capacity;
+    std::vector<Track> m_tracks;
+    std::vector<Constant> m_constants;
+    double m_timeCodesPerSecond = 24.0;
+    size_t m_dropped = 0;
+    bool m_recording = false;
+    Stopwatch m_clock;
+    std::thread m_flushThread;
+};
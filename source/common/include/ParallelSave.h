@@ -0,0 +1,135 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "Stopwatch.h"
+
+#include <pxr/pxr.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/usd/stage.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/*
+Saves the dirty layers of a stage concurrently instead of one after another.
+
+* UsdStage::Save (and omni::connect::core::saveStage) serializes and writes each dirty layer in turn. Every layer is
+    an independent file, so with WorkParallelForN a stage split into sublayers or payload layers saves in about the
+    time of its largest layer.
+* dirtyLayers picks the same layers UsdStage::Save does: dirty, not anonymous, and not in the session layer stack.
+* Each layer's save is timed on its own, so the report shows which layer the save waited on.
+*/
+
+namespace parallelsave
+{
+
+struct LayerTiming
+{
+    std::string identifier;
+    double milliseconds = 0.0;
+    bool saved = false;
+};
+
+struct SaveReport
+{
+    std::vector<LayerTiming> layers; // slowest first
+    double totalMs = 0.0;
+
+    bool ok() const
+    {
+        return std::all_of(layers.begin(), layers.end(), [](const LayerTiming& layer) { return layer.saved; });
+    }
+
+    // The per-layer times added up. The layers were saved at the same time and shared the disk or network, so this is
+    // not what saving them one after another takes.
+    double summedMs() const
+    {
+        double sum = 0.0;
+        for (const LayerTiming& layer : layers)
+        {
+            sum += layer.milliseconds;
+        }
+        return sum;
+    }
+};
+
+inline PXR_NS::SdfLayerHandleVector dirtyLayers(const PXR_NS::UsdStagePtr& stage)
+{
+    using namespace PXR_NS;
+
+    std::unordered_set<const SdfLayer*> sessionLayers;
+    const SdfLayerHandleVector withSession = stage->GetLayerStack(/* includeSessionLayers */ true);
+    const SdfLayerHandleVector withoutSession = stage->GetLayerStack(/* includeSessionLayers */ false);
+    for (const SdfLayerHandle& layer : withSession)
+    {
+        if (std::find(withoutSession.begin(), withoutSession.end(), layer) == withoutSession.end())
+        {
+            sessionLayers.insert(get_pointer(layer));
+        }
+    }
+
+    SdfLayerHandleVector dirty;
+    for (const SdfLayerHandle& layer : stage->GetUsedLayers())
+    {
+        if (layer->IsDirty() && !layer->IsAnonymous() && sessionLayers.count(get_pointer(layer)) == 0)
+        {
+            dirty.push_back(layer);
+        }
+    }
+    return dirty;
+}
+
+// Save the layers that are dirty, each on its own task
+inline SaveReport saveLayers(const PXR_NS::SdfLayerHandleVector& layers)
+{
+    using namespace PXR_NS;
+
+    SaveReport report;
+    SdfLayerHandleVector dirty;
+    for (const SdfLayerHandle& layer : layers)
+    {
+        if (layer && layer->IsDirty())
+        {
+            dirty.push_back(layer);
+        }
+    }
+    report.layers.resize(dirty.size());
+
+    Stopwatch totalTimer;
+    WorkParallelForN(
+        dirty.size(),
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                Stopwatch timer;
+                report.layers[i].identifier = dirty[i]->GetIdentifier();
+                report.layers[i].saved = dirty[i]->Save();
+                report.layers[i].milliseconds = timer.milliseconds();
+            }
+        },
+        1
+    );
+    report.totalMs = totalTimer.milliseconds();
+
+    std::sort(
+        report.layers.begin(),
+        report.layers.end(),
+        [](const LayerTiming& a, const LayerTiming& b) { return a.milliseconds > b.milliseconds; }
+    );
+    return report;
+}
+
+// The parallel replacement for UsdStage::Save
+inline SaveReport saveDirtyLayers(const PXR_NS::UsdStagePtr& stage)
+{
+    return saveLayers(dirtyLayers(stage));
+}
+
+} // namespace parallelsave
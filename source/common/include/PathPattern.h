@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////////////
+// Glob style matching of prim paths, for the commands that select prims with a
+// pattern like "/World/Boxes/box_*" instead of listing each path.
+///////////////////////////////////////////////////////////////////////////////////////
+
+// `*` matches any run of characters and `?` any one character
+inline bool matchesPathPattern(const char* path, const char* pattern)
+{
+    const char* starPattern = nullptr;
+    const char* starPath = nullptr;
+    while (*path)
+    {
+        if (*pattern == '*')
+        {
+            starPattern = pattern++;
+            starPath = path;
+        }
+        else if (*pattern == '?' || *pattern == *path)
+        {
+            pattern++;
+            path++;
+        }
+        else if (starPattern)
+        {
+            pattern = starPattern + 1;
+            path = ++starPath;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (*pattern == '*')
+    {
+        pattern++;
+    }
+    return *pattern == '\0';
+}
@@ -0,0 +1,225 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "Stopwatch.h"
+
+#include <pxr/pxr.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/copyUtils.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/layerUtils.h>
+#include <pxr/usd/sdf/payload.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/relationshipSpec.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+
+#include <iterator>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+A stage writer mode that moves heavy subtrees out of the root layer into payload layers.
+
+* Each subtree is copied at the Sdf level into its own anonymous layer, with the subtree root as the default prim,
+    and the layers are exported in parallel with WorkParallelForN. Exporting is where the time goes (serializing and
+    uploading), the copies are cheap.
+* The subtree root stays in the root layer with its type, metadata, transform, visibility, purpose and extent and
+    gets a payload to its layer. A stage opened with UsdStage::LoadNone reads only the tiny root layer but still
+    shows every subtree in the hierarchy, and bounds where the subtree root authors an extent.
+* A subtree whose relationships or connections target prims outside it stays in the root layer, as those targets
+    would not map through the payload.
+* measureOpenTimes opens a stage with everything loaded and with nothing loaded. The stage being measured must not
+    be open elsewhere in the process, or its layers are already in memory.
+*/
+
+namespace payloadsplit
+{
+
+struct SplitResult
+{
+    size_t payloadCount = 0;
+    PXR_NS::SdfPathVector keptInRoot; // subtrees with targets outside them
+    std::vector<std::string> failed; // payload layers that could not be written
+    double copyMs = 0.0;
+    double writeMs = 0.0;
+};
+
+struct OpenTimes
+{
+    double loadAllMs = 0.0;
+    double loadNoneMs = 0.0;
+    size_t loadAllPrims = 0;
+    size_t loadNonePrims = 0;
+};
+
+// The properties of a subtree root that stay in the root layer, so the unloaded prim is placed and sized correctly
+inline bool staysInRoot(const PXR_NS::TfToken& name)
+{
+    const std::string& text = name.GetString();
+    return PXR_NS::TfStringStartsWith(text, "xformOp") || text == "visibility" || text == "purpose" || text == "extent";
+}
+
+// True when a relationship or attribute connection in the subtree at `root` targets a path outside it
+inline bool hasOutsideTargets(const PXR_NS::SdfLayerHandle& layer, const PXR_NS::SdfPath& root)
+{
+    bool outside = false;
+    layer->Traverse(
+        root,
+        [&](const PXR_NS::SdfPath& path)
+        {
+            if (outside || !path.IsPropertyPath())
+            {
+                return;
+            }
+            PXR_NS::SdfPathVector targets;
+            if (PXR_NS::SdfRelationshipSpecHandle relationship = layer->GetRelationshipAtPath(path))
+            {
+                targets = relationship->GetTargetPathList().GetAddedOrExplicitItems();
+            }
+            else if (PXR_NS::SdfAttributeSpecHandle attribute = layer->GetAttributeAtPath(path))
+            {
+                targets = attribute->GetConnectionPathList().GetAddedOrExplicitItems();
+            }
+            for (const PXR_NS::SdfPath& target : targets)
+            {
+                outside = outside || !target.MakeAbsolutePath(path.GetPrimPath()).HasPrefix(root);
+            }
+        }
+    );
+    return outside;
+}
+
+// Move the subtrees at `roots` (prim paths defined in the stage's root layer) into payload layers named after their
+// paths in `folder`, relative to the root layer, and save the root layer. Nested roots are not supported.
+inline SplitResult splitIntoPayloads(const PXR_NS::UsdStageRefPtr& stage, const PXR_NS::SdfPathVector& roots, const std::string& folder)
+{
+    using namespace PXR_NS;
+
+    SplitResult result;
+    SdfLayerHandle rootLayer = stage->GetRootLayer();
+    std::vector<SdfLayerRefPtr> layers;
+    std::vector<SdfPath> paths;
+    std::vector<std::string> relativePaths;
+
+    Stopwatch copyTimer;
+    for (const SdfPath& root : roots)
+    {
+        SdfPrimSpecHandle spec = rootLayer->GetPrimAtPath(root);
+        if (!spec)
+        {
+            continue;
+        }
+        if (hasOutsideTargets(rootLayer, root))
+        {
+            result.keptInRoot.push_back(root);
+            continue;
+        }
+        SdfLayerRefPtr layer = SdfLayer::CreateAnonymous(".usdc");
+        layer->SetDocumentation("Payload of " + root.GetString());
+        for (const TfToken& key : { TfToken("upAxis"), TfToken("metersPerUnit") })
+        {
+            if (rootLayer->GetPseudoRoot()->HasInfo(key))
+            {
+                layer->GetPseudoRoot()->SetInfo(key, rootLayer->GetPseudoRoot()->GetInfo(key));
+            }
+        }
+        const SdfPath layerRoot = SdfPath::AbsoluteRootPath().AppendChild(root.GetNameToken());
+        if (!SdfCopySpec(rootLayer, root, layer, layerRoot))
+        {
+            result.failed.push_back(root.GetString());
+            continue;
+        }
+        // The subtree root's transform and bounds are only authored in the root layer
+        SdfPrimSpecHandle layerSpec = layer->GetPrimAtPath(layerRoot);
+        for (const SdfPropertySpecHandle& property : layerSpec->GetProperties().values())
+        {
+            if (staysInRoot(property->GetNameToken()))
+            {
+                layerSpec->RemoveProperty(property);
+            }
+        }
+        layer->SetDefaultPrim(layerRoot.GetNameToken());
+        layers.push_back(layer);
+        paths.push_back(root);
+        relativePaths.push_back(folder + "/" + TfStringReplace(root.GetString().substr(1), "/", "_") + ".usdc");
+    }
+    result.copyMs = copyTimer.milliseconds();
+
+    // The payload layers are independent files, so they are serialized and written in parallel
+    Stopwatch writeTimer;
+    std::vector<char> written(layers.size(), 0);
+    WorkParallelForN(
+        layers.size(),
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                written[i] = layers[i]->Export(SdfComputeAssetPathRelativeToLayer(rootLayer, relativePaths[i])) ? 1 : 0;
+            }
+        },
+        1
+    );
+    result.writeMs = writeTimer.milliseconds();
+
+    // Only the subtrees whose layer was written are replaced by payloads
+    {
+        SdfChangeBlock changeBlock;
+        for (size_t i = 0; i < layers.size(); i++)
+        {
+            if (!written[i])
+            {
+                result.failed.push_back(relativePaths[i]);
+                continue;
+            }
+            SdfPrimSpecHandle spec = rootLayer->GetPrimAtPath(paths[i]);
+            spec->SetNameChildren(SdfPrimSpecHandleVector());
+            for (const SdfPropertySpecHandle& property : spec->GetProperties().values())
+            {
+                if (!staysInRoot(property->GetNameToken()))
+                {
+                    spec->RemoveProperty(property);
+                }
+            }
+            spec->GetPayloadList().Prepend(SdfPayload(relativePaths[i]));
+            result.payloadCount++;
+        }
+    }
+    rootLayer->Save();
+    return result;
+}
+
+inline size_t countPrims(const PXR_NS::UsdStageRefPtr& stage)
+{
+    const PXR_NS::UsdPrimRange range = stage ? stage->Traverse() : PXR_NS::UsdPrimRange();
+    return (size_t)std::distance(range.begin(), range.end());
+}
+
+// Open the stage twice, with no payloads loaded and with all of them, and count the prims each time
+inline OpenTimes measureOpenTimes(const std::string& stageUrl)
+{
+    using namespace PXR_NS;
+
+    OpenTimes times;
+    {
+        Stopwatch timer;
+        UsdStageRefPtr stage = UsdStage::Open(stageUrl, UsdStage::LoadNone);
+        times.loadNoneMs = timer.milliseconds();
+        times.loadNonePrims = countPrims(stage);
+    }
+    {
+        Stopwatch timer;
+        UsdStageRefPtr stage = UsdStage::Open(stageUrl, UsdStage::LoadAll);
+        times.loadAllMs = timer.milliseconds();
+        times.loadAllPrims = countPrims(stage);
+    }
+    return times;
+}
+
+} // namespace payloadsplit
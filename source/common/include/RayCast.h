@@ -0,0 +1,527 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "SpatialIndex.h"
+
+#include <pxr/pxr.h>
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/range3d.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xformCache.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+
+/*
+A CPU ray caster for picking and line-of-sight checks against the meshes of a stage.
+
+* Every UsdGeomMesh is fan triangulated from faceVertexCounts / faceVertexIndices into its own MeshBvh, in the mesh's
+    local space, so the triangles don't change when the mesh moves.
+* The triangles are stored as structure of arrays (vertex 0 and two edges, one array per component) in BVH leaf
+    order. The ray/triangle test of a leaf is a branch free loop over contiguous floats that the compiler vectorizes.
+* A PrimBvh over the world bounds of the meshes is the top level. Rays are moved into mesh local space with the
+    inverse world transform, which keeps the hit distance t unchanged.
+* Batches of rays are split across threads with WorkParallelForN, the scene is read only while casting.
+*/
+
+namespace raycast
+{
+
+struct Ray
+{
+    PXR_NS::GfVec3d origin;
+    PXR_NS::GfVec3d direction; // does not need to be normalized, t is in units of its length
+    double tMax = DBL_MAX;
+};
+
+struct Hit
+{
+    double t = DBL_MAX;
+    uint32_t mesh = UINT32_MAX; // index into RayCastScene::meshPaths()
+    uint32_t face = UINT32_MAX; // index of the source face in faceVertexCounts
+    float u = 0.0f;
+    float v = 0.0f;
+
+    bool valid() const
+    {
+        return mesh != UINT32_MAX;
+    }
+};
+
+// Slab test, returns the entry distance or a negative value if the ray misses the box within [0, tMax]
+template<class Vec, class Scalar>
+inline Scalar rayBoxEntry(Vec const& origin, Vec const& invDirection, Scalar const* boxMin, Scalar const* boxMax, Scalar tMax)
+{
+    Scalar tEnter = 0;
+    Scalar tExit = tMax;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        Scalar t0 = (boxMin[axis] - origin[axis]) * invDirection[axis];
+        Scalar t1 = (boxMax[axis] - origin[axis]) * invDirection[axis];
+        tEnter = std::max(tEnter, std::min(t0, t1));
+        tExit = std::min(tExit, std::max(t0, t1));
+    }
+    return tEnter <= tExit ? tEnter : Scalar(-1);
+}
+
+// Division that maps a zero direction component to a huge value instead of inf * 0 = NaN in the slab test
+inline float safeInverse(float v)
+{
+    return std::fabs(v) > 1e-30f ? 1.0f / v : std::copysign(1e30f, v);
+}
+
+inline double safeInverse(double v)
+{
+    return std::fabs(v) > 1e-300 ? 1.0 / v : std::copysign(1e300, v);
+}
+
+class MeshBvh
+{
+public:
+    static constexpr uint32_t kLeafSize = 4;
+
+    // Fan triangulate the faces, skipping faces with fewer than 3 vertices or indices outside the points array.
+    // Returns false if the mesh has no valid triangles.
+    bool build(PXR_NS::VtVec3fArray const& points, PXR_NS::VtIntArray const& faceVertexCounts, PXR_NS::VtIntArray const& faceVertexIndices)
+    {
+        std::vector<uint32_t> corners;
+        std::vector<uint32_t> faces;
+        size_t offset = 0;
+        for (size_t face = 0; face < faceVertexCounts.size(); face++)
+        {
+            const int count = faceVertexCounts[face];
+            if (count < 0 || offset + count > faceVertexIndices.size())
+            {
+                break;
+            }
+            for (int corner = 1; corner + 1 < count; corner++)
+            {
+                const int a = faceVertexIndices[offset];
+                const int b = faceVertexIndices[offset + corner];
+                const int c = faceVertexIndices[offset + corner + 1];
+                if (a < 0 || b < 0 || c < 0 || (size_t)a >= points.size() || (size_t)b >= points.size() || (size_t)c >= points.size())
+                {
+                    continue;
+                }
+                corners.insert(corners.end(), { (uint32_t)a, (uint32_t)b, (uint32_t)c });
+                faces.push_back((uint32_t)face);
+            }
+            offset += count;
+        }
+
+        const size_t triangleCount = faces.size();
+        if (triangleCount == 0)
+        {
+            return false;
+        }
+
+        std::vector<uint32_t> order(triangleCount);
+        std::vector<PXR_NS::GfVec3f> centroids(triangleCount);
+        for (uint32_t i = 0; i < triangleCount; i++)
+        {
+            order[i] = i;
+            centroids[i] = (points[corners[3 * i]] + points[corners[3 * i + 1]] + points[corners[3 * i + 2]]) / 3.0f;
+        }
+        m_nodes.clear();
+        m_nodes.reserve(2 * triangleCount / kLeafSize + 1);
+        buildNode(points, corners, centroids, order, 0, (uint32_t)triangleCount);
+
+        // Store the triangles in leaf order, one array per component
+        for (auto* component : { &m_v0x, &m_v0y, &m_v0z, &m_e1x, &m_e1y, &m_e1z, &m_e2x, &m_e2y, &m_e2z })
+        {
+            component->resize(triangleCount);
+        }
+        m_faces.resize(triangleCount);
+        for (size_t slot = 0; slot < triangleCount; slot++)
+        {
+            const uint32_t tri = order[slot];
+            const PXR_NS::GfVec3f& p0 = points[corners[3 * tri]];
+            const PXR_NS::GfVec3f e1 = points[corners[3 * tri + 1]] - p0;
+            const PXR_NS::GfVec3f e2 = points[corners[3 * tri + 2]] - p0;
+            m_v0x[slot] = p0[0];
+            m_v0y[slot] = p0[1];
+            m_v0z[slot] = p0[2];
+            m_e1x[slot] = e1[0];
+            m_e1y[slot] = e1[1];
+            m_e1z[slot] = e1[2];
+            m_e2x[slot] = e2[0];
+            m_e2y[slot] = e2[1];
+            m_e2z[slot] = e2[2];
+            m_faces[slot] = faces[tri];
+        }
+        return true;
+    }
+
+    // Closest hit along a ray in the mesh's local space, updates `hit` if a closer triangle is found.
+    // With `anyHit` the walk stops at the first triangle hit, which is all a visibility test needs.
+    bool intersect(PXR_NS::GfVec3f const& origin, PXR_NS::GfVec3f const& direction, float tMax, Hit& hit, bool anyHit) const
+    {
+        if (m_nodes.empty())
+        {
+            return false;
+        }
+        const PXR_NS::GfVec3f invDirection(safeInverse(direction[0]), safeInverse(direction[1]), safeInverse(direction[2]));
+        float best = tMax;
+        bool found = false;
+
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const Node& node = m_nodes[stack[--top]];
+            if (rayBoxEntry(origin, invDirection, node.min, node.max, best) < 0.0f)
+            {
+                continue;
+            }
+            if (node.count > 0)
+            {
+                float t[kLeafSize];
+                float u[kLeafSize];
+                float v[kLeafSize];
+                intersectLeaf(origin, direction, node.first, node.count, best, t, u, v);
+                for (uint32_t lane = 0; lane < node.count; lane++)
+                {
+                    if (t[lane] < best)
+                    {
+                        best = t[lane];
+                        hit.t = best;
+                        hit.face = m_faces[node.first + lane];
+                        hit.u = u[lane];
+                        hit.v = v[lane];
+                        found = true;
+                    }
+                }
+                if (found && anyHit)
+                {
+                    return true;
+                }
+            }
+            else
+            {
+                // Visit the nearer child first so the farther one is often culled by the closer hit
+                const uint32_t left = (uint32_t)(&node - m_nodes.data()) + 1;
+                const uint32_t right = node.first;
+                const Node& leftNode = m_nodes[left];
+                const Node& rightNode = m_nodes[right];
+                float leftEntry = rayBoxEntry(origin, invDirection, leftNode.min, leftNode.max, best);
+                float rightEntry = rayBoxEntry(origin, invDirection, rightNode.min, rightNode.max, best);
+                if (leftEntry <= rightEntry)
+                {
+                    stack[top++] = right;
+                    stack[top++] = left;
+                }
+                else
+                {
+                    stack[top++] = left;
+                    stack[top++] = right;
+                }
+            }
+        }
+        return found;
+    }
+
+    size_t triangleCount() const
+    {
+        return m_faces.size();
+    }
+
+    PXR_NS::GfRange3d bounds() const
+    {
+        if (m_nodes.empty())
+        {
+            return PXR_NS::GfRange3d();
+        }
+        const Node& root = m_nodes[0];
+        return PXR_NS::GfRange3d(PXR_NS::GfVec3d(root.min[0], root.min[1], root.min[2]), PXR_NS::GfVec3d(root.max[0], root.max[1], root.max[2]));
+    }
+
+private:
+    struct Node
+    {
+        float min[3];
+        float max[3];
+        uint32_t first; // first triangle of a leaf, or the right child of an inner node (the left child is the next node)
+        uint32_t count; // 0 for inner nodes
+    };
+
+    uint32_t buildNode(
+        PXR_NS::VtVec3fArray const& points,
+        std::vector<uint32_t> const& corners,
+        std::vector<PXR_NS::GfVec3f> const& centroids,
+        std::vector<uint32_t>& order,
+        uint32_t first,
+        uint32_t end
+    )
+    {
+        const uint32_t index = (uint32_t)m_nodes.size();
+        m_nodes.emplace_back();
+
+        Node node;
+        float centerMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float centerMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (int axis = 0; axis < 3; axis++)
+        {
+            node.min[axis] = FLT_MAX;
+            node.max[axis] = -FLT_MAX;
+        }
+        for (uint32_t i = first; i < end; i++)
+        {
+            const uint32_t tri = order[i];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    const float value = points[corners[3 * tri + corner]][axis];
+                    node.min[axis] = std::min(node.min[axis], value);
+                    node.max[axis] = std::max(node.max[axis], value);
+                }
+                centerMin[axis] = std::min(centerMin[axis], centroids[tri][axis]);
+                centerMax[axis] = std::max(centerMax[axis], centroids[tri][axis]);
+            }
+        }
+
+        if (end - first <= kLeafSize)
+        {
+            node.first = first;
+            node.count = end - first;
+            m_nodes[index] = node;
+            return index;
+        }
+
+        const float sx = centerMax[0] - centerMin[0];
+        const float sy = centerMax[1] - centerMin[1];
+        const float sz = centerMax[2] - centerMin[2];
+        const int axis = (sx >= sy && sx >= sz) ? 0 : (sy >= sz ? 1 : 2);
+        const uint32_t middle = first + (end - first) / 2;
+        std::nth_element(
+            order.begin() + first,
+            order.begin() + middle,
+            order.begin() + end,
+            [&centroids, axis](uint32_t a, uint32_t b)
+            {
+                return centroids[a][axis] < centroids[b][axis];
+            }
+        );
+
+        buildNode(points, corners, centroids, order, first, middle);
+        node.first = buildNode(points, corners, centroids, order, middle, end);
+        node.count = 0;
+        m_nodes[index] = node;
+        return index;
+    }
+
+    // Moller-Trumbore over the triangles of one leaf. Misses write FLT_MAX so the caller only compares against t.
+    void intersectLeaf(
+        PXR_NS::GfVec3f const& o,
+        PXR_NS::GfVec3f const& d,
+        uint32_t first,
+        uint32_t count,
+        float tMax,
+        float* tOut,
+        float* uOut,
+        float* vOut
+    ) const
+    {
+        for (uint32_t lane = 0; lane < count; lane++)
+        {
+            const uint32_t i = first + lane;
+            // p = d x e2
+            const float px = d[1] * m_e2z[i] - d[2] * m_e2y[i];
+            const float py = d[2] * m_e2x[i] - d[0] * m_e2z[i];
+            const float pz = d[0] * m_e2y[i] - d[1] * m_e2x[i];
+            const float det = m_e1x[i] * px + m_e1y[i] * py + m_e1z[i] * pz;
+            const float invDet = 1.0f / (std::fabs(det) > 1e-20f ? det : 1e-20f);
+            // s = o - v0
+            const float sx = o[0] - m_v0x[i];
+            const float sy = o[1] - m_v0y[i];
+            const float sz = o[2] - m_v0z[i];
+            const float u = (sx * px + sy * py + sz * pz) * invDet;
+            // q = s x e1
+            const float qx = sy * m_e1z[i] - sz * m_e1y[i];
+            const float qy = sz * m_e1x[i] - sx * m_e1z[i];
+            const float qz = sx * m_e1y[i] - sy * m_e1x[i];
+            const float v = (d[0] * qx + d[1] * qy + d[2] * qz) * invDet;
+            const float t = (m_e2x[i] * qx + m_e2y[i] * qy + m_e2z[i] * qz) * invDet;
+            const bool valid = std::fabs(det) > 1e-20f && u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < tMax;
+            tOut[lane] = valid ? t : FLT_MAX;
+            uOut[lane] = u;
+            vOut[lane] = v;
+        }
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<float> m_v0x, m_v0y, m_v0z;
+    std::vector<float> m_e1x, m_e1y, m_e1z;
+    std::vector<float> m_e2x, m_e2y, m_e2z;
+    std::vector<uint32_t> m_faces;
+};
+
+class RayCastScene
+{
+public:
+    // Triangulate and index every visible mesh on the stage (including meshes inside instances), in parallel
+    void build(PXR_NS::UsdStageRefPtr const& stage, PXR_NS::UsdTimeCode time = PXR_NS::UsdTimeCode::Default())
+    {
+        std::vector<PXR_NS::UsdPrim> prims;
+        for (PXR_NS::UsdPrim const& prim : stage->Traverse(PXR_NS::UsdTraverseInstanceProxies()))
+        {
+            if (prim.IsA<PXR_NS::UsdGeomMesh>())
+            {
+                prims.push_back(prim);
+            }
+        }
+
+        std::vector<MeshBvh> meshes(prims.size());
+        std::vector<PXR_NS::GfMatrix4d> worldTransforms(prims.size());
+        std::vector<char> valid(prims.size(), 0);
+        PXR_NS::WorkParallelForN(
+            prims.size(),
+            [&](size_t begin, size_t end)
+            {
+                PXR_NS::UsdGeomXformCache xformCache(time);
+                for (size_t i = begin; i < end; ++i)
+                {
+                    PXR_NS::UsdGeomMesh mesh(prims[i]);
+                    if (mesh.ComputeVisibility(time) == PXR_NS::UsdGeomTokens->invisible)
+                    {
+                        continue;
+                    }
+                    PXR_NS::VtVec3fArray points;
+                    PXR_NS::VtIntArray counts;
+                    PXR_NS::VtIntArray indices;
+                    mesh.GetPointsAttr().Get(&points, time);
+                    mesh.GetFaceVertexCountsAttr().Get(&counts, time);
+                    mesh.GetFaceVertexIndicesAttr().Get(&indices, time);
+                    if (meshes[i].build(points, counts, indices))
+                    {
+                        worldTransforms[i] = xformCache.GetLocalToWorldTransform(prims[i]);
+                        valid[i] = 1;
+                    }
+                }
+            }
+        );
+
+        m_meshes.clear();
+        m_paths.clear();
+        m_toLocal.clear();
+        std::vector<PXR_NS::GfRange3d> worldBounds;
+        for (size_t i = 0; i < prims.size(); i++)
+        {
+            if (!valid[i])
+            {
+                continue;
+            }
+            worldBounds.push_back(PXR_NS::GfBBox3d(meshes[i].bounds(), worldTransforms[i]).ComputeAlignedRange());
+            m_meshes.push_back(std::move(meshes[i]));
+            m_paths.push_back(prims[i].GetPath());
+            m_toLocal.push_back(worldTransforms[i].GetInverse());
+        }
+        m_topLevel.build(worldBounds);
+    }
+
+    Hit intersect(Ray const& ray, bool anyHit = false) const
+    {
+        Hit hit;
+        hit.t = ray.tMax;
+        const PXR_NS::GfVec3d invDirection(safeInverse(ray.direction[0]), safeInverse(ray.direction[1]), safeInverse(ray.direction[2]));
+        m_topLevel.traverse(
+            [&ray, &invDirection, &hit, anyHit](PXR_NS::GfRange3d const& box)
+            {
+                if (anyHit && hit.valid())
+                {
+                    return false;
+                }
+                return rayBoxEntry(ray.origin, invDirection, box.GetMin().data(), box.GetMax().data(), hit.t) >= 0.0;
+            },
+            [this, &ray, &hit, anyHit](uint32_t mesh)
+            {
+                if (anyHit && hit.valid())
+                {
+                    return;
+                }
+                // An affine transform keeps t the same in both spaces because the direction is not renormalized
+                const PXR_NS::GfVec3f origin(m_toLocal[mesh].Transform(ray.origin));
+                const PXR_NS::GfVec3f direction(m_toLocal[mesh].TransformDir(ray.direction));
+                const float tMax = (float)std::min(hit.t, (double)FLT_MAX);
+                if (m_meshes[mesh].intersect(origin, direction, tMax, hit, anyHit))
+                {
+                    hit.mesh = mesh;
+                }
+            }
+        );
+        return hit;
+    }
+
+    // Cast every ray in parallel, hits[i] belongs to rays[i]
+    void intersect(std::vector<Ray> const& rays, std::vector<Hit>& hits, bool anyHit = false) const
+    {
+        hits.resize(rays.size());
+        PXR_NS::WorkParallelForN(
+            rays.size(),
+            [this, &rays, &hits, anyHit](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    hits[i] = intersect(rays[i], anyHit);
+                }
+            }
+        );
+    }
+
+    // True if nothing blocks the segment between two points
+    bool visible(PXR_NS::GfVec3d const& from, PXR_NS::GfVec3d const& to) const
+    {
+        Ray ray;
+        ray.origin = from;
+        ray.direction = to - from;
+        ray.tMax = 1.0 - 1e-6;
+        return !intersect(ray, true).valid();
+    }
+
+    PXR_NS::GfVec3d hitPoint(Ray const& ray, Hit const& hit) const
+    {
+        return ray.origin + ray.direction * hit.t;
+    }
+
+    std::vector<PXR_NS::SdfPath> const& meshPaths() const
+    {
+        return m_paths;
+    }
+
+    size_t triangleCount() const
+    {
+        size_t count = 0;
+        for (MeshBvh const& mesh : m_meshes)
+        {
+            count += mesh.triangleCount();
+        }
+        return count;
+    }
+
+    PXR_NS::GfRange3d bounds() const
+    {
+        return m_topLevel.bounds();
+    }
+
+private:
+    std::vector<MeshBvh> m_meshes;
+    std::vector<PXR_NS::SdfPath> m_paths;
+    std::vector<PXR_NS::GfMatrix4d> m_toLocal;
+    PrimBvh m_topLevel;
+};
+
+} // namespace raycast
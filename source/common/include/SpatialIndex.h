@@ -0,0 +1,448 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <pxr/pxr.h>
+#include <pxr/base/gf/bbox3d.h>
+#include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/range3d.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/bboxCache.h>
+#include <pxr/usd/usdGeom/boundable.h>
+#include <pxr/usd/usdGeom/tokens.h>
+
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+/*
+PrimBvh is a bounding volume hierarchy over a fixed set of world-space boxes.
+
+* Nodes are stored depth first: an inner node's left child is the next node and its right child is at `right`,
+    so a reverse walk over the node array visits children before parents. That makes a refit one linear pass.
+* Leaves hold up to kLeafSize items. Items are split at the median of the longest axis of their centers.
+* Queries return item indices; the owner maps them back to prims.
+*/
+class PrimBvh
+{
+public:
+    static constexpr uint32_t kLeafSize = 4;
+
+    void build(std::vector<PXR_NS::GfRange3d> const& boxes)
+    {
+        m_boxes = boxes;
+        m_nodes.clear();
+        m_order.resize(m_boxes.size());
+        for (uint32_t i = 0; i < m_order.size(); i++)
+        {
+            m_order[i] = i;
+        }
+        m_centers.resize(m_boxes.size());
+        for (size_t i = 0; i < m_boxes.size(); i++)
+        {
+            m_centers[i] = m_boxes[i].IsEmpty() ? PXR_NS::GfVec3d(0.0) : m_boxes[i].GetMidpoint();
+        }
+        if (!m_boxes.empty())
+        {
+            m_nodes.reserve(2 * m_boxes.size() / kLeafSize + 1);
+            buildNode(0, (uint32_t)m_boxes.size());
+        }
+        m_centers.clear();
+        m_centers.shrink_to_fit();
+    }
+
+    // Replace the box of one item, call refit() once all boxes are updated
+    void setBox(uint32_t item, PXR_NS::GfRange3d const& box)
+    {
+        m_boxes[item] = box;
+    }
+
+    // Recompute every node box from the item boxes without changing the tree shape.
+    // Refits are much cheaper than rebuilds but the tree gets looser as items move far from where they were built.
+    void refit()
+    {
+        for (size_t n = m_nodes.size(); n-- > 0;)
+        {
+            Node& node = m_nodes[n];
+            if (node.count > 0)
+            {
+                node.box = PXR_NS::GfRange3d();
+                for (uint32_t i = node.first; i < node.first + node.count; i++)
+                {
+                    node.box.UnionWith(m_boxes[m_order[i]]);
+                }
+            }
+            else
+            {
+                node.box = PXR_NS::GfRange3d::GetUnion(m_nodes[n + 1].box, m_nodes[node.right].box);
+            }
+        }
+    }
+
+    void queryBox(PXR_NS::GfRange3d const& region, std::vector<uint32_t>& items) const
+    {
+        query(
+            [&region](PXR_NS::GfRange3d const& box)
+            {
+                return !PXR_NS::GfRange3d::GetIntersection(box, region).IsEmpty();
+            },
+            items
+        );
+    }
+
+    void querySphere(PXR_NS::GfVec3d const& center, double radius, std::vector<uint32_t>& items) const
+    {
+        query(
+            [&center, radius](PXR_NS::GfRange3d const& box)
+            {
+                // Squared distance from the center to the closest point of the box
+                double distance = 0.0;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    double v = std::max(box.GetMin()[axis] - center[axis], std::max(0.0, center[axis] - box.GetMax()[axis]));
+                    distance += v * v;
+                }
+                return distance <= radius * radius;
+            },
+            items
+        );
+    }
+
+    void queryFrustum(PXR_NS::GfFrustum const& frustum, std::vector<uint32_t>& items) const
+    {
+        query(
+            [&frustum](PXR_NS::GfRange3d const& box)
+            {
+                return frustum.Intersects(PXR_NS::GfBBox3d(box));
+            },
+            items
+        );
+    }
+
+    // Descend into every node whose box `enter` accepts and call `visit` with each item of the leaves reached.
+    // `enter` is called again for every node, so it may tighten its test as items are visited (e.g. a ray's closest hit).
+    template<class Enter, class Visit>
+    void traverse(Enter&& enter, Visit&& visit) const
+    {
+        if (m_nodes.empty())
+        {
+            return;
+        }
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            uint32_t index = stack[--top];
+            Node const& node = m_nodes[index];
+            if (node.box.IsEmpty() || !enter(node.box))
+            {
+                continue;
+            }
+            if (node.count > 0)
+            {
+                for (uint32_t i = node.first; i < node.first + node.count; i++)
+                {
+                    visit(m_order[i]);
+                }
+            }
+            else
+            {
+                // Median splits keep the depth at log2(n / kLeafSize), far below the stack size
+                stack[top++] = node.right;
+                stack[top++] = index + 1;
+            }
+        }
+    }
+
+    PXR_NS::GfRange3d const& box(uint32_t item) const
+    {
+        return m_boxes[item];
+    }
+
+    size_t size() const
+    {
+        return m_boxes.size();
+    }
+
+    size_t nodeCount() const
+    {
+        return m_nodes.size();
+    }
+
+    PXR_NS::GfRange3d bounds() const
+    {
+        return m_nodes.empty() ? PXR_NS::GfRange3d() : m_nodes[0].box;
+    }
+
+private:
+    struct Node
+    {
+        PXR_NS::GfRange3d box;
+        uint32_t first = 0;
+        uint32_t count = 0; // 0 for inner nodes
+        uint32_t right = 0;
+    };
+
+    uint32_t buildNode(uint32_t first, uint32_t end)
+    {
+        uint32_t index = (uint32_t)m_nodes.size();
+        m_nodes.emplace_back();
+
+        PXR_NS::GfRange3d box;
+        PXR_NS::GfRange3d centers;
+        for (uint32_t i = first; i < end; i++)
+        {
+            box.UnionWith(m_boxes[m_order[i]]);
+            centers.UnionWith(m_centers[m_order[i]]);
+        }
+        m_nodes[index].box = box;
+
+        if (end - first <= kLeafSize)
+        {
+            m_nodes[index].first = first;
+            m_nodes[index].count = end - first;
+            return index;
+        }
+
+        PXR_NS::GfVec3d size = centers.GetSize();
+        int axis = (size[0] >= size[1] && size[0] >= size[2]) ? 0 : (size[1] >= size[2] ? 1 : 2);
+        uint32_t middle = first + (end - first) / 2;
+        std::nth_element(
+            m_order.begin() + first,
+            m_order.begin() + middle,
+            m_order.begin() + end,
+            [this, axis](uint32_t a, uint32_t b)
+            {
+                return m_centers[a][axis] < m_centers[b][axis];
+            }
+        );
+
+        buildNode(first, middle);
+        uint32_t right = buildNode(middle, end);
+        m_nodes[index].right = right;
+        return index;
+    }
+
+    template<class Overlaps>
+    void query(Overlaps&& overlaps, std::vector<uint32_t>& items) const
+    {
+        items.clear();
+        traverse(
+            overlaps,
+            [this, &overlaps, &items](uint32_t item)
+            {
+                if (!m_boxes[item].IsEmpty() && overlaps(m_boxes[item]))
+                {
+                    items.push_back(item);
+                }
+            }
+        );
+    }
+
+    std::vector<PXR_NS::GfRange3d> m_boxes;
+    std::vector<PXR_NS::GfVec3d> m_centers;
+    std::vector<uint32_t> m_order;
+    std::vector<Node> m_nodes;
+};
+
+/*
+StageSpatialIndex keeps a PrimBvh of the world bounds of every boundable prim on a stage.
+
+* rebuild() computes all bounds in parallel, one UsdGeomBBoxCache per task, and builds a new tree.
+* Transform, extent, points and visibility edits reported by UsdNotice::ObjectsChanged mark the prims below the edited
+    prim as dirty. The next update() (every query calls it) recomputes just those bounds and refits the tree.
+* A resync (prims added, removed or recomposed) changes the set of items and triggers a full rebuild instead.
+*/
+class StageSpatialIndex : public PXR_NS::TfWeakBase
+{
+public:
+    explicit StageSpatialIndex(PXR_NS::UsdStageRefPtr const& stage, PXR_NS::UsdTimeCode time = PXR_NS::UsdTimeCode::Default())
+        : m_stage(stage)
+        , m_time(time)
+    {
+        m_noticeKey =
+            PXR_NS::TfNotice::Register(PXR_NS::TfCreateWeakPtr(this), &StageSpatialIndex::onObjectsChanged, PXR_NS::UsdStageWeakPtr(stage));
+    }
+
+    ~StageSpatialIndex()
+    {
+        PXR_NS::TfNotice::Revoke(m_noticeKey);
+    }
+
+    StageSpatialIndex(StageSpatialIndex const&) = delete;
+    StageSpatialIndex& operator=(StageSpatialIndex const&) = delete;
+
+    void rebuild()
+    {
+        m_paths.clear();
+        for (PXR_NS::UsdPrim const& prim : m_stage->Traverse())
+        {
+            if (prim.IsA<PXR_NS::UsdGeomBoundable>())
+            {
+                m_paths.push_back(prim.GetPath());
+            }
+        }
+        // Sorted paths keep every subtree contiguous, so a dirty prim maps to one range of items
+        std::sort(m_paths.begin(), m_paths.end());
+
+        std::vector<PXR_NS::GfRange3d> boxes(m_paths.size());
+        std::vector<uint32_t> all(m_paths.size());
+        for (uint32_t i = 0; i < all.size(); i++)
+        {
+            all[i] = i;
+        }
+        computeBounds(all, boxes);
+        m_bvh.build(boxes);
+
+        m_needsRebuild = false;
+        m_dirtyPrims.clear();
+    }
+
+    // Bring the index up to date with the stage, returns true if anything was recomputed
+    bool update()
+    {
+        if (m_needsRebuild)
+        {
+            rebuild();
+            return true;
+        }
+        if (m_dirtyPrims.empty())
+        {
+            return false;
+        }
+
+        std::vector<uint32_t> dirty;
+        for (PXR_NS::SdfPath const& prim : m_dirtyPrims)
+        {
+            for (auto it = std::lower_bound(m_paths.begin(), m_paths.end(), prim); it != m_paths.end() && it->HasPrefix(prim); ++it)
+            {
+                dirty.push_back((uint32_t)(it - m_paths.begin()));
+            }
+        }
+        m_dirtyPrims.clear();
+        std::sort(dirty.begin(), dirty.end());
+        dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+        std::vector<PXR_NS::GfRange3d> boxes(m_paths.size());
+        computeBounds(dirty, boxes);
+        for (uint32_t item : dirty)
+        {
+            m_bvh.setBox(item, boxes[item]);
+        }
+        m_bvh.refit();
+        return true;
+    }
+
+    void queryBox(PXR_NS::GfRange3d const& region, std::vector<PXR_NS::SdfPath>& prims)
+    {
+        update();
+        m_bvh.queryBox(region, m_items);
+        toPaths(prims);
+    }
+
+    void querySphere(PXR_NS::GfVec3d const& center, double radius, std::vector<PXR_NS::SdfPath>& prims)
+    {
+        update();
+        m_bvh.querySphere(center, radius, m_items);
+        toPaths(prims);
+    }
+
+    void queryFrustum(PXR_NS::GfFrustum const& frustum, std::vector<PXR_NS::SdfPath>& prims)
+    {
+        update();
+        m_bvh.queryFrustum(frustum, m_items);
+        toPaths(prims);
+    }
+
+    // Refit every node without recomputing any prim bounds
+    void refit()
+    {
+        m_bvh.refit();
+    }
+
+    PrimBvh const& bvh() const
+    {
+        return m_bvh;
+    }
+
+    PXR_NS::SdfPath const& path(uint32_t item) const
+    {
+        return m_paths[item];
+    }
+
+private:
+    // Fill boxes[item] for each listed item, in parallel with one bounding box cache per task
+    void computeBounds(std::vector<uint32_t> const& items, std::vector<PXR_NS::GfRange3d>& boxes) const
+    {
+        PXR_NS::TfTokenVector const purposes = { PXR_NS::UsdGeomTokens->default_, PXR_NS::UsdGeomTokens->render };
+        PXR_NS::WorkParallelForN(
+            items.size(),
+            [this, &items, &boxes, &purposes](size_t begin, size_t end)
+            {
+                PXR_NS::UsdGeomBBoxCache cache(m_time, purposes);
+                for (size_t i = begin; i < end; ++i)
+                {
+                    PXR_NS::UsdPrim prim = m_stage->GetPrimAtPath(m_paths[items[i]]);
+                    boxes[items[i]] = prim ? cache.ComputeWorldBound(prim).ComputeAlignedRange() : PXR_NS::GfRange3d();
+                }
+            }
+        );
+    }
+
+    void toPaths(std::vector<PXR_NS::SdfPath>& prims) const
+    {
+        prims.clear();
+        prims.reserve(m_items.size());
+        for (uint32_t item : m_items)
+        {
+            prims.push_back(m_paths[item]);
+        }
+    }
+
+    static bool affectsBounds(PXR_NS::TfToken const& propertyName)
+    {
+        return PXR_NS::TfStringStartsWith(propertyName.GetString(), "xformOp") || propertyName == PXR_NS::UsdGeomTokens->extent ||
+            propertyName == PXR_NS::UsdGeomTokens->points || propertyName == PXR_NS::UsdGeomTokens->visibility;
+    }
+
+    void onObjectsChanged(PXR_NS::UsdNotice::ObjectsChanged const& notice, PXR_NS::UsdStageWeakPtr const& /* sender */)
+    {
+        if (m_needsRebuild)
+        {
+            return;
+        }
+        if (!notice.GetResyncedPaths().empty())
+        {
+            m_needsRebuild = true;
+            return;
+        }
+        for (PXR_NS::SdfPath const& path : notice.GetChangedInfoOnlyPaths())
+        {
+            if (path.IsPropertyPath() && affectsBounds(path.GetNameToken()))
+            {
+                m_dirtyPrims.push_back(path.GetPrimPath());
+            }
+        }
+    }
+
+    PXR_NS::UsdStageRefPtr m_stage;
+    PXR_NS::UsdTimeCode m_time;
+    PXR_NS::TfNotice::Key m_noticeKey;
+
+    std::vector<PXR_NS::SdfPath> m_paths;
+    PrimBvh m_bvh;
+    std::vector<uint32_t> m_items;
+
+    bool m_needsRebuild = true;
+    std::vector<PXR_NS::SdfPath> m_dirtyPrims;
+};
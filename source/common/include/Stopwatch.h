@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <chrono>
+
+// A monotonic timer for the throughput numbers the samples report
+class Stopwatch
+{
+public:
+
+    Stopwatch() : m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    void reset()
+    {
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    double seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    double milliseconds() const
+    {
+        return seconds() * 1000.0;
+    }
+
+private:
+
+    std::chrono::steady_clock::time_point m_start;
+};
@@ -0,0 +1,367 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <omni/connect/core/XformAlgo.h>
+
+#include <pxr/pxr.h>
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/gf/vec3h.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/usd/editTarget.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/timeCode.h>
+#include <pxr/usd/usdGeom/xformable.h>
+#include <pxr/usd/usdGeom/xformOp.h>
+
+#include <vector>
+
+/*
+Writes the local transforms of many prims per call, for animation streaming and layout tools.
+
+* omni::connect::core::setLocalTransform reads and validates the prim's xformOpOrder and looks up its ops on every
+    call. The writer resolves each prim's ops once, when it is constructed, and keeps the attribute specs they are
+    authored on in the stage's edit target layer.
+* write() takes one TRS or one matrix per prim and sets the cached specs directly, as defaults or as time samples,
+    inside one SdfChangeBlock, so the stage processes a single change notice per call instead of one per attribute.
+* In TRS layout a prim keeps its translate, rotate (any three axis order) and scale ops,
+    and its pivot ops if it has them, as authored by setLocalTransform. Prims with any other op stack, and every
+    prim in matrix layout that does not have exactly one transform op, get a new stack when the writer is built,
+    which starts out at the prim's current local transform and keeps its resetXformStack.
+* The prims must not be removed and their op stacks must not be changed by others while the writer is in use.
+*/
+class TransformWriter
+{
+public:
+
+    enum class Layout
+    {
+        eTrs,
+        eMatrix,
+    };
+
+    struct Trs
+    {
+        PXR_NS::GfVec3d translate = PXR_NS::GfVec3d(0.0);
+        PXR_NS::GfVec3f rotate = PXR_NS::GfVec3f(0.0f); // degrees about X, Y and Z, applied in the rotate op's order
+        PXR_NS::GfVec3f scale = PXR_NS::GfVec3f(1.0f);
+    };
+
+    TransformWriter(const PXR_NS::UsdStagePtr& stage, const PXR_NS::SdfPathVector& primPaths, Layout layout)
+        : m_layout(layout), m_layer(stage->GetEditTarget().GetLayer())
+    {
+        using namespace PXR_NS;
+
+        const UsdEditTarget editTarget = stage->GetEditTarget();
+        m_entries.resize(primPaths.size());
+        for (size_t i = 0; i < primPaths.size(); i++)
+        {
+            UsdGeomXformable xformable(stage->GetPrimAtPath(primPaths[i]));
+            if (!xformable)
+            {
+                continue;
+            }
+            std::vector<UsdGeomXformOp> ops = layout == Layout::eTrs ? resolveTrsOps(xformable) : resolveMatrixOp(xformable);
+            Entry& entry = m_entries[i];
+            entry.valid = ops.size() == (layout == Layout::eTrs ? 3 : 1);
+            for (size_t op = 0; op < ops.size(); op++)
+            {
+                entry.slots[op] = makeSlot(editTarget, ops[op].GetAttr());
+                entry.attrs[op] = ops[op].GetAttr();
+                entry.valid = entry.valid && entry.slots[op].spec;
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    // The prims whose ops could not be resolved, for example because the path is not an Xformable
+    bool isValid(size_t index) const
+    {
+        return m_entries[index].valid;
+    }
+
+    // True when the stage edits another layer now, or another client removed one of the specs the writer sets.
+    // Build a new writer then, writing through an expired spec would be a fatal error.
+    bool isExpired(const PXR_NS::UsdStagePtr& stage) const
+    {
+        if (!m_layer || stage->GetEditTarget().GetLayer() != m_layer)
+        {
+            return true;
+        }
+        const size_t slotCount = m_layout == Layout::eTrs ? 3 : 1;
+        for (const Entry& entry : m_entries)
+        {
+            for (size_t op = 0; entry.valid && op < slotCount; op++)
+            {
+                if (!entry.slots[op].spec)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // A prim's op attribute: translate, rotate or scale in TRS layout, the transform in matrix layout
+    PXR_NS::UsdAttribute attribute(size_t index, size_t op) const
+    {
+        return m_entries[index].attrs[op];
+    }
+
+    // Read back a prim's TRS through the cached attributes
+    bool read(size_t index, Trs& trs, PXR_NS::UsdTimeCode time = PXR_NS::UsdTimeCode::Default()) const
+    {
+        const Entry& entry = m_entries[index];
+        if (m_layout != Layout::eTrs || !entry.valid)
+        {
+            return false;
+        }
+        PXR_NS::VtValue value;
+        if (entry.attrs[0].Get(&value, time))
+        {
+            trs.translate = toVec3d(value);
+        }
+        if (entry.attrs[1].Get(&value, time))
+        {
+            trs.rotate = PXR_NS::GfVec3f(toVec3d(value));
+        }
+        if (entry.attrs[2].Get(&value, time))
+        {
+            trs.scale = PXR_NS::GfVec3f(toVec3d(value));
+        }
+        return true;
+    }
+
+    // One TRS per prim, in the order of the paths the writer was built with
+    bool write(const std::vector<Trs>& values, PXR_NS::UsdTimeCode time = PXR_NS::UsdTimeCode::Default())
+    {
+        if (m_layout != Layout::eTrs || values.size() != m_entries.size())
+        {
+            return false;
+        }
+        PXR_NS::SdfChangeBlock changeBlock;
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            const Entry& entry = m_entries[i];
+            if (entry.valid)
+            {
+                setVec3(entry.slots[0], values[i].translate, time);
+                setVec3(entry.slots[1], PXR_NS::GfVec3d(values[i].rotate), time);
+                setVec3(entry.slots[2], PXR_NS::GfVec3d(values[i].scale), time);
+            }
+        }
+        return true;
+    }
+
+    // One local matrix per prim, in the order of the paths the writer was built with
+    bool write(const std::vector<PXR_NS::GfMatrix4d>& matrices, PXR_NS::UsdTimeCode time = PXR_NS::UsdTimeCode::Default())
+    {
+        if (m_layout != Layout::eMatrix || matrices.size() != m_entries.size())
+        {
+            return false;
+        }
+        PXR_NS::SdfChangeBlock changeBlock;
+        for (size_t i = 0; i < matrices.size(); i++)
+        {
+            if (m_entries[i].valid)
+            {
+                setValue(m_entries[i].slots[0], PXR_NS::VtValue(matrices[i]), time);
+            }
+        }
+        return true;
+    }
+
+private:
+
+    struct Slot
+    {
+        PXR_NS::SdfAttributeSpecHandle spec;
+        PXR_NS::SdfPath path;
+        PXR_NS::SdfValueTypeName type;
+    };
+
+    struct Entry
+    {
+        Slot slots[3];
+        PXR_NS::UsdAttribute attrs[3];
+        bool valid = false;
+    };
+
+    // translate, rotate and scale, reusing the ops setLocalTransform authors, or a new stack of them that keeps the
+    // prim's current local transform
+    static std::vector<PXR_NS::UsdGeomXformOp> resolveTrsOps(PXR_NS::UsdGeomXformable& xformable)
+    {
+        using namespace PXR_NS;
+
+        bool resetsStack = false;
+        const std::vector<UsdGeomXformOp> ops = xformable.GetOrderedXformOps(&resetsStack);
+        UsdGeomXformOp translate;
+        UsdGeomXformOp rotate;
+        UsdGeomXformOp scale;
+        bool reusable = !ops.empty();
+        for (const UsdGeomXformOp& op : ops)
+        {
+            const UsdGeomXformOp::Type type = op.GetOpType();
+            const bool isPivot = type == UsdGeomXformOp::TypeTranslate && op.HasSuffix(TfToken("pivot"));
+            if (type == UsdGeomXformOp::TypeTranslate && !isPivot && !translate && !op.IsInverseOp())
+            {
+                translate = op;
+            }
+            else if (type >= UsdGeomXformOp::TypeRotateXYZ && type <= UsdGeomXformOp::TypeRotateZYX && !rotate && !op.IsInverseOp())
+            {
+                rotate = op;
+            }
+            else if (type == UsdGeomXformOp::TypeScale && !scale && !op.IsInverseOp())
+            {
+                scale = op;
+            }
+            else if (!isPivot)
+            {
+                reusable = false;
+            }
+        }
+        if (reusable && translate && rotate && scale)
+        {
+            return { translate, rotate, scale };
+        }
+        GfVec3d position(0.0);
+        GfVec3d pivot(0.0);
+        GfVec3f rotation(0.0f);
+        omni::connect::core::RotationOrder rotationOrder = omni::connect::core::RotationOrder::eXyz;
+        GfVec3f scaling(1.0f);
+        omni::connect::core::getLocalTransformComponents(xformable.GetPrim(), position, pivot, rotation, rotationOrder, scaling);
+        omni::connect::core::setLocalTransform(xformable.GetPrim(), position, pivot, rotation, rotationOrder, scaling);
+        xformable.SetResetXformStack(resetsStack);
+        for (const UsdGeomXformOp& op : xformable.GetOrderedXformOps(&resetsStack))
+        {
+            const UsdGeomXformOp::Type type = op.GetOpType();
+            if (type == UsdGeomXformOp::TypeTranslate && !op.HasSuffix(TfToken("pivot")))
+            {
+                translate = op;
+            }
+            else if (type >= UsdGeomXformOp::TypeRotateXYZ && type <= UsdGeomXformOp::TypeRotateZYX)
+            {
+                rotate = op;
+            }
+            else if (type == UsdGeomXformOp::TypeScale)
+            {
+                scale = op;
+            }
+        }
+        if (!translate || !rotate || !scale)
+        {
+            return {};
+        }
+        return { translate, rotate, scale };
+    }
+
+    static std::vector<PXR_NS::UsdGeomXformOp> resolveMatrixOp(PXR_NS::UsdGeomXformable& xformable)
+    {
+        using namespace PXR_NS;
+
+        bool resetsStack = false;
+        const std::vector<UsdGeomXformOp> ops = xformable.GetOrderedXformOps(&resetsStack);
+        if (ops.size() == 1 && ops[0].GetOpType() == UsdGeomXformOp::TypeTransform && !ops[0].IsInverseOp())
+        {
+            return ops;
+        }
+        // Keep the prim where it is, the new op starts out as the matrix of the stack it replaces
+        GfMatrix4d localTransform(1.0);
+        xformable.GetLocalTransformation(&localTransform, &resetsStack);
+        xformable.ClearXformOpOrder();
+        UsdGeomXformOp transform = xformable.AddTransformOp(UsdGeomXformOp::PrecisionDouble);
+        if (!transform)
+        {
+            return {};
+        }
+        transform.Set(localTransform);
+        xformable.SetResetXformStack(resetsStack);
+        return { transform };
+    }
+
+    // The op attribute's spec in the edit target layer, created without a value if the layer has none
+    Slot makeSlot(const PXR_NS::UsdEditTarget& editTarget, const PXR_NS::UsdAttribute& attr) const
+    {
+        using namespace PXR_NS;
+
+        Slot slot;
+        slot.path = editTarget.MapToSpecPath(attr.GetPath());
+        slot.type = attr.GetTypeName();
+        slot.spec = m_layer->GetAttributeAtPath(slot.path);
+        if (!slot.spec)
+        {
+            SdfPrimSpecHandle primSpec = SdfCreatePrimInLayer(m_layer, slot.path.GetPrimPath());
+            slot.spec = primSpec ? SdfAttributeSpec::New(primSpec, slot.path.GetNameToken(), slot.type) : SdfAttributeSpecHandle();
+        }
+        return slot;
+    }
+
+    static PXR_NS::GfVec3d toVec3d(const PXR_NS::VtValue& value)
+    {
+        using namespace PXR_NS;
+
+        if (value.IsHolding<GfVec3d>())
+        {
+            return value.UncheckedGet<GfVec3d>();
+        }
+        if (value.IsHolding<GfVec3f>())
+        {
+            return GfVec3d(value.UncheckedGet<GfVec3f>());
+        }
+        if (value.IsHolding<GfVec3h>())
+        {
+            return GfVec3d(value.UncheckedGet<GfVec3h>());
+        }
+        return GfVec3d(0.0);
+    }
+
+    // Cast to the op's precision, a value of the wrong type would be rejected by the spec
+    void setVec3(const Slot& slot, const PXR_NS::GfVec3d& value, PXR_NS::UsdTimeCode time)
+    {
+        using namespace PXR_NS;
+
+        if (slot.type == SdfValueTypeNames->Double3)
+        {
+            setValue(slot, VtValue(value), time);
+        }
+        else if (slot.type == SdfValueTypeNames->Float3)
+        {
+            setValue(slot, VtValue(GfVec3f(value)), time);
+        }
+        else if (slot.type == SdfValueTypeNames->Half3)
+        {
+            setValue(slot, VtValue(GfVec3h(value)), time);
+        }
+    }
+
+    void setValue(const Slot& slot, const PXR_NS::VtValue& value, PXR_NS::UsdTimeCode time)
+    {
+        if (!slot.spec)
+        {
+            return;
+        }
+        if (time.IsDefault())
+        {
+            slot.spec->SetDefaultValue(value);
+        }
+        else
+        {
+            m_layer->SetTimeSample(slot.path, time.GetValue(), value);
+        }
+    }
+
+    Layout m_layout;
+    PXR_NS::SdfLayerHandle m_layer;
+    std::vector<Entry> m_entries;
+};
@@ -135,11 +135,10 @@ void createAndBindAnimForSkel(UsdStageRefPtr stage, const SdfPath& animPrimPath,
 }
 
 
-// Set the elbow joint's relative X axis translation at time=0 for skeleton's current animation
+// Get the joint translations attribute of the skeleton's current animation
 //
 // param: stage The USD stage for the skeleton and the animation
-// param: elbowXTranslation The relative translation on the elbow joint's X axis from the root
-void setElbowRelativeXTranslation(UsdStageRefPtr stage, double elbowXTranslation)
+UsdAttribute getSkelAnimTranslationsAttr(UsdStageRefPtr stage)
 {
     UsdPrim skelPrim = ::getSkeletonPrim(stage);
     if (skelPrim)
@@ -153,15 +152,30 @@ void setElbowRelativeXTranslation(UsdStageRefPtr stage, double elbowXTranslation
                 UsdSkelAnimation anim = UsdSkelAnimation(animPrim);
                 if (anim)
                 {
-                    VtVec3fArray translations = {
-                        GfVec3f(elbowXTranslation, 0, g_boneSize), // elbow
-                        GfVec3f(-elbowXTranslation, 0, g_boneSize) // wrist (must negate since these are relative to the parent joint)
-                    };
-                    anim.GetTranslationsAttr().Set(translations, UsdTimeCode(0));
+                    return anim.GetTranslationsAttr();
                 }
             }
         }
     }
+    return UsdAttribute();
+}
+
+
+// Set the elbow joint's relative X axis translation at time=0 for skeleton's current animation
+//
+// param: stage The USD stage for the skeleton and the animation
+// param: elbowXTranslation The relative translation on the elbow joint's X axis from the root
+void setElbowRelativeXTranslation(UsdStageRefPtr stage, double elbowXTranslation)
+{
+    UsdAttribute translationsAttr = getSkelAnimTranslationsAttr(stage);
+    if (translationsAttr)
+    {
+        VtVec3fArray translations = {
+            GfVec3f(elbowXTranslation, 0, g_boneSize), // elbow
+            GfVec3f(-elbowXTranslation, 0, g_boneSize) // wrist (must negate since these are relative to the parent joint)
+        };
+        translationsAttr.Set(translations, UsdTimeCode(0));
+    }
 }
 
 
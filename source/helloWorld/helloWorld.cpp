@@ -17,14 +17,22 @@
 #  * add a light to the stage
 #  * move and rotate the box with live updates
 #  * create animations and animate a joint with live updates
+#  * record the streamed joint motion as time samples in a separate layer
+#  * stream a deforming mesh with live updates, authoring only the chunks that moved
 #  * disconnect from an Omniverse server
 #  *
 #  * optional stuff:
 #  *  print verbose Omniverse logs
 #  *  open an existing stage and find a mesh to do live edits
+#  *  write a stress stage of many dense blocks, each in its own payload layer
 #
 ###############################################################################*/
 
+#include "DeltaPointStream.h"
+#include "MotionRecorder.h"
+#include "PayloadSplit.h"
+#include "Stopwatch.h"
+#include "TransformWriter.h"
 #include "exampleMaterial.h"
 #include "exampleSkelMesh.h"
 
@@ -42,6 +50,7 @@
 #include <omni/core/OmniInit.h>
 #include <omni/log/ILog.h>
 
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <fstream>
@@ -50,6 +59,7 @@
 #include <math.h>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <sstream>
 #include <stdio.h>
 #include <stdlib.h>
@@ -863,16 +873,158 @@ char inputChar()
     return achar;
 }
 
+// Stream a deforming grid to the live stage as a simulation would, once rewriting the whole points array every frame
+// and once rewriting only the chunks a vertex moved in, and report the bytes per frame and frame rate of each
+static void streamDeformingMesh(UsdStageRefPtr stage)
+{
+    // A 256 x 256 quad grid, 200 units across, with a bump that travels across it
+    constexpr int kResolution = 256;
+    constexpr float kSize = 200.0f;
+    constexpr float kRadius = 20.0f;
+    constexpr int kFrames = 90;
+    constexpr size_t kFacesPerChunk = 4096;
+    VtIntArray faceVertexCounts(kResolution * kResolution, 4);
+    VtIntArray faceVertexIndices;
+    faceVertexIndices.reserve(kResolution * kResolution * 4);
+    for (int z = 0; z < kResolution; z++)
+    {
+        for (int x = 0; x < kResolution; x++)
+        {
+            const int corner = z * (kResolution + 1) + x;
+            faceVertexIndices.push_back(corner);
+            faceVertexIndices.push_back(corner + kResolution + 1);
+            faceVertexIndices.push_back(corner + kResolution + 2);
+            faceVertexIndices.push_back(corner + 1);
+        }
+    }
+    VtVec3fArray restPoints((kResolution + 1) * (kResolution + 1));
+    for (int z = 0; z <= kResolution; z++)
+    {
+        for (int x = 0; x <= kResolution; x++)
+        {
+            restPoints[z * (kResolution + 1) + x] = GfVec3f(((float)x / kResolution - 0.5f) * kSize, 0.0f, ((float)z / kResolution - 0.5f) * kSize);
+        }
+    }
+    auto deform = [&](int frame, VtVec3fArray& points)
+    {
+        const float t = (float)frame / (float)(kFrames - 1);
+        const GfVec2f center((t - 0.5f) * kSize * 0.8f, (0.5f - t) * kSize * 0.4f);
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            const GfVec3f& rest = restPoints[i];
+            const float distance = (GfVec2f(rest[0], rest[2]) - center).GetLength();
+            const float height = distance < kRadius ? 10.0f * 0.5f * (1.0f + cosf((float)M_PI * distance / kRadius)) : 0.0f;
+            points[i] = GfVec3f(rest[0], height, rest[2]);
+        }
+    };
+
+    UsdPrim world = stage->GetDefaultPrim();
+    UsdGeomMesh fullMesh = omni::connect::core::definePolyMesh(world, TfToken("DeformingGrid"), faceVertexCounts, faceVertexIndices, restPoints);
+    DeltaPointStream chunkedMesh(world, TfToken("DeformingGridChunks"), faceVertexCounts, faceVertexIndices, restPoints, kFacesPerChunk);
+    if (!fullMesh || !chunkedMesh)
+    {
+        OMNI_LOG_ERROR("Failure to create the deforming grids");
+        return;
+    }
+    omni::connect::core::setLocalTransform(
+        fullMesh.GetPrim(),
+        GfVec3d(-kSize * 0.6, 0.0, -300.0),
+        /* pivot */ GfVec3d(0.0),
+        /* rotation */ GfVec3f(0.0f),
+        omni::connect::core::RotationOrder::eXyz,
+        GfVec3f(1.0f)
+    );
+    omni::connect::core::setLocalTransform(
+        chunkedMesh.root().GetPrim(),
+        GfVec3d(kSize * 0.6, 0.0, -300.0),
+        /* pivot */ GfVec3d(0.0),
+        /* rotation */ GfVec3f(0.0f),
+        omni::connect::core::RotationOrder::eXyz,
+        GfVec3f(1.0f)
+    );
+    omniClientLiveProcess();
+
+    VtVec3fArray points = restPoints;
+    const char* modeNames[2] = { "full points arrays", "changed chunks only" };
+    for (int mode = 0; mode < 2; mode++)
+    {
+        size_t bytes = 0;
+        size_t changedChunks = 0;
+        Stopwatch timer;
+        for (int frame = 0; frame < kFrames; frame++)
+        {
+            deform(frame, points);
+            if (mode == 0)
+            {
+                VtVec3fArray extent;
+                UsdGeomPointBased::ComputeExtent(points, &extent);
+                fullMesh.GetPointsAttr().Set(points);
+                fullMesh.GetExtentAttr().Set(extent);
+                bytes += (points.size() + extent.size()) * sizeof(GfVec3f);
+            }
+            else
+            {
+                const DeltaPointStream::FrameStats stats = chunkedMesh.write(points);
+                bytes += stats.bytes;
+                changedChunks += stats.changedChunks;
+            }
+            // Commit the change to USD
+            omniClientLiveProcess();
+        }
+        const double seconds = timer.seconds();
+        OMNI_LOG_INFO(
+            "Streamed %d frames of %zu points with %s: %.1f KB per frame, %.1f FPS",
+            kFrames,
+            points.size(),
+            modeNames[mode],
+            (double)bytes / kFrames / 1000.0,
+            seconds > 0.0 ? kFrames / seconds : 0.0
+        );
+        if (mode == 1)
+        {
+            OMNI_LOG_INFO("  %.1f of %zu chunks written per frame on average", (double)changedChunks / kFrames, chunkedMesh.chunkCount());
+        }
+    }
+}
+
+// Log how a motion recording was written, called from the recorder's background thread
+static void logRecording(const MotionRecorder::FlushReport& report)
+{
+    if (!report.saved)
+    {
+        OMNI_LOG_ERROR("Failed to write the motion recording to %s", report.layerPath.c_str());
+        return;
+    }
+    OMNI_LOG_INFO(
+        "Motion recording written to %s: kept %zu of %zu samples (%zu dropped), %zu -> %zu bytes (%.1f%% smaller), %.0f samples/s",
+        report.layerPath.c_str(),
+        report.keptSamples,
+        report.capturedSamples,
+        report.droppedSamples,
+        report.capturedBytes,
+        report.keptBytes,
+        report.savedPercent(),
+        report.samplesPerSecond()
+    );
+}
+
 // Perform a live edit on the box
 static void liveEdit(UsdGeomMesh& meshIn, std::string stageUrl)
 {
     double angle = 0;
+    std::optional<TransformWriter> boxWriter;
+    // Samples within this distance of the interpolated motion are dropped from recordings
+    constexpr double kRecordingTolerance = 0.01;
+    MotionRecorder recorder;
+    size_t recordedTrack = MotionRecorder::kInvalidTrack;
     std::srand(std::time(0));
 
     constexpr const char kLoopText[] =
         "Enter 't' to transform,\n"
         "'s' to create anim,\n"
         "'a' to stream anim,\n"
+        "'k' to start/stop recording the anim stream,\n"
+        "'d' to stream a deforming mesh,\n"
         "'m' to msg channel,\n"
         "'l' to leave channel,\n"
         "'q' to quit";
@@ -947,30 +1099,29 @@ static void liveEdit(UsdGeomMesh& meshIn, std::string stageUrl)
                 double x = sin(radians) * 100;
                 double y = cos(radians) * 100;
 
-                GfVec3d position(0);
-                GfVec3d pivot(0);
-                GfVec3f rotXYZ(0);
-                omni::connect::core::RotationOrder rotationOrder;
-                GfVec3f scale(1);
-
-                UsdPrim meshPrim = meshIn.GetPrim();
-
-                omni::connect::core::getLocalTransformComponents(meshPrim, position, pivot, rotXYZ, rotationOrder, scale);
+                // The box's transform ops are looked up on the first move and reused by every move after it
+                if (!boxWriter)
+                {
+                    boxWriter.emplace(meshIn.GetPrim().GetStage(), SdfPathVector{ meshIn.GetPath() }, TransformWriter::Layout::eTrs);
+                }
+                std::vector<TransformWriter::Trs> transforms(1);
+                TransformWriter::Trs& trs = transforms[0];
+                boxWriter->read(0, trs);
 
                 // Move/Rotate the existing position/rotation - this works for Y-up stages
-                position += GfVec3d(x, 0, y);
-                rotXYZ = GfVec3f(rotXYZ[0], angle, rotXYZ[2]);
+                trs.translate += GfVec3d(x, 0, y);
+                trs.rotate = GfVec3f(trs.rotate[0], angle, trs.rotate[2]);
 
-                omni::connect::core::setLocalTransform(meshPrim, position, pivot, rotXYZ, rotationOrder, scale);
+                boxWriter->write(transforms);
 
                 OMNI_LOG_INFO(
                     "Setting pos: ( %f, %f, %f ) and rot: ( %f, %f, %f )",
-                    position[0],
-                    position[1],
-                    position[2],
-                    rotXYZ[0],
-                    rotXYZ[1],
-                    rotXYZ[2]
+                    trs.translate[0],
+                    trs.translate[1],
+                    trs.translate[2],
+                    trs.rotate[0],
+                    trs.rotate[1],
+                    trs.rotate[2]
                 );
                 // Commit the change to USD
                 omniClientLiveProcess();
@@ -1011,6 +1162,15 @@ static void liveEdit(UsdGeomMesh& meshIn, std::string stageUrl)
                     std::cout << "\b" << kScrollWheel[i % 4];
                     fflush(stdout);
                     setElbowRelativeXTranslation(gStage, displacement);
+                    if (recorder.isRecording())
+                    {
+                        VtVec3fArray translations;
+                        getSkelAnimTranslationsAttr(gStage).Get(&translations, UsdTimeCode(0));
+                        if (translations.size() == 2)
+                        {
+                            recorder.record(recordedTrack, translations.cdata());
+                        }
+                    }
                     // Commit the change to USD
                     omniClientLiveProcess();
 
@@ -1020,6 +1180,33 @@ static void liveEdit(UsdGeomMesh& meshIn, std::string stageUrl)
                 std::cout << std::endl;
                 break;
             }
+            case 'k':
+            {
+                // Keep every streamed elbow transform as a time sample, written when recording stops
+                if (!recorder.isRecording())
+                {
+                    recordedTrack = recorder.addTrack(getSkelAnimTranslationsAttr(gStage), 2);
+                    if (recordedTrack == MotionRecorder::kInvalidTrack)
+                    {
+                        OMNI_LOG_WARN("The skeleton's animation translations can't be recorded");
+                        break;
+                    }
+                    recorder.start(gStage->GetTimeCodesPerSecond());
+                    OMNI_LOG_INFO("Recording the anim stream, enter 'k' again to stop");
+                }
+                else
+                {
+                    const std::string rootLayer = gStage->GetRootLayer()->GetIdentifier();
+                    recorder.stop(MotionRecorder::layerPathFor(rootLayer), rootLayer, kRecordingTolerance, logRecording);
+                    OMNI_LOG_INFO("Recording stopped, writing it in the background");
+                }
+                break;
+            }
+            case 'd':
+            {
+                streamDeformingMesh(gStage);
+                break;
+            }
             case 'm':
             {
                 if (kInvalidRequestId != joinRequestId)
@@ -1070,6 +1257,12 @@ static void liveEdit(UsdGeomMesh& meshIn, std::string stageUrl)
             case 27:
             case 'q':
                 wait = false;
+                if (recorder.isRecording())
+                {
+                    const std::string rootLayer = gStage->GetRootLayer()->GetIdentifier();
+                    recorder.stop(MotionRecorder::layerPathFor(rootLayer), rootLayer, kRecordingTolerance, logRecording);
+                }
+                recorder.wait();
                 OMNI_LOG_INFO("Live Edit complete\n");
                 break;
             default:
@@ -1078,6 +1271,106 @@ static void liveEdit(UsdGeomMesh& meshIn, std::string stageUrl)
     }
 }
 
+// Write a stage of `blockCount` dense blocks, a rippled grid mesh under an Xform each, and move every block into its
+// own payload layer. Opening it with nothing loaded then only reads the small root layer.
+static void createStressStage(const std::string& destinationPath, int blockCount, const std::string& stageExtension)
+{
+    const std::string stageUrl = destinationPath + "/stress" + stageExtension;
+    UsdStageRefPtr stage = omni::connect::core::createStage(stageUrl, _tokens->World, UsdGeomTokens->y, UsdGeomLinearUnits::centimeters);
+    if (!stage)
+    {
+        OMNI_LOG_ERROR("Failure to create the stress stage %s", stageUrl.c_str());
+        return;
+    }
+
+    // A 128 x 128 quad grid, 100 units across, shared by every block
+    constexpr int kResolution = 128;
+    constexpr float kSize = 100.0f;
+    VtIntArray faceVertexCounts(kResolution * kResolution, 4);
+    VtIntArray faceVertexIndices;
+    faceVertexIndices.reserve(kResolution * kResolution * 4);
+    for (int z = 0; z < kResolution; z++)
+    {
+        for (int x = 0; x < kResolution; x++)
+        {
+            const int corner = z * (kResolution + 1) + x;
+            faceVertexIndices.push_back(corner);
+            faceVertexIndices.push_back(corner + kResolution + 1);
+            faceVertexIndices.push_back(corner + kResolution + 2);
+            faceVertexIndices.push_back(corner + 1);
+        }
+    }
+
+    Stopwatch authorTimer;
+    const int blocksPerRow = std::max(1, (int)std::ceil(std::sqrt((double)blockCount)));
+    UsdPrim world = stage->GetDefaultPrim();
+    SdfPathVector blockPaths;
+    for (int block = 0; block < blockCount; block++)
+    {
+        UsdGeomXform xform = omni::connect::core::defineXform(world, TfToken("Block_" + std::to_string(block)));
+        omni::connect::core::setLocalTransform(
+            xform.GetPrim(),
+            GfVec3d((block % blocksPerRow) * kSize * 1.2, 0.0, (block / blocksPerRow) * kSize * 1.2),
+            /* pivot */ GfVec3d(0.0),
+            /* rotation */ GfVec3f(0.0f),
+            omni::connect::core::RotationOrder::eXyz,
+            GfVec3f(1.0f)
+        );
+
+        // A different ripple per block so no two blocks hold the same points
+        VtVec3fArray points((kResolution + 1) * (kResolution + 1));
+        const float phase = (float)block * 0.7f;
+        for (int z = 0; z <= kResolution; z++)
+        {
+            for (int x = 0; x <= kResolution; x++)
+            {
+                const float u = (float)x / kResolution;
+                const float v = (float)z / kResolution;
+                points[z * (kResolution + 1) + x] = GfVec3f((u - 0.5f) * kSize, 4.0f * sinf(u * 12.0f + phase) * cosf(v * 9.0f - phase), (v - 0.5f) * kSize);
+            }
+        }
+        const GfVec3f color(0.2f + 0.6f * (float)(block % 3) / 2.0f, 0.5f, 0.8f - 0.6f * (float)(block % 5) / 4.0f);
+        omni::connect::core::definePolyMesh(
+            xform.GetPrim(),
+            TfToken("Grid"),
+            faceVertexCounts,
+            faceVertexIndices,
+            points,
+            std::nullopt,
+            std::nullopt,
+            omni::connect::core::Vec3fPrimvarData(UsdGeomTokens->constant, { color })
+        );
+        blockPaths.push_back(xform.GetPath());
+    }
+    const double authorMs = authorTimer.milliseconds();
+
+    const payloadsplit::SplitResult split = payloadsplit::splitIntoPayloads(stage, blockPaths, "./stress_payloads");
+    for (const std::string& failed : split.failed)
+    {
+        OMNI_LOG_ERROR("Failed to write the payload layer %s", failed.c_str());
+    }
+    OMNI_LOG_INFO(
+        "Stress stage %s: %d blocks authored in %.1f ms, %zu payload layers copied in %.1f ms and written in parallel in %.1f ms",
+        stageUrl.c_str(),
+        blockCount,
+        authorMs,
+        split.payloadCount,
+        split.copyMs,
+        split.writeMs
+    );
+
+    // Release the stage so the timed opens read its layers again
+    stage.Reset();
+    const payloadsplit::OpenTimes times = payloadsplit::measureOpenTimes(stageUrl);
+    OMNI_LOG_INFO(
+        "Open with no payloads loaded: %.1f ms (%zu prims), with all payloads loaded: %.1f ms (%zu prims)",
+        times.loadNoneMs,
+        times.loadNonePrims,
+        times.loadAllMs,
+        times.loadAllPrims
+    );
+}
+
 // Print the command line arguments help
 static void printCmdLineArgHelp()
 {
@@ -1088,12 +1381,16 @@ static void printCmdLineArgHelp()
         "    -l, --live                    Allow the user to continue modifying the stage live after creating (with the 't' key)\n"
         "    -p, --path dest_stage_folder  Alternate destination stage path folder [default: omniverse://localhost/Users/test]\n"
         "    -e, --existing path_to_stage  Open an existing stage and perform live transform edits (full omniverse URL)\n"
+        "    -s, --stress block_count      Also write stress.usd, block_count dense meshes each in its own payload layer,\n"
+        "                                  and time opening it with and without the payloads loaded\n"
         "    -v, --verbose                 Show the verbose Omniverse logging\n"
         "\n\nExamples:\n"
         " * create a stage on the localhost server at /Projects/HelloWorld/helloworld.usd\n"
         "    > samples -p omniverse://localhost/Projects/HelloWorld\n"
         "\n * live edit a stage on the localhost server at /Projects/LiveEdit/livestage.usd\n"
         "    > samples -e omniverse://localhost/Projects/LiveEdit/livestage.usd\n"
+        "\n * also write a stress stage of 400 payload blocks next to the stage\n"
+        "    > samples -p omniverse://localhost/Projects/HelloWorld -s 400\n"
     );
 }
 
@@ -1106,6 +1403,7 @@ int main(int argc, char* argv[])
     std::string destinationPath = "";
     std::string finalCheckpointComment = "HelloWorld sample completed";
     std::string stageExtension(".usd");
+    int stressBlocks = 0;
     UsdGeomMesh boxMesh;
 
     // check for verbose flag
@@ -1159,6 +1457,16 @@ int main(int argc, char* argv[])
                 );
             }
         }
+        else if (strcmp(argv[x], "-s") == 0 || strcmp(argv[x], "--stress") == 0)
+        {
+            if (x == argc - 1)
+            {
+                OMNI_LOG_ERROR("ERROR: Missing the number of stress blocks.");
+                printCmdLineArgHelp();
+                return -1;
+            }
+            stressBlocks = std::max(0, atoi(argv[++x]));
+        }
         else if (strcmp(argv[x], "-v") == 0 || strcmp(argv[x], "--verbose") == 0)
         {
             // this was handled in the pre-process loop
@@ -1281,6 +1589,12 @@ int main(int argc, char* argv[])
 
         // Add a final comment
         saveStage(gStage, finalCheckpointComment.c_str());
+
+        // Write the payload split stress stage next to the sample stage
+        if (stressBlocks > 0)
+        {
+            createStressStage(destinationPath, stressBlocks, stageExtension);
+        }
     }
     else
     {
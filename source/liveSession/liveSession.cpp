@@ -14,6 +14,7 @@
 # * Display existing live sessions for a stage
 # * Connect to a live session
 # * Make xform changes to a mesh prim in the .live layer
+# * Record the xform changes as time samples in a separate layer
 # * Rename a prim that exists in the .live layer
 # * Display the owner of the live session
 # * Display the current connected users/peers in the session
@@ -24,6 +25,9 @@
 #
 ###############################################################################*/
 
+#include "MotionRecorder.h"
+#include "TransformWriter.h"
+
 #include <omni/connect/core/Core.h>
 #include <omni/connect/core/LayerAlgo.h>
 #include <omni/connect/core/LiveSession.h>
@@ -46,6 +50,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <sstream>
 #include <stdio.h>
 #include <stdlib.h>
@@ -294,13 +299,65 @@ bool endAndMergeSession(omni::connect::core::LiveSession* liveSession)
 }
 
 
+// Log how a motion recording was written, called from the recorder's background thread
+static void logRecording(const MotionRecorder::FlushReport& report)
+{
+    if (!report.saved)
+    {
+        OMNI_LOG_ERROR("Failed to write the motion recording to %s", report.layerPath.c_str());
+        return;
+    }
+    OMNI_LOG_INFO(
+        "Motion recording written to %s: kept %zu of %zu samples (%zu dropped), %zu -> %zu bytes (%.1f%% smaller), %.0f samples/s",
+        report.layerPath.c_str(),
+        report.keptSamples,
+        report.capturedSamples,
+        report.droppedSamples,
+        report.capturedBytes,
+        report.keptBytes,
+        report.savedPercent(),
+        report.samplesPerSecond()
+    );
+}
+
 // Perform a live edit on the box
 static void liveEdit(UsdStagePtr stage, UsdGeomMesh& geomMesh, omni::connect::core::LiveSession* liveSession)
 {
     double angle = 0;
+    std::optional<TransformWriter> meshWriter;
+    SdfPath writerPath;
+    // The mesh's transform ops are looked up once per mesh, another client may have replaced it since
+    auto getMeshWriter = [&]() -> TransformWriter&
+    {
+        // Other clients can delete or retype the op attributes the writer caches, and the edit target can change
+        if (!meshWriter || writerPath != geomMesh.GetPath() || meshWriter->isExpired(stage))
+        {
+            writerPath = geomMesh.GetPath();
+            meshWriter.emplace(stage, SdfPathVector{ writerPath }, TransformWriter::Layout::eTrs);
+        }
+        return *meshWriter;
+    };
+
+    // Samples within this distance (or angle in degrees) of the interpolated motion are dropped from recordings
+    constexpr double kRecordingTolerance = 0.01;
+    MotionRecorder recorder;
+    SdfPath recordedPath;
+    size_t translateTrack = MotionRecorder::kInvalidTrack;
+    size_t rotateTrack = MotionRecorder::kInvalidTrack;
+    auto stopRecording = [&]()
+    {
+        if (recorder.isRecording())
+        {
+            const std::string rootLayer = stage->GetRootLayer()->GetIdentifier();
+            recorder.stop(MotionRecorder::layerPathFor(rootLayer), rootLayer, kRecordingTolerance, logRecording);
+            OMNI_LOG_INFO("Recording stopped, writing it in the background");
+        }
+    };
+
     const char* optionsStr =
         "Enter an option:\n"
         " [t] transform the mesh\n"
+        " [k] start/stop recording the mesh transforms\n"
         " [r] rename a prim\n"
         " [o] list session owner/admin\n"
         " [u] list session users\n"
@@ -325,6 +382,7 @@ static void liveEdit(UsdStagePtr stage, UsdGeomMesh& geomMesh, omni::connect::co
         // A more sophisticated client should reload the stage without the live session layer
         if (gStageMerged)
         {
+            stopRecording();
             return;
         }
 
@@ -363,28 +421,29 @@ static void liveEdit(UsdStagePtr stage, UsdGeomMesh& geomMesh, omni::connect::co
                 double x = sin(radians) * 10;
                 double y = cos(radians) * 10;
 
-                GfVec3d position(0);
-                GfVec3d pivot(0);
-                GfVec3f rotXYZ(0);
-                omni::connect::core::RotationOrder rotationOrder;
-                GfVec3f scale(1);
-
-                UsdPrim meshPrim = geomMesh.GetPrim();
-                omni::connect::core::getLocalTransformComponents(meshPrim, position, pivot, rotXYZ, rotationOrder, scale);
+                TransformWriter& writer = getMeshWriter();
+                std::vector<TransformWriter::Trs> transforms(1);
+                TransformWriter::Trs& trs = transforms[0];
+                writer.read(0, trs);
 
                 // Move/Rotate the existing position/rotation - this works for Y-up stages
-                position += GfVec3d(x, 0, y);
-                rotXYZ = GfVec3f(rotXYZ[0], angle, rotXYZ[2]);
+                trs.translate += GfVec3d(x, 0, y);
+                trs.rotate = GfVec3f(trs.rotate[0], angle, trs.rotate[2]);
 
-                omni::connect::core::setLocalTransform(meshPrim, position, pivot, rotXYZ, rotationOrder, scale);
+                writer.write(transforms);
+                if (recorder.isRecording() && recordedPath == writerPath)
+                {
+                    recorder.record(translateTrack, &trs.translate);
+                    recorder.record(rotateTrack, &trs.rotate);
+                }
                 OMNI_LOG_INFO(
                     "Setting pos: ( %f, %f, %f ) and rot: ( %f, %f, %f )",
-                    position[0],
-                    position[1],
-                    position[2],
-                    rotXYZ[0],
-                    rotXYZ[1],
-                    rotXYZ[2]
+                    trs.translate[0],
+                    trs.translate[1],
+                    trs.translate[2],
+                    trs.rotate[0],
+                    trs.rotate[1],
+                    trs.rotate[2]
                 );
 
                 // Commit the change to USD
@@ -498,9 +557,43 @@ static void liveEdit(UsdStagePtr stage, UsdGeomMesh& geomMesh, omni::connect::co
                 }
                 break;
             }
+            case 'k':
+            {
+                // Keep every transform edit as a time sample, written when recording stops
+                if (recorder.isRecording())
+                {
+                    stopRecording();
+                    break;
+                }
+                if (!geomMesh.GetPrim().IsValid() || !geomMesh.GetPrim().IsActive())
+                {
+                    OMNI_LOG_WARN("Prim no longer valid and active, transform it with 't' to find a new one before recording");
+                    break;
+                }
+                TransformWriter& writer = getMeshWriter();
+                translateTrack = recorder.addTrack(writer.attribute(0, 0));
+                rotateTrack = recorder.addTrack(writer.attribute(0, 1));
+                // The op order and the other ops may only be authored in the live layer, the recording layer only
+                // sublayers the root layer
+                const UsdGeomXformable xformable(geomMesh.GetPrim());
+                recorder.addConstant(xformable.GetXformOpOrderAttr());
+                bool resetsStack = false;
+                for (const UsdGeomXformOp& op : xformable.GetOrderedXformOps(&resetsStack))
+                {
+                    if (op.GetAttr() != writer.attribute(0, 0) && op.GetAttr() != writer.attribute(0, 1))
+                    {
+                        recorder.addConstant(op.GetAttr());
+                    }
+                }
+                recordedPath = writerPath;
+                recorder.start(stage->GetTimeCodesPerSecond());
+                OMNI_LOG_INFO("Recording the transforms of %s, enter 'k' again to stop", recordedPath.GetText());
+                break;
+            }
             case 'm':
             {
                 OMNI_LOG_INFO("Merging session changes to root layer, Live Session complete");
+                stopRecording();
                 if (endAndMergeSession(liveSession))
                 {
                     wait = false;
@@ -512,6 +605,7 @@ static void liveEdit(UsdStagePtr stage, UsdGeomMesh& geomMesh, omni::connect::co
             case 'q':
             {
                 wait = false;
+                stopRecording();
                 OMNI_LOG_INFO("Live Edit complete");
                 break;
             }
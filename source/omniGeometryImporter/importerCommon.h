@@ -0,0 +1,304 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "FileSize.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+#include <omni/connect/core/MeshAlgo.h>
+
+#include <OmniClient.h>
+
+#include <pxr/base/gf/vec2f.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/usd/usd/prim.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/tokens.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Geometry Importer sample and holds the argument parsing,
+// vertex welding and mesh authoring that every input format shares.
+///////////////////////////////////////////////////////////////////////////////////////
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+// The importer's command line: positional arguments and "--option value" pairs
+class ImporterArgs
+{
+public:
+
+    ImporterArgs(int argc, char* argv[], int first)
+    {
+        for (int x = first; x < argc; x++)
+        {
+            mArgs.emplace_back(argv[x]);
+        }
+    }
+
+    // The n-th argument that is not an option (or an option value)
+    std::string positional(size_t index) const
+    {
+        size_t found = 0;
+        for (size_t i = 0; i < mArgs.size(); i++)
+        {
+            if (mArgs[i].compare(0, 1, "-") == 0 && mArgs[i].size() > 1)
+            {
+                // Skip the option's value if it has one
+                if (i + 1 < mArgs.size() && mArgs[i + 1].compare(0, 2, "--") != 0 && !isFlag(mArgs[i]))
+                {
+                    i++;
+                }
+                continue;
+            }
+            if (found++ == index)
+            {
+                return mArgs[i];
+            }
+        }
+        return std::string();
+    }
+
+    bool hasFlag(const char* name) const
+    {
+        for (const auto& arg : mArgs)
+        {
+            if (arg == name)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string getString(const char* name, const std::string& defaultValue) const
+    {
+        for (size_t i = 0; i + 1 < mArgs.size(); i++)
+        {
+            if (mArgs[i] == name)
+            {
+                return mArgs[i + 1];
+            }
+        }
+        return defaultValue;
+    }
+
+    double getDouble(const char* name, double defaultValue) const
+    {
+        std::string value = getString(name, std::string());
+        return value.empty() ? defaultValue : std::strtod(value.c_str(), nullptr);
+    }
+
+    long getInt(const char* name, long defaultValue) const
+    {
+        std::string value = getString(name, std::string());
+        return value.empty() ? defaultValue : std::strtol(value.c_str(), nullptr, 10);
+    }
+
+private:
+
+    bool isFlag(const std::string& arg) const
+    {
+        for (const char* name : mFlagNames)
+        {
+            if (arg == name)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::string> mArgs;
+    std::vector<const char*> mFlagNames = { "--weld", "-v", "--verbose" };
+};
+
+// The most memory the process has had resident so far
+static size_t peakMemoryBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    // ru_maxrss is in kilobytes on Linux
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+// Merges points that are closer than a tolerance with a hash grid, so the cost per point is constant.
+// The buckets and chains are kept between calls, so streaming many chunks through one welder allocates once.
+class VertexWelder
+{
+public:
+
+    explicit VertexWelder(float tolerance) : m_tolerance(tolerance), m_invCellSize(tolerance > 0.0f ? 1.0f / tolerance : 0.0f)
+    {
+    }
+
+    // Write the welded points to `unique` and, for every input point, the index of the point it was welded to
+    void weld(const GfVec3f* points, size_t count, VtVec3fArray& unique, std::vector<int>& remap)
+    {
+        size_t bucketCount = 64;
+        while (bucketCount < count * 2)
+        {
+            bucketCount *= 2;
+        }
+        m_heads.assign(bucketCount, -1);
+        m_next.clear();
+        m_next.reserve(count);
+        const uint32_t mask = (uint32_t)bucketCount - 1;
+        const float toleranceSquared = m_tolerance * m_tolerance;
+
+        unique.clear();
+        unique.reserve(count);
+        remap.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            const GfVec3f& point = points[i];
+            int found = -1;
+            uint32_t ownBucket;
+            if (m_tolerance <= 0.0f)
+            {
+                // Exact welding only needs the point's own bucket
+                ownBucket = exactHash(point) & mask;
+                for (int j = m_heads[ownBucket]; j >= 0 && found < 0; j = m_next[j])
+                {
+                    found = unique[j] == point ? j : -1;
+                }
+            }
+            else
+            {
+                // A point within the tolerance can sit in any of the 27 cells around this one
+                const int cx = (int)std::floor(point[0] * m_invCellSize);
+                const int cy = (int)std::floor(point[1] * m_invCellSize);
+                const int cz = (int)std::floor(point[2] * m_invCellSize);
+                ownBucket = cellHash(cx, cy, cz) & mask;
+                for (int dz = -1; dz <= 1 && found < 0; dz++)
+                {
+                    for (int dy = -1; dy <= 1 && found < 0; dy++)
+                    {
+                        for (int dx = -1; dx <= 1 && found < 0; dx++)
+                        {
+                            for (int j = m_heads[cellHash(cx + dx, cy + dy, cz + dz) & mask]; j >= 0; j = m_next[j])
+                            {
+                                if ((unique[j] - point).GetLengthSq() <= toleranceSquared)
+                                {
+                                    found = j;
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (found < 0)
+            {
+                found = (int)unique.size();
+                unique.push_back(point);
+                m_next.push_back(m_heads[ownBucket]);
+                m_heads[ownBucket] = found;
+            }
+            remap[i] = found;
+        }
+    }
+
+private:
+
+    static uint32_t exactHash(const GfVec3f& point)
+    {
+        uint32_t bits[3];
+        const float components[3] = { point[0] + 0.0f, point[1] + 0.0f, point[2] + 0.0f };
+        memcpy(bits, components, sizeof(bits));
+        return cellHash((int)bits[0], (int)bits[1], (int)bits[2]);
+    }
+
+    static uint32_t cellHash(int x, int y, int z)
+    {
+        uint32_t hash = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+        hash ^= hash >> 15;
+        hash *= 0x2c1b3c6du;
+        hash ^= hash >> 12;
+        return hash;
+    }
+
+    float m_tolerance;
+    float m_invCellSize;
+    std::vector<int> m_heads;
+    std::vector<int> m_next;
+};
+
+// One piece of an imported mesh, authored as its own UsdGeomMesh
+struct MeshChunk
+{
+    VtIntArray faceVertexCounts;
+    VtIntArray faceVertexIndices;
+    VtVec3fArray points;
+    VtVec3fArray normals;
+    TfToken normalsInterpolation;
+    VtVec2fArray st;
+    size_t inputVertices = 0;
+
+    size_t triangleCount() const
+    {
+        size_t triangles = 0;
+        for (int count : faceVertexCounts)
+        {
+            triangles += count > 2 ? (size_t)(count - 2) : 0;
+        }
+        return triangles;
+    }
+};
+
+// Author a chunk with definePolyMesh, leaving out the primvars the input did not have
+static UsdGeomMesh authorChunk(UsdPrim parent, const std::string& name, const MeshChunk& chunk)
+{
+    std::optional<const omni::connect::core::Vec3fPrimvarData> normalsData;
+    std::optional<const omni::connect::core::Vec2fPrimvarData> stData;
+    if (!chunk.normals.empty())
+    {
+        normalsData.emplace(chunk.normalsInterpolation, chunk.normals);
+    }
+    if (!chunk.st.empty())
+    {
+        stData.emplace(UsdGeomTokens->faceVarying, chunk.st);
+    }
+    UsdGeomMesh mesh =
+        omni::connect::core::definePolyMesh(parent, name, chunk.faceVertexCounts, chunk.faceVertexIndices, chunk.points, normalsData, stData);
+    if (!mesh)
+    {
+        OMNI_LOG_ERROR("Failed to define mesh %s under %s", name.c_str(), parent.GetPath().GetText());
+    }
+    return mesh;
+}
@@ -0,0 +1,555 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "MappedFile.h"
+#include "importerCommon.h"
+#include "numberParser.h"
+
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Geometry Importer sample and reads binary and ASCII STL
+// files and Wavefront OBJ files into mesh chunks.
+//
+// Each reader hands out one chunk of at most N triangles at a time, so the importer
+// can author a chunk while the next one is being read and never holds a second copy
+// of the whole model next to the stage.
+///////////////////////////////////////////////////////////////////////////////////////
+
+// STL stores a soup of triangles: every triangle repeats its three corners, so they are welded back into shared points
+class StlReader
+{
+public:
+
+    StlReader(const MappedFile& file, size_t chunkTriangles, float weldTolerance) : m_file(file), m_chunkTriangles(chunkTriangles), m_welder(weldTolerance)
+    {
+        // A binary STL is an 80 byte header, a triangle count and 50 bytes per triangle. ASCII files often start with
+        // "solid" too, so the size is the reliable test.
+        if (m_file.size() >= 84)
+        {
+            uint32_t count = 0;
+            memcpy(&count, m_file.data() + 80, sizeof(count));
+            m_binary = m_file.size() == 84 + (size_t)count * 50;
+            m_binaryTriangles = m_binary ? count : 0;
+        }
+        m_cursor = { (const char*)m_file.data(), (const char*)m_file.data() + m_file.size() };
+    }
+
+    bool isBinary() const
+    {
+        return m_binary;
+    }
+
+    bool nextChunk(MeshChunk& chunk)
+    {
+        if (m_binary)
+        {
+            decodeBinary();
+        }
+        else
+        {
+            parseAscii();
+        }
+        if (m_soupPoints.empty())
+        {
+            return false;
+        }
+
+        chunk = MeshChunk();
+        chunk.inputVertices = m_soupPoints.size();
+        m_welder.weld(m_soupPoints.data(), m_soupPoints.size(), chunk.points, m_remap);
+
+        // Welding can collapse sliver triangles, those are dropped rather than authored as degenerate faces
+        const size_t triangles = m_soupPoints.size() / 3;
+        chunk.faceVertexIndices.reserve(triangles * 3);
+        bool hasNormals = false;
+        for (size_t t = 0; t < triangles; t++)
+        {
+            const int a = m_remap[t * 3];
+            const int b = m_remap[t * 3 + 1];
+            const int c = m_remap[t * 3 + 2];
+            if (a == b || b == c || a == c)
+            {
+                continue;
+            }
+            chunk.faceVertexIndices.push_back(a);
+            chunk.faceVertexIndices.push_back(b);
+            chunk.faceVertexIndices.push_back(c);
+            chunk.normals.push_back(m_soupNormals[t]);
+            hasNormals = hasNormals || m_soupNormals[t] != GfVec3f(0.0f);
+        }
+        chunk.faceVertexCounts.assign(chunk.faceVertexIndices.size() / 3, 3);
+
+        // Many exporters write zero facet normals, renderers compute better ones than that
+        if (hasNormals)
+        {
+            chunk.normalsInterpolation = UsdGeomTokens->uniform;
+        }
+        else
+        {
+            chunk.normals.clear();
+        }
+        return true;
+    }
+
+private:
+
+    // Copy the corners of the next range of 50 byte records in parallel, they are independent
+    void decodeBinary()
+    {
+        const size_t first = m_nextTriangle;
+        const size_t count = std::min(m_chunkTriangles, m_binaryTriangles - first);
+        m_nextTriangle += count;
+        m_soupPoints.resize(count * 3);
+        m_soupNormals.resize(count);
+
+        const uint8_t* records = m_file.data() + 84 + first * 50;
+        GfVec3f* points = m_soupPoints.data();
+        GfVec3f* normals = m_soupNormals.data();
+        WorkParallelForN(
+            count,
+            [records, points, normals](size_t begin, size_t end)
+            {
+                for (size_t t = begin; t < end; ++t)
+                {
+                    const uint8_t* record = records + t * 50;
+                    memcpy(normals[t].data(), record, 12);
+                    memcpy(points[t * 3].data(), record + 12, 36);
+                }
+            }
+        );
+    }
+
+    // "facet normal nx ny nz / outer loop / vertex x y z (x3) / endloop / endfacet", read up to a chunk of facets
+    void parseAscii()
+    {
+        m_soupPoints.clear();
+        m_soupNormals.clear();
+        GfVec3f normal(0.0f);
+        GfVec3f corners[3];
+        size_t facetCorners = 0;
+        while (m_soupNormals.size() < m_chunkTriangles)
+        {
+            textparse::skipWhitespace(m_cursor);
+            if (m_cursor.atEnd())
+            {
+                break;
+            }
+            const std::string word = textparse::nextWord(m_cursor);
+            if (word == "facet")
+            {
+                textparse::nextWord(m_cursor); // "normal"
+                normal = GfVec3f(0.0f);
+                for (int c = 0; c < 3; c++)
+                {
+                    textparse::parseFloat(m_cursor, normal[c]);
+                }
+                facetCorners = 0;
+            }
+            else if (word == "vertex")
+            {
+                GfVec3f point(0.0f);
+                for (int c = 0; c < 3; c++)
+                {
+                    textparse::parseFloat(m_cursor, point[c]);
+                }
+                // Corners past the third are not valid STL and are ignored
+                if (facetCorners < 3)
+                {
+                    corners[facetCorners] = point;
+                }
+                facetCorners++;
+            }
+            else if (word == "endfacet")
+            {
+                if (facetCorners >= 3)
+                {
+                    m_soupPoints.insert(m_soupPoints.end(), corners, corners + 3);
+                    m_soupNormals.push_back(normal);
+                }
+                facetCorners = 0;
+            }
+            else
+            {
+                // solid, outer loop, endloop and endsolid carry nothing the mesh needs
+                textparse::skipLine(m_cursor);
+            }
+        }
+    }
+
+    const MappedFile& m_file;
+    size_t m_chunkTriangles;
+    VertexWelder m_welder;
+    bool m_binary = false;
+    size_t m_binaryTriangles = 0;
+    size_t m_nextTriangle = 0;
+    textparse::Cursor m_cursor;
+    std::vector<GfVec3f> m_soupPoints;
+    std::vector<GfVec3f> m_soupNormals;
+    std::vector<int> m_remap;
+};
+
+// OBJ faces index one shared list of positions, texture coordinates and normals. The file is split at line breaks
+// and the pieces are parsed in parallel, then faces are cut into chunks that each get their own compact point list.
+class ObjReader
+{
+public:
+
+    ObjReader(const MappedFile& file, size_t chunkTriangles, bool weld, float weldTolerance) : m_chunkTriangles(chunkTriangles)
+    {
+        parse(file);
+        if (weld && !m_positions.empty())
+        {
+            // Welding the shared positions once welds every chunk consistently
+            VertexWelder welder(weldTolerance);
+            VtVec3fArray unique;
+            welder.weld(m_positions.data(), m_positions.size(), unique, m_positionRemap);
+            m_positions.assign(unique.begin(), unique.end());
+        }
+        m_localIndex.assign(m_positions.size(), -1);
+    }
+
+    size_t positionCount() const
+    {
+        return m_positions.size();
+    }
+
+    size_t faceCount() const
+    {
+        return m_faceCorners.size();
+    }
+
+    const std::string& error() const
+    {
+        return m_error;
+    }
+
+    bool nextChunk(MeshChunk& chunk)
+    {
+        if (m_nextFace >= m_faceCorners.size() || !m_error.empty())
+        {
+            return false;
+        }
+
+        // Take whole faces until the chunk holds the requested number of triangles
+        const size_t firstFace = m_nextFace;
+        size_t triangles = 0;
+        while (m_nextFace < m_faceCorners.size() && (triangles < m_chunkTriangles || m_nextFace == firstFace))
+        {
+            triangles += cornerCount(m_nextFace) - 2;
+            m_nextFace++;
+        }
+        const size_t firstCorner = m_faceCorners[firstFace];
+        const size_t endCorner = m_nextFace < m_faceCorners.size() ? m_faceCorners[m_nextFace] : m_cornerPositions.size();
+
+        chunk = MeshChunk();
+        chunk.inputVertices = endCorner - firstCorner;
+        chunk.faceVertexCounts.resize(m_nextFace - firstFace);
+        for (size_t face = firstFace; face < m_nextFace; face++)
+        {
+            chunk.faceVertexCounts[face - firstFace] = (int)cornerCount(face);
+        }
+
+        // Map the shared position indices to indices into this chunk's own points
+        chunk.faceVertexIndices.resize(endCorner - firstCorner);
+        std::vector<int> touched;
+        for (size_t corner = firstCorner; corner < endCorner; corner++)
+        {
+            int position = m_cornerPositions[corner];
+            if (!m_positionRemap.empty())
+            {
+                position = m_positionRemap[position];
+            }
+            int& local = m_localIndex[position];
+            if (local < 0)
+            {
+                local = (int)chunk.points.size();
+                chunk.points.push_back(m_positions[position]);
+                touched.push_back(position);
+            }
+            chunk.faceVertexIndices[corner - firstCorner] = local;
+        }
+        for (int position : touched)
+        {
+            m_localIndex[position] = -1;
+        }
+
+        // Texture coordinates and normals are per corner, authored only if every corner in the chunk has one
+        copyCornerValues(m_cornerUvs, m_uvs, firstCorner, endCorner, chunk.st);
+        copyCornerValues(m_cornerNormals, m_normals, firstCorner, endCorner, chunk.normals);
+        chunk.normalsInterpolation = UsdGeomTokens->faceVarying;
+        return true;
+    }
+
+private:
+
+    // Relative (negative) indices in a piece are stored offset by this much until the piece's first index is known
+    static constexpr int64_t kRelative = int64_t(1) << 40;
+    static constexpr int64_t kMissing = -1;
+
+    struct Piece
+    {
+        std::vector<GfVec3f> positions;
+        std::vector<GfVec2f> uvs;
+        std::vector<GfVec3f> normals;
+        std::vector<uint32_t> faceCorners;
+        std::vector<int64_t> cornerPositions;
+        std::vector<int64_t> cornerUvs;
+        std::vector<int64_t> cornerNormals;
+        std::string error;
+    };
+
+    size_t cornerCount(size_t face) const
+    {
+        const size_t end = face + 1 < m_faceCorners.size() ? m_faceCorners[face + 1] : m_cornerPositions.size();
+        return end - m_faceCorners[face];
+    }
+
+    // One index of a face corner, 1-based or negative to count back from the last element read so far
+    static int64_t readCornerIndex(textparse::Cursor& cursor, size_t elementCount)
+    {
+        long long index = 0;
+        if (!textparse::parseInt(cursor, index) || index == 0)
+        {
+            return kMissing;
+        }
+        return index > 0 ? index - 1 : kRelative + (int64_t)elementCount + index;
+    }
+
+    static void parsePiece(textparse::Cursor cursor, Piece& piece)
+    {
+        while (!cursor.atEnd())
+        {
+            textparse::skipWhitespace(cursor);
+            if (cursor.atEnd())
+            {
+                break;
+            }
+            const char first = cursor.pos[0];
+            const char second = cursor.end - cursor.pos > 1 ? cursor.pos[1] : '\0';
+            if (first == 'v' && (second == ' ' || second == '\t'))
+            {
+                cursor.pos += 2;
+                GfVec3f position(0.0f);
+                for (int c = 0; c < 3; c++)
+                {
+                    textparse::parseFloat(cursor, position[c]);
+                }
+                piece.positions.push_back(position);
+            }
+            else if (first == 'v' && second == 't')
+            {
+                cursor.pos += 2;
+                GfVec2f uv(0.0f);
+                textparse::parseFloat(cursor, uv[0]);
+                textparse::parseFloat(cursor, uv[1]);
+                piece.uvs.push_back(uv);
+            }
+            else if (first == 'v' && second == 'n')
+            {
+                cursor.pos += 2;
+                GfVec3f normal(0.0f);
+                for (int c = 0; c < 3; c++)
+                {
+                    textparse::parseFloat(cursor, normal[c]);
+                }
+                piece.normals.push_back(normal);
+            }
+            else if (first == 'f' && (second == ' ' || second == '\t'))
+            {
+                cursor.pos += 2;
+                const size_t faceStart = piece.cornerPositions.size();
+                while (true)
+                {
+                    textparse::skipSpaces(cursor);
+                    if (cursor.atEnd() || !(textparse::isDigit(*cursor.pos) || *cursor.pos == '-'))
+                    {
+                        break;
+                    }
+                    // A corner is "v", "v/vt", "v//vn" or "v/vt/vn"
+                    piece.cornerPositions.push_back(readCornerIndex(cursor, piece.positions.size()));
+                    int64_t uv = kMissing;
+                    int64_t normal = kMissing;
+                    if (!cursor.atEnd() && *cursor.pos == '/')
+                    {
+                        cursor.pos++;
+                        if (!cursor.atEnd() && *cursor.pos != '/')
+                        {
+                            uv = readCornerIndex(cursor, piece.uvs.size());
+                        }
+                        if (!cursor.atEnd() && *cursor.pos == '/')
+                        {
+                            cursor.pos++;
+                            normal = readCornerIndex(cursor, piece.normals.size());
+                        }
+                    }
+                    piece.cornerUvs.push_back(uv);
+                    piece.cornerNormals.push_back(normal);
+                }
+                const size_t corners = piece.cornerPositions.size() - faceStart;
+                if (corners >= 3)
+                {
+                    piece.faceCorners.push_back((uint32_t)faceStart);
+                }
+                else
+                {
+                    // Points and lines are not mesh faces
+                    piece.cornerPositions.resize(faceStart);
+                    piece.cornerUvs.resize(faceStart);
+                    piece.cornerNormals.resize(faceStart);
+                }
+            }
+            // Groups, objects, materials and smoothing groups are not imported
+            textparse::skipLine(cursor);
+        }
+    }
+
+    // Resolve a piece's corner indices against the elements of every piece before it
+    static bool resolveIndices(const std::vector<int64_t>& in, size_t elementsBefore, size_t totalElements, int* out, bool allowMissing)
+    {
+        for (size_t i = 0; i < in.size(); i++)
+        {
+            int64_t index = in[i];
+            if (index >= kRelative / 2)
+            {
+                index = index - kRelative + (int64_t)elementsBefore;
+            }
+            if (index == kMissing && allowMissing)
+            {
+                out[i] = -1;
+                continue;
+            }
+            if (index < 0 || index >= (int64_t)totalElements)
+            {
+                return false;
+            }
+            out[i] = (int)index;
+        }
+        return true;
+    }
+
+    void parse(const MappedFile& file)
+    {
+        // Split at line breaks into about 4 pieces per thread, at least 1 MB each
+        const char* begin = (const char*)file.data();
+        const char* end = begin + file.size();
+        const size_t pieceCount = std::max<size_t>(1, std::min<size_t>(WorkGetConcurrencyLimit() * 4, file.size() / (1 << 20)));
+        std::vector<textparse::Cursor> ranges;
+        const char* start = begin;
+        for (size_t p = 1; p <= pieceCount && start < end; p++)
+        {
+            const char* split = p == pieceCount ? end : begin + file.size() * p / pieceCount;
+            if (split < start)
+            {
+                continue;
+            }
+            const void* newline = memchr(split, '\n', (size_t)(end - split));
+            split = newline && split != end ? (const char*)newline + 1 : end;
+            ranges.push_back({ start, split });
+            start = split;
+        }
+
+        std::vector<Piece> pieces(ranges.size());
+        WorkParallelForN(
+            ranges.size(),
+            [&ranges, &pieces](size_t first, size_t last)
+            {
+                for (size_t p = first; p < last; ++p)
+                {
+                    parsePiece(ranges[p], pieces[p]);
+                }
+            }
+        );
+
+        // Offsets of every piece's elements in the combined arrays
+        struct Offsets
+        {
+            size_t positions = 0, uvs = 0, normals = 0, faces = 0, corners = 0;
+        };
+        std::vector<Offsets> offsets(pieces.size() + 1);
+        for (size_t p = 0; p < pieces.size(); p++)
+        {
+            offsets[p + 1].positions = offsets[p].positions + pieces[p].positions.size();
+            offsets[p + 1].uvs = offsets[p].uvs + pieces[p].uvs.size();
+            offsets[p + 1].normals = offsets[p].normals + pieces[p].normals.size();
+            offsets[p + 1].faces = offsets[p].faces + pieces[p].faceCorners.size();
+            offsets[p + 1].corners = offsets[p].corners + pieces[p].cornerPositions.size();
+        }
+        const Offsets& total = offsets.back();
+        m_positions.resize(total.positions);
+        m_uvs.resize(total.uvs);
+        m_normals.resize(total.normals);
+        m_faceCorners.resize(total.faces);
+        m_cornerPositions.resize(total.corners);
+        m_cornerUvs.resize(total.corners);
+        m_cornerNormals.resize(total.corners);
+
+        std::vector<char> valid(pieces.size(), 1);
+        WorkParallelForN(
+            pieces.size(),
+            [&](size_t first, size_t last)
+            {
+                for (size_t p = first; p < last; ++p)
+                {
+                    const Piece& piece = pieces[p];
+                    const Offsets& offset = offsets[p];
+                    std::copy(piece.positions.begin(), piece.positions.end(), m_positions.begin() + offset.positions);
+                    std::copy(piece.uvs.begin(), piece.uvs.end(), m_uvs.begin() + offset.uvs);
+                    std::copy(piece.normals.begin(), piece.normals.end(), m_normals.begin() + offset.normals);
+                    for (size_t f = 0; f < piece.faceCorners.size(); f++)
+                    {
+                        m_faceCorners[offset.faces + f] = offset.corners + piece.faceCorners[f];
+                    }
+                    valid[p] = resolveIndices(piece.cornerPositions, offset.positions, total.positions, &m_cornerPositions[offset.corners], false) &&
+                        resolveIndices(piece.cornerUvs, offset.uvs, total.uvs, &m_cornerUvs[offset.corners], true) &&
+                        resolveIndices(piece.cornerNormals, offset.normals, total.normals, &m_cornerNormals[offset.corners], true);
+                }
+            }
+        );
+        if (std::find(valid.begin(), valid.end(), 0) != valid.end())
+        {
+            m_error = "a face refers to a vertex, texture coordinate or normal that is not defined";
+        }
+    }
+
+    template<class T>
+    static void copyCornerValues(const std::vector<int>& cornerIndices, const std::vector<T>& values, size_t firstCorner, size_t endCorner, VtArray<T>& out)
+    {
+        for (size_t corner = firstCorner; corner < endCorner; corner++)
+        {
+            if (cornerIndices[corner] < 0)
+            {
+                out.clear();
+                return;
+            }
+        }
+        out.resize(endCorner - firstCorner);
+        for (size_t corner = firstCorner; corner < endCorner; corner++)
+        {
+            out[corner - firstCorner] = values[cornerIndices[corner]];
+        }
+    }
+
+    size_t m_chunkTriangles;
+    std::vector<GfVec3f> m_positions;
+    std::vector<GfVec2f> m_uvs;
+    std::vector<GfVec3f> m_normals;
+    std::vector<size_t> m_faceCorners;
+    std::vector<int> m_cornerPositions;
+    std::vector<int> m_cornerUvs;
+    std::vector<int> m_cornerNormals;
+    std::vector<int> m_positionRemap;
+    std::vector<int> m_localIndex;
+    size_t m_nextFace = 0;
+    std::string m_error;
+};
@@ -0,0 +1,231 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Geometry Importer sample and parses the numbers of text
+// geometry formats (OBJ, ASCII STL, ASCII PLY, XYZ) straight out of a mapped file.
+//
+// strtod and streams handle locales, hex floats and arbitrary precision, and spend
+// most of their time doing so. Geometry files hold plain decimal numbers, so these
+// parsers read eight digits at a time with 64-bit integer arithmetic (SIMD within a
+// register) and only fall back to strtod for the rare number they cannot represent.
+///////////////////////////////////////////////////////////////////////////////////////
+
+namespace textparse
+{
+
+// A cursor over a read-only text buffer. Nothing is ever read at or after `end`.
+struct Cursor
+{
+    const char* pos;
+    const char* end;
+
+    bool atEnd() const
+    {
+        return pos >= end;
+    }
+};
+
+static inline bool isDigit(char c)
+{
+    return (unsigned char)(c - '0') < 10;
+}
+
+// Spaces and tabs, not newlines, so callers can tell where a line ends
+static inline void skipSpaces(Cursor& cursor)
+{
+    while (cursor.pos < cursor.end && (*cursor.pos == ' ' || *cursor.pos == '\t' || *cursor.pos == '\r'))
+    {
+        cursor.pos++;
+    }
+}
+
+static inline void skipLine(Cursor& cursor)
+{
+    const void* newline = memchr(cursor.pos, '\n', (size_t)(cursor.end - cursor.pos));
+    cursor.pos = newline ? (const char*)newline + 1 : cursor.end;
+}
+
+static inline void skipWhitespace(Cursor& cursor)
+{
+    while (cursor.pos < cursor.end && (*cursor.pos == ' ' || *cursor.pos == '\t' || *cursor.pos == '\r' || *cursor.pos == '\n'))
+    {
+        cursor.pos++;
+    }
+}
+
+// The next whitespace separated word, empty at the end of a line
+static inline std::string nextWord(Cursor& cursor)
+{
+    skipSpaces(cursor);
+    const char* start = cursor.pos;
+    while (cursor.pos < cursor.end && *cursor.pos != ' ' && *cursor.pos != '\t' && *cursor.pos != '\r' && *cursor.pos != '\n')
+    {
+        cursor.pos++;
+    }
+    return std::string(start, cursor.pos);
+}
+
+// True if the 8 bytes of `chunk` are all ASCII digits
+static inline bool isEightDigits(uint64_t chunk)
+{
+    return (((chunk & 0xF0F0F0F0F0F0F0F0ull) | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull);
+}
+
+// Convert 8 ASCII digits, first digit in the lowest byte, to their value with three multiplies instead of eight
+static inline uint32_t parseEightDigits(uint64_t chunk)
+{
+    chunk -= 0x3030303030303030ull;
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) + (((chunk >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    return (uint32_t)chunk;
+}
+
+// Accumulate digits into `mantissa`, returning the number of digits read.
+// Digits past the 19th no longer fit a uint64 and are counted in `dropped` instead.
+static inline int readDigits(Cursor& cursor, uint64_t& mantissa, int& dropped)
+{
+    int count = 0;
+    // 8 digits at a time while the result stays below 10^19
+    while (cursor.end - cursor.pos >= 8 && mantissa <= 99999999999ull)
+    {
+        uint64_t chunk;
+        memcpy(&chunk, cursor.pos, sizeof(chunk));
+        if (!isEightDigits(chunk))
+        {
+            break;
+        }
+        mantissa = mantissa * 100000000ull + parseEightDigits(chunk);
+        cursor.pos += 8;
+        count += 8;
+    }
+    while (cursor.pos < cursor.end && isDigit(*cursor.pos))
+    {
+        if (mantissa < 1000000000000000000ull)
+        {
+            mantissa = mantissa * 10 + (uint64_t)(*cursor.pos - '0');
+        }
+        else
+        {
+            dropped++;
+        }
+        cursor.pos++;
+        count++;
+    }
+    return count;
+}
+
+static const double kPowersOfTen[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+// Parse a decimal number ("-1.25e-3", "7", ".5", "nan" is not supported) at the cursor after skipping spaces.
+// Returns false and leaves the cursor where it was if there is no number.
+static inline bool parseDouble(Cursor& cursor, double& value)
+{
+    skipSpaces(cursor);
+    const char* start = cursor.pos;
+    bool negative = false;
+    if (cursor.pos < cursor.end && (*cursor.pos == '-' || *cursor.pos == '+'))
+    {
+        negative = *cursor.pos == '-';
+        cursor.pos++;
+    }
+
+    uint64_t mantissa = 0;
+    int dropped = 0;
+    int digits = readDigits(cursor, mantissa, dropped);
+    int exponent = dropped;
+    if (cursor.pos < cursor.end && *cursor.pos == '.')
+    {
+        cursor.pos++;
+        int ignored = 0;
+        int fraction = readDigits(cursor, mantissa, ignored);
+        digits += fraction;
+        exponent -= fraction - ignored;
+    }
+    if (digits == 0)
+    {
+        cursor.pos = start;
+        return false;
+    }
+    if (cursor.pos < cursor.end && (*cursor.pos == 'e' || *cursor.pos == 'E'))
+    {
+        const char* exponentStart = cursor.pos;
+        cursor.pos++;
+        bool negativeExponent = false;
+        if (cursor.pos < cursor.end && (*cursor.pos == '-' || *cursor.pos == '+'))
+        {
+            negativeExponent = *cursor.pos == '-';
+            cursor.pos++;
+        }
+        if (cursor.pos < cursor.end && isDigit(*cursor.pos))
+        {
+            int explicitExponent = 0;
+            while (cursor.pos < cursor.end && isDigit(*cursor.pos))
+            {
+                explicitExponent = explicitExponent < 10000 ? explicitExponent * 10 + (*cursor.pos - '0') : explicitExponent;
+                cursor.pos++;
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+        }
+        else
+        {
+            cursor.pos = exponentStart;
+        }
+    }
+
+    // Exact when the mantissa fits in 53 bits and the power of ten is exactly representable, otherwise let strtod round
+    if (mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double result = (double)mantissa;
+        result = exponent < 0 ? result / kPowersOfTen[-exponent] : result * kPowersOfTen[exponent];
+        value = negative ? -result : result;
+        return true;
+    }
+    std::string text(start, cursor.pos);
+    value = strtod(text.c_str(), nullptr);
+    return true;
+}
+
+static inline bool parseFloat(Cursor& cursor, float& value)
+{
+    double result;
+    if (!parseDouble(cursor, result))
+    {
+        return false;
+    }
+    value = (float)result;
+    return true;
+}
+
+// Parse a signed integer after skipping spaces
+static inline bool parseInt(Cursor& cursor, long long& value)
+{
+    skipSpaces(cursor);
+    const char* start = cursor.pos;
+    bool negative = false;
+    if (cursor.pos < cursor.end && (*cursor.pos == '-' || *cursor.pos == '+'))
+    {
+        negative = *cursor.pos == '-';
+        cursor.pos++;
+    }
+    uint64_t magnitude = 0;
+    int dropped = 0;
+    if (readDigits(cursor, magnitude, dropped) == 0)
+    {
+        cursor.pos = start;
+        return false;
+    }
+    value = negative ? -(long long)magnitude : (long long)magnitude;
+    return true;
+}
+
+} // namespace textparse
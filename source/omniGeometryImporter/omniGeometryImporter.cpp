@@ -0,0 +1,469 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+/*###############################################################################
+#
+# This "omniGeometryImporter" sample demonstrates how to:
+#  * connect to an Omniverse server
+#  * create a new stage and stream large meshes into it with definePolyMesh
+#  * memory map an input file and parse it without copying it
+#  * parse text numbers quickly and weld triangle soups with a hash grid
+#  * overlap reading the next chunk of geometry with authoring the current one
+#  * report throughput and peak memory
+#
+#  * supported inputs:
+#  *  .stl - binary or ASCII STL, welded into shared points
+#  *  .obj - Wavefront OBJ positions, texture coordinates, normals and faces
+#  *  .ply, .xyz, .pts - point clouds, split into spatial chunks that are
+#  *                     each written to a payload layer
+#
+###############################################################################*/
+
+#include "MappedFile.h"
+#include "Stopwatch.h"
+#include "importerCommon.h"
+#include "meshImport.h"
+#include "pointCloudImport.h"
+
+#include <omni/connect/core/Core.h>
+#include <omni/connect/core/Log.h>
+#include <omni/connect/core/PrimAlgo.h>
+#include <omni/connect/core/StageAlgo.h>
+#include <omni/connect/core/XformAlgo.h>
+
+#include <omni/core/OmniInit.h>
+#include <omni/log/ILog.h>
+
+#include <OmniClient.h>
+
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/metrics.h>
+#include <pxr/usd/usdGeom/xform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <future>
+#include <string>
+
+// Globals for Omniverse Connection and base Stage
+OMNI_APP_GLOBALS("GeometryImporter", "Omniverse Geometry Importer");
+
+// Startup Omniverse
+static bool startOmniverse(bool verbose)
+{
+    // Check that the core Omniverse frameworks started successfully
+    OMNICONNECTCORE_INIT();
+    if (!omni::connect::core::initialized())
+    {
+        return false;
+    }
+
+    // Set the retry behavior to limit retries so that invalid server addresses fail quickly
+    omniClientSetRetries({ 1000, 500, 0 });
+
+    auto log = omniGetLogWithoutAcquire();
+    log->setLevel(verbose ? omni::log::Level::eVerbose : omni::log::Level::eInfo);
+
+    return true;
+}
+
+// Print the command line arguments help
+static void printCmdLineArgHelp()
+{
+    OMNI_LOG_INFO(
+        "\nUsage: omniGeometryImporter <input_file> <stage_url> [options]\n"
+        "  options:\n"
+        "    -h, --help                Print this help\n"
+        "    -v, --verbose             Show the verbose Omniverse logging\n"
+        "    --chunk-triangles N       Author a mesh for every N triangles (default 1000000)\n"
+        "    --weld                    Weld the shared OBJ positions too (STL is always welded)\n"
+        "    --weld-tolerance T        Merge points closer than T (default 0, exact matches only)\n"
+        "    --up-axis y|z             The up axis of the input (default z)\n"
+        "    --meters-per-unit M       The length of one input unit in meters (default 0.001 for meshes, 1 for point clouds)\n"
+        "    --chunk-points N          Aim for N points per point cloud chunk (default 1000000)\n"
+        "    --point-width W           The width of the points in input units (default 1 cm)\n"
+        "    --xyz-columns KIND        What the last 3 of 6 columns in an XYZ or PTS file are: normals (default) or colors\n"
+        "\n\nExamples:\n"
+        " * import a binary STL into a new stage on the localhost server\n"
+        "    > omniGeometryImporter part.stl omniverse://localhost/Users/test/part.usd\n"
+        " * import a laser scan as chunks that load on demand\n"
+        "    > omniGeometryImporter scan.ply omniverse://localhost/Users/test/scan.usd --chunk-points 500000\n"
+    );
+}
+
+static std::string getExtension(const std::string& path)
+{
+    const size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
+static std::string getStem(const std::string& path)
+{
+    const size_t slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    const size_t dot = name.find_last_of('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+// Create the output stage with a default prim Xform to import into
+static UsdStageRefPtr createImportStage(const std::string& stageUrl, const ImporterArgs& args, double defaultMetersPerUnit)
+{
+    if (omni::connect::core::doesUriExist(stageUrl))
+    {
+        OMNI_LOG_ERROR("%s already exists, choose a new stage URL", stageUrl.c_str());
+        return UsdStageRefPtr();
+    }
+    const TfToken upAxis = args.getString("--up-axis", "z") == "y" ? UsdGeomTokens->y : UsdGeomTokens->z;
+    UsdStageRefPtr stage = omni::connect::core::createStage(stageUrl, TfToken("World"), upAxis, args.getDouble("--meters-per-unit", defaultMetersPerUnit));
+    if (!stage)
+    {
+        OMNI_LOG_ERROR("Failure to create stage: %s", stageUrl.c_str());
+        return UsdStageRefPtr();
+    }
+    omni::connect::core::defineXform(stage, stage->GetDefaultPrim().GetPath());
+    return stage;
+}
+
+// Author every chunk a reader produces under `parent`, reading the next chunk on another thread while the current one
+// is being authored. The stage is only ever written from this thread.
+template<class Reader>
+static bool streamChunks(Reader& reader, UsdPrim parent, size_t& triangles, size_t& inputVertices, size_t& points)
+{
+    auto readNext = [&reader]()
+    {
+        MeshChunk chunk;
+        return reader.nextChunk(chunk) ? std::optional<MeshChunk>(std::move(chunk)) : std::nullopt;
+    };
+
+    std::future<std::optional<MeshChunk>> next = std::async(std::launch::async, readNext);
+    size_t index = 0;
+    while (true)
+    {
+        std::optional<MeshChunk> chunk = next.get();
+        if (!chunk)
+        {
+            break;
+        }
+        next = std::async(std::launch::async, readNext);
+
+        char name[32];
+        snprintf(name, sizeof(name), "Chunk_%04zu", index++);
+        if (!authorChunk(parent, name, *chunk))
+        {
+            next.wait();
+            return false;
+        }
+        triangles += chunk->triangleCount();
+        inputVertices += chunk->inputVertices;
+        points += chunk->points.size();
+        OMNI_LOG_VERBOSE("Authored %s: %zu points, %zu faces", name, chunk->points.size(), chunk->faceVertexCounts.size());
+    }
+    return true;
+}
+
+// Import an STL or OBJ file as a set of meshes under one Xform
+static int importMesh(const ImporterArgs& args, const std::string& inputPath, const std::string& stageUrl)
+{
+    const std::string extension = getExtension(inputPath);
+    const size_t chunkTriangles = (size_t)std::max(1L, args.getInt("--chunk-triangles", 1000000));
+    const float weldTolerance = (float)std::max(0.0, args.getDouble("--weld-tolerance", 0.0));
+
+    Stopwatch totalTimer;
+    MappedFile file(inputPath);
+    if (!file.isOpen())
+    {
+        OMNI_LOG_ERROR("Could not open %s", inputPath.c_str());
+        return EXIT_FAILURE;
+    }
+    file.adviseSequential();
+
+    UsdStageRefPtr stage = createImportStage(stageUrl, args, 0.001);
+    if (!stage)
+    {
+        return EXIT_FAILURE;
+    }
+    UsdPrim defaultPrim = stage->GetDefaultPrim();
+    const TfToken meshName = omni::connect::core::getValidChildNames(defaultPrim, { getStem(inputPath) })[0];
+    UsdGeomXform parent = omni::connect::core::defineXform(defaultPrim, meshName);
+    omni::connect::core::setDisplayName(parent.GetPrim(), getStem(inputPath));
+
+    size_t triangles = 0;
+    size_t inputVertices = 0;
+    size_t points = 0;
+    bool ok = false;
+    if (extension == "stl")
+    {
+        StlReader reader(file, chunkTriangles, weldTolerance);
+        OMNI_LOG_INFO("Importing %s STL %s (%s)", reader.isBinary() ? "binary" : "ASCII", inputPath.c_str(), formatBytes((double)file.size()).c_str());
+        ok = streamChunks(reader, parent.GetPrim(), triangles, inputVertices, points);
+    }
+    else
+    {
+        Stopwatch parseTimer;
+        ObjReader reader(file, chunkTriangles, args.hasFlag("--weld"), weldTolerance);
+        if (!reader.error().empty())
+        {
+            OMNI_LOG_ERROR("Could not read %s: %s", inputPath.c_str(), reader.error().c_str());
+            return EXIT_FAILURE;
+        }
+        OMNI_LOG_INFO(
+            "Parsed OBJ %s (%s): %zu positions, %zu faces in %.1f ms",
+            inputPath.c_str(),
+            formatBytes((double)file.size()).c_str(),
+            reader.positionCount(),
+            reader.faceCount(),
+            parseTimer.milliseconds()
+        );
+        ok = streamChunks(reader, parent.GetPrim(), triangles, inputVertices, points);
+    }
+    if (!ok)
+    {
+        return EXIT_FAILURE;
+    }
+    const double importSeconds = totalTimer.seconds();
+
+    Stopwatch saveTimer;
+    omni::connect::core::saveStage(stage, "Import " + getStem(inputPath));
+    const double saveSeconds = saveTimer.seconds();
+
+    OMNI_LOG_INFO("Imported %zu triangles, welded %zu vertices to %zu points", triangles, inputVertices, points);
+    OMNI_LOG_INFO(
+        "Import %.1f ms (%.2f M triangles/sec), save %.1f ms, peak memory %s",
+        importSeconds * 1000.0,
+        importSeconds > 0.0 ? triangles / importSeconds / 1e6 : 0.0,
+        saveSeconds * 1000.0,
+        formatBytes((double)peakMemoryBytes()).c_str()
+    );
+    return EXIT_SUCCESS;
+}
+
+// Import a PLY, XYZ or PTS point cloud as a grid of chunks, each a UsdGeomPoints prim in its own payload layer
+static int importPointCloud(const ImporterArgs& args, const std::string& inputPath, const std::string& stageUrl)
+{
+    const std::string extension = getExtension(inputPath);
+    const size_t chunkPoints = (size_t)std::max(1L, args.getInt("--chunk-points", 1000000));
+    const std::string xyzColumns = args.getString("--xyz-columns", "normals");
+    if (xyzColumns != "normals" && xyzColumns != "colors")
+    {
+        OMNI_LOG_ERROR("ERROR: --xyz-columns must be normals or colors, not %s", xyzColumns.c_str());
+        return EXIT_FAILURE;
+    }
+    const SixColumns sixColumns = xyzColumns == "colors" ? SixColumns::Colors : SixColumns::Normals;
+
+    Stopwatch totalTimer;
+    MappedFile file(inputPath);
+    if (!file.isOpen())
+    {
+        OMNI_LOG_ERROR("Could not open %s", inputPath.c_str());
+        return EXIT_FAILURE;
+    }
+    file.adviseSequential();
+
+    Stopwatch parseTimer;
+    PointCloud cloud;
+    if (!(extension == "ply" ? readPly(file, cloud) : readXyz(file, sixColumns, cloud)))
+    {
+        OMNI_LOG_ERROR("Could not read %s: %s", inputPath.c_str(), cloud.error.c_str());
+        return EXIT_FAILURE;
+    }
+    const size_t skippedPoints = removeNonFinitePoints(cloud);
+    const double parseMs = parseTimer.milliseconds();
+    if (skippedPoints > 0)
+    {
+        OMNI_LOG_WARN("Skipped %zu points with NaN or infinite coordinates", skippedPoints);
+    }
+    const size_t pointCount = cloud.positions.size();
+    if (pointCount == 0)
+    {
+        OMNI_LOG_ERROR("%s has no points", inputPath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    Stopwatch partitionTimer;
+    const ChunkGrid grid = buildChunkGrid(cloud.positions, chunkPoints);
+    const PointChunks chunks = partitionPoints(cloud, grid);
+    const bool hasColors = !chunks.colors.empty();
+    const bool hasNormals = !chunks.normals.empty();
+    cloud = PointCloud();
+    const double partitionMs = partitionTimer.milliseconds();
+
+    UsdStageRefPtr stage = createImportStage(stageUrl, args, 1.0);
+    if (!stage)
+    {
+        return EXIT_FAILURE;
+    }
+    const double metersPerUnit = UsdGeomGetStageMetersPerUnit(stage);
+    const TfToken upAxis = UsdGeomGetStageUpAxis(stage);
+    const float width = (float)args.getDouble("--point-width", 0.01 / metersPerUnit);
+    UsdPrim defaultPrim = stage->GetDefaultPrim();
+    const std::string stem = getStem(inputPath);
+    const TfToken cloudName = omni::connect::core::getValidChildNames(defaultPrim, { stem })[0];
+    UsdGeomXform parent = omni::connect::core::defineXform(defaultPrim, cloudName);
+    omni::connect::core::setDisplayName(parent.GetPrim(), stem);
+
+    // Chunks are named after their grid cell and written next to the stage in a folder named after the input
+    const size_t chunkCount = chunks.cells.size();
+    std::vector<std::string> names(chunkCount);
+    std::vector<std::string> relativePaths(chunkCount);
+    std::vector<std::string> urls(chunkCount);
+    const SdfLayerHandle rootLayer = stage->GetRootLayer();
+    for (size_t k = 0; k < chunkCount; k++)
+    {
+        const uint32_t cell = chunks.cells[k];
+        const int x = (int)(cell % grid.dims[0]);
+        const int y = (int)((cell / grid.dims[0]) % grid.dims[1]);
+        const int z = (int)(cell / ((size_t)grid.dims[0] * grid.dims[1]));
+        names[k] = "Chunk_" + std::to_string(x) + "_" + std::to_string(y) + "_" + std::to_string(z);
+        relativePaths[k] = "./" + cloudName.GetString() + "_chunks/" + names[k] + ".usdc";
+        urls[k] = SdfComputeAssetPathRelativeToLayer(rootLayer, relativePaths[k]);
+    }
+
+    // Every chunk is an independent layer, so they are built and written in parallel
+    Stopwatch writeTimer;
+    std::vector<VtVec3fArray> extents(chunkCount);
+    std::vector<uint64_t> chunkSizes(chunkCount, 0);
+    std::vector<char> written(chunkCount, 0);
+    WorkParallelForN(
+        chunkCount,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t k = begin; k < end; ++k)
+            {
+                const size_t first = chunks.offsets[k];
+                const size_t count = chunks.offsets[k + 1] - first;
+                SdfLayerRefPtr layer = buildChunkLayer(
+                    chunks.positions.data() + first,
+                    hasColors ? chunks.colors.data() + first : nullptr,
+                    hasNormals ? chunks.normals.data() + first : nullptr,
+                    count,
+                    width,
+                    upAxis,
+                    metersPerUnit,
+                    extents[k]
+                );
+                written[k] = layer->Export(urls[k], "Point cloud chunk written by omniGeometryImporter") ? 1 : 0;
+                chunkSizes[k] = written[k] ? getFileSize(urls[k]) : 0;
+            }
+        }
+    );
+    const double writeMs = writeTimer.milliseconds();
+
+    // The root layer gets one prim per chunk with a payload and the chunk's extent, authored in a single change block
+    size_t failedChunks = 0;
+    {
+        SdfChangeBlock changeBlock;
+        SdfPrimSpecHandle parentSpec = rootLayer->GetPrimAtPath(parent.GetPath());
+        for (size_t k = 0; k < chunkCount; k++)
+        {
+            if (!written[k])
+            {
+                OMNI_LOG_ERROR("Failed to write %s", urls[k].c_str());
+                failedChunks++;
+                continue;
+            }
+            SdfPrimSpecHandle chunkSpec = SdfPrimSpec::New(parentSpec, names[k], SdfSpecifierDef, "Points");
+            chunkSpec->GetPayloadList().Append(SdfPayload(relativePaths[k]));
+            SdfAttributeSpec::New(chunkSpec, UsdGeomTokens->extent, SdfValueTypeNames->Float3Array)->SetDefaultValue(VtValue(extents[k]));
+        }
+    }
+    const double importSeconds = totalTimer.seconds();
+    omni::connect::core::saveStage(stage, "Import " + stem);
+
+    uint64_t chunkBytes = 0;
+    for (uint64_t size : chunkSizes)
+    {
+        chunkBytes += size;
+    }
+    OMNI_LOG_INFO(
+        "Imported %zu points%s%s into %zu chunks (grid %d x %d x %d), skipped %zu non-finite points",
+        pointCount,
+        hasColors ? " with colors" : "",
+        hasNormals ? (hasColors ? " and normals" : " with normals") : "",
+        chunkCount,
+        grid.dims[0],
+        grid.dims[1],
+        grid.dims[2],
+        skippedPoints
+    );
+    OMNI_LOG_INFO(
+        "Parse %.1f ms, partition %.1f ms, write %.1f ms, total %.1f ms (%.2f M points/sec), peak memory %s",
+        parseMs,
+        partitionMs,
+        writeMs,
+        importSeconds * 1000.0,
+        importSeconds > 0.0 ? pointCount / importSeconds / 1e6 : 0.0,
+        formatBytes((double)peakMemoryBytes()).c_str()
+    );
+    OMNI_LOG_INFO(
+        "Input %s, root layer %s, chunk layers %s",
+        formatBytes((double)file.size()).c_str(),
+        formatBytes((double)getFileSize(stageUrl)).c_str(),
+        formatBytes((double)chunkBytes).c_str()
+    );
+    if (failedChunks > 0)
+    {
+        OMNI_LOG_ERROR("%zu of %zu chunks could not be written, the stage is missing their points", failedChunks, chunkCount);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Main Application
+int main(int argc, char* argv[])
+{
+    bool verbose = false;
+    for (int x = 1; x < argc; x++)
+    {
+        if (strcmp(argv[x], "-h") == 0 || strcmp(argv[x], "--help") == 0)
+        {
+            startOmniverse(false);
+            printCmdLineArgHelp();
+            return EXIT_SUCCESS;
+        }
+        if (strcmp(argv[x], "-v") == 0 || strcmp(argv[x], "--verbose") == 0)
+        {
+            verbose = true;
+        }
+    }
+
+    if (!startOmniverse(verbose))
+    {
+        return EXIT_FAILURE;
+    }
+
+    ImporterArgs args(argc, argv, 1);
+    const std::string inputPath = args.positional(0);
+    const std::string stageUrl = args.positional(1);
+    if (inputPath.empty() || stageUrl.empty())
+    {
+        OMNI_LOG_ERROR("ERROR: An input file and a stage URL are required.");
+        printCmdLineArgHelp();
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_FAILURE;
+    const std::string extension = getExtension(inputPath);
+    if (extension == "stl" || extension == "obj")
+    {
+        result = importMesh(args, inputPath, stageUrl);
+    }
+    else if (extension == "ply" || extension == "xyz" || extension == "pts")
+    {
+        result = importPointCloud(args, inputPath, stageUrl);
+    }
+    else
+    {
+        OMNI_LOG_ERROR("ERROR: Unsupported input format: %s", inputPath.c_str());
+        printCmdLineArgHelp();
+    }
+
+    // Calling this prior to shutdown ensures that all pending updates complete.
+    omniClientLiveWaitForPendingUpdates();
+
+    return result;
+}
@@ -0,0 +1,810 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "MappedFile.h"
+#include "importerCommon.h"
+#include "numberParser.h"
+
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/layerUtils.h>
+#include <pxr/usd/sdf/payload.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/types.h>
+#include <pxr/usd/usdGeom/tokens.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Geometry Importer sample and reads PLY and XYZ point
+// clouds, splits them into a grid of spatial chunks and writes every chunk to its own
+// layer as a UsdGeomPoints prim that the stage loads through a payload.
+//
+// A laser scan of hundreds of millions of points is too large to load at once. With
+// one payload per grid cell, and the cell's extent authored in the root layer, a
+// viewer can open the stage with nothing loaded and then load only the chunks near
+// the camera.
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct PointCloud
+{
+    std::vector<GfVec3f> positions;
+    std::vector<GfVec3f> colors;
+    std::vector<GfVec3f> normals;
+    std::string error;
+};
+
+// Split a text region at line breaks into about 4 pieces per thread, at least 1 MB each
+static std::vector<textparse::Cursor> splitLines(const char* begin, const char* end)
+{
+    const size_t size = (size_t)(end - begin);
+    const size_t pieceCount = std::max<size_t>(1, std::min<size_t>(WorkGetConcurrencyLimit() * 4, size / (1 << 20)));
+    std::vector<textparse::Cursor> pieces;
+    const char* start = begin;
+    for (size_t p = 1; p <= pieceCount && start < end; p++)
+    {
+        const char* split = p == pieceCount ? end : begin + size * p / pieceCount;
+        if (split < start)
+        {
+            continue;
+        }
+        const void* newline = split < end ? memchr(split, '\n', (size_t)(end - split)) : nullptr;
+        split = newline ? (const char*)newline + 1 : end;
+        pieces.push_back({ start, split });
+        start = split;
+    }
+    return pieces;
+}
+
+// Color and normal columns for parseTextPoints: none, or found per line from the number of columns
+constexpr int kNoColumn = -2;
+constexpr int kGuessColumn = -1;
+
+// How the guess reads a line of 6 columns, which both XYZ variants write
+enum class SixColumns
+{
+    Normals, // x y z nx ny nz
+    Colors // x y z r g b
+};
+
+// Read whitespace separated numbers a line at a time, in parallel pieces, and keep the position, color and normal
+// columns. Guessed columns come after the position: 6 columns are normals or colors as `sixColumns` says, 7 or more are
+// x y z intensity r g b, as PTS files write them.
+static void parseTextPoints(
+    const char* begin,
+    const char* end,
+    int xColumn,
+    int colorColumn,
+    int normalColumn,
+    SixColumns sixColumns,
+    size_t maxPoints,
+    PointCloud& cloud
+)
+{
+    struct Piece
+    {
+        std::vector<GfVec3f> positions;
+        std::vector<GfVec3f> colors;
+        std::vector<GfVec3f> normals;
+        // colors and normals line up with the positions before these points
+        size_t firstUncolored = SIZE_MAX;
+        size_t firstWithoutNormal = SIZE_MAX;
+    };
+    const std::vector<textparse::Cursor> ranges = splitLines(begin, end);
+    std::vector<Piece> pieces(ranges.size());
+    WorkParallelForN(
+        ranges.size(),
+        [&](size_t first, size_t last)
+        {
+            double values[16];
+            for (size_t p = first; p < last; ++p)
+            {
+                textparse::Cursor cursor = ranges[p];
+                Piece& piece = pieces[p];
+                while (!cursor.atEnd())
+                {
+                    int count = 0;
+                    while (count < 16 && textparse::parseDouble(cursor, values[count]))
+                    {
+                        count++;
+                    }
+                    textparse::skipLine(cursor);
+
+                    // Comments and header lines have no leading number
+                    if (count < xColumn + 3)
+                    {
+                        continue;
+                    }
+                    piece.positions.emplace_back((float)values[xColumn], (float)values[xColumn + 1], (float)values[xColumn + 2]);
+                    int column = colorColumn;
+                    int normal = normalColumn;
+                    if (colorColumn == kGuessColumn)
+                    {
+                        column = count >= 7 ? 4 : (count == 6 && sixColumns == SixColumns::Colors ? 3 : kNoColumn);
+                    }
+                    if (normalColumn == kGuessColumn)
+                    {
+                        normal = count == 6 && sixColumns == SixColumns::Normals ? 3 : kNoColumn;
+                    }
+                    if (column >= 0 && column + 3 <= count)
+                    {
+                        piece.colors.emplace_back((float)values[column], (float)values[column + 1], (float)values[column + 2]);
+                    }
+                    else if (piece.firstUncolored == SIZE_MAX)
+                    {
+                        piece.firstUncolored = piece.positions.size() - 1;
+                    }
+                    if (normal >= 0 && normal + 3 <= count)
+                    {
+                        piece.normals.emplace_back((float)values[normal], (float)values[normal + 1], (float)values[normal + 2]);
+                    }
+                    else if (piece.firstWithoutNormal == SIZE_MAX)
+                    {
+                        piece.firstWithoutNormal = piece.positions.size() - 1;
+                    }
+                }
+            }
+        }
+    );
+
+    // Concatenate the first `maxPoints` in file order. Colors and normals are only kept if every one of those points
+    // has one, the lines after them (like the faces of a PLY file) don't count.
+    size_t total = 0;
+    bool allColored = true;
+    bool allNormals = true;
+    for (const Piece& piece : pieces)
+    {
+        const size_t take = std::min(piece.positions.size(), maxPoints - total);
+        allColored = allColored && piece.firstUncolored >= take;
+        allNormals = allNormals && piece.firstWithoutNormal >= take;
+        total += take;
+    }
+    cloud.positions.reserve(total);
+    if (allColored)
+    {
+        cloud.colors.reserve(total);
+    }
+    if (allNormals)
+    {
+        cloud.normals.reserve(total);
+    }
+    for (const Piece& piece : pieces)
+    {
+        const size_t take = std::min(piece.positions.size(), total - cloud.positions.size());
+        cloud.positions.insert(cloud.positions.end(), piece.positions.begin(), piece.positions.begin() + take);
+        if (allColored)
+        {
+            cloud.colors.insert(cloud.colors.end(), piece.colors.begin(), piece.colors.begin() + take);
+        }
+        if (allNormals)
+        {
+            cloud.normals.insert(cloud.normals.end(), piece.normals.begin(), piece.normals.begin() + take);
+        }
+    }
+
+    // Colors written as 0-255 integers are scaled to the 0-1 range of displayColor
+    float maxComponent = 0.0f;
+    for (const GfVec3f& color : cloud.colors)
+    {
+        maxComponent = std::max(maxComponent, std::max(color[0], std::max(color[1], color[2])));
+    }
+    if (maxComponent > 1.0f)
+    {
+        for (GfVec3f& color : cloud.colors)
+        {
+            color /= 255.0f;
+        }
+    }
+}
+
+static bool readXyz(const MappedFile& file, SixColumns sixColumns, PointCloud& cloud)
+{
+    const char* begin = (const char*)file.data();
+    parseTextPoints(begin, begin + file.size(), 0, kGuessColumn, kGuessColumn, sixColumns, SIZE_MAX, cloud);
+    return true;
+}
+
+// The parts of a PLY header the importer needs: where the vertex records are and how to read x, y, z, the colors and
+// the normals
+struct PlyLayout
+{
+    enum Format
+    {
+        Ascii,
+        BinaryLittleEndian,
+        BinaryBigEndian
+    };
+    struct Property
+    {
+        std::string name;
+        std::string type;
+        size_t size = 0;
+        size_t offset = 0;
+    };
+
+    Format format = Ascii;
+    size_t vertexCount = 0;
+    std::vector<Property> properties;
+    size_t recordSize = 0;
+    size_t dataOffset = 0;
+    // Text lines or binary bytes of the elements that come before the vertices
+    size_t skipLines = 0;
+    size_t skipBytes = 0;
+    std::string error;
+
+    int find(const char* name) const
+    {
+        for (size_t i = 0; i < properties.size(); i++)
+        {
+            if (properties[i].name == name)
+            {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+};
+
+static size_t plyTypeSize(const std::string& type)
+{
+    if (type == "char" || type == "uchar" || type == "int8" || type == "uint8")
+    {
+        return 1;
+    }
+    if (type == "short" || type == "ushort" || type == "int16" || type == "uint16")
+    {
+        return 2;
+    }
+    if (type == "int" || type == "uint" || type == "int32" || type == "uint32" || type == "float" || type == "float32")
+    {
+        return 4;
+    }
+    if (type == "double" || type == "float64")
+    {
+        return 8;
+    }
+    return 0;
+}
+
+static PlyLayout readPlyHeader(const MappedFile& file)
+{
+    PlyLayout layout;
+    textparse::Cursor cursor = { (const char*)file.data(), (const char*)file.data() + file.size() };
+    if (textparse::nextWord(cursor) != "ply")
+    {
+        layout.error = "not a PLY file";
+        return layout;
+    }
+
+    std::string element;
+    size_t elementCount = 0;
+    bool elementFixedSize = true;
+    size_t elementRecordSize = 0;
+    bool vertexSeen = false;
+    auto closeElement = [&]()
+    {
+        // Elements before the vertices are skipped: lines in text files, bytes in binary files (if their size is fixed)
+        if (!element.empty() && element != "vertex" && !vertexSeen)
+        {
+            layout.skipLines += elementCount;
+            layout.skipBytes += elementCount * elementRecordSize;
+            if (!elementFixedSize && layout.format != PlyLayout::Ascii)
+            {
+                layout.error = "binary PLY files with list elements before the vertices are not supported";
+            }
+        }
+        if (element == "vertex")
+        {
+            vertexSeen = true;
+        }
+    };
+
+    while (!cursor.atEnd())
+    {
+        textparse::skipLine(cursor);
+        const std::string keyword = textparse::nextWord(cursor);
+        if (keyword == "format")
+        {
+            const std::string format = textparse::nextWord(cursor);
+            layout.format = format == "ascii" ? PlyLayout::Ascii
+                                              : (format == "binary_big_endian" ? PlyLayout::BinaryBigEndian : PlyLayout::BinaryLittleEndian);
+        }
+        else if (keyword == "element")
+        {
+            closeElement();
+            element = textparse::nextWord(cursor);
+            long long count = 0;
+            textparse::parseInt(cursor, count);
+            elementCount = (size_t)std::max(0LL, count);
+            elementFixedSize = true;
+            elementRecordSize = 0;
+            if (element == "vertex")
+            {
+                layout.vertexCount = elementCount;
+            }
+        }
+        else if (keyword == "property")
+        {
+            const std::string type = textparse::nextWord(cursor);
+            if (type == "list")
+            {
+                elementFixedSize = false;
+                if (element == "vertex")
+                {
+                    layout.error = "PLY vertices with list properties are not supported";
+                }
+                continue;
+            }
+            const size_t size = plyTypeSize(type);
+            elementRecordSize += size;
+            if (element == "vertex")
+            {
+                PlyLayout::Property property;
+                property.type = type;
+                property.name = textparse::nextWord(cursor);
+                property.size = size;
+                property.offset = layout.recordSize;
+                layout.recordSize += size;
+                layout.properties.push_back(property);
+            }
+        }
+        else if (keyword == "end_header")
+        {
+            closeElement();
+            textparse::skipLine(cursor);
+            layout.dataOffset = (size_t)(cursor.pos - (const char*)file.data());
+            break;
+        }
+    }
+    if (layout.error.empty() && (layout.find("x") < 0 || layout.find("y") < 0 || layout.find("z") < 0))
+    {
+        layout.error = "the PLY vertices have no x, y and z properties";
+    }
+    return layout;
+}
+
+// Read one scalar of any PLY type as a float, swapping bytes for big endian files
+static inline float readPlyScalar(const uint8_t* data, const PlyLayout::Property& property, bool swap)
+{
+    uint8_t bytes[8];
+    memcpy(bytes, data, property.size);
+    if (swap)
+    {
+        std::reverse(bytes, bytes + property.size);
+    }
+    const std::string& type = property.type;
+    switch (property.size)
+    {
+        case 1:
+            return type[0] == 'u' ? (float)bytes[0] : (float)(int8_t)bytes[0];
+        case 2:
+        {
+            uint16_t value;
+            memcpy(&value, bytes, 2);
+            return type[0] == 'u' ? (float)value : (float)(int16_t)value;
+        }
+        case 4:
+        {
+            if (type[0] == 'f')
+            {
+                float value;
+                memcpy(&value, bytes, 4);
+                return value;
+            }
+            uint32_t value;
+            memcpy(&value, bytes, 4);
+            return type[0] == 'u' ? (float)value : (float)(int32_t)value;
+        }
+        case 8:
+        {
+            double value;
+            memcpy(&value, bytes, 8);
+            return (float)value;
+        }
+    }
+    return 0.0f;
+}
+
+static bool readPly(const MappedFile& file, PointCloud& cloud)
+{
+    const PlyLayout layout = readPlyHeader(file);
+    if (!layout.error.empty())
+    {
+        cloud.error = layout.error;
+        return false;
+    }
+
+    int colorProperties[3] = { layout.find("red"), layout.find("green"), layout.find("blue") };
+    if (colorProperties[0] < 0)
+    {
+        colorProperties[0] = layout.find("diffuse_red");
+        colorProperties[1] = layout.find("diffuse_green");
+        colorProperties[2] = layout.find("diffuse_blue");
+    }
+    const bool hasColors = colorProperties[0] >= 0 && colorProperties[1] >= 0 && colorProperties[2] >= 0;
+    const int normalProperties[3] = { layout.find("nx"), layout.find("ny"), layout.find("nz") };
+    const bool hasNormals = normalProperties[0] >= 0 && normalProperties[1] >= 0 && normalProperties[2] >= 0;
+
+    if (layout.format == PlyLayout::Ascii)
+    {
+        // Property order is the column order, x, y and z are nearly always the first three
+        textparse::Cursor cursor = { (const char*)file.data() + layout.dataOffset, (const char*)file.data() + file.size() };
+        for (size_t line = 0; line < layout.skipLines && !cursor.atEnd(); line++)
+        {
+            textparse::skipLine(cursor);
+        }
+        const int xColumn = layout.find("x");
+        if (layout.find("y") != xColumn + 1 || layout.find("z") != xColumn + 2 ||
+            (hasColors && (colorProperties[1] != colorProperties[0] + 1 || colorProperties[2] != colorProperties[0] + 2)))
+        {
+            cloud.error = "ASCII PLY files need x, y, z (and red, green, blue) in consecutive properties";
+            return false;
+        }
+        // Normals are optional, so ones that are not in consecutive properties are left out rather than failing the import
+        const bool consecutiveNormals = hasNormals && normalProperties[1] == normalProperties[0] + 1 && normalProperties[2] == normalProperties[0] + 2;
+        parseTextPoints(
+            cursor.pos,
+            cursor.end,
+            xColumn,
+            hasColors ? colorProperties[0] : kNoColumn,
+            consecutiveNormals ? normalProperties[0] : kNoColumn,
+            SixColumns::Normals,
+            layout.vertexCount,
+            cloud
+        );
+        if (cloud.positions.size() != layout.vertexCount)
+        {
+            cloud.error = "the file has fewer vertices than its header declares";
+            return false;
+        }
+        return true;
+    }
+
+    const size_t start = layout.dataOffset + layout.skipBytes;
+    if (start + layout.vertexCount * layout.recordSize > file.size())
+    {
+        cloud.error = "the file is shorter than its header declares";
+        return false;
+    }
+
+    // Fixed size records decode independently, so they are decoded in parallel straight from the mapping
+    const bool swap = layout.format == PlyLayout::BinaryBigEndian;
+    const PlyLayout::Property& x = layout.properties[layout.find("x")];
+    const PlyLayout::Property& y = layout.properties[layout.find("y")];
+    const PlyLayout::Property& z = layout.properties[layout.find("z")];
+    const bool colorBytes = hasColors && layout.properties[colorProperties[0]].size == 1;
+    cloud.positions.resize(layout.vertexCount);
+    cloud.colors.resize(hasColors ? layout.vertexCount : 0);
+    cloud.normals.resize(hasNormals ? layout.vertexCount : 0);
+    const uint8_t* records = file.data() + start;
+    WorkParallelForN(
+        layout.vertexCount,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                const uint8_t* record = records + i * layout.recordSize;
+                cloud.positions[i] = GfVec3f(readPlyScalar(record + x.offset, x, swap), readPlyScalar(record + y.offset, y, swap), readPlyScalar(record + z.offset, z, swap));
+                if (hasColors)
+                {
+                    GfVec3f color;
+                    for (int c = 0; c < 3; c++)
+                    {
+                        const PlyLayout::Property& property = layout.properties[colorProperties[c]];
+                        color[c] = readPlyScalar(record + property.offset, property, swap);
+                    }
+                    cloud.colors[i] = colorBytes ? color / 255.0f : color;
+                }
+                if (hasNormals)
+                {
+                    for (int c = 0; c < 3; c++)
+                    {
+                        const PlyLayout::Property& property = layout.properties[normalProperties[c]];
+                        cloud.normals[i][c] = readPlyScalar(record + property.offset, property, swap);
+                    }
+                }
+            }
+        }
+    );
+    return true;
+}
+
+// Remove the points with a NaN or infinite coordinate, which have no place in the grid (and would make the cell index
+// conversion undefined), along with their colors and normals. Returns how many were removed.
+static size_t removeNonFinitePoints(PointCloud& cloud)
+{
+    const size_t count = cloud.positions.size();
+    std::atomic<size_t> nonFinite(0);
+    WorkParallelForN(
+        count,
+        [&](size_t begin, size_t end)
+        {
+            size_t found = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                const GfVec3f& point = cloud.positions[i];
+                found += std::isfinite(point[0]) && std::isfinite(point[1]) && std::isfinite(point[2]) ? 0 : 1;
+            }
+            nonFinite.fetch_add(found, std::memory_order_relaxed);
+        }
+    );
+    if (nonFinite.load() == 0)
+    {
+        return 0;
+    }
+
+    // Scans rarely have any, so compacting the arrays in order is done only when needed
+    const bool hasColors = !cloud.colors.empty();
+    const bool hasNormals = !cloud.normals.empty();
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const GfVec3f& point = cloud.positions[i];
+        if (!std::isfinite(point[0]) || !std::isfinite(point[1]) || !std::isfinite(point[2]))
+        {
+            continue;
+        }
+        cloud.positions[kept] = point;
+        if (hasColors)
+        {
+            cloud.colors[kept] = cloud.colors[i];
+        }
+        if (hasNormals)
+        {
+            cloud.normals[kept] = cloud.normals[i];
+        }
+        kept++;
+    }
+    cloud.positions.resize(kept);
+    cloud.colors.resize(hasColors ? kept : 0);
+    cloud.normals.resize(hasNormals ? kept : 0);
+    return count - kept;
+}
+
+// A uniform grid over the cloud's bounds with about `pointsPerCell` points per cell if the points were spread evenly.
+// Flat scans (a floor, a facade) only get cells along the axes they extend in.
+struct ChunkGrid
+{
+    GfVec3f origin;
+    float cellSize = 1.0f;
+    int dims[3] = { 1, 1, 1 };
+
+    size_t cellCount() const
+    {
+        return (size_t)dims[0] * dims[1] * dims[2];
+    }
+
+    uint32_t cellOf(const GfVec3f& point) const
+    {
+        int cell[3];
+        for (int a = 0; a < 3; a++)
+        {
+            cell[a] = std::min(dims[a] - 1, std::max(0, (int)((point[a] - origin[a]) / cellSize)));
+        }
+        return (uint32_t)((cell[2] * dims[1] + cell[1]) * dims[0] + cell[0]);
+    }
+};
+
+static ChunkGrid buildChunkGrid(const std::vector<GfVec3f>& positions, size_t pointsPerCell)
+{
+    // Bounds over blocks of points in parallel, then over the blocks
+    const size_t blockCount = std::max<size_t>(1, std::min<size_t>(positions.size() / 65536 + 1, 1024));
+    std::vector<GfVec3f> blockMin(blockCount, GfVec3f(FLT_MAX));
+    std::vector<GfVec3f> blockMax(blockCount, GfVec3f(-FLT_MAX));
+    WorkParallelForN(
+        blockCount,
+        [&](size_t first, size_t last)
+        {
+            for (size_t b = first; b < last; ++b)
+            {
+                const size_t begin = positions.size() * b / blockCount;
+                const size_t end = positions.size() * (b + 1) / blockCount;
+                GfVec3f low(FLT_MAX);
+                GfVec3f high(-FLT_MAX);
+                for (size_t i = begin; i < end; i++)
+                {
+                    for (int a = 0; a < 3; a++)
+                    {
+                        low[a] = std::min(low[a], positions[i][a]);
+                        high[a] = std::max(high[a], positions[i][a]);
+                    }
+                }
+                blockMin[b] = low;
+                blockMax[b] = high;
+            }
+        }
+    );
+    GfVec3f low(FLT_MAX);
+    GfVec3f high(-FLT_MAX);
+    for (size_t b = 0; b < blockCount; b++)
+    {
+        for (int a = 0; a < 3; a++)
+        {
+            low[a] = std::min(low[a], blockMin[b][a]);
+            high[a] = std::max(high[a], blockMax[b][a]);
+        }
+    }
+
+    ChunkGrid grid;
+    grid.origin = low;
+    const GfVec3f size = high - low;
+    const float largest = std::max(size[0], std::max(size[1], size[2]));
+    const double targetCells = std::min(1e6, std::ceil((double)positions.size() / (double)std::max<size_t>(1, pointsPerCell)));
+    if (largest <= 0.0f || targetCells <= 1.0)
+    {
+        grid.cellSize = std::max(largest, 1.0f) * 1.0001f;
+        return grid;
+    }
+
+    // Cells are cubes sized so the axes with extent share the target cell count
+    double extentProduct = 1.0;
+    int extendedAxes = 0;
+    for (int a = 0; a < 3; a++)
+    {
+        if (size[a] > largest * 1e-3f)
+        {
+            extentProduct *= size[a];
+            extendedAxes++;
+        }
+    }
+    grid.cellSize = (float)std::pow(extentProduct / targetCells, 1.0 / extendedAxes);
+    for (int a = 0; a < 3; a++)
+    {
+        grid.dims[a] = std::max(1, (int)std::ceil(size[a] / grid.cellSize));
+    }
+    return grid;
+}
+
+// The points of each non-empty grid cell, stored contiguously per cell
+struct PointChunks
+{
+    std::vector<uint32_t> cells;
+    std::vector<size_t> offsets;
+    std::vector<GfVec3f> positions;
+    std::vector<GfVec3f> colors;
+    std::vector<GfVec3f> normals;
+};
+
+// Counting sort of the points into their cells: count in parallel, prefix sum, find each point's slot in parallel,
+// then move the points to their slots in place. The cloud's arrays become the chunks' arrays, so a second copy of
+// the cloud is never allocated. The order of the points within a cell depends on thread timing, which does not
+// matter for a point cloud.
+static PointChunks partitionPoints(PointCloud& cloud, const ChunkGrid& grid)
+{
+    const size_t count = cloud.positions.size();
+    std::vector<std::atomic<uint32_t>> cellCounts(grid.cellCount());
+    for (std::atomic<uint32_t>& cellCount : cellCounts)
+    {
+        cellCount.store(0, std::memory_order_relaxed);
+    }
+    WorkParallelForN(
+        count,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                cellCounts[grid.cellOf(cloud.positions[i])].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    );
+
+    PointChunks chunks;
+    std::vector<std::atomic<size_t>> cursors(grid.cellCount());
+    size_t offset = 0;
+    for (size_t cell = 0; cell < cellCounts.size(); cell++)
+    {
+        cursors[cell].store(offset, std::memory_order_relaxed);
+        const uint32_t cellCount = cellCounts[cell].load(std::memory_order_relaxed);
+        if (cellCount > 0)
+        {
+            chunks.cells.push_back((uint32_t)cell);
+            chunks.offsets.push_back(offset);
+            offset += cellCount;
+        }
+    }
+    chunks.offsets.push_back(offset);
+
+    std::vector<size_t> slots(count);
+    WorkParallelForN(
+        count,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                slots[i] = cursors[grid.cellOf(cloud.positions[i])].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    );
+
+    // Follow the cycles of the permutation, every swap puts one point in its final slot
+    const bool hasColors = !cloud.colors.empty();
+    const bool hasNormals = !cloud.normals.empty();
+    for (size_t i = 0; i < count; i++)
+    {
+        while (slots[i] != i)
+        {
+            const size_t slot = slots[i];
+            std::swap(cloud.positions[i], cloud.positions[slot]);
+            if (hasColors)
+            {
+                std::swap(cloud.colors[i], cloud.colors[slot]);
+            }
+            if (hasNormals)
+            {
+                std::swap(cloud.normals[i], cloud.normals[slot]);
+            }
+            std::swap(slots[i], slots[slot]);
+        }
+    }
+    chunks.positions = std::move(cloud.positions);
+    chunks.colors = std::move(cloud.colors);
+    chunks.normals = std::move(cloud.normals);
+    return chunks;
+}
+
+// Author a UsdGeomPoints prim holding one chunk into a new layer, at the Sdf level since the layer is not on a stage
+static SdfLayerRefPtr buildChunkLayer(
+    const GfVec3f* positions,
+    const GfVec3f* colors,
+    const GfVec3f* normals,
+    size_t count,
+    float width,
+    const TfToken& upAxis,
+    double metersPerUnit,
+    VtVec3fArray& extent
+)
+{
+    static const TfToken kChunkName("Chunk");
+    SdfLayerRefPtr layer = SdfLayer::CreateAnonymous(".usdc");
+    SdfPrimSpecHandle prim = SdfPrimSpec::New(layer->GetPseudoRoot(), kChunkName, SdfSpecifierDef, "Points");
+    layer->SetDefaultPrim(kChunkName);
+    layer->GetPseudoRoot()->SetInfo(UsdGeomTokens->upAxis, VtValue(upAxis));
+    layer->GetPseudoRoot()->SetInfo(UsdGeomTokens->metersPerUnit, VtValue(metersPerUnit));
+
+    VtVec3fArray points(positions, positions + count);
+    GfVec3f low(FLT_MAX);
+    GfVec3f high(-FLT_MAX);
+    for (const GfVec3f& point : points)
+    {
+        for (int a = 0; a < 3; a++)
+        {
+            low[a] = std::min(low[a], point[a]);
+            high[a] = std::max(high[a], point[a]);
+        }
+    }
+    // Extents include the point widths
+    const GfVec3f radius(width * 0.5f);
+    extent = { low - radius, high + radius };
+
+    SdfAttributeSpec::New(prim, UsdGeomTokens->points, SdfValueTypeNames->Point3fArray)->SetDefaultValue(VtValue::Take(points));
+    SdfAttributeSpec::New(prim, UsdGeomTokens->extent, SdfValueTypeNames->Float3Array)->SetDefaultValue(VtValue(extent));
+    SdfAttributeSpecHandle widths = SdfAttributeSpec::New(prim, UsdGeomTokens->widths, SdfValueTypeNames->FloatArray);
+    widths->SetDefaultValue(VtValue(VtFloatArray(1, width)));
+    widths->SetInfo(UsdGeomTokens->interpolation, VtValue(UsdGeomTokens->constant));
+    if (colors)
+    {
+        SdfAttributeSpecHandle displayColor = SdfAttributeSpec::New(prim, UsdGeomTokens->primvarsDisplayColor, SdfValueTypeNames->Color3fArray);
+        displayColor->SetDefaultValue(VtValue(VtVec3fArray(colors, colors + count)));
+        displayColor->SetInfo(UsdGeomTokens->interpolation, VtValue(UsdGeomTokens->vertex));
+    }
+    if (normals)
+    {
+        SdfAttributeSpecHandle normalsSpec = SdfAttributeSpec::New(prim, UsdGeomTokens->normals, SdfValueTypeNames->Normal3fArray);
+        normalsSpec->SetDefaultValue(VtValue(VtVec3fArray(normals, normals + count)));
+        normalsSpec->SetInfo(UsdGeomTokens->interpolation, VtValue(UsdGeomTokens->vertex));
+    }
+    return layer;
+}
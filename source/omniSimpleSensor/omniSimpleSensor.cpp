@@ -6,7 +6,7 @@
 # The Omniverse Simple Sensor is a command line program that continously pushes updates from an external
 # source into an existing USD on the Nucleus Server. This is to demonstrate a simulated sensor sync
 # path with a model in USD.
-#    * Two arguments,
+#    * Three arguments, and an optional fourth,
 #       1. The path to where to place the USD stage
 #           * Acceptable forms:
 #               * omniverse://localhost/Users/test
@@ -16,14 +16,18 @@
 #           * Acceptable forms:
 #              * 1
 #              * 2, etc.
+#       3. The timeout in seconds
+#       4. --payloads, to move every box into its own payload layer
 #   * Create a USD stage
 #    * Destroy the stage object
 #    * Shutdown the Omniverse Client library
 #
-# eg. omniSimpleSensor.exe omniverse://localhost/Users/test  4
+# eg. omniSimpleSensor.exe omniverse://localhost/Users/test  4 -1 --payloads
 #
 ###############################################################################*/
 
+#include "PayloadSplit.h"
+
 #include <omni/connect/core/Core.h>
 #include <omni/connect/core/LightAlgo.h>
 #include <omni/connect/core/LightCompatibility.h>
@@ -288,16 +292,18 @@ Info createZoneGeometry(int zoneNumber, int totalZones, std::string)
     return returnInfo;
 }
 
-// The program expects three arguments, output USD path, processes and timeout in seconds
+// The program expects three arguments, output USD path, processes and timeout in seconds, and optionally --payloads
 int main(int argc, char* argv[])
 {
-    if (argc != 4)
+    const bool usePayloads = argc == 5 && std::string(argv[4]) == "--payloads";
+    if (argc != 4 && !usePayloads)
     {
         std::cout << "Please provide a path where to keep the USD model and thread count." << std::endl;
         std::cout << "   Arguments:" << std::endl;
         std::cout << "       1. Path to USD model (omniverse://localhost/Users/test)" << std::endl;
         std::cout << "       2. Number of boxes / processes" << std::endl;
         std::cout << "       3. Timeout in seconds (-1 for infinity)" << std::endl;
+        std::cout << "       4. Optional: --payloads to write every box to its own payload layer" << std::endl;
         std::cout << "Example - omniSimpleSensor.exe omniverse://localhost/Users/test 4 10" << std::endl;
         exit(1);
     }
@@ -339,14 +345,41 @@ int main(int argc, char* argv[])
 
     // Initialize the worker threads structure that exports the USDA file
     std::cout << "    Create the zone geometry" << std::endl;
+    SdfPathVector boxPaths;
     for (int x = 0; x < numberOfThreads; x++)
     {
         // Add zones of data to the model
         Info returnInfo = createZoneGeometry(x, numberOfThreads, baseUrl);
+        if (returnInfo.mesh)
+        {
+            boxPaths.push_back(returnInfo.mesh.GetPath());
+        }
     }
 
-    gStage->Save();
-    std::cout << "    All geometry created" << std::endl;
+    if (usePayloads)
+    {
+        // Every box goes to its own layer, the live layer keeps the box prims, their extents and the payload arcs
+        const payloadsplit::SplitResult split = payloadsplit::splitIntoPayloads(gStage, boxPaths, "./SimpleSensorExample_payloads");
+        for (const std::string& failed : split.failed)
+        {
+            std::cout << "    Failed to write the payload layer " << failed << std::endl;
+        }
+        std::cout << "    " << split.payloadCount << " payload layers copied in " << split.copyMs << " ms and written in parallel in "
+                  << split.writeMs << " ms" << std::endl;
+        std::cout << "    All geometry created" << std::endl;
+
+        // Release the stage so the timed opens read its layers again
+        omniClientLiveWaitForPendingUpdates();
+        gStage.Reset();
+        const payloadsplit::OpenTimes times = payloadsplit::measureOpenTimes(newStageUrl);
+        std::cout << "    Open with no payloads loaded: " << times.loadNoneMs << " ms (" << times.loadNonePrims
+                  << " prims), with all payloads loaded: " << times.loadAllMs << " ms (" << times.loadAllPrims << " prims)" << std::endl;
+    }
+    else
+    {
+        gStage->Save();
+        std::cout << "    All geometry created" << std::endl;
+    }
 
     shutdownOmniverse();
 
@@ -0,0 +1,484 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "convexHull.h"
+#include "optimizerCommon.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/range3f.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/listOp.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/tokens.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xformOp.h>
+#include <pxr/usd/usdPhysics/collisionAPI.h>
+#include <pxr/usd/usdPhysics/meshCollisionAPI.h>
+#include <pxr/usd/usdPhysics/rigidBodyAPI.h>
+#include <pxr/usd/usdPhysics/tokens.h>
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and precomputes the convex
+// collision shapes of dynamic rigid bodies.
+//
+// helloWorld gives dynamic meshes the convexHull approximation, which every physics
+// consumer computes from the full render mesh each time the stage loads. Here the
+// hulls are computed once, in parallel, and written to a collider layer as guide
+// meshes in a "<mesh>_Colliders" Xform next to each source mesh, inside the same
+// rigid body, and the source mesh stops colliding. Gprims can't be nested, so a mesh
+// that is a rigid body itself has no place for its hulls and is skipped. A hull mesh
+// is already convex and has at most --max-vertices points, so cooking it at load time
+// is nearly free.
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct HullWork
+{
+    UsdGeomMesh mesh;
+    bool decompose = false;
+    size_t inputPoints = 0;
+    std::vector<std::vector<GfVec3f>> hullPoints;
+    std::vector<std::vector<int>> hullTriangles;
+    std::string skipReason;
+};
+
+// A mesh collides as part of a dynamic body when a RigidBodyAPI is applied to it or to one of its ancestors
+static bool isInRigidBody(UsdPrim prim)
+{
+    for (; prim && !prim.IsPseudoRoot(); prim = prim.GetParent())
+    {
+        if (prim.HasAPI<UsdPhysicsRigidBodyAPI>())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::string hullName(size_t index, size_t count)
+{
+    return count == 1 ? std::string("ConvexHull") : TfStringPrintf("ConvexHull_%zu", index);
+}
+
+// The Xform next to the source mesh that holds its hulls, a Gprim can't have Gprim children
+static SdfPath hullContainerPath(const SdfPath& meshPath)
+{
+    return meshPath.ReplaceName(TfToken(meshPath.GetName() + "_Colliders"));
+}
+
+// Split a mesh's faces into at most `maxParts` parts: its connected pieces when there are few enough of them, then
+// repeatedly the widest part in half across its longest axis. A coarse stand-in for a concavity driven decomposition
+// like V-HACD, but cheap and good enough for the long, bent and multi-part props convex hulls fit worst.
+static std::vector<std::vector<int>> splitIntoParts(
+    const VtVec3fArray& points,
+    const VtIntArray& faceVertexCounts,
+    const VtIntArray& faceVertexIndices,
+    const std::vector<int>& faceOffsets,
+    size_t maxParts
+)
+{
+    const size_t faceCount = faceVertexCounts.size();
+    std::vector<int> parent(points.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&parent](int p)
+    {
+        while (parent[p] != p)
+        {
+            p = parent[p] = parent[parent[p]];
+        }
+        return p;
+    };
+    for (size_t f = 0; f < faceCount; f++)
+    {
+        for (int c = 1; c < faceVertexCounts[f]; c++)
+        {
+            parent[find(faceVertexIndices[faceOffsets[f] + c])] = find(faceVertexIndices[faceOffsets[f]]);
+        }
+    }
+    std::map<int, std::vector<int>> components;
+    for (size_t f = 0; f < faceCount; f++)
+    {
+        components[find(faceVertexIndices[faceOffsets[f]])].push_back((int)f);
+    }
+    std::vector<std::vector<int>> parts;
+    if (components.size() <= maxParts)
+    {
+        for (auto& component : components)
+        {
+            parts.push_back(std::move(component.second));
+        }
+    }
+    else
+    {
+        parts.emplace_back(faceCount);
+        std::iota(parts.back().begin(), parts.back().end(), 0);
+    }
+
+    std::vector<GfVec3f> centroids(faceCount);
+    for (size_t f = 0; f < faceCount; f++)
+    {
+        GfVec3f sum(0.0f);
+        for (int c = 0; c < faceVertexCounts[f]; c++)
+        {
+            sum += points[faceVertexIndices[faceOffsets[f] + c]];
+        }
+        centroids[f] = sum / (float)std::max(1, faceVertexCounts[f]);
+    }
+    auto bounds = [&centroids](const std::vector<int>& part)
+    {
+        GfRange3f range;
+        for (int f : part)
+        {
+            range.UnionWith(centroids[f]);
+        }
+        return range;
+    };
+    while (parts.size() < maxParts)
+    {
+        size_t widest = 0;
+        double widestSize = -1.0;
+        for (size_t i = 0; i < parts.size(); i++)
+        {
+            const double size = parts[i].size() < 2 ? -1.0 : bounds(parts[i]).GetSize().GetLength();
+            if (size > widestSize)
+            {
+                widest = i;
+                widestSize = size;
+            }
+        }
+        if (widestSize <= 0.0)
+        {
+            break;
+        }
+        std::vector<int>& part = parts[widest];
+        const GfVec3f size = bounds(part).GetSize();
+        const int axis = size[0] >= size[1] && size[0] >= size[2] ? 0 : (size[1] >= size[2] ? 1 : 2);
+        const auto middle = part.begin() + part.size() / 2;
+        std::nth_element(part.begin(), middle, part.end(), [&centroids, axis](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+        std::vector<int> upper(middle, part.end());
+        part.erase(middle, part.end());
+        parts.push_back(std::move(upper));
+    }
+    return parts;
+}
+
+static void computeMeshHulls(HullWork& work, size_t maxVertices, size_t maxHulls)
+{
+    VtVec3fArray points;
+    VtIntArray faceVertexCounts;
+    VtIntArray faceVertexIndices;
+    work.mesh.GetPointsAttr().Get(&points);
+    work.mesh.GetFaceVertexCountsAttr().Get(&faceVertexCounts);
+    work.mesh.GetFaceVertexIndicesAttr().Get(&faceVertexIndices);
+    work.inputPoints = points.size();
+
+    std::vector<int> faceOffsets(faceVertexCounts.size());
+    size_t corner = 0;
+    for (size_t f = 0; f < faceVertexCounts.size(); f++)
+    {
+        faceOffsets[f] = (int)corner;
+        corner += (size_t)std::max(0, faceVertexCounts[f]);
+    }
+    if (corner != faceVertexIndices.size() ||
+        std::any_of(faceVertexIndices.cbegin(), faceVertexIndices.cend(), [&points](int i) { return i < 0 || (size_t)i >= points.size(); }))
+    {
+        work.skipReason = "have invalid topology";
+        return;
+    }
+
+    std::vector<std::vector<int>> parts;
+    if (work.decompose && maxHulls > 1)
+    {
+        parts = splitIntoParts(points, faceVertexCounts, faceVertexIndices, faceOffsets, maxHulls);
+    }
+    else
+    {
+        parts.emplace_back(faceVertexCounts.size());
+        std::iota(parts.back().begin(), parts.back().end(), 0);
+    }
+
+    QuickHull hull;
+    std::vector<GfVec3f> partPoints;
+    std::vector<char> used(points.size());
+    for (const std::vector<int>& part : parts)
+    {
+        // Only the points the part's faces use, once each
+        partPoints.clear();
+        std::fill(used.begin(), used.end(), 0);
+        for (int f : part)
+        {
+            for (int c = 0; c < faceVertexCounts[f]; c++)
+            {
+                const int p = faceVertexIndices[faceOffsets[f] + c];
+                if (!used[p])
+                {
+                    used[p] = 1;
+                    partPoints.push_back(points[p]);
+                }
+            }
+        }
+        if (hull.compute(partPoints.data(), partPoints.size(), maxVertices))
+        {
+            work.hullPoints.emplace_back();
+            work.hullTriangles.emplace_back();
+            hull.snapshot(work.hullPoints.back(), work.hullTriangles.back());
+        }
+    }
+    if (work.hullPoints.empty())
+    {
+        work.skipReason = "are flat";
+    }
+}
+
+static void authorHullMesh(const SdfPrimSpecHandle& spec, const std::vector<GfVec3f>& hullPoints, const std::vector<int>& hullTriangles)
+{
+    static const TfToken kCollisionApi("PhysicsCollisionAPI");
+    static const TfToken kMeshCollisionApi("PhysicsMeshCollisionAPI");
+
+    spec->SetSpecifier(SdfSpecifierDef);
+    spec->SetTypeName("Mesh");
+    SdfTokenListOp apiSchemas;
+    apiSchemas.SetPrependedItems({ kCollisionApi, kMeshCollisionApi });
+    spec->SetInfo(UsdTokens->apiSchemas, VtValue(apiSchemas));
+
+    GfRange3f extent;
+    for (const GfVec3f& p : hullPoints)
+    {
+        extent.UnionWith(p);
+    }
+    auto author = [&spec](const TfToken& name, const SdfValueTypeName& type, VtValue&& value, SdfVariability variability = SdfVariabilityVarying)
+    {
+        if (SdfAttributeSpecHandle attr = SdfAttributeSpec::New(spec, name, type, variability))
+        {
+            attr->SetDefaultValue(value);
+        }
+    };
+    author(UsdGeomTokens->points, SdfValueTypeNames->Point3fArray, VtValue(VtVec3fArray(hullPoints.begin(), hullPoints.end())));
+    author(UsdGeomTokens->faceVertexCounts, SdfValueTypeNames->IntArray, VtValue(VtIntArray(hullTriangles.size() / 3, 3)));
+    author(UsdGeomTokens->faceVertexIndices, SdfValueTypeNames->IntArray, VtValue(VtIntArray(hullTriangles.begin(), hullTriangles.end())));
+    author(UsdGeomTokens->extent, SdfValueTypeNames->Float3Array, VtValue(VtVec3fArray({ extent.GetMin(), extent.GetMax() })));
+    author(UsdGeomTokens->purpose, SdfValueTypeNames->Token, VtValue(UsdGeomTokens->guide), SdfVariabilityUniform);
+    author(UsdPhysicsTokens->physicsApproximation, SdfValueTypeNames->Token, VtValue(UsdPhysicsTokens->convexHull), SdfVariabilityUniform);
+}
+
+// Compute the convex hull (or an approximate convex decomposition) of every dynamic collider mesh in parallel and
+// author the results as collision meshes in a collider layer
+static int generateColliderHulls(const OptimizerArgs& args)
+{
+    const bool dryRun = args.hasFlag("--dry-run");
+    const bool verbose = args.hasFlag("-v") || args.hasFlag("--verbose");
+    const size_t maxVertices = (size_t)std::min(255L, std::max(4L, args.getInt("--max-vertices", 64)));
+    const size_t maxHulls = (size_t)std::max(1L, args.getInt("--max-hulls", 8));
+
+    UsdStageRefPtr stage = openStageForCommand(args.stageUrl());
+    if (!stage)
+    {
+        return EXIT_FAILURE;
+    }
+    SdfLayerHandle rootLayer = stage->GetRootLayer();
+    const std::string layerArg = args.getString("--layer", std::string());
+    const std::string layerPath = layerArg.empty() ? TfStringGetBeforeSuffix(rootLayer->GetIdentifier()) + "_colliders.usdc" : layerArg;
+
+    Stopwatch traverseTimer;
+    std::vector<HullWork> work;
+    size_t colliderCount = 0;
+    std::map<std::string, size_t> skipped;
+    for (const UsdPrim& prim : stage->Traverse())
+    {
+        UsdGeomMesh mesh(prim);
+        if (!mesh || !prim.HasAPI<UsdPhysicsMeshCollisionAPI>())
+        {
+            continue;
+        }
+        TfToken approximation;
+        UsdPhysicsMeshCollisionAPI(prim).GetApproximationAttr().Get(&approximation);
+        if ((approximation != UsdPhysicsTokens->convexHull && approximation != UsdPhysicsTokens->convexDecomposition) || !isInRigidBody(prim))
+        {
+            continue;
+        }
+        colliderCount++;
+        if (prim.GetStage()->GetPrimAtPath(hullContainerPath(prim.GetPath())))
+        {
+            skipped["already have hulls"]++;
+        }
+        else if (prim.HasAPI<UsdPhysicsRigidBodyAPI>())
+        {
+            // Hulls next to the mesh would not move with it, and hulls under it would nest Gprims
+            skipped["are rigid bodies themselves"]++;
+        }
+        else if (mesh.TransformMightBeTimeVarying())
+        {
+            skipped["have animated transforms"]++;
+        }
+        else if (UsdPhysicsCollisionAPI(prim).GetCollisionEnabledAttr().HasAuthoredValue())
+        {
+            // The collider layer is a sublayer, so it could not turn off an authored physics:collisionEnabled
+            skipped["author physics:collisionEnabled"]++;
+        }
+        else if (mesh.GetPointsAttr().ValueMightBeTimeVarying() || mesh.GetFaceVertexIndicesAttr().ValueMightBeTimeVarying())
+        {
+            skipped["are animated"]++;
+        }
+        else
+        {
+            work.emplace_back();
+            work.back().mesh = mesh;
+            work.back().decompose = approximation == UsdPhysicsTokens->convexDecomposition;
+        }
+    }
+    const double traverseMs = traverseTimer.milliseconds();
+
+    Stopwatch computeTimer;
+    WorkParallelForN(
+        work.size(),
+        [&work, maxVertices, maxHulls](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                computeMeshHulls(work[i], maxVertices, maxHulls);
+            }
+        },
+        1
+    );
+    const double computeMs = computeTimer.milliseconds();
+
+    size_t meshCount = 0;
+    size_t hullCount = 0;
+    size_t inputPoints = 0;
+    size_t hullPoints = 0;
+    for (const HullWork& entry : work)
+    {
+        if (!entry.skipReason.empty())
+        {
+            skipped[entry.skipReason]++;
+            continue;
+        }
+        meshCount++;
+        hullCount += entry.hullPoints.size();
+        inputPoints += entry.inputPoints;
+        for (const auto& points : entry.hullPoints)
+        {
+            hullPoints += points.size();
+        }
+        if (verbose)
+        {
+            OMNI_LOG_INFO("  %s: %zu points -> %zu hull(s)", entry.mesh.GetPath().GetText(), entry.inputPoints, entry.hullPoints.size());
+        }
+    }
+
+    Stopwatch authorTimer;
+    SdfLayerRefPtr colliderLayer;
+    if (!dryRun && meshCount > 0)
+    {
+        colliderLayer = SdfLayer::FindOrOpen(layerPath);
+        colliderLayer = colliderLayer ? colliderLayer : SdfLayer::CreateNew(layerPath);
+        if (!colliderLayer)
+        {
+            OMNI_LOG_ERROR("Could not create the collider layer %s", layerPath.c_str());
+            return EXIT_FAILURE;
+        }
+        SdfChangeBlock changeBlock;
+        for (const HullWork& entry : work)
+        {
+            if (!entry.skipReason.empty())
+            {
+                continue;
+            }
+            // The render mesh stays a collider in name only, its hulls collide in its place
+            const SdfPath meshPath = entry.mesh.GetPath();
+            SdfPrimSpecHandle meshSpec = SdfCreatePrimInLayer(colliderLayer, meshPath);
+            if (SdfAttributeSpecHandle enabled = SdfAttributeSpec::New(meshSpec, UsdPhysicsTokens->physicsCollisionEnabled, SdfValueTypeNames->Bool))
+            {
+                enabled->SetDefaultValue(VtValue(false));
+            }
+            // The hulls are in the mesh's space, so their Xform repeats the mesh's local transform
+            SdfPrimSpecHandle containerSpec = SdfCreatePrimInLayer(colliderLayer, hullContainerPath(meshPath));
+            containerSpec->SetSpecifier(SdfSpecifierDef);
+            containerSpec->SetTypeName("Xform");
+            bool resetsXformStack = false;
+            GfMatrix4d localTransform(1.0);
+            entry.mesh.GetLocalTransformation(&localTransform, &resetsXformStack);
+            const TfToken transformOp("xformOp:transform");
+            if (SdfAttributeSpecHandle transform = SdfAttributeSpec::New(containerSpec, transformOp, SdfValueTypeNames->Matrix4d))
+            {
+                transform->SetDefaultValue(VtValue(localTransform));
+            }
+            VtTokenArray opOrder = { transformOp };
+            if (resetsXformStack)
+            {
+                opOrder.insert(opOrder.begin(), UsdGeomXformOpTypes->resetXformStack);
+            }
+            if (SdfAttributeSpecHandle order =
+                    SdfAttributeSpec::New(containerSpec, UsdGeomTokens->xformOpOrder, SdfValueTypeNames->TokenArray, SdfVariabilityUniform))
+            {
+                order->SetDefaultValue(VtValue(opOrder));
+            }
+            for (size_t i = 0; i < entry.hullPoints.size(); i++)
+            {
+                SdfPrimSpecHandle hullSpec =
+                    SdfCreatePrimInLayer(colliderLayer, containerSpec->GetPath().AppendChild(TfToken(hullName(i, entry.hullPoints.size()))));
+                authorHullMesh(hullSpec, entry.hullPoints[i], entry.hullTriangles[i]);
+            }
+        }
+    }
+    const double authorMs = authorTimer.milliseconds();
+
+    Stopwatch saveTimer;
+    if (colliderLayer)
+    {
+        colliderLayer->Save();
+        const std::string subLayerPath = layerArg.empty() ? "./" + TfGetBaseName(layerPath) : layerPath;
+        const std::vector<std::string> subLayers = rootLayer->GetSubLayerPaths();
+        if (std::find(subLayers.begin(), subLayers.end(), subLayerPath) == subLayers.end())
+        {
+            rootLayer->InsertSubLayerPath(subLayerPath, 0);
+            rootLayer->Save();
+        }
+    }
+    const double saveMs = saveTimer.milliseconds();
+
+    const std::string destination = dryRun ? " (dry run, nothing authored)" : (colliderLayer ? ", written to " + layerPath : std::string());
+    OMNI_LOG_INFO(
+        "Computed %zu convex hulls for %zu of %zu dynamic collider meshes (%zu points in, %zu hull points out)%s",
+        hullCount,
+        meshCount,
+        colliderCount,
+        inputPoints,
+        hullPoints,
+        destination.c_str()
+    );
+    for (const auto& entry : skipped)
+    {
+        OMNI_LOG_INFO("  %zu meshes skipped: %s", entry.second, entry.first.c_str());
+    }
+    OMNI_LOG_INFO(
+        "Traverse %.1f ms, compute %.1f ms (%.0f hulls/sec on %u threads), author %.1f ms, save %.1f ms",
+        traverseMs,
+        computeMs,
+        computeMs > 0.0 ? (double)hullCount * 1000.0 / computeMs : 0.0,
+        WorkGetConcurrencyLimit(),
+        authorMs,
+        saveMs
+    );
+    return EXIT_SUCCESS;
+}
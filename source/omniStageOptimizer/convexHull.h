@@ -0,0 +1,313 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/gf/vec3f.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and holds a 3D quickhull
+// (Barber, Dobkin and Huhdanpaa, "The Quickhull Algorithm for Convex Hulls").
+//
+// The hull grows from a tetrahedron by always adding the point farthest outside one
+// of its faces, so stopping at a vertex budget (physics engines cap convex meshes at
+// 255 vertices, usually 64) still leaves the best hull of that size this greedy order
+// finds, never one larger than the input.
+///////////////////////////////////////////////////////////////////////////////////////
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+class QuickHull
+{
+public:
+
+    // Returns false when the points are all (nearly) on one plane, which has no volume to collide with
+    bool compute(const GfVec3f* input, size_t count, size_t maxVertices)
+    {
+        mFaces.clear();
+        mEdgeFaces.clear();
+        mPoints.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            mPoints[i] = GfVec3d(input[i]);
+        }
+        if (count < 4 || !buildTetrahedron())
+        {
+            return false;
+        }
+
+        size_t vertexCount = 4;
+        std::vector<int> visible;
+        std::vector<std::pair<int, int>> horizon;
+        std::vector<int> orphans;
+        while (vertexCount < std::max<size_t>(maxVertices, 4))
+        {
+            // The point farthest outside any face is the next hull vertex
+            int startFace = -1;
+            for (size_t f = 0; f < mFaces.size(); f++)
+            {
+                if (mFaces[f].alive && mFaces[f].farthest >= 0 && (startFace < 0 || mFaces[f].farthestDistance > mFaces[startFace].farthestDistance))
+                {
+                    startFace = (int)f;
+                }
+            }
+            if (startFace < 0)
+            {
+                break;
+            }
+            const int eye = mFaces[startFace].farthest;
+
+            // Flood fill the faces the eye sees, the border of that region is the horizon
+            visible.assign(1, startFace);
+            horizon.clear();
+            mFaces[startFace].visited = true;
+            for (size_t i = 0; i < visible.size(); i++)
+            {
+                const Face& face = mFaces[visible[i]];
+                for (int e = 0; e < 3; e++)
+                {
+                    const int a = face.v[e];
+                    const int b = face.v[(e + 1) % 3];
+                    const int neighbor = mEdgeFaces[edgeKey(b, a)];
+                    if (mFaces[neighbor].visited)
+                    {
+                        continue;
+                    }
+                    if (distance(mFaces[neighbor], mPoints[eye]) > mEpsilon)
+                    {
+                        mFaces[neighbor].visited = true;
+                        visible.push_back(neighbor);
+                    }
+                    else
+                    {
+                        horizon.emplace_back(a, b);
+                    }
+                }
+            }
+
+            orphans.clear();
+            for (int f : visible)
+            {
+                Face& face = mFaces[f];
+                face.alive = false;
+                for (int e = 0; e < 3; e++)
+                {
+                    mEdgeFaces.erase(edgeKey(face.v[e], face.v[(e + 1) % 3]));
+                }
+                for (int p : face.outside)
+                {
+                    if (p != eye)
+                    {
+                        orphans.push_back(p);
+                    }
+                }
+                face.outside = std::vector<int>();
+            }
+
+            // Each horizon edge keeps the winding it had in its visible face, so the new faces face outwards too
+            const size_t firstNew = mFaces.size();
+            for (const auto& edge : horizon)
+            {
+                addFace(edge.first, edge.second, eye);
+            }
+            for (int p : orphans)
+            {
+                assignOutside(p, firstNew);
+            }
+            vertexCount++;
+        }
+        return true;
+    }
+
+    // The hull as compact points and counter-clockwise (seen from outside) triangles
+    void snapshot(std::vector<GfVec3f>& points, std::vector<int>& triangles) const
+    {
+        points.clear();
+        triangles.clear();
+        std::vector<int> remap(mPoints.size(), -1);
+        for (const Face& face : mFaces)
+        {
+            if (!face.alive)
+            {
+                continue;
+            }
+            for (int v : face.v)
+            {
+                if (remap[v] < 0)
+                {
+                    remap[v] = (int)points.size();
+                    points.emplace_back(mPoints[v]);
+                }
+                triangles.push_back(remap[v]);
+            }
+        }
+    }
+
+private:
+
+    struct Face
+    {
+        int v[3];
+        GfVec3d normal;
+        double offset = 0.0;
+        std::vector<int> outside;
+        int farthest = -1;
+        double farthestDistance = 0.0;
+        bool alive = true;
+        bool visited = false;
+    };
+
+    static uint64_t edgeKey(int a, int b)
+    {
+        return ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+    }
+
+    static double distance(const Face& face, const GfVec3d& p)
+    {
+        return GfDot(face.normal, p) - face.offset;
+    }
+
+    void addFace(int a, int b, int c)
+    {
+        Face face;
+        face.v[0] = a;
+        face.v[1] = b;
+        face.v[2] = c;
+        face.normal = GfCross(mPoints[b] - mPoints[a], mPoints[c] - mPoints[a]);
+        const double length = face.normal.GetLength();
+        face.normal = length > 0.0 ? face.normal / length : GfVec3d(0.0);
+        face.offset = GfDot(face.normal, mPoints[a]);
+        const int index = (int)mFaces.size();
+        mEdgeFaces[edgeKey(a, b)] = index;
+        mEdgeFaces[edgeKey(b, c)] = index;
+        mEdgeFaces[edgeKey(c, a)] = index;
+        mFaces.push_back(std::move(face));
+    }
+
+    // Points inside every face from `firstFace` on are inside the hull and dropped
+    void assignOutside(int p, size_t firstFace)
+    {
+        for (size_t f = firstFace; f < mFaces.size(); f++)
+        {
+            Face& face = mFaces[f];
+            if (!face.alive)
+            {
+                continue;
+            }
+            const double d = distance(face, mPoints[p]);
+            if (d > mEpsilon)
+            {
+                face.outside.push_back(p);
+                if (d > face.farthestDistance)
+                {
+                    face.farthest = p;
+                    face.farthestDistance = d;
+                }
+                return;
+            }
+        }
+    }
+
+    bool buildTetrahedron()
+    {
+        // The extreme points on each axis, and the two of them farthest apart
+        int extremes[6] = { 0, 0, 0, 0, 0, 0 };
+        for (int i = 0; i < (int)mPoints.size(); i++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                extremes[axis] = mPoints[i][axis] < mPoints[extremes[axis]][axis] ? i : extremes[axis];
+                extremes[axis + 3] = mPoints[i][axis] > mPoints[extremes[axis + 3]][axis] ? i : extremes[axis + 3];
+            }
+        }
+        double scale = 0.0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            scale = std::max(scale, mPoints[extremes[axis + 3]][axis] - mPoints[extremes[axis]][axis]);
+        }
+        mEpsilon = scale * 1e-7;
+        int v0 = extremes[0];
+        int v1 = extremes[3];
+        double best = -1.0;
+        for (int i = 0; i < 6; i++)
+        {
+            for (int j = i + 1; j < 6; j++)
+            {
+                const double d = (mPoints[extremes[i]] - mPoints[extremes[j]]).GetLengthSq();
+                if (d > best)
+                {
+                    best = d;
+                    v0 = extremes[i];
+                    v1 = extremes[j];
+                }
+            }
+        }
+
+        // The point farthest from that line, then the point farthest from the plane of all three
+        const GfVec3d axis = (mPoints[v1] - mPoints[v0]).GetNormalized();
+        int v2 = -1;
+        best = mEpsilon;
+        for (int i = 0; i < (int)mPoints.size(); i++)
+        {
+            const GfVec3d offset = mPoints[i] - mPoints[v0];
+            const double d = (offset - axis * GfDot(offset, axis)).GetLength();
+            if (d > best)
+            {
+                best = d;
+                v2 = i;
+            }
+        }
+        if (v2 < 0)
+        {
+            return false;
+        }
+        const GfVec3d normal = GfCross(mPoints[v1] - mPoints[v0], mPoints[v2] - mPoints[v0]).GetNormalized();
+        int v3 = -1;
+        best = mEpsilon;
+        for (int i = 0; i < (int)mPoints.size(); i++)
+        {
+            const double d = std::abs(GfDot(mPoints[i] - mPoints[v0], normal));
+            if (d > best)
+            {
+                best = d;
+                v3 = i;
+            }
+        }
+        if (v3 < 0)
+        {
+            return false;
+        }
+
+        // Wind the faces so they face away from the fourth point
+        if (GfDot(mPoints[v3] - mPoints[v0], normal) > 0.0)
+        {
+            std::swap(v1, v2);
+        }
+        addFace(v0, v1, v2);
+        addFace(v0, v3, v1);
+        addFace(v1, v3, v2);
+        addFace(v2, v3, v0);
+        for (int i = 0; i < (int)mPoints.size(); i++)
+        {
+            if (i != v0 && i != v1 && i != v2 && i != v3)
+            {
+                assignOutside(i, 0);
+            }
+        }
+        return true;
+    }
+
+    std::vector<GfVec3d> mPoints;
+    std::vector<Face> mFaces;
+    std::unordered_map<uint64_t, int> mEdgeFaces;
+    double mEpsilon = 0.0;
+};
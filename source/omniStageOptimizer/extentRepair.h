@@ -0,0 +1,260 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "optimizerCommon.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/boundable.h>
+#include <pxr/usd/usdGeom/mesh.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and computes the extent of every
+// boundable prim on a stage, authoring only the extents that are missing or stale.
+//
+// Renderers and the UsdGeomBBoxCache trust the authored extent attribute. When it is
+// missing they must read every point to compute it on load, and when it is wrong
+// objects are culled or framed incorrectly.
+///////////////////////////////////////////////////////////////////////////////////////
+
+// Min/max over a packed xyz float array.
+// The points are read as a flat float array in blocks of 8 points (24 floats), each lane keeping its own running
+// min and max. The inner loops have no dependency between lanes, so the compiler turns them into SIMD min/max
+// instructions without any intrinsics.
+static VtVec3fArray computePointsExtent(const VtVec3fArray& points)
+{
+    constexpr size_t kBlockPoints = 8;
+    constexpr size_t kLanes = kBlockPoints * 3;
+
+    VtVec3fArray extent;
+    if (points.empty())
+    {
+        return extent;
+    }
+
+    const float* data = points.cdata()->data();
+    const size_t floatCount = points.size() * 3;
+    const size_t blockedCount = floatCount - (floatCount % kLanes);
+
+    float lo[kLanes];
+    float hi[kLanes];
+    std::fill(lo, lo + kLanes, FLT_MAX);
+    std::fill(hi, hi + kLanes, -FLT_MAX);
+    for (size_t i = 0; i < blockedCount; i += kLanes)
+    {
+        for (size_t lane = 0; lane < kLanes; lane++)
+        {
+            lo[lane] = std::min(lo[lane], data[i + lane]);
+            hi[lane] = std::max(hi[lane], data[i + lane]);
+        }
+    }
+
+    // Fold the lanes back to x, y, z and pick up the points that did not fill a block
+    GfVec3f minPoint(FLT_MAX);
+    GfVec3f maxPoint(-FLT_MAX);
+    for (size_t lane = 0; lane < kLanes; lane++)
+    {
+        minPoint[lane % 3] = std::min(minPoint[lane % 3], lo[lane]);
+        maxPoint[lane % 3] = std::max(maxPoint[lane % 3], hi[lane]);
+    }
+    for (size_t i = blockedCount; i < floatCount; i++)
+    {
+        minPoint[i % 3] = std::min(minPoint[i % 3], data[i]);
+        maxPoint[i % 3] = std::max(maxPoint[i % 3], data[i]);
+    }
+
+    extent.resize(2);
+    extent[0] = minPoint;
+    extent[1] = maxPoint;
+    return extent;
+}
+
+// Extents computed in float from the same points can differ in the last bits depending on summation order,
+// so compare relative to the size of the box
+static bool extentsMatch(const VtVec3fArray& authored, const VtVec3fArray& computed)
+{
+    if (authored.size() != 2 || computed.size() != 2)
+    {
+        return authored.size() == computed.size();
+    }
+    const float tolerance = 1e-5f * std::max(1.0f, (computed[1] - computed[0]).GetLength());
+    for (size_t corner = 0; corner < 2; corner++)
+    {
+        for (size_t axis = 0; axis < 3; axis++)
+        {
+            if (std::fabs(authored[corner][axis] - computed[corner][axis]) > tolerance)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+struct ExtentWork
+{
+    UsdGeomBoundable boundable;
+    std::vector<UsdTimeCode> times;
+    std::vector<VtVec3fArray> computed;
+    size_t pointCount = 0;
+    bool missing = false;
+    bool stale = false;
+};
+
+// Meshes take the fast path over their points, other boundables (points with widths, curves, implicit shapes,
+// point instancers) go through the registered extent plugins
+static void computeExtents(ExtentWork& work)
+{
+    UsdGeomMesh mesh(work.boundable.GetPrim());
+    UsdAttribute extentAttr = work.boundable.GetExtentAttr();
+
+    if (mesh)
+    {
+        std::vector<double> sampleTimes;
+        mesh.GetPointsAttr().GetTimeSamples(&sampleTimes);
+        for (double time : sampleTimes)
+        {
+            work.times.emplace_back(time);
+        }
+    }
+    if (work.times.empty())
+    {
+        work.times.push_back(UsdTimeCode::Default());
+    }
+
+    for (const UsdTimeCode& time : work.times)
+    {
+        VtVec3fArray extent;
+        if (mesh)
+        {
+            VtVec3fArray points;
+            mesh.GetPointsAttr().Get(&points, time);
+            work.pointCount += points.size();
+            extent = computePointsExtent(points);
+        }
+        else if (!UsdGeomBoundable::ComputeExtentFromPlugins(work.boundable, time, &extent))
+        {
+            extent.clear();
+        }
+        work.computed.push_back(extent);
+
+        VtVec3fArray authored;
+        if (!extentAttr.HasAuthoredValue() || !extentAttr.Get(&authored, time))
+        {
+            work.missing = work.missing || !extent.empty();
+        }
+        else if (!extent.empty() && !extentsMatch(authored, extent))
+        {
+            work.stale = true;
+        }
+    }
+}
+
+// Compute the extent of every boundable prim in parallel and author the missing or stale ones to the root layer
+static int repairExtents(const OptimizerArgs& args)
+{
+    const bool dryRun = args.hasFlag("--dry-run");
+    const bool verbose = args.hasFlag("-v") || args.hasFlag("--verbose");
+
+    UsdStageRefPtr stage = openStageForCommand(args.stageUrl());
+    if (!stage)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Gathering prims is a serial walk, computing their extents is not
+    Stopwatch traverseTimer;
+    std::vector<ExtentWork> work;
+    for (const UsdPrim& prim : stage->Traverse())
+    {
+        if (prim.IsA<UsdGeomBoundable>())
+        {
+            work.emplace_back();
+            work.back().boundable = UsdGeomBoundable(prim);
+        }
+    }
+    const double traverseMs = traverseTimer.milliseconds();
+
+    Stopwatch computeTimer;
+    WorkParallelForN(
+        work.size(),
+        [&work](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                computeExtents(work[i]);
+            }
+        }
+    );
+    const double computeMs = computeTimer.milliseconds();
+
+    size_t missing = 0;
+    size_t stale = 0;
+    size_t totalPoints = 0;
+    for (const ExtentWork& entry : work)
+    {
+        missing += entry.missing ? 1 : 0;
+        stale += entry.stale ? 1 : 0;
+        totalPoints += entry.pointCount;
+    }
+
+    // Authoring is serial, the stage is not safe to write from several threads
+    Stopwatch authorTimer;
+    if (!dryRun)
+    {
+        for (const ExtentWork& entry : work)
+        {
+            if (!entry.missing && !entry.stale)
+            {
+                continue;
+            }
+            if (verbose)
+            {
+                OMNI_LOG_INFO("  %s extent: %s", entry.missing ? "missing" : "stale", entry.boundable.GetPath().GetText());
+            }
+            UsdAttribute extentAttr = entry.boundable.CreateExtentAttr();
+            for (size_t i = 0; i < entry.times.size(); i++)
+            {
+                if (!entry.computed[i].empty())
+                {
+                    extentAttr.Set(entry.computed[i], entry.times[i]);
+                }
+            }
+        }
+        if (missing + stale > 0)
+        {
+            stage->GetRootLayer()->Save();
+        }
+    }
+
+    OMNI_LOG_INFO(
+        "Checked %zu boundable prims: %zu missing extents, %zu stale extents%s",
+        work.size(),
+        missing,
+        stale,
+        dryRun ? " (dry run, nothing authored)" : ""
+    );
+    OMNI_LOG_INFO(
+        "Traverse %.1f ms, compute %.1f ms over %zu points (%.2f ms per million points), author %.1f ms",
+        traverseMs,
+        computeMs,
+        totalPoints,
+        totalPoints ? computeMs * 1e6 / (double)totalPoints : 0.0,
+        authorTimer.milliseconds()
+    );
+    return EXIT_SUCCESS;
+}
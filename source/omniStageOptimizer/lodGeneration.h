@@ -0,0 +1,651 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "meshDecimation.h"
+#include "optimizerCommon.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+
+#include <pxr/base/gf/vec2d.h>
+#include <pxr/base/gf/vec2f.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/gf/vec3h.h>
+#include <pxr/base/gf/vec4d.h>
+#include <pxr/base/gf/vec4f.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/copyUtils.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/types.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/variantSets.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/primvarsAPI.h>
+#include <pxr/usd/usdGeom/subset.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and generates decimated levels
+// of detail for every mesh.
+//
+// The levels live in an "LOD" variant set on the mesh's parent Xform, with the full
+// mesh as LOD0, so a viewer with less memory or GPU picks a coarser level by changing
+// one variant selection. The mesh's own spec moves into the variants because a
+// direct opinion in the root layer would be stronger than any variant.
+///////////////////////////////////////////////////////////////////////////////////////
+
+// Call `fn` with the typed array held by `value` for the plain data types that primvars hold.
+// Returns false for other types (strings, tokens, ...), which the LOD pass does not rewrite.
+template<class Fn>
+static bool visitPlainArray(const VtValue& value, Fn&& fn)
+{
+    if (value.IsHolding<VtFloatArray>())
+    {
+        fn(value.UncheckedGet<VtFloatArray>());
+    }
+    else if (value.IsHolding<VtDoubleArray>())
+    {
+        fn(value.UncheckedGet<VtDoubleArray>());
+    }
+    else if (value.IsHolding<VtIntArray>())
+    {
+        fn(value.UncheckedGet<VtIntArray>());
+    }
+    else if (value.IsHolding<VtVec2fArray>())
+    {
+        fn(value.UncheckedGet<VtVec2fArray>());
+    }
+    else if (value.IsHolding<VtVec3fArray>())
+    {
+        fn(value.UncheckedGet<VtVec3fArray>());
+    }
+    else if (value.IsHolding<VtVec4fArray>())
+    {
+        fn(value.UncheckedGet<VtVec4fArray>());
+    }
+    else if (value.IsHolding<VtVec2dArray>())
+    {
+        fn(value.UncheckedGet<VtVec2dArray>());
+    }
+    else if (value.IsHolding<VtVec3dArray>())
+    {
+        fn(value.UncheckedGet<VtVec3dArray>());
+    }
+    else if (value.IsHolding<VtVec4dArray>())
+    {
+        fn(value.UncheckedGet<VtVec4dArray>());
+    }
+    else if (value.IsHolding<VtVec3hArray>())
+    {
+        fn(value.UncheckedGet<VtVec3hArray>());
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// A new array of the same type holding the elements `from[i]` of `value`
+static VtValue gatherElements(const VtValue& value, const std::vector<int>& from)
+{
+    VtValue result;
+    visitPlainArray(
+        value,
+        [&from, &result](const auto& array)
+        {
+            std::decay_t<decltype(array)> gathered(from.size());
+            for (size_t i = 0; i < from.size(); i++)
+            {
+                gathered[i] = array[from[i]];
+            }
+            result = VtValue::Take(gathered);
+        }
+    );
+    return result;
+}
+
+// An id per element of `value`, equal for elements with the same bytes
+static std::vector<int> elementClasses(const VtValue& value)
+{
+    std::vector<int> classes;
+    visitPlainArray(
+        value,
+        [&classes](const auto& array)
+        {
+            using Element = typename std::decay_t<decltype(array)>::value_type;
+            std::unordered_map<std::string, int> ids;
+            classes.resize(array.size());
+            for (size_t i = 0; i < array.size(); i++)
+            {
+                const std::string key(reinterpret_cast<const char*>(&array[i]), sizeof(Element));
+                classes[i] = ids.emplace(key, (int)ids.size()).first->second;
+            }
+        }
+    );
+    return classes;
+}
+
+// Fold another id per element into `combined`, so two elements end up with the same id only if they had the same
+// ids before and the same `next` id
+static void combineClasses(std::vector<int>& combined, const std::vector<int>& next)
+{
+    std::unordered_map<uint64_t, int> ids;
+    for (size_t i = 0; i < combined.size(); i++)
+    {
+        const uint64_t key = ((uint64_t)(uint32_t)combined[i] << 32) | (uint32_t)next[i];
+        combined[i] = ids.emplace(key, (int)ids.size()).first->second;
+    }
+}
+
+// A primvar (or the normals attribute) that follows the mesh's topology
+struct LodStream
+{
+    TfToken name;
+    TfToken interpolation;
+    VtValue values;
+    VtIntArray indices;
+    bool indexed = false;
+};
+
+// One decimated level, with the original point, face corner and face every new element takes its data from
+struct LodLevel
+{
+    VtIntArray faceVertexIndices;
+    std::vector<int> vertices;
+    std::vector<int> corners;
+    std::vector<int> faces;
+};
+
+struct LodMesh
+{
+    UsdPrim prim;
+    std::string skipReason;
+    VtVec3fArray points;
+    VtIntArray faceVertexCounts;
+    VtIntArray faceVertexIndices;
+    std::vector<LodStream> streams;
+    std::vector<std::pair<TfToken, VtIntArray>> subsets;
+    size_t triangleCounts[3] = {};
+    LodLevel levels[2];
+};
+
+// The number of elements a stream must hold for its interpolation, 0 for interpolations the pass does not handle
+static size_t expectedStreamSize(const LodMesh& mesh, const TfToken& interpolation)
+{
+    if (interpolation == UsdGeomTokens->vertex || interpolation == UsdGeomTokens->varying)
+    {
+        return mesh.points.size();
+    }
+    if (interpolation == UsdGeomTokens->faceVarying)
+    {
+        return mesh.faceVertexIndices.size();
+    }
+    if (interpolation == UsdGeomTokens->uniform)
+    {
+        return mesh.faceVertexCounts.size();
+    }
+    return 0;
+}
+
+static bool addLodStream(LodMesh& mesh, LodStream stream)
+{
+    const size_t expected = expectedStreamSize(mesh, stream.interpolation);
+    const size_t actual = stream.indexed ? stream.indices.size() : stream.values.GetArraySize();
+    if (expected == 0 || actual != expected || !visitPlainArray(stream.values, [](const auto&) {}))
+    {
+        mesh.skipReason = "has a primvar of an unsupported type, interpolation or size";
+        return false;
+    }
+    if (stream.indexed)
+    {
+        for (int index : stream.indices)
+        {
+            if (index < 0 || (size_t)index >= stream.values.GetArraySize())
+            {
+                mesh.skipReason = "has a primvar with invalid indices";
+                return false;
+            }
+        }
+    }
+    mesh.streams.push_back(std::move(stream));
+    return true;
+}
+
+// Read everything the LOD variants need to rewrite. Only meshes that are fully defined by one spec in the root layer
+// can be moved into variants, and animated meshes, subdivision creases and holes are left alone.
+static bool loadLodMesh(LodMesh& mesh, const SdfLayerHandle& rootLayer)
+{
+    const UsdPrim& prim = mesh.prim;
+    SdfPrimSpecHandleVector stack = prim.GetPrimStack();
+    if (stack.size() != 1 || stack[0]->GetLayer() != rootLayer)
+    {
+        mesh.skipReason = "is not defined by a single spec in the root layer";
+        return false;
+    }
+    for (const UsdAttribute& attr : prim.GetAuthoredAttributes())
+    {
+        if (attr.ValueMightBeTimeVarying())
+        {
+            mesh.skipReason = "is animated";
+            return false;
+        }
+    }
+    UsdGeomMesh usdMesh(prim);
+    if (usdMesh.GetCornerIndicesAttr().HasAuthoredValue() || usdMesh.GetCreaseIndicesAttr().HasAuthoredValue() ||
+        usdMesh.GetHoleIndicesAttr().HasAuthoredValue())
+    {
+        mesh.skipReason = "has subdivision creases, corners or holes";
+        return false;
+    }
+
+    usdMesh.GetPointsAttr().Get(&mesh.points);
+    usdMesh.GetFaceVertexCountsAttr().Get(&mesh.faceVertexCounts);
+    usdMesh.GetFaceVertexIndicesAttr().Get(&mesh.faceVertexIndices);
+    size_t cornerCount = 0;
+    bool valid = true;
+    for (int count : mesh.faceVertexCounts)
+    {
+        valid = valid && count >= 3;
+        cornerCount += (size_t)std::max(count, 0);
+    }
+    valid = valid && cornerCount == mesh.faceVertexIndices.size();
+    for (size_t i = 0; valid && i < mesh.faceVertexIndices.size(); i++)
+    {
+        valid = mesh.faceVertexIndices[i] >= 0 && (size_t)mesh.faceVertexIndices[i] < mesh.points.size();
+    }
+    if (!valid || mesh.faceVertexCounts.empty())
+    {
+        mesh.skipReason = "has invalid or empty topology";
+        return false;
+    }
+
+    for (const UsdGeomPrimvar& primvar : UsdGeomPrimvarsAPI(prim).GetAuthoredPrimvars())
+    {
+        LodStream stream;
+        stream.name = primvar.GetAttr().GetName();
+        stream.interpolation = primvar.GetInterpolation();
+        if (stream.interpolation == UsdGeomTokens->constant)
+        {
+            continue;
+        }
+        if (primvar.GetElementSize() != 1)
+        {
+            mesh.skipReason = "has a primvar with an element size";
+            return false;
+        }
+        primvar.Get(&stream.values);
+        stream.indexed = primvar.GetIndices(&stream.indices);
+        if (!addLodStream(mesh, std::move(stream)))
+        {
+            return false;
+        }
+    }
+    if (usdMesh.GetNormalsAttr().HasAuthoredValue())
+    {
+        LodStream stream;
+        stream.name = UsdGeomTokens->normals;
+        stream.interpolation = usdMesh.GetNormalsInterpolation();
+        usdMesh.GetNormalsAttr().Get(&stream.values);
+        if (!addLodStream(mesh, std::move(stream)))
+        {
+            return false;
+        }
+    }
+    if (usdMesh.GetVelocitiesAttr().HasAuthoredValue())
+    {
+        LodStream stream;
+        stream.name = UsdGeomTokens->velocities;
+        stream.interpolation = UsdGeomTokens->vertex;
+        usdMesh.GetVelocitiesAttr().Get(&stream.values);
+        if (!addLodStream(mesh, std::move(stream)))
+        {
+            return false;
+        }
+    }
+
+    for (const UsdPrim& child : prim.GetAllChildren())
+    {
+        UsdGeomSubset subset(child);
+        TfToken elementType;
+        VtIntArray indices;
+        if (!subset || !subset.GetElementTypeAttr().Get(&elementType) || elementType != UsdGeomTokens->face ||
+            child.GetPrimStack().size() != 1 || subset.GetIndicesAttr().ValueMightBeTimeVarying() || !subset.GetIndicesAttr().Get(&indices))
+        {
+            mesh.skipReason = "has children other than face GeomSubsets";
+            return false;
+        }
+        mesh.subsets.emplace_back(child.GetName(), indices);
+    }
+    return true;
+}
+
+// Fan triangulate the mesh and decimate it to each ratio of its triangle count in turn
+static void decimateLodMesh(LodMesh& mesh, const double ratios[2])
+{
+    std::vector<int> triangles;
+    std::vector<int> corners;
+    std::vector<int> faces;
+    size_t corner = 0;
+    for (size_t f = 0; f < mesh.faceVertexCounts.size(); f++)
+    {
+        const int count = mesh.faceVertexCounts[f];
+        for (int k = 1; k + 1 < count; k++)
+        {
+            const int a = mesh.faceVertexIndices[corner];
+            const int b = mesh.faceVertexIndices[corner + k];
+            const int c = mesh.faceVertexIndices[corner + k + 1];
+            if (a == b || b == c || a == c)
+            {
+                continue;
+            }
+            triangles.insert(triangles.end(), { a, b, c });
+            corners.insert(corners.end(), { (int)corner, (int)corner + k, (int)corner + k + 1 });
+            faces.push_back((int)f);
+        }
+        corner += (size_t)count;
+    }
+    mesh.triangleCounts[0] = faces.size();
+    if (faces.empty())
+    {
+        mesh.skipReason = "has no triangles";
+        return;
+    }
+
+    // Corners (and faces) are only interchangeable if every face-varying (or uniform) stream and subset agrees
+    std::vector<int> cornerClasses(mesh.faceVertexIndices.size(), 0);
+    std::vector<int> faceClasses(mesh.faceVertexCounts.size(), 0);
+    for (const LodStream& stream : mesh.streams)
+    {
+        if (stream.interpolation != UsdGeomTokens->faceVarying && stream.interpolation != UsdGeomTokens->uniform)
+        {
+            continue;
+        }
+        std::vector<int> classes = elementClasses(stream.values);
+        if (stream.indexed)
+        {
+            std::vector<int> indexedClasses(stream.indices.size());
+            for (size_t i = 0; i < stream.indices.size(); i++)
+            {
+                indexedClasses[i] = classes[stream.indices[i]];
+            }
+            classes = std::move(indexedClasses);
+        }
+        combineClasses(stream.interpolation == UsdGeomTokens->faceVarying ? cornerClasses : faceClasses, classes);
+    }
+    for (const auto& subset : mesh.subsets)
+    {
+        std::vector<int> membership(faceClasses.size(), 0);
+        for (int face : subset.second)
+        {
+            if (face >= 0 && (size_t)face < membership.size())
+            {
+                membership[face] = 1;
+            }
+        }
+        combineClasses(faceClasses, membership);
+    }
+
+    QuadricDecimator decimator(
+        mesh.points.cdata(),
+        mesh.points.size(),
+        std::move(triangles),
+        std::move(corners),
+        std::move(faces),
+        [&cornerClasses](int a, int b) { return cornerClasses[a] == cornerClasses[b]; },
+        [&faceClasses](int a, int b) { return faceClasses[a] == faceClasses[b]; }
+    );
+    std::vector<int> remap;
+    for (int l = 0; l < 2; l++)
+    {
+        LodLevel& level = mesh.levels[l];
+        decimator.decimateTo(std::max<size_t>(1, (size_t)std::ceil((double)mesh.triangleCounts[0] * ratios[l])));
+        std::vector<int> levelTriangles;
+        decimator.snapshot(levelTriangles, level.corners, level.faces);
+        mesh.triangleCounts[l + 1] = level.faces.size();
+
+        // Only the points the level still uses are kept
+        remap.assign(mesh.points.size(), -1);
+        level.faceVertexIndices.resize(levelTriangles.size());
+        for (size_t i = 0; i < levelTriangles.size(); i++)
+        {
+            int& index = remap[levelTriangles[i]];
+            if (index < 0)
+            {
+                index = (int)level.vertices.size();
+                level.vertices.push_back(levelTriangles[i]);
+            }
+            level.faceVertexIndices[i] = index;
+        }
+    }
+}
+
+static void setAttributeDefault(const SdfLayerHandle& layer, const SdfPath& primPath, const TfToken& name, const VtValue& value)
+{
+    SdfAttributeSpecHandle spec = layer->GetAttributeAtPath(primPath.AppendProperty(name));
+    if (!spec)
+    {
+        spec = SdfAttributeSpec::New(layer->GetPrimAtPath(primPath), name.GetString(), SdfGetValueTypeNameForValue(value));
+    }
+    if (spec)
+    {
+        spec->SetDefaultValue(value);
+    }
+}
+
+// Overwrite the geometry of a copy of the mesh spec with a decimated level
+static void authorLodLevel(const SdfLayerHandle& layer, const SdfPath& path, const LodMesh& mesh, const LodLevel& level)
+{
+    setAttributeDefault(layer, path, UsdGeomTokens->points, gatherElements(VtValue(mesh.points), level.vertices));
+    setAttributeDefault(layer, path, UsdGeomTokens->faceVertexCounts, VtValue(VtIntArray(level.faces.size(), 3)));
+    setAttributeDefault(layer, path, UsdGeomTokens->faceVertexIndices, VtValue(level.faceVertexIndices));
+    for (const LodStream& stream : mesh.streams)
+    {
+        const std::vector<int>& from = stream.interpolation == UsdGeomTokens->faceVarying ? level.corners
+                                       : stream.interpolation == UsdGeomTokens->uniform   ? level.faces
+                                                                                          : level.vertices;
+        if (stream.indexed)
+        {
+            setAttributeDefault(layer, path, TfToken(stream.name.GetString() + ":indices"), gatherElements(VtValue(stream.indices), from));
+        }
+        else
+        {
+            setAttributeDefault(layer, path, stream.name, gatherElements(stream.values, from));
+        }
+    }
+    for (const auto& subset : mesh.subsets)
+    {
+        std::vector<char> membership(mesh.faceVertexCounts.size(), 0);
+        for (int face : subset.second)
+        {
+            if (face >= 0 && (size_t)face < membership.size())
+            {
+                membership[face] = 1;
+            }
+        }
+        VtIntArray indices;
+        for (size_t t = 0; t < level.faces.size(); t++)
+        {
+            if (membership[level.faces[t]])
+            {
+                indices.push_back((int)t);
+            }
+        }
+        setAttributeDefault(layer, path.AppendChild(subset.first), UsdGeomTokens->indices, VtValue(indices));
+    }
+}
+
+// Decimate every mesh in parallel and author LOD0/LOD1/LOD2 variants on the parent Xforms
+static int generateLods(const OptimizerArgs& args)
+{
+    const bool dryRun = args.hasFlag("--dry-run");
+    const bool verbose = args.hasFlag("-v") || args.hasFlag("--verbose");
+    const double ratios[2] = { std::min(1.0, std::max(0.001, args.getDouble("--lod1", 0.5))),
+                               std::min(1.0, std::max(0.001, args.getDouble("--lod2", 0.25))) };
+    const long selection = std::min(2L, std::max(0L, args.getInt("--select", 0)));
+    static const TfToken kLodSet("LOD");
+    static const std::string kLodNames[] = { "LOD0", "LOD1", "LOD2" };
+
+    UsdStageRefPtr stage = openStageForCommand(args.stageUrl());
+    if (!stage)
+    {
+        return EXIT_FAILURE;
+    }
+    SdfLayerHandle rootLayer = stage->GetRootLayer();
+
+    std::vector<LodMesh> meshes;
+    for (const UsdPrim& prim : stage->Traverse())
+    {
+        if (!prim.IsA<UsdGeomMesh>())
+        {
+            continue;
+        }
+        meshes.emplace_back();
+        meshes.back().prim = prim;
+        const UsdPrim parent = prim.GetParent();
+        if (!parent.IsA<UsdGeomXform>())
+        {
+            meshes.back().skipReason = "has no parent Xform";
+        }
+        else if (parent.GetVariantSets().HasVariantSet(kLodSet))
+        {
+            meshes.back().skipReason = "already has LOD variants";
+        }
+    }
+
+    Stopwatch decimateTimer;
+    WorkParallelForN(
+        meshes.size(),
+        [&meshes, &rootLayer, &ratios](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (meshes[i].skipReason.empty() && loadLodMesh(meshes[i], rootLayer))
+                {
+                    decimateLodMesh(meshes[i], ratios);
+                }
+            }
+        }
+    );
+    const double decimateMs = decimateTimer.milliseconds();
+
+    std::map<SdfPath, std::vector<size_t>> parents;
+    std::map<std::string, size_t> skipped;
+    size_t lodMeshes = 0;
+    size_t triangles[3] = {};
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const LodMesh& mesh = meshes[i];
+        if (!mesh.skipReason.empty())
+        {
+            skipped[mesh.skipReason]++;
+            if (verbose)
+            {
+                OMNI_LOG_INFO("  %s skipped: %s", mesh.prim.GetPath().GetText(), mesh.skipReason.c_str());
+            }
+            continue;
+        }
+        parents[mesh.prim.GetParent().GetPath()].push_back(i);
+        lodMeshes++;
+        for (int l = 0; l < 3; l++)
+        {
+            triangles[l] += mesh.triangleCounts[l];
+        }
+        if (verbose)
+        {
+            OMNI_LOG_INFO(
+                "  %s: %zu -> %zu -> %zu triangles",
+                mesh.prim.GetPath().GetText(),
+                mesh.triangleCounts[0],
+                mesh.triangleCounts[1],
+                mesh.triangleCounts[2]
+            );
+        }
+    }
+
+    Stopwatch authorTimer;
+    if (!dryRun && !parents.empty())
+    {
+        // The variant sets are added with the Usd API, the way helloWorld adds its references and payloads
+        for (const auto& entry : parents)
+        {
+            UsdVariantSet variantSet = stage->GetPrimAtPath(entry.first).GetVariantSets().AddVariantSet(kLodSet);
+            for (const std::string& name : kLodNames)
+            {
+                variantSet.AddVariant(name);
+            }
+            variantSet.SetVariantSelection(kLodNames[selection]);
+        }
+
+        // Then each mesh spec is copied into every variant, decimated in LOD1 and LOD2, and removed from the parent
+        {
+            SdfChangeBlock changeBlock;
+            for (const auto& entry : parents)
+            {
+                SdfPrimSpecHandle parentSpec = rootLayer->GetPrimAtPath(entry.first);
+                for (size_t i : entry.second)
+                {
+                    const LodMesh& mesh = meshes[i];
+                    const SdfPath meshPath = mesh.prim.GetPath();
+                    for (int l = 0; l < 3; l++)
+                    {
+                        const SdfPath variantPath =
+                            entry.first.AppendVariantSelection(kLodSet.GetString(), kLodNames[l]).AppendChild(mesh.prim.GetName());
+                        SdfCopySpec(rootLayer, meshPath, rootLayer, variantPath);
+                        if (l > 0)
+                        {
+                            authorLodLevel(rootLayer, variantPath, mesh, mesh.levels[l - 1]);
+                        }
+                    }
+                    parentSpec->RemoveNameChild(rootLayer->GetPrimAtPath(meshPath));
+                }
+            }
+        }
+        rootLayer->Save();
+    }
+    const double authorMs = authorTimer.milliseconds();
+
+    OMNI_LOG_INFO(
+        "Generated LODs for %zu of %zu meshes under %zu Xforms%s",
+        lodMeshes,
+        meshes.size(),
+        parents.size(),
+        dryRun ? " (dry run, nothing authored)" : ""
+    );
+    for (const auto& entry : skipped)
+    {
+        OMNI_LOG_INFO("  %zu meshes skipped: %s", entry.second, entry.first.c_str());
+    }
+    const double percent1 = triangles[0] ? 100.0 * (double)triangles[1] / (double)triangles[0] : 0.0;
+    const double percent2 = triangles[0] ? 100.0 * (double)triangles[2] / (double)triangles[0] : 0.0;
+    OMNI_LOG_INFO("Triangles: LOD0 %zu, LOD1 %zu (%.1f%%), LOD2 %zu (%.1f%%)", triangles[0], triangles[1], percent1, triangles[2], percent2);
+    OMNI_LOG_INFO(
+        "Load and decimate %.1f ms (%.2f million input triangles/sec on %u threads), author %.1f ms",
+        decimateMs,
+        decimateMs > 0.0 ? (double)triangles[0] / (decimateMs * 1000.0) : 0.0,
+        WorkGetConcurrencyLimit(),
+        authorMs
+    );
+    return EXIT_SUCCESS;
+}
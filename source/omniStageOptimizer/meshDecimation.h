@@ -0,0 +1,502 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/gf/vec3f.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and holds a quadric error
+// metric triangle decimator (Garland and Heckbert, "Surface Simplification Using
+// Quadric Error Metrics").
+//
+// Edges collapse onto one of their two vertices rather than an optimal new point, so
+// a decimated mesh only ever uses points of the original. Vertex primvars can then be
+// copied for the points that are kept and face-varying primvars for the original
+// face corners that are kept, whatever their type.
+///////////////////////////////////////////////////////////////////////////////////////
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+// The symmetric 4x4 matrix of the summed squared distances to a set of planes
+struct Quadric
+{
+    double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+    double b2 = 0.0, bc = 0.0, bd = 0.0;
+    double c2 = 0.0, cd = 0.0;
+    double d2 = 0.0;
+
+    // The plane n.p + d = 0 with a unit normal n
+    void addPlane(const GfVec3d& n, double d, double weight)
+    {
+        a2 += weight * n[0] * n[0];
+        ab += weight * n[0] * n[1];
+        ac += weight * n[0] * n[2];
+        ad += weight * n[0] * d;
+        b2 += weight * n[1] * n[1];
+        bc += weight * n[1] * n[2];
+        bd += weight * n[1] * d;
+        c2 += weight * n[2] * n[2];
+        cd += weight * n[2] * d;
+        d2 += weight * d * d;
+    }
+
+    Quadric& operator+=(const Quadric& other)
+    {
+        a2 += other.a2;
+        ab += other.ab;
+        ac += other.ac;
+        ad += other.ad;
+        b2 += other.b2;
+        bc += other.bc;
+        bd += other.bd;
+        c2 += other.c2;
+        cd += other.cd;
+        d2 += other.d2;
+        return *this;
+    }
+
+    double evaluate(const GfVec3f& p) const
+    {
+        const double x = p[0];
+        const double y = p[1];
+        const double z = p[2];
+        return x * x * a2 + 2.0 * x * y * ab + 2.0 * x * z * ac + 2.0 * x * ad + y * y * b2 + 2.0 * y * z * bc + 2.0 * y * bd + z * z * c2 +
+               2.0 * z * cd + d2;
+    }
+};
+
+// Greedily collapses the cheapest edge until a triangle budget is reached.
+//
+// Every triangle corner remembers the original corner it takes its face-varying data from and every triangle the
+// original face it came from. A vertex is only removed when all of its triangles agree on both, so UV seams, hard
+// normal edges and material borders stay where they are. Open borders are kept by penalty planes through the
+// border edges.
+class QuadricDecimator
+{
+public:
+
+    // `sameCorner(a, b)` and `sameFace(a, b)` compare the face-varying data of two original corners and the uniform
+    // data of two original faces
+    QuadricDecimator(
+        const GfVec3f* points,
+        size_t pointCount,
+        std::vector<int> triangles,
+        std::vector<int> corners,
+        std::vector<int> faces,
+        std::function<bool(int, int)> sameCorner,
+        std::function<bool(int, int)> sameFace
+    )
+        : m_points(points)
+        , m_triangles(std::move(triangles))
+        , m_corners(std::move(corners))
+        , m_faces(std::move(faces))
+        , m_sameCorner(std::move(sameCorner))
+        , m_sameFace(std::move(sameFace))
+        , m_quadrics(pointCount)
+        , m_vertexTriangles(pointCount)
+        , m_removed(pointCount, 0)
+        , m_stamps(pointCount, 0)
+        , m_marks(pointCount, 0)
+    {
+        const size_t triangleCount = m_triangles.size() / 3;
+        m_dead.assign(triangleCount, 0);
+        m_liveTriangles = triangleCount;
+
+        // Area weighted face planes
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            GfVec3d normal;
+            double area;
+            if (!facePlane(t, normal, area))
+            {
+                continue;
+            }
+            const GfVec3d p(m_points[m_triangles[t * 3]]);
+            Quadric plane;
+            plane.addPlane(normal, -GfDot(normal, p), area);
+            for (int k = 0; k < 3; k++)
+            {
+                m_quadrics[m_triangles[t * 3 + k]] += plane;
+            }
+        }
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                m_vertexTriangles[m_triangles[t * 3 + k]].push_back((int)t);
+            }
+        }
+
+        // Edges used by one triangle are open borders (and edges used by more than two are not manifold): a plane
+        // through the edge, perpendicular to the face, keeps them from sliding inward
+        std::vector<std::pair<uint64_t, int>> edges;
+        edges.reserve(m_triangles.size());
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                edges.emplace_back(edgeKey(m_triangles[t * 3 + k], m_triangles[t * 3 + (k + 1) % 3]), (int)t);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        std::vector<uint64_t> uniqueEdges;
+        for (size_t begin = 0, end = 0; begin < edges.size(); begin = end)
+        {
+            while (end < edges.size() && edges[end].first == edges[begin].first)
+            {
+                end++;
+            }
+            const uint64_t key = edges[begin].first;
+            if (end - begin != 2)
+            {
+                for (size_t e = begin; e < end; e++)
+                {
+                    addBorderPlane((int)(key >> 32), (int)(key & 0xffffffffu), (size_t)edges[e].second);
+                }
+            }
+            uniqueEdges.push_back(key);
+        }
+
+        // The quadrics are complete, queue every edge
+        for (uint64_t key : uniqueEdges)
+        {
+            pushEdge((int)(key >> 32), (int)(key & 0xffffffffu));
+        }
+    }
+
+    size_t triangleCount() const
+    {
+        return m_liveTriangles;
+    }
+
+    // Collapse edges until at most `target` triangles are left or no edge can be collapsed without breaking the mesh
+    void decimateTo(size_t target)
+    {
+        while (m_liveTriangles > target && !m_heap.empty())
+        {
+            const Candidate candidate = m_heap.top();
+            m_heap.pop();
+            if (m_removed[candidate.remove] || m_removed[candidate.keep] || m_stamps[candidate.remove] != candidate.removeStamp ||
+                m_stamps[candidate.keep] != candidate.keepStamp)
+            {
+                continue;
+            }
+            collapse(candidate.remove, candidate.keep);
+        }
+    }
+
+    // The live triangles with the original corner and face each of them takes its data from
+    void snapshot(std::vector<int>& triangles, std::vector<int>& corners, std::vector<int>& faces) const
+    {
+        triangles.clear();
+        corners.clear();
+        faces.clear();
+        for (size_t t = 0; t < m_dead.size(); t++)
+        {
+            if (m_dead[t])
+            {
+                continue;
+            }
+            triangles.insert(triangles.end(), m_triangles.begin() + t * 3, m_triangles.begin() + t * 3 + 3);
+            corners.insert(corners.end(), m_corners.begin() + t * 3, m_corners.begin() + t * 3 + 3);
+            faces.push_back(m_faces[t]);
+        }
+    }
+
+private:
+
+    struct Candidate
+    {
+        double cost;
+        int remove;
+        int keep;
+        uint32_t removeStamp;
+        uint32_t keepStamp;
+
+        bool operator<(const Candidate& other) const
+        {
+            // std::priority_queue is a max heap, the cheapest collapse has to come out first
+            return cost > other.cost;
+        }
+    };
+
+    static uint64_t edgeKey(int a, int b)
+    {
+        return a < b ? ((uint64_t)a << 32) | (uint32_t)b : ((uint64_t)b << 32) | (uint32_t)a;
+    }
+
+    bool facePlane(size_t t, GfVec3d& normal, double& area) const
+    {
+        const GfVec3d a(m_points[m_triangles[t * 3]]);
+        const GfVec3d b(m_points[m_triangles[t * 3 + 1]]);
+        const GfVec3d c(m_points[m_triangles[t * 3 + 2]]);
+        normal = GfCross(b - a, c - a);
+        const double length = normal.GetLength();
+        if (length <= 0.0)
+        {
+            return false;
+        }
+        normal /= length;
+        area = 0.5 * length;
+        return true;
+    }
+
+    void addBorderPlane(int a, int b, size_t t)
+    {
+        GfVec3d faceNormal;
+        double area;
+        if (!facePlane(t, faceNormal, area))
+        {
+            return;
+        }
+        const GfVec3d pa(m_points[a]);
+        const GfVec3d edge = GfVec3d(m_points[b]) - pa;
+        GfVec3d normal = GfCross(edge, faceNormal);
+        const double length = normal.GetLength();
+        if (length <= 0.0)
+        {
+            return;
+        }
+        normal /= length;
+        // Weighted by the squared edge length so the penalty has the same units as the area weighted face planes
+        Quadric plane;
+        plane.addPlane(normal, -GfDot(normal, pa), kBorderWeight * edge.GetLengthSq());
+        m_quadrics[a] += plane;
+        m_quadrics[b] += plane;
+    }
+
+    // A vertex can go when its triangles take the same data from it and all come from equivalent faces
+    bool isRemovable(int v) const
+    {
+        int firstCorner = -1;
+        int firstFace = -1;
+        for (int t : m_vertexTriangles[v])
+        {
+            if (m_dead[t])
+            {
+                continue;
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                if (m_triangles[t * 3 + k] != v)
+                {
+                    continue;
+                }
+                const int corner = m_corners[t * 3 + k];
+                if (firstCorner < 0)
+                {
+                    firstCorner = corner;
+                    firstFace = m_faces[t];
+                }
+                else if ((corner != firstCorner && !m_sameCorner(firstCorner, corner)) ||
+                         (m_faces[t] != firstFace && !m_sameFace(firstFace, m_faces[t])))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Queue the cheaper allowed direction of collapsing the edge a-b
+    void pushEdge(int a, int b)
+    {
+        Quadric quadric = m_quadrics[a];
+        quadric += m_quadrics[b];
+        const bool removeA = isRemovable(a);
+        const bool removeB = isRemovable(b);
+        if (!removeA && !removeB)
+        {
+            return;
+        }
+        const double costKeepB = removeA ? quadric.evaluate(m_points[b]) : 0.0;
+        const double costKeepA = removeB ? quadric.evaluate(m_points[a]) : 0.0;
+        if (removeA && (!removeB || costKeepB <= costKeepA))
+        {
+            m_heap.push({ costKeepB, a, b, m_stamps[a], m_stamps[b] });
+        }
+        else
+        {
+            m_heap.push({ costKeepA, b, a, m_stamps[b], m_stamps[a] });
+        }
+    }
+
+    // Move vertex v onto vertex u. Returns false, changing nothing, if the collapse would fold a triangle over or
+    // join two sheets of the surface.
+    bool collapse(int v, int u)
+    {
+        if (!isRemovable(v))
+        {
+            return false;
+        }
+
+        // The triangles on the edge vanish, the others around v move their corner to u
+        int sharedCount = 0;
+        int sharedTriangle = -1;
+        for (int t : m_vertexTriangles[v])
+        {
+            if (!m_dead[t] && (m_triangles[t * 3] == u || m_triangles[t * 3 + 1] == u || m_triangles[t * 3 + 2] == u))
+            {
+                sharedCount++;
+                sharedTriangle = t;
+            }
+        }
+        if (sharedCount == 0)
+        {
+            return false;
+        }
+
+        // Link condition: u and v may only have the opposite vertices of their shared triangles in common
+        m_markStamp++;
+        for (int t : m_vertexTriangles[u])
+        {
+            if (!m_dead[t])
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    m_marks[m_triangles[t * 3 + k]] = m_markStamp;
+                }
+            }
+        }
+        int commonCount = 0;
+        for (int t : m_vertexTriangles[v])
+        {
+            if (m_dead[t])
+            {
+                continue;
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                const int w = m_triangles[t * 3 + k];
+                if (w != u && w != v && m_marks[w] == m_markStamp)
+                {
+                    // Count every common neighbor once
+                    m_marks[w] = m_markStamp - 1;
+                    commonCount++;
+                }
+            }
+        }
+        if (commonCount > sharedCount)
+        {
+            return false;
+        }
+
+        // No moved triangle may flip over
+        const GfVec3f& target = m_points[u];
+        for (int t : m_vertexTriangles[v])
+        {
+            if (m_dead[t])
+            {
+                continue;
+            }
+            GfVec3f corner[3];
+            GfVec3f moved[3];
+            bool shared = false;
+            for (int k = 0; k < 3; k++)
+            {
+                const int w = m_triangles[t * 3 + k];
+                shared = shared || w == u;
+                corner[k] = m_points[w];
+                moved[k] = w == v ? target : corner[k];
+            }
+            if (shared)
+            {
+                continue;
+            }
+            const GfVec3f before = GfCross(corner[1] - corner[0], corner[2] - corner[0]);
+            const GfVec3f after = GfCross(moved[1] - moved[0], moved[2] - moved[0]);
+            if (GfDot(before, after) <= 0.0f)
+            {
+                return false;
+            }
+        }
+
+        // The moved corners take their face-varying data from u's corner on the collapsed edge
+        int keptCorner = -1;
+        for (int k = 0; k < 3; k++)
+        {
+            if (m_triangles[sharedTriangle * 3 + k] == u)
+            {
+                keptCorner = m_corners[sharedTriangle * 3 + k];
+            }
+        }
+        std::vector<int>& uTriangles = m_vertexTriangles[u];
+        for (int t : m_vertexTriangles[v])
+        {
+            if (m_dead[t])
+            {
+                continue;
+            }
+            int* tri = &m_triangles[t * 3];
+            if (tri[0] == u || tri[1] == u || tri[2] == u)
+            {
+                m_dead[t] = 1;
+                m_liveTriangles--;
+                continue;
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                if (tri[k] == v)
+                {
+                    tri[k] = u;
+                    m_corners[t * 3 + k] = keptCorner;
+                }
+            }
+            uTriangles.push_back(t);
+        }
+        uTriangles.erase(
+            std::remove_if(uTriangles.begin(), uTriangles.end(), [this](int t) { return m_dead[t] != 0; }),
+            uTriangles.end()
+        );
+        m_vertexTriangles[v].clear();
+        m_vertexTriangles[v].shrink_to_fit();
+        m_removed[v] = 1;
+        m_quadrics[u] += m_quadrics[v];
+
+        // Every queued edge of u is stale now, requeue them with the new quadric
+        m_stamps[u]++;
+        m_markStamp++;
+        m_marks[u] = m_markStamp;
+        for (int t : uTriangles)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                const int w = m_triangles[t * 3 + k];
+                if (m_marks[w] != m_markStamp)
+                {
+                    m_marks[w] = m_markStamp;
+                    pushEdge(u, w);
+                }
+            }
+        }
+        return true;
+    }
+
+    static constexpr double kBorderWeight = 100.0;
+
+    const GfVec3f* m_points;
+    std::vector<int> m_triangles;
+    std::vector<int> m_corners;
+    std::vector<int> m_faces;
+    std::function<bool(int, int)> m_sameCorner;
+    std::function<bool(int, int)> m_sameFace;
+    std::vector<Quadric> m_quadrics;
+    std::vector<std::vector<int>> m_vertexTriangles;
+    std::vector<char> m_dead;
+    std::vector<char> m_removed;
+    std::vector<uint32_t> m_stamps;
+    std::vector<uint32_t> m_marks;
+    uint32_t m_markStamp = 0;
+    size_t m_liveTriangles = 0;
+    std::priority_queue<Candidate> m_heap;
+};
@@ -0,0 +1,570 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "ChildNameAllocator.h"
+#include "extentRepair.h"
+#include "optimizerCommon.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/quath.h>
+#include <pxr/base/gf/rotation.h>
+#include <pxr/base/gf/transform.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/copyUtils.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/reference.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/tokens.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/pointInstancer.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xformCache.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and replaces meshes that only
+// differ by their transform (or by a constant offset baked into their points) with
+// one shared prototype.
+//
+// Stages built like the Simple Sensor sample hold thousands of boxes with identical
+// topology, normals and UVs. Each copy costs parse time, memory and a draw; as
+// instances, the renderer and the file keep one copy of the geometry.
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct MeshSignature
+{
+    UsdPrim prim;
+    bool eligible = false;
+    uint64_t hash = 0;
+    float quantum = 0.0f;
+    GfVec3f offset = GfVec3f(0.0f);
+    VtVec3fArray normalizedPoints;
+    std::vector<std::pair<TfToken, VtValue>> attributes;
+    std::vector<std::pair<TfToken, SdfPathVector>> relationships;
+    size_t geometryBytes = 0;
+};
+
+static uint64_t hashMix(uint64_t hash, uint64_t value)
+{
+    return hash ^ (value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+}
+
+// Only meshes that are fully defined by one spec in the root layer can be rewritten in place.
+// Animated meshes, meshes with children (GeomSubsets) and meshes with applied schemas other than material binding
+// (physics, for example, must stay on the mesh) are left alone.
+static bool isInstancingCandidate(const UsdPrim& prim, const SdfLayerHandle& rootLayer)
+{
+    SdfPrimSpecHandleVector stack = prim.GetPrimStack();
+    if (stack.size() != 1 || stack[0]->GetLayer() != rootLayer || !prim.GetAllChildren().empty())
+    {
+        return false;
+    }
+    for (const TfToken& schema : prim.GetAppliedSchemas())
+    {
+        if (schema != TfToken("MaterialBindingAPI"))
+        {
+            return false;
+        }
+    }
+    for (const UsdAttribute& attr : prim.GetAuthoredAttributes())
+    {
+        if (attr.ValueMightBeTimeVarying())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool isTransformProperty(const TfToken& name)
+{
+    return TfStringStartsWith(name.GetString(), "xformOp") || name == UsdGeomTokens->extent;
+}
+
+// Hash everything that defines the mesh except its transform and its point positions. The points are centered on
+// their bounds, but copies that were offset in float still differ in the last bits and any rounding of them into
+// the hash would split near equal copies at the rounding boundaries. Only the point count is hashed, the positions
+// are compared within the tolerance by sameMesh.
+static void computeSignature(MeshSignature& signature, const SdfLayerHandle& rootLayer)
+{
+    const UsdPrim& prim = signature.prim;
+    if (!isInstancingCandidate(prim, rootLayer))
+    {
+        return;
+    }
+
+    VtVec3fArray points;
+    UsdGeomMesh(prim).GetPointsAttr().Get(&points);
+    VtVec3fArray extent = computePointsExtent(points);
+    if (extent.size() != 2)
+    {
+        return;
+    }
+    signature.offset = (extent[0] + extent[1]) * 0.5f;
+    const float size = std::max(1.0f, (extent[1] - extent[0]).GetLength());
+    // A power of two step of about 1e-5 of the mesh size, the float error copies can pick up from being offset
+    signature.quantum = std::exp2(std::floor(std::log2(size * 1e-5f)));
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = hashMix(hash, (uint64_t)points.size());
+    signature.normalizedPoints.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        signature.normalizedPoints[i] = points[i] - signature.offset;
+    }
+    signature.geometryBytes = arrayBytes(VtValue(points));
+
+    // GetAuthoredAttributes and GetAuthoredProperties return properties sorted by name, so the hash is order stable
+    for (const UsdAttribute& attr : prim.GetAuthoredAttributes())
+    {
+        const TfToken& name = attr.GetName();
+        if (name == UsdGeomTokens->points || isTransformProperty(name))
+        {
+            continue;
+        }
+        VtValue value;
+        attr.Get(&value);
+        hash = hashMix(hash, TfHash()(name));
+        hash = hashMix(hash, value.GetHash());
+        signature.geometryBytes += arrayBytes(value);
+        signature.attributes.emplace_back(name, value);
+    }
+    for (const UsdRelationship& rel : prim.GetAuthoredRelationships())
+    {
+        SdfPathVector targets;
+        rel.GetTargets(&targets);
+        hash = hashMix(hash, TfHash()(rel.GetName()));
+        for (const SdfPath& target : targets)
+        {
+            hash = hashMix(hash, SdfPath::Hash()(target));
+        }
+        signature.relationships.emplace_back(rel.GetName(), targets);
+    }
+    signature.hash = hash;
+    signature.eligible = true;
+}
+
+// Equal hashes are confirmed with a full comparison, allowing the points to differ by twice the larger step
+static bool sameMesh(const MeshSignature& a, const MeshSignature& b)
+{
+    if (a.normalizedPoints.size() != b.normalizedPoints.size() || a.attributes != b.attributes || a.relationships != b.relationships)
+    {
+        return false;
+    }
+    const float tolerance = 2.0f * std::max(a.quantum, b.quantum);
+    for (size_t i = 0; i < a.normalizedPoints.size(); i++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (std::fabs(a.normalizedPoints[i][axis] - b.normalizedPoints[i][axis]) > tolerance)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// A copy of a spec's property list, so properties can be removed while walking it
+static std::vector<SdfPropertySpecHandle> propertiesOf(const SdfPrimSpecHandle& spec)
+{
+    std::vector<SdfPropertySpecHandle> properties;
+    for (const SdfPropertySpecHandle& property : spec->GetProperties())
+    {
+        properties.push_back(property);
+    }
+    return properties;
+}
+
+// Copy a mesh spec to `destination` without its transform, with its points centered on the origin
+static bool copyPrototypeMesh(const SdfLayerHandle& layer, const MeshSignature& source, const SdfPath& destination)
+{
+    if (!SdfCopySpec(layer, source.prim.GetPath(), layer, destination))
+    {
+        return false;
+    }
+    SdfPrimSpecHandle spec = layer->GetPrimAtPath(destination);
+    if (!spec)
+    {
+        return false;
+    }
+    for (const SdfPropertySpecHandle& property : propertiesOf(spec))
+    {
+        if (isTransformProperty(property->GetNameToken()))
+        {
+            spec->RemoveProperty(property);
+        }
+    }
+    if (SdfAttributeSpecHandle points = layer->GetAttributeAtPath(destination.AppendProperty(UsdGeomTokens->points)))
+    {
+        points->SetDefaultValue(VtValue(source.normalizedPoints));
+    }
+    SdfAttributeSpecHandle extent = SdfAttributeSpec::New(spec, UsdGeomTokens->extent, SdfValueTypeNames->Float3Array);
+    if (extent)
+    {
+        extent->SetDefaultValue(VtValue(computePointsExtent(source.normalizedPoints)));
+    }
+    return true;
+}
+
+// The first "<base>_<n>" child name that is free, counting up from `next`
+static TfToken nextNumberedName(ChildNameAllocator& names, const char* base, size_t& next)
+{
+    TfToken name;
+    do
+    {
+        name = TfToken(TfStringPrintf("%s_%zu", base, next++));
+    } while (names.isUsed(name));
+    names.reserve(name);
+    return name;
+}
+
+// The prims under the prototypes of every point instancer, an earlier pointinstancer run left its prototype meshes
+// there and removing one of them breaks the instancer
+static std::unordered_set<SdfPath, SdfPath::Hash> pointInstancerPrototypes(const UsdStageRefPtr& stage)
+{
+    std::unordered_set<SdfPath, SdfPath::Hash> prototypes;
+    for (const UsdPrim& prim : stage->Traverse())
+    {
+        if (prim.IsA<UsdGeomPointInstancer>())
+        {
+            SdfPathVector targets;
+            UsdGeomPointInstancer(prim).GetPrototypesRel().GetTargets(&targets);
+            prototypes.insert(targets.begin(), targets.end());
+        }
+    }
+    return prototypes;
+}
+
+static bool isUnderAny(const SdfPath& path, const std::unordered_set<SdfPath, SdfPath::Hash>& roots)
+{
+    for (SdfPath ancestor = path; !ancestor.IsEmpty() && !ancestor.IsAbsoluteRootPath(); ancestor = ancestor.GetParentPath())
+    {
+        if (roots.count(ancestor))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Turn the mesh spec at `path` into an instanceable Xform that references `prototype`. The mesh's own transform ops
+// are kept and the offset that was removed from the points is appended as one more translate.
+static bool makeInstance(const SdfLayerHandle& layer, const MeshSignature& member, const SdfPath& prototype)
+{
+    static const TfToken offsetOpName("xformOp:translate:instanceOffset");
+
+    SdfPrimSpecHandle spec = layer->GetPrimAtPath(member.prim.GetPath());
+    if (!spec || spec->GetAttributeAtPath(member.prim.GetPath().AppendProperty(offsetOpName)))
+    {
+        return false;
+    }
+    for (const SdfPropertySpecHandle& property : propertiesOf(spec))
+    {
+        const TfToken& name = property->GetNameToken();
+        if (!TfStringStartsWith(name.GetString(), "xformOp") && name != UsdGeomTokens->visibility && name != UsdGeomTokens->purpose)
+        {
+            spec->RemoveProperty(property);
+        }
+    }
+    spec->ClearInfo(UsdTokens->apiSchemas);
+    spec->SetTypeName("Xform");
+    spec->SetInstanceable(true);
+    spec->GetReferenceList().Prepend(SdfReference(std::string(), prototype));
+
+    SdfAttributeSpecHandle offsetOp = SdfAttributeSpec::New(spec, offsetOpName, SdfValueTypeNames->Double3);
+    if (!offsetOp)
+    {
+        return false;
+    }
+    offsetOp->SetDefaultValue(VtValue(GfVec3d(member.offset)));
+
+    SdfAttributeSpecHandle opOrder = layer->GetAttributeAtPath(member.prim.GetPath().AppendProperty(UsdGeomTokens->xformOpOrder));
+    if (!opOrder)
+    {
+        opOrder = SdfAttributeSpec::New(spec, UsdGeomTokens->xformOpOrder, SdfValueTypeNames->TokenArray, SdfVariabilityUniform);
+        if (!opOrder)
+        {
+            return false;
+        }
+    }
+    VtTokenArray order;
+    VtValue current = opOrder->GetDefaultValue();
+    if (current.IsHolding<VtTokenArray>())
+    {
+        order = current.UncheckedGet<VtTokenArray>();
+    }
+    order.push_back(offsetOpName);
+    opOrder->SetDefaultValue(VtValue(order));
+    return true;
+}
+
+// Find meshes that are copies of each other and share one prototype between them, either as instanceable
+// references (--mode references, the default) or as the prototype of a UsdGeomPointInstancer (--mode pointinstancer)
+static int instanceDuplicateMeshes(const OptimizerArgs& args)
+{
+    const bool dryRun = args.hasFlag("--dry-run");
+    const bool usePointInstancer = args.getString("--mode", "references") == "pointinstancer";
+    const size_t minCount = (size_t)std::max(2L, args.getInt("--min-count", 2));
+    const std::string stageUrl = args.stageUrl();
+
+    // Warm any connection and file caches, then time a clean load for the before/after comparison
+    timeStageLoad(stageUrl);
+    const double loadBeforeMs = timeStageLoad(stageUrl);
+    const uint64_t fileBefore = getFileSize(stageUrl);
+
+    size_t meshCount = 0;
+    size_t instancedCount = 0;
+    size_t groupCount = 0;
+    size_t bytesBefore = 0;
+    size_t bytesAfter = 0;
+    {
+        UsdStageRefPtr stage = openStageForCommand(stageUrl);
+        if (!stage)
+        {
+            return EXIT_FAILURE;
+        }
+        SdfLayerHandle rootLayer = stage->GetRootLayer();
+
+        Stopwatch hashTimer;
+        const std::unordered_set<SdfPath, SdfPath::Hash> instancerPrototypes = pointInstancerPrototypes(stage);
+        std::vector<MeshSignature> meshes;
+        for (const UsdPrim& prim : stage->Traverse())
+        {
+            if (prim.IsA<UsdGeomMesh>() && !isUnderAny(prim.GetPath(), instancerPrototypes))
+            {
+                meshes.emplace_back();
+                meshes.back().prim = prim;
+            }
+        }
+        meshCount = meshes.size();
+        WorkParallelForN(
+            meshes.size(),
+            [&meshes, &rootLayer](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    computeSignature(meshes[i], rootLayer);
+                }
+            }
+        );
+
+        // Bucket by hash, then split each bucket into groups of meshes that really are equal
+        std::unordered_map<uint64_t, std::vector<std::vector<size_t>>> buckets;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            if (!meshes[i].eligible)
+            {
+                continue;
+            }
+            std::vector<std::vector<size_t>>& groups = buckets[meshes[i].hash];
+            auto group = std::find_if(
+                groups.begin(),
+                groups.end(),
+                [&meshes, i](const std::vector<size_t>& candidates)
+                {
+                    return sameMesh(meshes[candidates[0]], meshes[i]);
+                }
+            );
+            if (group == groups.end())
+            {
+                groups.push_back({ i });
+            }
+            else
+            {
+                group->push_back(i);
+            }
+        }
+        std::vector<std::vector<size_t>> groups;
+        for (auto& bucket : buckets)
+        {
+            for (auto& group : bucket.second)
+            {
+                if (group.size() >= minCount)
+                {
+                    groups.push_back(std::move(group));
+                }
+            }
+        }
+        // Hash order is arbitrary, sort so the prototype names are stable between runs
+        std::sort(
+            groups.begin(),
+            groups.end(),
+            [&meshes](const std::vector<size_t>& a, const std::vector<size_t>& b)
+            {
+                return meshes[a[0]].prim.GetPath() < meshes[b[0]].prim.GetPath();
+            }
+        );
+        groupCount = groups.size();
+        for (const auto& group : groups)
+        {
+            instancedCount += group.size();
+            bytesBefore += group.size() * meshes[group[0]].geometryBytes;
+            bytesAfter += meshes[group[0]].geometryBytes;
+        }
+        OMNI_LOG_INFO(
+            "Hashed %zu meshes in %.1f ms: %zu groups of duplicates cover %zu meshes",
+            meshCount,
+            hashTimer.milliseconds(),
+            groupCount,
+            instancedCount
+        );
+        if (dryRun || groups.empty())
+        {
+            for (const auto& group : groups)
+            {
+                OMNI_LOG_INFO("  %zu copies of %s", group.size(), meshes[group[0]].prim.GetPath().GetText());
+            }
+            return EXIT_SUCCESS;
+        }
+
+        Stopwatch authorTimer;
+        size_t failedGroups = 0;
+        if (usePointInstancer)
+        {
+            // The instancers sit under the default prim, the instance transforms are relative to it
+            UsdPrim parent = stage->GetDefaultPrim() ? stage->GetDefaultPrim() : stage->GetPseudoRoot();
+            SdfPath instancersPath = parent.GetPath().AppendChild(TfToken("Instancers"));
+            // Instancers from an earlier run are kept, the new ones are numbered after them
+            ChildNameAllocator instancerNames(stage->DefinePrim(instancersPath, TfToken("Scope")));
+            size_t nextInstancer = 0;
+            UsdGeomXformCache xformCache;
+            const GfMatrix4d toInstancer = xformCache.GetLocalToWorldTransform(parent).GetInverse();
+
+            for (const std::vector<size_t>& group : groups)
+            {
+                SdfPath instancerPath = instancersPath.AppendChild(nextNumberedName(instancerNames, "Instancer", nextInstancer));
+                UsdGeomPointInstancer instancer = UsdGeomPointInstancer::Define(stage, instancerPath);
+                SdfPath prototypesPath = instancerPath.AppendChild(TfToken("Prototypes"));
+                SdfPath prototypePath = prototypesPath.AppendChild(meshes[group[0]].prim.GetName());
+                if (!instancer || !stage->DefinePrim(prototypesPath, TfToken("Scope")) || !copyPrototypeMesh(rootLayer, meshes[group[0]], prototypePath))
+                {
+                    OMNI_LOG_ERROR("Could not author the instancer %s, its %zu meshes are left as they are", instancerPath.GetText(), group.size());
+                    stage->RemovePrim(instancerPath);
+                    failedGroups++;
+                    continue;
+                }
+                instancer.CreatePrototypesRel().SetTargets({ prototypePath });
+
+                // Prototype space -> instancer space, decomposed into the scale, orientation and position the
+                // instancer composes. Meshes with shear can't be expressed that way and stay as they are.
+                VtVec3fArray positions;
+                VtQuathArray orientations;
+                VtVec3fArray scales;
+                std::vector<SdfPath> replaced;
+                for (size_t member : group)
+                {
+                    const MeshSignature& mesh = meshes[member];
+                    GfMatrix4d matrix = GfMatrix4d().SetTranslate(GfVec3d(mesh.offset)) * xformCache.GetLocalToWorldTransform(mesh.prim) * toInstancer;
+                    GfTransform transform(matrix);
+                    GfMatrix4d rebuilt = GfMatrix4d().SetScale(transform.GetScale()) * GfMatrix4d().SetRotate(transform.GetRotation()) *
+                        GfMatrix4d().SetTranslate(transform.GetTranslation());
+                    bool exact = true;
+                    for (int r = 0; r < 4 && exact; r++)
+                    {
+                        for (int c = 0; c < 4 && exact; c++)
+                        {
+                            exact = std::fabs(rebuilt[r][c] - matrix[r][c]) <= 1e-6 * std::max(1.0, std::fabs(matrix[r][c]));
+                        }
+                    }
+                    if (!exact)
+                    {
+                        instancedCount--;
+                        bytesBefore -= mesh.geometryBytes;
+                        continue;
+                    }
+                    positions.push_back(GfVec3f(transform.GetTranslation()));
+                    orientations.push_back(GfQuath(transform.GetRotation().GetQuat()));
+                    scales.push_back(GfVec3f(transform.GetScale()));
+                    replaced.push_back(mesh.prim.GetPath());
+                }
+                instancer.CreatePositionsAttr().Set(positions);
+                instancer.CreateOrientationsAttr().Set(orientations);
+                instancer.CreateScalesAttr().Set(scales);
+                instancer.CreateProtoIndicesAttr().Set(VtIntArray(positions.size(), 0));
+                VtVec3fArray extent;
+                if (UsdGeomBoundable::ComputeExtentFromPlugins(instancer, UsdTimeCode::Default(), &extent))
+                {
+                    instancer.CreateExtentAttr().Set(extent);
+                }
+                for (const SdfPath& path : replaced)
+                {
+                    stage->RemovePrim(path);
+                }
+            }
+        }
+        else
+        {
+            // Class prims are not rendered or traversed, they only exist to be referenced. Prototypes from an earlier run
+            // are kept, the new ones are numbered after them.
+            const SdfPath prototypesPath("/Prototypes");
+            ChildNameAllocator prototypeNames(stage->GetPrimAtPath(prototypesPath));
+            size_t nextPrototype = 0;
+            SdfChangeBlock changeBlock;
+            SdfPrimSpecHandle prototypesSpec = SdfCreatePrimInLayer(rootLayer, prototypesPath);
+            if (!prototypesSpec)
+            {
+                OMNI_LOG_ERROR("Could not author %s in the root layer", prototypesPath.GetText());
+                return EXIT_FAILURE;
+            }
+            prototypesSpec->SetSpecifier(SdfSpecifierClass);
+            for (const std::vector<size_t>& group : groups)
+            {
+                const TfToken name = nextNumberedName(prototypeNames, "Prototype", nextPrototype);
+                SdfPrimSpecHandle prototypeSpec = SdfPrimSpec::New(prototypesSpec, name, SdfSpecifierDef, "Xform");
+                if (!prototypeSpec || !copyPrototypeMesh(rootLayer, meshes[group[0]], prototypeSpec->GetPath().AppendChild(meshes[group[0]].prim.GetName())))
+                {
+                    OMNI_LOG_ERROR("Could not author the prototype %s, its %zu meshes are left as they are", name.GetText(), group.size());
+                    failedGroups++;
+                    continue;
+                }
+                const SdfPath prototypePath = prototypeSpec->GetPath();
+                for (size_t member : group)
+                {
+                    if (!makeInstance(rootLayer, meshes[member], prototypePath))
+                    {
+                        OMNI_LOG_ERROR("Could not turn %s into an instance", meshes[member].prim.GetPath().GetText());
+                    }
+                }
+            }
+        }
+        rootLayer->Save();
+        OMNI_LOG_INFO("Authored %zu prototypes in %.1f ms", groupCount - failedGroups, authorTimer.milliseconds());
+        if (failedGroups > 0)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    const double loadAfterMs = timeStageLoad(stageUrl);
+    const uint64_t fileAfter = getFileSize(stageUrl);
+    OMNI_LOG_INFO(
+        "Instanced %zu of %zu meshes with %zu prototypes (%s)",
+        instancedCount,
+        meshCount,
+        groupCount,
+        usePointInstancer ? "point instancers" : "instanceable references"
+    );
+    OMNI_LOG_INFO("Geometry data: %s -> %s", formatBytes((double)bytesBefore).c_str(), formatBytes((double)bytesAfter).c_str());
+    OMNI_LOG_INFO("Root layer size: %s -> %s", formatBytes((double)fileBefore).c_str(), formatBytes((double)fileAfter).c_str());
+    OMNI_LOG_INFO("Stage load time: %.1f ms -> %.1f ms", loadBeforeMs, loadAfterMs);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,583 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "ChildNameAllocator.h"
+#include "optimizerCommon.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+#include <omni/connect/core/MaterialAlgo.h>
+#include <omni/connect/core/MeshAlgo.h>
+#include <omni/connect/core/PrimAlgo.h>
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/primvarsAPI.h>
+#include <pxr/usd/usdGeom/subset.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xformCache.h>
+#include <pxr/usd/usdShade/material.h>
+#include <pxr/usd/usdShade/materialBindingAPI.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and merges the small meshes of a
+// subtree that share a material into a few large meshes.
+//
+// Every prim costs composition and traversal time and every mesh costs a draw call,
+// so thousands of fasteners or sensor boxes are far slower than the same triangles
+// in one mesh. Each merged mesh keeps a GeomSubset per source mesh so the faces can
+// still be traced back to the prim they came from.
+///////////////////////////////////////////////////////////////////////////////////////
+
+// Transform packed points as row vectors (p * M), the convention of GfMatrix4d.
+// The matrix is read once into floats and every point is independent, so the loop vectorizes.
+static void transformPoints(const GfMatrix4d& matrix, const GfVec3f* in, size_t count, GfVec3f* out)
+{
+    float m[4][3];
+    for (int r = 0; r < 4; r++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            m[r][c] = (float)matrix[r][c];
+        }
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        const float x = in[i][0];
+        const float y = in[i][1];
+        const float z = in[i][2];
+        out[i] = GfVec3f(
+            x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0],
+            x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1],
+            x * m[0][2] + y * m[1][2] + z * m[2][2] + m[3][2]
+        );
+    }
+}
+
+// Normals go through the inverse transpose of the upper 3x3 and are renormalized, so scaled meshes keep unit normals
+static void transformNormals(const GfMatrix4d& matrix, const GfVec3f* in, size_t count, GfVec3f* out)
+{
+    GfMatrix4d normalMatrix = matrix.GetInverse().GetTranspose();
+    float m[3][3];
+    for (int r = 0; r < 3; r++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            m[r][c] = (float)normalMatrix[r][c];
+        }
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        const float x = in[i][0] * m[0][0] + in[i][1] * m[1][0] + in[i][2] * m[2][0];
+        const float y = in[i][0] * m[0][1] + in[i][1] * m[1][1] + in[i][2] * m[2][1];
+        const float z = in[i][0] * m[0][2] + in[i][1] * m[1][2] + in[i][2] * m[2][2];
+        const float length = std::sqrt(x * x + y * y + z * z);
+        const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        out[i] = GfVec3f(x * scale, y * scale, z * scale);
+    }
+}
+
+// Expand a primvar of any interpolation to one value per face corner, resolving its indices
+template<class T>
+static bool flattenToFaceVarying(const UsdGeomPrimvar& primvar, const VtIntArray& faceVertexCounts, const VtIntArray& faceVertexIndices, VtArray<T>& out)
+{
+    VtArray<T> values;
+    if (!primvar || !primvar.Get(&values) || values.empty())
+    {
+        return false;
+    }
+    VtIntArray indices;
+    primvar.GetIndices(&indices);
+    const TfToken interpolation = primvar.GetInterpolation();
+
+    out.resize(faceVertexIndices.size());
+    size_t corner = 0;
+    for (size_t face = 0; face < faceVertexCounts.size(); face++)
+    {
+        for (int k = 0; k < faceVertexCounts[face]; k++, corner++)
+        {
+            size_t element = 0;
+            if (interpolation == UsdGeomTokens->uniform)
+            {
+                element = face;
+            }
+            else if (interpolation == UsdGeomTokens->vertex || interpolation == UsdGeomTokens->varying)
+            {
+                element = (size_t)faceVertexIndices[corner];
+            }
+            else if (interpolation == UsdGeomTokens->faceVarying)
+            {
+                element = corner;
+            }
+            if (!indices.empty())
+            {
+                if (element >= indices.size())
+                {
+                    return false;
+                }
+                element = (size_t)indices[element];
+            }
+            if (element >= values.size())
+            {
+                return false;
+            }
+            out[corner] = values[element];
+        }
+    }
+    return true;
+}
+
+struct MergeSource
+{
+    UsdGeomMesh mesh;
+    GfMatrix4d toMerged;
+    VtVec3fArray points;
+    VtIntArray faceVertexCounts;
+    VtIntArray faceVertexIndices;
+    VtVec3fArray normals;
+    VtVec2fArray st;
+    VtVec3fArray displayColor;
+    bool flipWinding = false;
+    size_t pointOffset = 0;
+    size_t faceOffset = 0;
+    size_t cornerOffset = 0;
+};
+
+// Read a source mesh and its primvars, flattened to face varying so meshes with different interpolations combine
+static bool loadMergeSource(MergeSource& source)
+{
+    source.mesh.GetPointsAttr().Get(&source.points);
+    source.mesh.GetFaceVertexCountsAttr().Get(&source.faceVertexCounts);
+    source.mesh.GetFaceVertexIndicesAttr().Get(&source.faceVertexIndices);
+    size_t cornerCount = 0;
+    for (int count : source.faceVertexCounts)
+    {
+        cornerCount += (size_t)std::max(count, 0);
+    }
+    if (source.points.empty() || cornerCount != source.faceVertexIndices.size())
+    {
+        return false;
+    }
+    for (int index : source.faceVertexIndices)
+    {
+        if (index < 0 || (size_t)index >= source.points.size())
+        {
+            return false;
+        }
+    }
+
+    UsdGeomPrimvarsAPI primvars(source.mesh);
+    if (!flattenToFaceVarying(primvars.GetPrimvar(UsdGeomTokens->normals), source.faceVertexCounts, source.faceVertexIndices, source.normals))
+    {
+        // Normals may also be authored as the mesh's normals attribute
+        VtVec3fArray normals;
+        if (source.mesh.GetNormalsAttr().Get(&normals) && !normals.empty())
+        {
+            source.normals.resize(source.faceVertexIndices.size());
+            const bool perVertex = source.mesh.GetNormalsInterpolation() != UsdGeomTokens->faceVarying;
+            for (size_t corner = 0; corner < source.faceVertexIndices.size(); corner++)
+            {
+                size_t element = perVertex ? (size_t)source.faceVertexIndices[corner] : corner;
+                source.normals[corner] = element < normals.size() ? normals[element] : GfVec3f(0.0f);
+            }
+        }
+    }
+    flattenToFaceVarying(primvars.GetPrimvar(TfToken("st")), source.faceVertexCounts, source.faceVertexIndices, source.st);
+    flattenToFaceVarying(primvars.GetPrimvar(UsdGeomTokens->primvarsDisplayColor), source.faceVertexCounts, source.faceVertexIndices, source.displayColor);
+    return true;
+}
+
+// Copy the sources into the merged arrays at their offsets, baking transforms and flipping winding where a
+// transform mirrors the mesh. Each source writes its own disjoint ranges, so they run in parallel.
+static void writeMergedGeometry(
+    std::vector<MergeSource>& sources,
+    VtVec3fArray& points,
+    VtIntArray& faceVertexCounts,
+    VtIntArray& faceVertexIndices,
+    VtVec3fArray* normals,
+    VtVec2fArray* st,
+    VtVec3fArray* displayColor
+)
+{
+    GfVec3f* pointData = points.data();
+    int* countData = faceVertexCounts.data();
+    int* indexData = faceVertexIndices.data();
+    GfVec3f* normalData = normals ? normals->data() : nullptr;
+    GfVec2f* stData = st ? st->data() : nullptr;
+    GfVec3f* colorData = displayColor ? displayColor->data() : nullptr;
+
+    WorkParallelForN(
+        sources.size(),
+        [&](size_t begin, size_t end)
+        {
+            for (size_t s = begin; s < end; ++s)
+            {
+                MergeSource& source = sources[s];
+                transformPoints(source.toMerged, source.points.cdata(), source.points.size(), pointData + source.pointOffset);
+                if (normalData)
+                {
+                    transformNormals(source.toMerged, source.normals.cdata(), source.normals.size(), normalData + source.cornerOffset);
+                }
+
+                size_t corner = 0;
+                for (size_t face = 0; face < source.faceVertexCounts.size(); face++)
+                {
+                    const int count = source.faceVertexCounts[face];
+                    countData[source.faceOffset + face] = count;
+                    for (int k = 0; k < count; k++)
+                    {
+                        // A mirrored mesh reverses each face's corners to keep its front faces pointing out
+                        const size_t from = corner + (source.flipWinding ? (size_t)(count - 1 - k) : (size_t)k);
+                        const size_t to = source.cornerOffset + corner + k;
+                        indexData[to] = source.faceVertexIndices[from] + (int)source.pointOffset;
+                        if (stData)
+                        {
+                            stData[to] = source.st[from];
+                        }
+                        if (colorData)
+                        {
+                            colorData[to] = source.displayColor[from];
+                        }
+                    }
+                    if (normalData && source.flipWinding)
+                    {
+                        std::reverse(normalData + source.cornerOffset + corner, normalData + source.cornerOffset + corner + count);
+                    }
+                    corner += count;
+                }
+            }
+        }
+    );
+}
+
+// Merge the meshes under --root that share a material, subdivision scheme, orientation and sidedness
+// True when the prim's transform relative to `root`, its own ops or those of any ancestor below `root`, may be animated.
+// Ancestors are looked up once and remembered in `animated`.
+static bool transformMightBeTimeVarying(const UsdPrim& prim, const UsdPrim& root, std::unordered_map<SdfPath, bool, SdfPath::Hash>& animated)
+{
+    if (!prim || prim == root || prim.IsPseudoRoot())
+    {
+        return false;
+    }
+    auto found = animated.find(prim.GetPath());
+    if (found != animated.end())
+    {
+        return found->second;
+    }
+    const UsdGeomXformable xformable(prim);
+    const bool result = (xformable && xformable.TransformMightBeTimeVarying()) || transformMightBeTimeVarying(prim.GetParent(), root, animated);
+    animated.emplace(prim.GetPath(), result);
+    return result;
+}
+
+// Applied schemas other than material binding (physics, skinning) would be lost when the mesh becomes part of another
+static bool hasNonMaterialSchemas(const UsdPrim& prim)
+{
+    for (const TfToken& schema : prim.GetAppliedSchemas())
+    {
+        if (schema != TfToken("MaterialBindingAPI"))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int mergeMeshes(const OptimizerArgs& args)
+{
+    const bool dryRun = args.hasFlag("--dry-run");
+    const std::string rootArg = args.getString("--root", std::string());
+    const size_t maxPoints = (size_t)std::max(1L, args.getInt("--max-points", 1000000));
+    const std::string stageUrl = args.stageUrl();
+
+    // Warm any connection and file caches, then time a clean load for the before/after comparison
+    timeStageLoad(stageUrl);
+    const double loadBeforeMs = timeStageLoad(stageUrl);
+
+    size_t primsBefore = 0;
+    size_t primsAfter = 0;
+    size_t mergedSources = 0;
+    size_t mergedMeshes = 0;
+    {
+        UsdStageRefPtr stage = openStageForCommand(stageUrl);
+        if (!stage)
+        {
+            return EXIT_FAILURE;
+        }
+        UsdPrim root = rootArg.empty() ? stage->GetDefaultPrim() : stage->GetPrimAtPath(SdfPath(rootArg));
+        if (!root)
+        {
+            OMNI_LOG_ERROR("No prim to merge under, pass --root /Path or set the stage's default prim");
+            return EXIT_FAILURE;
+        }
+        for (const UsdPrim& prim : stage->Traverse())
+        {
+            (void)prim;
+            primsBefore++;
+        }
+
+        // Group the eligible meshes. Meshes with children (GeomSubsets), animated points or transforms, physics or skinning
+        // schemas, or that are hidden keep their prims.
+        Stopwatch gatherTimer;
+        UsdGeomXformCache xformCache;
+        const GfMatrix4d rootToWorldInverse = xformCache.GetLocalToWorldTransform(root).GetInverse();
+        std::map<std::string, std::vector<MergeSource>> groups;
+        std::map<std::string, UsdGeomMesh> groupTemplates;
+        std::unordered_map<SdfPath, bool, SdfPath::Hash> animatedTransforms;
+        for (const UsdPrim& prim : UsdPrimRange(root))
+        {
+            UsdGeomMesh mesh(prim);
+            if (!mesh || !prim.GetAllChildren().empty() || mesh.GetPointsAttr().ValueMightBeTimeVarying() ||
+                mesh.ComputeVisibility() == UsdGeomTokens->invisible || hasNonMaterialSchemas(prim) ||
+                transformMightBeTimeVarying(prim, root, animatedTransforms))
+            {
+                continue;
+            }
+            const UsdShadeMaterial material = UsdShadeMaterialBindingAPI(prim).ComputeBoundMaterial();
+            TfToken subdivisionScheme;
+            TfToken orientation;
+            bool doubleSided = false;
+            mesh.GetSubdivisionSchemeAttr().Get(&subdivisionScheme);
+            mesh.GetOrientationAttr().Get(&orientation);
+            mesh.GetDoubleSidedAttr().Get(&doubleSided);
+            const std::string key = (material ? material.GetPath().GetString() : std::string()) + "|" + subdivisionScheme.GetString() + "|" +
+                orientation.GetString() + "|" + (doubleSided ? "1" : "0") + "|" + mesh.ComputePurpose().GetString();
+
+            MergeSource source;
+            source.mesh = mesh;
+            source.toMerged = xformCache.GetLocalToWorldTransform(prim) * rootToWorldInverse;
+            source.flipWinding = source.toMerged.GetDeterminant3() < 0.0;
+            groups[key].push_back(source);
+            groupTemplates.emplace(key, mesh);
+        }
+
+        std::vector<MergeSource*> allSources;
+        for (auto& group : groups)
+        {
+            for (MergeSource& source : group.second)
+            {
+                allSources.push_back(&source);
+            }
+        }
+        WorkParallelForN(
+            allSources.size(),
+            [&allSources](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    // Meshes with broken topology are left alone
+                    if (!loadMergeSource(*allSources[i]))
+                    {
+                        allSources[i]->points.clear();
+                    }
+                }
+            }
+        );
+        for (auto& group : groups)
+        {
+            group.second.erase(
+                std::remove_if(
+                    group.second.begin(),
+                    group.second.end(),
+                    [](const MergeSource& source)
+                    {
+                        return source.points.empty();
+                    }
+                ),
+                group.second.end()
+            );
+        }
+        OMNI_LOG_INFO("Read %zu meshes under %s in %.1f ms", allSources.size(), root.GetPath().GetText(), gatherTimer.milliseconds());
+
+        Stopwatch mergeTimer;
+        UsdPrim mergedRoot;
+        std::optional<ChildNameAllocator> mergedNames;
+        for (auto& group : groups)
+        {
+            std::vector<MergeSource>& sources = group.second;
+            if (sources.size() < 2)
+            {
+                continue;
+            }
+
+            // Split the group into chunks of at most --max-points points
+            size_t chunkBegin = 0;
+            while (chunkBegin < sources.size())
+            {
+                size_t chunkEnd = chunkBegin;
+                size_t pointCount = 0;
+                size_t faceCount = 0;
+                size_t cornerCount = 0;
+                bool hasNormals = true;
+                bool hasSt = true;
+                bool hasColor = true;
+                while (chunkEnd < sources.size() && (chunkEnd == chunkBegin || pointCount + sources[chunkEnd].points.size() <= maxPoints))
+                {
+                    MergeSource& source = sources[chunkEnd];
+                    source.pointOffset = pointCount;
+                    source.faceOffset = faceCount;
+                    source.cornerOffset = cornerCount;
+                    pointCount += source.points.size();
+                    faceCount += source.faceVertexCounts.size();
+                    cornerCount += source.faceVertexIndices.size();
+                    hasNormals = hasNormals && !source.normals.empty();
+                    hasSt = hasSt && !source.st.empty();
+                    hasColor = hasColor && !source.displayColor.empty();
+                    chunkEnd++;
+                }
+                std::vector<MergeSource> chunk(sources.begin() + chunkBegin, sources.begin() + chunkEnd);
+                chunkBegin = chunkEnd;
+                if (chunk.size() < 2)
+                {
+                    continue;
+                }
+                mergedSources += chunk.size();
+                mergedMeshes++;
+                if (dryRun)
+                {
+                    continue;
+                }
+
+                VtVec3fArray points(pointCount);
+                VtIntArray faceVertexCounts(faceCount);
+                VtIntArray faceVertexIndices(cornerCount);
+                VtVec3fArray normals(hasNormals ? cornerCount : 0);
+                VtVec2fArray st(hasSt ? cornerCount : 0);
+                VtVec3fArray displayColor(hasColor ? cornerCount : 0);
+                writeMergedGeometry(
+                    chunk,
+                    points,
+                    faceVertexCounts,
+                    faceVertexIndices,
+                    hasNormals ? &normals : nullptr,
+                    hasSt ? &st : nullptr,
+                    hasColor ? &displayColor : nullptr
+                );
+
+                if (!mergedRoot)
+                {
+                    const TfToken scopeName = omni::connect::core::getValidChildNames(root, { "MergedMeshes" })[0];
+                    mergedRoot = stage->DefinePrim(root.GetPath().AppendChild(scopeName), TfToken("Scope"));
+                    mergedNames.emplace(mergedRoot);
+                }
+                const UsdGeomMesh& first = groupTemplates[group.first];
+                UsdShadeMaterial material = UsdShadeMaterialBindingAPI(first.GetPrim()).ComputeBoundMaterial();
+                std::string name = material ? material.GetPrim().GetName().GetString() : std::string("Unbound");
+
+                // Primvars that not every source had are left out rather than authored empty
+                std::optional<const omni::connect::core::Vec3fPrimvarData> normalsData;
+                std::optional<const omni::connect::core::Vec2fPrimvarData> stData;
+                std::optional<const omni::connect::core::Vec3fPrimvarData> colorData;
+                if (hasNormals)
+                {
+                    normalsData.emplace(UsdGeomTokens->faceVarying, normals);
+                }
+                if (hasSt)
+                {
+                    stData.emplace(UsdGeomTokens->faceVarying, st);
+                }
+                if (hasColor)
+                {
+                    colorData.emplace(UsdGeomTokens->faceVarying, displayColor);
+                }
+                UsdGeomMesh merged = omni::connect::core::definePolyMesh(
+                    mergedRoot,
+                    mergedNames->allocate(name),
+                    faceVertexCounts,
+                    faceVertexIndices,
+                    points,
+                    normalsData,
+                    stData,
+                    colorData
+                );
+                if (!merged)
+                {
+                    OMNI_LOG_ERROR("Failed to define a merged mesh for %s", name.c_str());
+                    continue;
+                }
+                VtValue value;
+                for (const UsdAttribute& attr : { first.GetSubdivisionSchemeAttr(), first.GetOrientationAttr(), first.GetDoubleSidedAttr() })
+                {
+                    if (attr.HasAuthoredValue() && attr.Get(&value))
+                    {
+                        merged.GetPrim().CreateAttribute(attr.GetName(), attr.GetTypeName(), attr.GetVariability()).Set(value);
+                    }
+                }
+                // Render, proxy and guide meshes are merged separately, the merged mesh keeps the purpose it inherited
+                const TfToken purpose = first.ComputePurpose();
+                if (purpose != UsdGeomTokens->default_)
+                {
+                    merged.CreatePurposeAttr().Set(purpose);
+                }
+                if (material)
+                {
+                    omni::connect::core::bindMaterial(merged.GetPrim(), material);
+                }
+
+                // One subset per source mesh, named after it, so picking a face can still report the original prim
+                std::vector<std::string> subsetNames;
+                for (const MergeSource& source : chunk)
+                {
+                    subsetNames.push_back(source.mesh.GetPrim().GetName().GetString());
+                }
+                TfTokenVector validNames = omni::connect::core::getValidChildNames(merged.GetPrim(), subsetNames);
+                static const TfToken familyName("mergedSource");
+                for (size_t s = 0; s < chunk.size(); s++)
+                {
+                    VtIntArray faces(chunk[s].faceVertexCounts.size());
+                    for (size_t f = 0; f < faces.size(); f++)
+                    {
+                        faces[f] = (int)(chunk[s].faceOffset + f);
+                    }
+                    UsdGeomSubset subset = UsdGeomSubset::CreateGeomSubset(merged, validNames[s], UsdGeomTokens->face, faces, familyName);
+                    subset.GetPrim().SetCustomDataByKey(TfToken("sourcePrim"), VtValue(chunk[s].mesh.GetPath().GetString()));
+                }
+                UsdGeomSubset::SetFamilyType(merged, familyName, UsdGeomTokens->partition);
+
+                // Deactivate rather than delete, the sources may come from other layers and can be restored
+                for (const MergeSource& source : chunk)
+                {
+                    source.mesh.GetPrim().SetActive(false);
+                }
+            }
+        }
+
+        if (!dryRun && mergedMeshes > 0)
+        {
+            stage->GetRootLayer()->Save();
+        }
+        for (const UsdPrim& prim : stage->Traverse())
+        {
+            (void)prim;
+            primsAfter++;
+        }
+        OMNI_LOG_INFO(
+            "Merged %zu meshes into %zu meshes in %.1f ms%s",
+            mergedSources,
+            mergedMeshes,
+            mergeTimer.milliseconds(),
+            dryRun ? " (dry run, nothing authored)" : ""
+        );
+    }
+
+    OMNI_LOG_INFO("Active prims: %zu -> %zu", primsBefore, primsAfter);
+    if (!dryRun && mergedMeshes > 0)
+    {
+        OMNI_LOG_INFO("Stage load time: %.1f ms -> %.1f ms", loadBeforeMs, timeStageLoad(stageUrl));
+    }
+    return EXIT_SUCCESS;
+}
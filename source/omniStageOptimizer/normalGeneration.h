@@ -0,0 +1,451 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "optimizerCommon.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/primvarsAPI.h>
+#include <pxr/usd/usdGeom/tokens.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and authors normals on the
+// meshes that have none, so renderers do not recompute them on every load.
+//
+// Smooth normals are the area weighted average of the normals of the faces around
+// each point (vertex interpolation), faceted normals are one per face (uniform
+// interpolation). Meshes are processed in parallel and the faces and points of each
+// mesh are split across threads as well, so one huge mesh uses every core too.
+///////////////////////////////////////////////////////////////////////////////////////
+
+// Cross products of edge pairs stored as one array per component.
+// Each iteration is independent and touches only contiguous floats, so the loop compiles to SIMD instructions.
+static void crossProducts(const float* const edges[6], float* const out[3], size_t count)
+{
+    const float* ax = edges[0];
+    const float* ay = edges[1];
+    const float* az = edges[2];
+    const float* bx = edges[3];
+    const float* by = edges[4];
+    const float* bz = edges[5];
+    float* cx = out[0];
+    float* cy = out[1];
+    float* cz = out[2];
+    for (size_t i = 0; i < count; i++)
+    {
+        cx[i] = ay[i] * bz[i] - az[i] * by[i];
+        cy[i] = az[i] * bx[i] - ax[i] * bz[i];
+        cz[i] = ax[i] * by[i] - ay[i] * bx[i];
+    }
+}
+
+// The area weighted normal (twice the area long) of every face in [begin, end), summed over its fan triangles.
+// Edges are gathered into blocks so the cross products run over packed arrays.
+static void computeFaceNormals(
+    const GfVec3f* points,
+    const int* faceVertexCounts,
+    const int* faceVertexIndices,
+    const size_t* faceOffsets,
+    size_t begin,
+    size_t end,
+    GfVec3f* faceNormals
+)
+{
+    constexpr size_t kBlockSize = 256;
+    float edgeData[6][kBlockSize];
+    float crossData[3][kBlockSize];
+    int owners[kBlockSize];
+    const float* const edges[6] = { edgeData[0], edgeData[1], edgeData[2], edgeData[3], edgeData[4], edgeData[5] };
+    float* const crosses[3] = { crossData[0], crossData[1], crossData[2] };
+    size_t pending = 0;
+
+    auto flush = [&]()
+    {
+        crossProducts(edges, crosses, pending);
+        for (size_t j = 0; j < pending; j++)
+        {
+            GfVec3f& normal = faceNormals[owners[j]];
+            normal[0] += crossData[0][j];
+            normal[1] += crossData[1][j];
+            normal[2] += crossData[2][j];
+        }
+        pending = 0;
+    };
+
+    for (size_t f = begin; f < end; f++)
+    {
+        faceNormals[f] = GfVec3f(0.0f);
+        const int* corners = faceVertexIndices + faceOffsets[f];
+        const GfVec3f& a = points[corners[0]];
+        for (int k = 1; k + 1 < faceVertexCounts[f]; k++)
+        {
+            const GfVec3f& b = points[corners[k]];
+            const GfVec3f& c = points[corners[k + 1]];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                edgeData[axis][pending] = b[axis] - a[axis];
+                edgeData[axis + 3][pending] = c[axis] - a[axis];
+            }
+            owners[pending] = (int)f;
+            if (++pending == kBlockSize)
+            {
+                flush();
+            }
+        }
+    }
+    flush();
+}
+
+// One mesh without normals and the normals computed for it
+struct NormalWork
+{
+    UsdGeomMesh mesh;
+    // Where the normals are authored: the root layer for stage prims, the layer that defines the mesh for prims in
+    // instance prototypes, which can't be overridden from the root layer
+    SdfLayerHandle layer;
+    SdfPath specPath;
+    std::string skipReason;
+    size_t triangleCount = 0;
+    VtVec3fArray normals;
+};
+
+static void generateMeshNormals(NormalWork& work, bool faceted)
+{
+    UsdGeomMesh& mesh = work.mesh;
+    VtVec3fArray points;
+    VtIntArray faceVertexCounts;
+    VtIntArray faceVertexIndices;
+    TfToken orientation;
+    mesh.GetPointsAttr().Get(&points);
+    mesh.GetFaceVertexCountsAttr().Get(&faceVertexCounts);
+    mesh.GetFaceVertexIndicesAttr().Get(&faceVertexIndices);
+    mesh.GetOrientationAttr().Get(&orientation);
+
+    const size_t faceCount = faceVertexCounts.size();
+    std::vector<size_t> faceOffsets(faceCount + 1, 0);
+    bool valid = true;
+    for (size_t f = 0; f < faceCount; f++)
+    {
+        valid = valid && faceVertexCounts[f] >= 3;
+        faceOffsets[f + 1] = faceOffsets[f] + (size_t)std::max(faceVertexCounts[f], 0);
+        work.triangleCount += faceVertexCounts[f] > 2 ? (size_t)(faceVertexCounts[f] - 2) : 0;
+    }
+    valid = valid && faceOffsets[faceCount] == faceVertexIndices.size();
+    for (size_t i = 0; valid && i < faceVertexIndices.size(); i++)
+    {
+        valid = faceVertexIndices[i] >= 0 && (size_t)faceVertexIndices[i] < points.size();
+    }
+    if (!valid || faceCount == 0)
+    {
+        work.skipReason = "has invalid or empty topology";
+        work.triangleCount = 0;
+        return;
+    }
+
+    // Split within the mesh too, in face and point ranges large enough to be worth a task
+    constexpr size_t kGrainSize = 16384;
+    const float sign = orientation == UsdGeomTokens->leftHanded ? -1.0f : 1.0f;
+    std::vector<GfVec3f> faceNormals(faceCount);
+    WorkParallelForN(
+        faceCount,
+        [&](size_t begin, size_t end)
+        { computeFaceNormals(points.cdata(), faceVertexCounts.cdata(), faceVertexIndices.cdata(), faceOffsets.data(), begin, end, faceNormals.data()); },
+        kGrainSize
+    );
+
+    auto normalized = [sign](const GfVec3f& normal)
+    {
+        const float length = normal.GetLength();
+        return length > 0.0f ? normal * (sign / length) : GfVec3f(0.0f);
+    };
+
+    if (faceted)
+    {
+        work.normals.resize(faceCount);
+        GfVec3f* out = work.normals.data();
+        WorkParallelForN(
+            faceCount,
+            [&](size_t begin, size_t end)
+            {
+                for (size_t f = begin; f < end; f++)
+                {
+                    out[f] = normalized(faceNormals[f]);
+                }
+            },
+            kGrainSize
+        );
+        return;
+    }
+
+    // Smooth: list the faces around every point (a counting sort of the corners), then sum them per point in parallel.
+    // Gathering per point instead of scattering per face needs no atomics and gives the same result on every run.
+    const size_t pointCount = points.size();
+    std::vector<size_t> pointStart(pointCount + 1, 0);
+    for (int index : faceVertexIndices)
+    {
+        pointStart[index + 1]++;
+    }
+    for (size_t p = 0; p < pointCount; p++)
+    {
+        pointStart[p + 1] += pointStart[p];
+    }
+    std::vector<int> pointFaces(faceVertexIndices.size());
+    {
+        std::vector<size_t> fill(pointStart.begin(), pointStart.end() - 1);
+        for (size_t f = 0; f < faceCount; f++)
+        {
+            for (size_t c = faceOffsets[f]; c < faceOffsets[f + 1]; c++)
+            {
+                pointFaces[fill[faceVertexIndices[c]]++] = (int)f;
+            }
+        }
+    }
+    work.normals.resize(pointCount);
+    GfVec3f* out = work.normals.data();
+    WorkParallelForN(
+        pointCount,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t p = begin; p < end; p++)
+            {
+                GfVec3f sum(0.0f);
+                for (size_t j = pointStart[p]; j < pointStart[p + 1]; j++)
+                {
+                    sum += faceNormals[pointFaces[j]];
+                }
+                out[p] = normalized(sum);
+            }
+        },
+        kGrainSize
+    );
+}
+
+// Author area weighted smooth or faceted normals on every mesh without normals
+static int generateNormals(const OptimizerArgs& args)
+{
+    const bool dryRun = args.hasFlag("--dry-run");
+    const bool verbose = args.hasFlag("-v") || args.hasFlag("--verbose");
+    const std::string mode = args.getString("--mode", "smooth");
+    const size_t batchTriangles = (size_t)std::max(1L, args.getInt("--batch-triangles", 8000000));
+    if (mode != "smooth" && mode != "faceted")
+    {
+        OMNI_LOG_ERROR("Unknown normals mode: %s (expected smooth or faceted)", mode.c_str());
+        return EXIT_FAILURE;
+    }
+    const bool faceted = mode == "faceted";
+    const TfToken interpolation = faceted ? UsdGeomTokens->uniform : UsdGeomTokens->vertex;
+
+    UsdStageRefPtr stage = openStageForCommand(args.stageUrl());
+    if (!stage)
+    {
+        return EXIT_FAILURE;
+    }
+    SdfLayerHandle rootLayer = stage->GetRootLayer();
+
+    Stopwatch traverseTimer;
+    std::vector<NormalWork> work;
+    size_t meshCount = 0;
+    std::map<std::string, size_t> skipped;
+    // Traverse() does not descend into instances, the meshes they share are walked in the stage's prototypes
+    std::vector<UsdPrim> meshPrims;
+    for (const UsdPrim& prim : stage->Traverse())
+    {
+        meshPrims.push_back(prim);
+    }
+    for (const UsdPrim& prototype : stage->GetPrototypes())
+    {
+        for (const UsdPrim& prim : UsdPrimRange(prototype))
+        {
+            meshPrims.push_back(prim);
+        }
+    }
+    for (const UsdPrim& prim : meshPrims)
+    {
+        UsdGeomMesh mesh(prim);
+        if (!mesh)
+        {
+            continue;
+        }
+        meshCount++;
+        // Renderers ignore the normals of subdivision surfaces, and authored normals (attribute or primvar) are kept
+        TfToken scheme;
+        mesh.GetSubdivisionSchemeAttr().Get(&scheme);
+        if (mesh.GetNormalsAttr().HasAuthoredValue() || UsdGeomPrimvarsAPI(prim).HasPrimvar(UsdGeomTokens->normals))
+        {
+            skipped["already have normals"]++;
+        }
+        else if (scheme != UsdGeomTokens->none)
+        {
+            skipped["are subdivision surfaces"]++;
+        }
+        else if (mesh.GetPointsAttr().ValueMightBeTimeVarying() || mesh.GetFaceVertexIndicesAttr().ValueMightBeTimeVarying())
+        {
+            skipped["are animated"]++;
+        }
+        else if (!prim.IsInPrototype())
+        {
+            work.emplace_back();
+            work.back().mesh = mesh;
+            work.back().layer = rootLayer;
+            work.back().specPath = prim.GetPath();
+        }
+        else
+        {
+            const SdfPrimSpecHandleVector stack = prim.GetPrimStack();
+            if (stack.empty())
+            {
+                skipped["have no spec to author prototype normals in"]++;
+                continue;
+            }
+            work.emplace_back();
+            work.back().mesh = mesh;
+            work.back().layer = stack.front()->GetLayer();
+            work.back().specPath = stack.front()->GetPath();
+        }
+    }
+    const double traverseMs = traverseTimer.milliseconds();
+
+    // Work through the meshes in batches of about `batchTriangles`: compute the batch in parallel, then author it in one
+    // change block. Batching bounds the memory of the points, topology and scratch buffers being worked on. The
+    // authored normals stay in their layers until they are saved.
+    double computeMs = 0.0;
+    double authorMs = 0.0;
+    size_t triangleCount = 0;
+    size_t authoredCount = 0;
+    size_t authoredBytes = 0;
+    size_t failedCount = 0;
+    std::vector<SdfLayerHandle> authoredLayers;
+    for (size_t batchStart = 0; batchStart < work.size();)
+    {
+        size_t batchEnd = batchStart;
+        size_t budget = 0;
+        while (batchEnd < work.size() && (batchEnd == batchStart || budget < batchTriangles))
+        {
+            // Face counts are a cheap stand-in for the triangle count before the topology is read
+            VtIntArray faceVertexCounts;
+            work[batchEnd].mesh.GetFaceVertexCountsAttr().Get(&faceVertexCounts);
+            budget += faceVertexCounts.size();
+            batchEnd++;
+        }
+
+        Stopwatch computeTimer;
+        WorkParallelForN(
+            batchEnd - batchStart,
+            [&work, batchStart, faceted](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    generateMeshNormals(work[batchStart + i], faceted);
+                }
+            },
+            1
+        );
+        computeMs += computeTimer.milliseconds();
+
+        Stopwatch authorTimer;
+        {
+            SdfChangeBlock changeBlock;
+            for (size_t i = batchStart; i < batchEnd; i++)
+            {
+                NormalWork& entry = work[i];
+                if (!entry.skipReason.empty())
+                {
+                    skipped[entry.skipReason]++;
+                    continue;
+                }
+                const size_t normalCount = entry.normals.size();
+                if (!dryRun)
+                {
+                    // A normals spec without a value (a declaration only) makes SdfAttributeSpec::New fail
+                    SdfPrimSpecHandle spec = SdfCreatePrimInLayer(entry.layer, entry.specPath);
+                    SdfAttributeSpecHandle normals =
+                        spec ? SdfAttributeSpec::New(spec, UsdGeomTokens->normals, SdfValueTypeNames->Normal3fArray) : SdfAttributeSpecHandle();
+                    if (!normals)
+                    {
+                        entry.normals = VtVec3fArray();
+                        OMNI_LOG_ERROR("Could not author normals for %s in %s", entry.mesh.GetPath().GetText(), entry.layer->GetIdentifier().c_str());
+                        failedCount++;
+                        continue;
+                    }
+                    normals->SetDefaultValue(VtValue::Take(entry.normals));
+                    normals->SetInfo(UsdGeomTokens->interpolation, VtValue(interpolation));
+                    if (std::find(authoredLayers.begin(), authoredLayers.end(), entry.layer) == authoredLayers.end())
+                    {
+                        authoredLayers.push_back(entry.layer);
+                    }
+                }
+                triangleCount += entry.triangleCount;
+                authoredCount++;
+                authoredBytes += normalCount * sizeof(GfVec3f);
+                if (verbose)
+                {
+                    OMNI_LOG_INFO("  %s: %zu %s normals", entry.mesh.GetPath().GetText(), normalCount, interpolation.GetText());
+                }
+                entry.normals = VtVec3fArray();
+            }
+        }
+        authorMs += authorTimer.milliseconds();
+        batchStart = batchEnd;
+    }
+
+    Stopwatch saveTimer;
+    for (const SdfLayerHandle& layer : authoredLayers)
+    {
+        if (!layer->Save())
+        {
+            OMNI_LOG_ERROR("Failed to save %s", layer->GetIdentifier().c_str());
+            failedCount++;
+        }
+    }
+    const double saveMs = saveTimer.milliseconds();
+
+    OMNI_LOG_INFO(
+        "Generated %s normals for %zu of %zu meshes (%zu triangles, %s)%s",
+        mode.c_str(),
+        authoredCount,
+        meshCount,
+        triangleCount,
+        formatBytes((double)authoredBytes).c_str(),
+        dryRun ? " (dry run, nothing authored)" : ""
+    );
+    for (const auto& entry : skipped)
+    {
+        OMNI_LOG_INFO("  %zu meshes skipped: %s", entry.second, entry.first.c_str());
+    }
+    OMNI_LOG_INFO(
+        "Traverse %.1f ms, compute %.1f ms (%.1f million triangles/sec on %u threads), author %.1f ms, save %.1f ms",
+        traverseMs,
+        computeMs,
+        computeMs > 0.0 ? (double)triangleCount / (computeMs * 1000.0) : 0.0,
+        WorkGetConcurrencyLimit(),
+        authorMs,
+        saveMs
+    );
+    if (failedCount > 0)
+    {
+        OMNI_LOG_ERROR("%zu meshes or layers failed", failedCount);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,220 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+/*###############################################################################
+#
+# This "omniStageOptimizer" sample demonstrates how to:
+#  * connect to an Omniverse server
+#  * open an existing stage and inspect every layer it composes
+#  * rewrite stage data offline to make it faster to load and render
+#  * use the USD work library to run independent passes in parallel
+#  * report how long each pass took and what it changed
+#
+#  * commands:
+#  *  usdc - convert usda layers with large arrays to usdc and retarget the arcs
+#  *         that point at them
+#  *  extents - compute the extents of all boundable prims in parallel and
+#  *            author the missing or stale ones
+#  *  instance - share one prototype between meshes that are copies of each
+#  *             other
+#  *  merge - merge the meshes of a subtree that share a material into a few
+#  *          large meshes
+#  *  index-primvars - author flat normals, st and displayColor primvars as
+#  *                   indexed primvars where that is smaller
+#  *  lod - decimate every mesh into LOD0/LOD1/LOD2 variants on its parent Xform
+#  *  normals - author smooth or faceted normals on the meshes that have none
+#  *  hulls - precompute the convex collision hulls of dynamic rigid bodies into
+#  *          a collider layer
+#  *  physics - apply the rigid body and collision schemas to many prims in one
+#  *            change block
+#  *  bake-skinning - bake skinned meshes into time sampled point caches in a
+#  *                  bake layer
+#
+###############################################################################*/
+
+#include "colliderHulls.h"
+#include "extentRepair.h"
+#include "lodGeneration.h"
+#include "meshInstancing.h"
+#include "meshMerging.h"
+#include "normalGeneration.h"
+#include "optimizerCommon.h"
+#include "physicsApplication.h"
+#include "primvarIndexing.h"
+#include "skinBaking.h"
+#include "usdcConversion.h"
+
+#include <omni/connect/core/Core.h>
+#include <omni/connect/core/Log.h>
+
+#include <omni/core/OmniInit.h>
+#include <omni/log/ILog.h>
+
+#include <OmniClient.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+// Initialize the Omniverse application
+OMNI_APP_GLOBALS("StageOptimizer", "Omniverse Stage Optimizer");
+
+struct Command
+{
+    const char* name;
+    const char* args;
+    const char* helpMessage;
+    int (*function)(const OptimizerArgs& args);
+};
+
+// clang-format off
+static Command gCommands[] = {
+    { "usdc", "<stage_url> [--threshold N] [--dry-run]",
+        "Convert usda layers holding arrays longer than N elements (default 1000) to usdc, retarget the\n"
+        "        sublayer, reference and payload paths to the new files and report the parse time speedup",
+        convertAsciiLayers },
+    { "extents", "<stage_url> [--dry-run] [-v]",
+        "Compute the extent of every boundable prim in parallel, author the missing or stale ones to the root\n"
+        "        layer and report the compute time per million points",
+        repairExtents },
+    { "instance", "<stage_url> [--mode references|pointinstancer] [--min-count N] [--dry-run]",
+        "Find meshes that differ only by transform or point offset, replace groups of at least N (default 2) with\n"
+        "        instanceable references to a shared prototype or a point instancer, and report the memory, file size\n"
+        "        and load time savings",
+        instanceDuplicateMeshes },
+    { "merge", "<stage_url> [--root /Path] [--max-points N] [--dry-run]",
+        "Merge the meshes under the root prim (default: the default prim) that share a material into meshes of at\n"
+        "        most N points (default 1000000), baking their transforms, and report the prim count and load time change",
+        mergeMeshes },
+    { "index-primvars", "<stage_url> [--dry-run] [-v]",
+        "Deduplicate the values of the normals, st and displayColor primvars of every mesh in parallel, author\n"
+        "        them as indexed primvars where that saves space and report the bytes saved",
+        indexMeshPrimvars },
+    { "lod", "<stage_url> [--lod1 R] [--lod2 R] [--select 0|1|2] [--dry-run] [-v]",
+        "Decimate every mesh in parallel to R of its triangles (defaults 0.5 and 0.25), author LOD0/LOD1/LOD2\n"
+        "        variants on the parent Xforms and report the triangles per level and the decimation throughput",
+        generateLods },
+    { "normals", "<stage_url> [--mode smooth|faceted] [--batch-triangles N] [--dry-run] [-v]",
+        "Compute area weighted smooth (vertex) or faceted (uniform) normals in parallel for every mesh without\n"
+        "        normals, N triangles (default 8000000) at a time, and report the triangles/sec throughput",
+        generateNormals },
+    { "physics", "<stage_url> (--pattern \"/World/*/Collider*\" | --list paths.txt) [--dynamic] [--approximation token] [--bench] [--dry-run] [-v]",
+        "Apply PhysicsRigidBodyAPI (with --dynamic), PhysicsCollisionAPI and PhysicsMeshCollisionAPI to the matching\n"
+        "        prims in one Sdf change block, --bench also times the per-prim Usd API path for comparison",
+        applyPhysics },
+    { "hulls", "<stage_url> [--max-vertices N] [--max-hulls N] [--layer path] [--dry-run] [-v]",
+        "Compute the convex hull (convexHull) or an approximate convex decomposition (convexDecomposition) of every\n"
+        "        dynamic collider mesh in parallel, author them as collision meshes in a collider sublayer and report hulls/sec",
+        generateColliderHulls },
+    { "bake-skinning", "<stage_url> [--start T] [--end T] [--stride T] [--layer path] [--dry-run] [-v]",
+        "Skin every mesh bound to a skeleton with UsdSkelSkinningQuery for each frame of the range (default: the\n"
+        "        stage's), in parallel over frames and meshes, write the points to a bake layer and report frames/sec",
+        bakeSkinning },
+};
+// clang-format on
+
+// Startup Omniverse
+static bool startOmniverse(bool verbose)
+{
+    // Check that the core Omniverse frameworks started successfully
+    OMNICONNECTCORE_INIT();
+    if (!omni::connect::core::initialized())
+    {
+        return false;
+    }
+
+    // Set the retry behavior to limit retries so that invalid server addresses fail quickly
+    omniClientSetRetries({ 1000, 500, 0 });
+
+    auto log = omniGetLogWithoutAcquire();
+    log->setLevel(verbose ? omni::log::Level::eVerbose : omni::log::Level::eInfo);
+
+    return true;
+}
+
+// Print the command line arguments help
+static void printCmdLineArgHelp()
+{
+    std::string help =
+        "\nUsage: omniStageOptimizer <command> <stage_url> [options]\n"
+        "  options:\n"
+        "    -h, --help     Print this help\n"
+        "    -v, --verbose  Show the verbose Omniverse logging\n"
+        "  commands:\n";
+    for (const Command& command : gCommands)
+    {
+        help += std::string("    ") + command.name + " " + command.args + "\n        " + command.helpMessage + "\n";
+    }
+    help +=
+        "\n\nExamples:\n"
+        " * convert the heavy usda layers of a stage on the localhost server\n"
+        "    > omniStageOptimizer usdc omniverse://localhost/Users/test/helloworld.usda\n";
+    OMNI_LOG_INFO("%s", help.c_str());
+}
+
+// Main Application
+int main(int argc, char* argv[])
+{
+    bool verbose = false;
+    for (int x = 1; x < argc; x++)
+    {
+        if (strcmp(argv[x], "-h") == 0 || strcmp(argv[x], "--help") == 0)
+        {
+            startOmniverse(false);
+            printCmdLineArgHelp();
+            return EXIT_SUCCESS;
+        }
+        if (strcmp(argv[x], "-v") == 0 || strcmp(argv[x], "--verbose") == 0)
+        {
+            verbose = true;
+        }
+    }
+
+    if (!startOmniverse(verbose))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (argc < 3)
+    {
+        OMNI_LOG_ERROR("ERROR: A command and a stage URL are required.");
+        printCmdLineArgHelp();
+        return EXIT_FAILURE;
+    }
+
+    const Command* command = nullptr;
+    for (const Command& candidate : gCommands)
+    {
+        if (strcmp(argv[1], candidate.name) == 0)
+        {
+            command = &candidate;
+        }
+    }
+    if (!command)
+    {
+        OMNI_LOG_ERROR("ERROR: Unknown command: %s", argv[1]);
+        printCmdLineArgHelp();
+        return EXIT_FAILURE;
+    }
+
+    const OptimizerArgs args(argc, argv, 2);
+    const std::vector<std::string> unknownOptions = args.unknownOptions(command->args);
+    if (!unknownOptions.empty())
+    {
+        for (const std::string& option : unknownOptions)
+        {
+            OMNI_LOG_ERROR("ERROR: Unknown option for %s: %s", command->name, option.c_str());
+        }
+        OMNI_LOG_INFO("Usage: omniStageOptimizer %s %s", command->name, command->args);
+        return EXIT_FAILURE;
+    }
+
+    int result = command->function(args);
+
+    // Calling this prior to shutdown ensures that all pending updates complete.
+    omniClientLiveWaitForPendingUpdates();
+
+    return result;
+}
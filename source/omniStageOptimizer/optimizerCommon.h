@@ -0,0 +1,234 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "FileSize.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+
+#include <OmniClient.h>
+
+#include <pxr/base/gf/vec2f.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/base/vt/value.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and holds the argument parsing
+// and reporting helpers that every optimizer command shares.
+///////////////////////////////////////////////////////////////////////////////////////
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+// The arguments that follow the command name: one stage URL and any number of "--option [value]" pairs
+class OptimizerArgs
+{
+public:
+
+    OptimizerArgs(int argc, char* argv[], int first)
+    {
+        for (int x = first; x < argc; x++)
+        {
+            mArgs.emplace_back(argv[x]);
+        }
+    }
+
+    // The first argument that is not an option (or an option value)
+    std::string stageUrl() const
+    {
+        for (size_t i = 0; i < mArgs.size(); i++)
+        {
+            // Short flags like -v are options too, a stage URL never starts with a dash
+            if (mArgs[i].compare(0, 1, "-") == 0 && mArgs[i].size() > 1)
+            {
+                // Skip the option's value if it has one
+                if (i + 1 < mArgs.size() && mArgs[i + 1].compare(0, 2, "--") != 0 && !isFlag(mArgs[i]))
+                {
+                    i++;
+                }
+                continue;
+            }
+            return mArgs[i];
+        }
+        return std::string();
+    }
+
+    bool hasFlag(const char* name) const
+    {
+        for (const auto& arg : mArgs)
+        {
+            if (arg == name)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string getString(const char* name, const std::string& defaultValue) const
+    {
+        for (size_t i = 0; i + 1 < mArgs.size(); i++)
+        {
+            if (mArgs[i] == name)
+            {
+                return mArgs[i + 1];
+            }
+        }
+        return defaultValue;
+    }
+
+    double getDouble(const char* name, double defaultValue) const
+    {
+        std::string value = getString(name, std::string());
+        return value.empty() ? defaultValue : std::strtod(value.c_str(), nullptr);
+    }
+
+    long getInt(const char* name, long defaultValue) const
+    {
+        std::string value = getString(name, std::string());
+        return value.empty() ? defaultValue : std::strtol(value.c_str(), nullptr, 10);
+    }
+
+    // The options that are not named in `usage` (a command's usage line, like "<stage_url> [--mode a|b] [-v]"), nor
+    // -v/--verbose. Option values are skipped the way stageUrl() skips them.
+    std::vector<std::string> unknownOptions(const char* usage) const
+    {
+        std::vector<std::string> known = { "-v", "--verbose" };
+        std::string word;
+        for (const char* c = usage;; c++)
+        {
+            if (*c == '\0' || std::strchr(" []()|\"", *c))
+            {
+                if (word.size() > 1 && word[0] == '-')
+                {
+                    known.push_back(word);
+                }
+                word.clear();
+                if (*c == '\0')
+                {
+                    break;
+                }
+                continue;
+            }
+            word += *c;
+        }
+
+        std::vector<std::string> unknown;
+        for (size_t i = 0; i < mArgs.size(); i++)
+        {
+            if (mArgs[i].compare(0, 1, "-") != 0 || mArgs[i].size() < 2)
+            {
+                continue;
+            }
+            if (std::find(known.begin(), known.end(), mArgs[i]) == known.end())
+            {
+                unknown.push_back(mArgs[i]);
+            }
+            if (i + 1 < mArgs.size() && mArgs[i + 1].compare(0, 2, "--") != 0 && !isFlag(mArgs[i]))
+            {
+                i++;
+            }
+        }
+        return unknown;
+    }
+
+    // Options without values must be registered so stageUrl() does not mistake the stage for their value
+    void addFlagNames(std::initializer_list<const char*> names)
+    {
+        mFlagNames.insert(mFlagNames.end(), names.begin(), names.end());
+    }
+
+private:
+
+    bool isFlag(const std::string& arg) const
+    {
+        for (const char* name : mFlagNames)
+        {
+            if (arg == name)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::string> mArgs;
+    std::vector<const char*> mFlagNames = { "--dry-run", "--bench", "--dynamic", "-v", "--verbose" };
+};
+
+// Open a stage for an optimizer command, logging why it failed if it could not be opened
+static UsdStageRefPtr openStageForCommand(const std::string& stageUrl, UsdStage::InitialLoadSet loadSet = UsdStage::LoadAll)
+{
+    if (stageUrl.empty())
+    {
+        OMNI_LOG_ERROR("No stage URL provided");
+        return UsdStageRefPtr();
+    }
+    UsdStageRefPtr stage = UsdStage::Open(stageUrl, loadSet);
+    if (!stage)
+    {
+        OMNI_LOG_ERROR("Failure to open stage: %s", stageUrl.c_str());
+    }
+    return stage;
+}
+
+// Bytes held by the elements of an array value, for the geometry types the optimizer passes rewrite
+static size_t arrayBytes(const VtValue& value)
+{
+    if (!value.IsArrayValued())
+    {
+        return 0;
+    }
+    size_t elementSize = 4;
+    if (value.IsHolding<VtVec3fArray>())
+    {
+        elementSize = sizeof(GfVec3f);
+    }
+    else if (value.IsHolding<VtVec2fArray>())
+    {
+        elementSize = sizeof(GfVec2f);
+    }
+    else if (value.IsHolding<VtVec3dArray>())
+    {
+        elementSize = sizeof(GfVec3d);
+    }
+    else if (value.IsHolding<VtDoubleArray>())
+    {
+        elementSize = sizeof(double);
+    }
+    return value.GetArraySize() * elementSize;
+}
+
+// Milliseconds to open a stage and walk all of its prims.
+// Layers that are still referenced elsewhere in the process are reused rather than parsed, so callers release their
+// own stage before timing a reload.
+static double timeStageLoad(const std::string& stageUrl, UsdStage::InitialLoadSet loadSet = UsdStage::LoadAll)
+{
+    Stopwatch timer;
+    UsdStageRefPtr stage = UsdStage::Open(stageUrl, loadSet);
+    if (!stage)
+    {
+        return 0.0;
+    }
+    // Walking the prims forces every prim index to compose
+    for (const UsdPrim& prim : stage->Traverse())
+    {
+        (void)prim;
+    }
+    return timer.milliseconds();
+}
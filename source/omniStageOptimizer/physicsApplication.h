@@ -0,0 +1,296 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "PathPattern.h"
+#include "optimizerCommon.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/listOp.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/usd/editContext.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/tokens.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdPhysics/collisionAPI.h>
+#include <pxr/usd/usdPhysics/meshCollisionAPI.h>
+#include <pxr/usd/usdPhysics/rigidBodyAPI.h>
+#include <pxr/usd/usdPhysics/tokens.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and applies the physics schemas
+// to many prims at once.
+//
+// helloWorld's enablePhysics applies RigidBodyAPI, CollisionAPI and MeshCollisionAPI
+// through the Usd API, and every Apply and Set sends its own change notice that the
+// stage recomposes the prim for. Here the apiSchemas list ops and approximation
+// attributes of all prims are edited as layer data in one change block, so the stage
+// recomposes once.
+///////////////////////////////////////////////////////////////////////////////////////
+
+// The prims to apply physics to: the paths listed in a file (one per line) or the prims matching a pattern.
+// Only the subtree above the pattern's first wildcard is traversed.
+static std::vector<UsdPrim> findPhysicsTargets(const UsdStageRefPtr& stage, const std::string& pattern, const std::string& listPath)
+{
+    std::vector<UsdPrim> targets;
+    if (!listPath.empty())
+    {
+        std::ifstream list(listPath);
+        if (!list)
+        {
+            OMNI_LOG_ERROR("Could not read the prim list %s", listPath.c_str());
+            return targets;
+        }
+        std::string line;
+        while (std::getline(list, line))
+        {
+            line = TfStringTrim(line);
+            if (line.empty() || line[0] == '#')
+            {
+                continue;
+            }
+            UsdPrim prim = SdfPath::IsValidPathString(line) ? stage->GetPrimAtPath(SdfPath(line)) : UsdPrim();
+            if (!prim || prim.IsPseudoRoot())
+            {
+                OMNI_LOG_WARN("No prim at %s, skipping it", line.c_str());
+                continue;
+            }
+            targets.push_back(prim);
+        }
+        return targets;
+    }
+
+    const std::string prefix = pattern.substr(0, pattern.find_first_of("*?"));
+    const std::string rootPath = prefix.size() > 1 ? prefix.substr(0, std::max<size_t>(prefix.find_last_of('/'), 1)) : "/";
+    UsdPrim root = SdfPath::IsValidPathString(rootPath) ? stage->GetPrimAtPath(SdfPath(rootPath)) : UsdPrim();
+    if (!root)
+    {
+        return targets;
+    }
+    for (const UsdPrim& prim : UsdPrimRange(root))
+    {
+        // A bare `*` also matches the pseudo-root "/", which can't have schemas
+        if (!prim.IsPseudoRoot() && matchesPathPattern(prim.GetPath().GetText(), pattern.c_str()))
+        {
+            targets.push_back(prim);
+        }
+    }
+    return targets;
+}
+
+// helloWorld's approximation: convex hulls for dynamic meshes, the triangle mesh itself for static ones
+static TfToken defaultApproximation(bool dynamic)
+{
+    return dynamic ? UsdPhysicsTokens->convexHull : UsdPhysicsTokens->none;
+}
+
+// The per-prim path, the same calls as helloWorld's enablePhysics
+static void applyPhysicsPerPrim(const UsdPrim& prim, bool dynamic, const TfToken& approximation)
+{
+    if (dynamic)
+    {
+        UsdPhysicsRigidBodyAPI::Apply(prim);
+    }
+    UsdPhysicsCollisionAPI::Apply(prim);
+    if (prim.IsA<UsdGeomMesh>())
+    {
+        UsdPhysicsMeshCollisionAPI::Apply(prim).CreateApproximationAttr().Set(approximation);
+    }
+}
+
+// Add a schema to an apiSchemas list op the way UsdPrim::ApplyAPI does: to the explicit items if the list op is
+// explicit, otherwise to the prepended items, and no longer deleted
+static bool addAppliedSchema(SdfTokenListOp& listOp, const TfToken& schema)
+{
+    if (listOp.IsExplicit())
+    {
+        TfTokenVector items = listOp.GetExplicitItems();
+        if (std::find(items.begin(), items.end(), schema) != items.end())
+        {
+            return false;
+        }
+        items.push_back(schema);
+        listOp.SetExplicitItems(items);
+        return true;
+    }
+    TfTokenVector prepended = listOp.GetPrependedItems();
+    TfTokenVector deleted = listOp.GetDeletedItems();
+    const auto deletedIt = std::find(deleted.begin(), deleted.end(), schema);
+    const bool wasDeleted = deletedIt != deleted.end();
+    if (wasDeleted)
+    {
+        deleted.erase(deletedIt);
+        listOp.SetDeletedItems(deleted);
+    }
+    if (std::find(prepended.begin(), prepended.end(), schema) != prepended.end())
+    {
+        return wasDeleted;
+    }
+    prepended.push_back(schema);
+    listOp.SetPrependedItems(prepended);
+    return true;
+}
+
+// The batched path: the same opinions as applyPhysicsPerPrim, written as layer data in one change block
+static void applyPhysicsBatched(const SdfLayerHandle& layer, const std::vector<UsdPrim>& targets, bool dynamic, const TfToken& approximation)
+{
+    static const TfToken kRigidBodyApi("PhysicsRigidBodyAPI");
+    static const TfToken kCollisionApi("PhysicsCollisionAPI");
+    static const TfToken kMeshCollisionApi("PhysicsMeshCollisionAPI");
+
+    // Whether a target is a mesh is read before the change block, while the stage is current
+    std::vector<char> isMesh(targets.size());
+    for (size_t i = 0; i < targets.size(); i++)
+    {
+        isMesh[i] = targets[i].IsA<UsdGeomMesh>();
+    }
+
+    SdfChangeBlock changeBlock;
+    for (size_t i = 0; i < targets.size(); i++)
+    {
+        SdfPrimSpecHandle spec = SdfCreatePrimInLayer(layer, targets[i].GetPath());
+        if (!spec)
+        {
+            continue;
+        }
+        SdfTokenListOp listOp;
+        const VtValue current = spec->GetInfo(UsdTokens->apiSchemas);
+        if (current.IsHolding<SdfTokenListOp>())
+        {
+            listOp = current.UncheckedGet<SdfTokenListOp>();
+        }
+        bool changed = dynamic && addAppliedSchema(listOp, kRigidBodyApi);
+        changed = addAppliedSchema(listOp, kCollisionApi) || changed;
+        if (isMesh[i])
+        {
+            changed = addAppliedSchema(listOp, kMeshCollisionApi) || changed;
+            SdfAttributeSpecHandle attr = layer->GetAttributeAtPath(targets[i].GetPath().AppendProperty(UsdPhysicsTokens->physicsApproximation));
+            if (!attr)
+            {
+                attr = SdfAttributeSpec::New(spec, UsdPhysicsTokens->physicsApproximation, SdfValueTypeNames->Token, SdfVariabilityUniform);
+            }
+            if (attr)
+            {
+                attr->SetDefaultValue(VtValue(approximation));
+            }
+        }
+        if (changed)
+        {
+            spec->SetInfo(UsdTokens->apiSchemas, VtValue(listOp));
+        }
+    }
+}
+
+// Apply RigidBodyAPI (with --dynamic), CollisionAPI and, on meshes, MeshCollisionAPI to many prims in one change block
+static int applyPhysics(const OptimizerArgs& args)
+{
+    const bool dryRun = args.hasFlag("--dry-run");
+    const bool bench = args.hasFlag("--bench");
+    const bool dynamic = args.hasFlag("--dynamic");
+    const std::string pattern = args.getString("--pattern", std::string());
+    const std::string listPath = args.getString("--list", std::string());
+    const TfToken approximation(args.getString("--approximation", defaultApproximation(dynamic).GetString()));
+    if (pattern.empty() == listPath.empty())
+    {
+        OMNI_LOG_ERROR("Pass either --pattern \"/Path/*\" or --list paths.txt to choose the prims");
+        return EXIT_FAILURE;
+    }
+    const TfTokenVector approximations = {
+        UsdPhysicsTokens->none,
+        UsdPhysicsTokens->convexHull,
+        UsdPhysicsTokens->convexDecomposition,
+        UsdPhysicsTokens->meshSimplification,
+        UsdPhysicsTokens->boundingCube,
+        UsdPhysicsTokens->boundingSphere,
+    };
+    if (std::find(approximations.begin(), approximations.end(), approximation) == approximations.end())
+    {
+        OMNI_LOG_ERROR("Unknown physics:approximation %s", approximation.GetText());
+        return EXIT_FAILURE;
+    }
+
+    UsdStageRefPtr stage = openStageForCommand(args.stageUrl());
+    if (!stage)
+    {
+        return EXIT_FAILURE;
+    }
+
+    Stopwatch findTimer;
+    const std::vector<UsdPrim> targets = findPhysicsTargets(stage, pattern, listPath);
+    const double findMs = findTimer.milliseconds();
+    size_t meshCount = 0;
+    for (const UsdPrim& prim : targets)
+    {
+        meshCount += prim.IsA<UsdGeomMesh>() ? 1 : 0;
+    }
+    OMNI_LOG_INFO(
+        "Found %zu prims (%zu meshes) in %.1f ms, applying %s physics with %s mesh approximation",
+        targets.size(),
+        meshCount,
+        findMs,
+        dynamic ? "dynamic" : "static",
+        approximation.GetText()
+    );
+    if (targets.empty())
+    {
+        return EXIT_SUCCESS;
+    }
+
+    if (bench)
+    {
+        // Both paths write to the session layer so the stage recomposes exactly as it would for the root layer, and
+        // the session layer is cleared after each run
+        SdfLayerHandle sessionLayer = stage->GetSessionLayer();
+        UsdEditContext editContext(stage, sessionLayer);
+        Stopwatch perPrimTimer;
+        for (const UsdPrim& prim : targets)
+        {
+            applyPhysicsPerPrim(prim, dynamic, approximation);
+        }
+        const double perPrimMs = perPrimTimer.milliseconds();
+        sessionLayer->Clear();
+
+        Stopwatch batchedTimer;
+        applyPhysicsBatched(sessionLayer, targets, dynamic, approximation);
+        const double batchedMs = batchedTimer.milliseconds();
+        sessionLayer->Clear();
+
+        OMNI_LOG_INFO(
+            "Per-prim Usd API: %.1f ms (%.0f prims/sec), batched Sdf change block: %.1f ms (%.0f prims/sec), %.1fx faster",
+            perPrimMs,
+            perPrimMs > 0.0 ? (double)targets.size() * 1000.0 / perPrimMs : 0.0,
+            batchedMs,
+            batchedMs > 0.0 ? (double)targets.size() * 1000.0 / batchedMs : 0.0,
+            batchedMs > 0.0 ? perPrimMs / batchedMs : 0.0
+        );
+    }
+
+    if (!dryRun)
+    {
+        Stopwatch authorTimer;
+        applyPhysicsBatched(stage->GetRootLayer(), targets, dynamic, approximation);
+        const double authorMs = authorTimer.milliseconds();
+        Stopwatch saveTimer;
+        stage->GetRootLayer()->Save();
+        OMNI_LOG_INFO("Authored physics on %zu prims in %.1f ms, saved in %.1f ms", targets.size(), authorMs, saveTimer.milliseconds());
+    }
+    else
+    {
+        OMNI_LOG_INFO("Dry run, nothing authored");
+    }
+    return EXIT_SUCCESS;
+}
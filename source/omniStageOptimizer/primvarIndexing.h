@@ -0,0 +1,257 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "optimizerCommon.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+
+#include <pxr/base/gf/vec2f.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/primvarsAPI.h>
+#include <pxr/usd/usdGeom/tokens.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and converts flat mesh primvars
+// (normals, st and displayColor) into indexed primvars where that makes them smaller.
+//
+// A faceted box written flat stores 24 normals for 6 distinct values, and imported
+// meshes are nearly always flat. An indexed primvar stores each distinct value once
+// plus one int per element, which is what helloWorld's box tables do by hand.
+///////////////////////////////////////////////////////////////////////////////////////
+
+// Hash the float bits of a vector directly, without building a key object.
+// Adding 0.0f folds -0.0 into 0.0 so the two compare and hash equal.
+template<class T>
+static inline uint32_t hashVec(const T& value)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t c = 0; c < T::dimension; c++)
+    {
+        const float component = value[c] + 0.0f;
+        uint32_t bits;
+        memcpy(&bits, &component, sizeof(bits));
+        bits *= 0xcc9e2d51u;
+        bits = (bits << 15) | (bits >> 17);
+        hash = (hash ^ (bits * 0x1b873593u)) * 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+template<class T>
+static inline bool sameVec(const T& a, const T& b)
+{
+    for (size_t c = 0; c < T::dimension; c++)
+    {
+        if (a[c] + 0.0f != b[c] + 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Build the unique value table and the index of every element into it.
+// `slots` is an open addressing table of positions in `unique`, kept by the caller so one thread reuses the same
+// memory for every primvar it indexes. Only exact duplicates are merged, there is no tolerance.
+template<class T>
+static void buildUniqueTable(const VtArray<T>& values, VtArray<T>& unique, VtIntArray& indices, std::vector<uint32_t>& slots)
+{
+    constexpr uint32_t kEmpty = UINT32_MAX;
+    size_t capacity = 16;
+    while (capacity < values.size() * 2)
+    {
+        capacity *= 2;
+    }
+    slots.assign(capacity, kEmpty);
+    const uint32_t mask = (uint32_t)capacity - 1;
+
+    unique.clear();
+    unique.reserve(values.size());
+    indices.resize(values.size());
+    const T* data = values.cdata();
+    int* indexData = indices.data();
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        uint32_t slot = hashVec(data[i]) & mask;
+        while (slots[slot] != kEmpty && !sameVec(unique[slots[slot]], data[i]))
+        {
+            slot = (slot + 1) & mask;
+        }
+        if (slots[slot] == kEmpty)
+        {
+            slots[slot] = (uint32_t)unique.size();
+            unique.push_back(data[i]);
+        }
+        indexData[i] = (int)slots[slot];
+    }
+}
+
+struct PrimvarIndexWork
+{
+    UsdGeomPrimvar primvar;
+    size_t bytesBefore = 0;
+    size_t bytesAfter = 0;
+    VtValue unique;
+    VtIntArray indices;
+};
+
+// Flatten the primvar (resolving any existing indices) and re-index it, keeping the result only if it is smaller
+template<class T>
+static void indexPrimvar(PrimvarIndexWork& work, std::vector<uint32_t>& slots)
+{
+    VtArray<T> values;
+    if (!work.primvar.Get(&values))
+    {
+        return;
+    }
+    VtIntArray authoredIndices;
+    work.primvar.GetIndices(&authoredIndices);
+    work.bytesBefore = values.size() * sizeof(T) + authoredIndices.size() * sizeof(int);
+
+    VtArray<T> flattened;
+    if (authoredIndices.empty())
+    {
+        flattened = values;
+    }
+    else if (!work.primvar.ComputeFlattened(&flattened))
+    {
+        return;
+    }
+
+    VtArray<T> unique;
+    VtIntArray indices;
+    buildUniqueTable(flattened, unique, indices, slots);
+    const size_t bytesAfter = unique.size() * sizeof(T) + indices.size() * sizeof(int);
+    if (bytesAfter < work.bytesBefore)
+    {
+        work.bytesAfter = bytesAfter;
+        work.unique = VtValue::Take(unique);
+        work.indices = std::move(indices);
+    }
+}
+
+// Author indexed normals, st and displayColor primvars wherever indexing them saves space
+static int indexMeshPrimvars(const OptimizerArgs& args)
+{
+    const bool dryRun = args.hasFlag("--dry-run");
+    const bool verbose = args.hasFlag("-v") || args.hasFlag("--verbose");
+
+    UsdStageRefPtr stage = openStageForCommand(args.stageUrl());
+    if (!stage)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Animated and constant primvars are left alone, there is nothing to share in a single value
+    static const TfToken kStToken("st");
+    static const TfToken kDisplayColorToken("displayColor");
+    const TfToken names[] = { UsdGeomTokens->normals, kStToken, kDisplayColorToken };
+    Stopwatch traverseTimer;
+    std::vector<PrimvarIndexWork> work;
+    for (const UsdPrim& prim : stage->Traverse())
+    {
+        if (!prim.IsA<UsdGeomMesh>())
+        {
+            continue;
+        }
+        UsdGeomPrimvarsAPI primvarsApi(prim);
+        for (const TfToken& name : names)
+        {
+            UsdGeomPrimvar primvar = primvarsApi.GetPrimvar(name);
+            if (primvar && primvar.HasAuthoredValue() && primvar.GetInterpolation() != UsdGeomTokens->constant &&
+                !primvar.ValueMightBeTimeVarying())
+            {
+                work.emplace_back();
+                work.back().primvar = primvar;
+            }
+        }
+    }
+    const double traverseMs = traverseTimer.milliseconds();
+
+    Stopwatch computeTimer;
+    WorkParallelForN(
+        work.size(),
+        [&work](size_t begin, size_t end)
+        {
+            std::vector<uint32_t> slots;
+            for (size_t i = begin; i < end; ++i)
+            {
+                const SdfValueTypeName typeName = work[i].primvar.GetTypeName().GetScalarType();
+                if (typeName.GetType() == SdfValueTypeNames->Float3.GetType())
+                {
+                    indexPrimvar<GfVec3f>(work[i], slots);
+                }
+                else if (typeName.GetType() == SdfValueTypeNames->Float2.GetType())
+                {
+                    indexPrimvar<GfVec2f>(work[i], slots);
+                }
+            }
+        }
+    );
+    const double computeMs = computeTimer.milliseconds();
+
+    size_t indexed = 0;
+    size_t bytesBefore = 0;
+    size_t bytesAfter = 0;
+    for (const PrimvarIndexWork& entry : work)
+    {
+        if (!entry.unique.IsEmpty())
+        {
+            indexed++;
+            bytesBefore += entry.bytesBefore;
+            bytesAfter += entry.bytesAfter;
+        }
+    }
+
+    // Authoring is serial, the stage is not safe to write from several threads
+    Stopwatch authorTimer;
+    if (!dryRun && indexed > 0)
+    {
+        for (const PrimvarIndexWork& entry : work)
+        {
+            if (entry.unique.IsEmpty())
+            {
+                continue;
+            }
+            if (verbose)
+            {
+                OMNI_LOG_INFO(
+                    "  %s: %zu values -> %zu unique",
+                    entry.primvar.GetAttr().GetPath().GetText(),
+                    entry.indices.size(),
+                    entry.unique.GetArraySize()
+                );
+            }
+            entry.primvar.Set(entry.unique);
+            entry.primvar.SetIndices(entry.indices);
+        }
+        stage->GetRootLayer()->Save();
+    }
+
+    OMNI_LOG_INFO(
+        "Checked %zu primvars: indexed %zu, saving %s (%s -> %s)%s",
+        work.size(),
+        indexed,
+        formatBytes((double)(bytesBefore - bytesAfter)).c_str(),
+        formatBytes((double)bytesBefore).c_str(),
+        formatBytes((double)bytesAfter).c_str(),
+        dryRun ? " (dry run, nothing authored)" : ""
+    );
+    OMNI_LOG_INFO("Traverse %.1f ms, index %.1f ms, author %.1f ms", traverseMs, computeMs, authorTimer.milliseconds());
+    return EXIT_SUCCESS;
+}
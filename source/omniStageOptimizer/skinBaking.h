@@ -0,0 +1,347 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "optimizerCommon.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/schema.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/pointBased.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdSkel/binding.h>
+#include <pxr/usd/usdSkel/cache.h>
+#include <pxr/usd/usdSkel/root.h>
+#include <pxr/usd/usdSkel/skeletonQuery.h>
+#include <pxr/usd/usdSkel/skinningQuery.h>
+#include <pxr/usd/usdSkel/tokens.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and bakes skinned meshes into
+// point caches.
+//
+// A skinned mesh, like the one helloWorld's createSkelMesh builds, only moves in
+// tools that evaluate UsdSkel. Here each skeleton's skinning transforms and then each
+// mesh's skinned points are computed with UsdSkelSkinningQuery for every frame of
+// the range, in parallel over frames and meshes, and written as time sampled points
+// and extents to a bake layer. The bake layer sublayers the stage, so opening it
+// shows the baked stage, and it blocks the meshes' joint influences so UsdSkel aware
+// tools don't skin the baked points a second time. Blend shapes are not evaluated.
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct SkeletonBake
+{
+    UsdSkelSkeletonQuery query;
+    std::vector<VtMatrix4dArray> skinningTransforms; // per frame
+    std::vector<GfMatrix4d> localToWorld;
+    std::vector<char> computed;
+};
+
+struct SkinnedMeshBake
+{
+    UsdGeomPointBased pointBased;
+    UsdSkelSkinningQuery skinningQuery;
+    size_t skeleton = 0;
+    VtVec3fArray restPoints;
+    std::vector<VtVec3fArray> points; // per frame, in the mesh's local space
+    std::vector<VtVec3fArray> extents;
+    std::vector<char> skinned;
+};
+
+// Skin the rest points with the skeleton's transforms at `frame` and move them from skeleton space to the mesh's space
+static bool skinMeshFrame(SkinnedMeshBake& mesh, const SkeletonBake& skeleton, size_t frame, UsdTimeCode time)
+{
+    if (!skeleton.computed[frame])
+    {
+        return false;
+    }
+    VtVec3fArray points = mesh.restPoints;
+    if (!mesh.skinningQuery.ComputeSkinnedPoints(skeleton.skinningTransforms[frame], &points, time))
+    {
+        return false;
+    }
+    const GfMatrix4d skelToMesh = skeleton.localToWorld[frame] * mesh.pointBased.ComputeLocalToWorldTransform(time).GetInverse();
+    if (skelToMesh != GfMatrix4d(1.0))
+    {
+        for (GfVec3f& point : points)
+        {
+            point = GfVec3f(skelToMesh.Transform(GfVec3d(point)));
+        }
+    }
+    VtVec3fArray extent;
+    if (!UsdGeomPointBased::ComputeExtent(points, &extent))
+    {
+        return false;
+    }
+    mesh.points[frame] = std::move(points);
+    mesh.extents[frame] = std::move(extent);
+    return true;
+}
+
+static int bakeSkinning(const OptimizerArgs& args)
+{
+    const bool dryRun = args.hasFlag("--dry-run");
+    const bool verbose = args.hasFlag("-v") || args.hasFlag("--verbose");
+
+    UsdStageRefPtr stage = openStageForCommand(args.stageUrl());
+    if (!stage)
+    {
+        return EXIT_FAILURE;
+    }
+    const double start = args.getDouble("--start", stage->GetStartTimeCode());
+    const double end = args.getDouble("--end", stage->GetEndTimeCode());
+    const double stride = std::max(1e-3, args.getDouble("--stride", 1.0));
+    if (end < start || (!stage->HasAuthoredTimeCodeRange() && args.getString("--end", std::string()).empty()))
+    {
+        OMNI_LOG_ERROR("No frame range to bake, the stage has no start and end time codes, use --start and --end");
+        return EXIT_FAILURE;
+    }
+    const size_t frameCount = (size_t)std::floor((end - start) / stride + 1e-6) + 1;
+    auto frameTime = [start, stride](size_t frame)
+    {
+        return UsdTimeCode(start + (double)frame * stride);
+    };
+
+    SdfLayerHandle rootLayer = stage->GetRootLayer();
+    const std::string layerArg = args.getString("--layer", std::string());
+    const std::string layerPath = layerArg.empty() ? TfStringGetBeforeSuffix(rootLayer->GetIdentifier()) + "_skinned.usdc" : layerArg;
+
+    // Populating the skel cache and resolving the bindings is not thread safe, the queries it hands out are
+    Stopwatch traverseTimer;
+    UsdSkelCache skelCache;
+    std::vector<SkeletonBake> skeletons;
+    std::map<SdfPath, size_t> skeletonIndices;
+    std::vector<SkinnedMeshBake> meshes;
+    std::map<std::string, size_t> skipped;
+    for (const UsdPrim& prim : stage->Traverse())
+    {
+        UsdSkelRoot skelRoot(prim);
+        if (!skelRoot)
+        {
+            continue;
+        }
+        skelCache.Populate(skelRoot, UsdPrimDefaultPredicate);
+        std::vector<UsdSkelBinding> bindings;
+        skelCache.ComputeSkelBindings(skelRoot, &bindings, UsdPrimDefaultPredicate);
+        for (const UsdSkelBinding& binding : bindings)
+        {
+            UsdSkelSkeletonQuery skelQuery = skelCache.GetSkelQuery(binding.GetSkeleton());
+            if (!skelQuery)
+            {
+                skipped["have an invalid skeleton"] += binding.GetSkinningTargets().size();
+                continue;
+            }
+            const SdfPath skeletonPath = binding.GetSkeleton().GetPath();
+            auto inserted = skeletonIndices.emplace(skeletonPath, skeletons.size());
+            if (inserted.second)
+            {
+                skeletons.emplace_back();
+                skeletons.back().query = skelQuery;
+            }
+            for (const UsdSkelSkinningQuery& skinningQuery : binding.GetSkinningTargets())
+            {
+                UsdGeomPointBased pointBased(skinningQuery.GetPrim());
+                if (!pointBased || !skinningQuery.HasJointInfluences())
+                {
+                    continue;
+                }
+                SkinnedMeshBake mesh;
+                mesh.pointBased = pointBased;
+                mesh.skinningQuery = skinningQuery;
+                mesh.skeleton = inserted.first->second;
+                if (pointBased.GetPointsAttr().ValueMightBeTimeVarying())
+                {
+                    skipped["have animated points"]++;
+                }
+                else if (!pointBased.GetPointsAttr().Get(&mesh.restPoints) || mesh.restPoints.empty())
+                {
+                    skipped["have no points"]++;
+                }
+                else
+                {
+                    meshes.push_back(std::move(mesh));
+                }
+            }
+        }
+    }
+    const double traverseMs = traverseTimer.milliseconds();
+    if (meshes.empty())
+    {
+        OMNI_LOG_INFO("No skinned meshes to bake");
+        for (const auto& entry : skipped)
+        {
+            OMNI_LOG_INFO("  %zu meshes skipped: %s", entry.second, entry.first.c_str());
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Each skeleton's joints are posed once per frame and shared by the meshes it skins
+    Stopwatch computeTimer;
+    for (SkeletonBake& skeleton : skeletons)
+    {
+        skeleton.skinningTransforms.resize(frameCount);
+        skeleton.localToWorld.resize(frameCount);
+        skeleton.computed.assign(frameCount, 0);
+    }
+    WorkParallelForN(
+        skeletons.size() * frameCount,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                SkeletonBake& skeleton = skeletons[i / frameCount];
+                const size_t frame = i % frameCount;
+                const UsdTimeCode time = frameTime(frame);
+                skeleton.computed[frame] = skeleton.query.ComputeSkinningTransforms(&skeleton.skinningTransforms[frame], time) ? 1 : 0;
+                skeleton.localToWorld[frame] = UsdGeomXformable(skeleton.query.GetPrim()).ComputeLocalToWorldTransform(time);
+            }
+        }
+    );
+    for (SkinnedMeshBake& mesh : meshes)
+    {
+        mesh.points.resize(frameCount);
+        mesh.extents.resize(frameCount);
+        mesh.skinned.assign(frameCount, 0);
+    }
+    WorkParallelForN(
+        meshes.size() * frameCount,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                SkinnedMeshBake& mesh = meshes[i / frameCount];
+                const size_t frame = i % frameCount;
+                mesh.skinned[frame] = skinMeshFrame(mesh, skeletons[mesh.skeleton], frame, frameTime(frame)) ? 1 : 0;
+            }
+        },
+        1
+    );
+    const double computeMs = computeTimer.milliseconds();
+
+    size_t bakedMeshes = 0;
+    size_t bakedPoints = 0;
+    for (const SkinnedMeshBake& mesh : meshes)
+    {
+        const size_t failedFrames = std::count(mesh.skinned.begin(), mesh.skinned.end(), 0);
+        if (failedFrames > 0)
+        {
+            skipped["could not be skinned"]++;
+            OMNI_LOG_WARN("Could not skin %s on %zu of %zu frames", mesh.pointBased.GetPath().GetText(), failedFrames, frameCount);
+            continue;
+        }
+        bakedMeshes++;
+        bakedPoints += mesh.restPoints.size() * frameCount;
+        if (verbose)
+        {
+            OMNI_LOG_INFO("  %s: %zu points x %zu frames", mesh.pointBased.GetPath().GetText(), mesh.restPoints.size(), frameCount);
+        }
+    }
+
+    Stopwatch authorTimer;
+    SdfLayerRefPtr bakeLayer;
+    if (!dryRun && bakedMeshes > 0)
+    {
+        bakeLayer = SdfLayer::CreateAnonymous(".usdc");
+        bakeLayer->SetDocumentation("Skinned point caches of " + rootLayer->GetIdentifier());
+        bakeLayer->SetSubLayerPaths({ rootLayer->GetIdentifier() });
+        // Stage metadata is only read from the root layer, which the bake layer is when it is opened
+        for (const TfToken& key : { SdfFieldKeys->DefaultPrim, UsdGeomTokens->upAxis, UsdGeomTokens->metersPerUnit })
+        {
+            if (rootLayer->GetPseudoRoot()->HasInfo(key))
+            {
+                bakeLayer->GetPseudoRoot()->SetInfo(key, rootLayer->GetPseudoRoot()->GetInfo(key));
+            }
+        }
+        bakeLayer->SetTimeCodesPerSecond(stage->GetTimeCodesPerSecond());
+        bakeLayer->SetFramesPerSecond(stage->GetFramesPerSecond());
+        bakeLayer->SetStartTimeCode(start);
+        bakeLayer->SetEndTimeCode(frameTime(frameCount - 1).GetValue());
+
+        SdfChangeBlock changeBlock;
+        for (const SkinnedMeshBake& mesh : meshes)
+        {
+            if (std::count(mesh.skinned.begin(), mesh.skinned.end(), 0) > 0)
+            {
+                continue;
+            }
+            const SdfPath meshPath = mesh.pointBased.GetPath();
+            SdfPrimSpecHandle meshSpec = SdfCreatePrimInLayer(bakeLayer, meshPath);
+            SdfAttributeSpecHandle pointsSpec = SdfAttributeSpec::New(meshSpec, UsdGeomTokens->points, SdfValueTypeNames->Point3fArray);
+            SdfAttributeSpecHandle extentSpec = SdfAttributeSpec::New(meshSpec, UsdGeomTokens->extent, SdfValueTypeNames->Float3Array);
+            for (size_t frame = 0; frame < frameCount; frame++)
+            {
+                const double time = frameTime(frame).GetValue();
+                bakeLayer->SetTimeSample(pointsSpec->GetPath(), time, mesh.points[frame]);
+                bakeLayer->SetTimeSample(extentSpec->GetPath(), time, mesh.extents[frame]);
+            }
+            // Without joint influences UsdSkel leaves the baked points as they are
+            const std::pair<TfToken, SdfValueTypeName> influences[] = {
+                { UsdSkelTokens->primvarsSkelJointIndices, SdfValueTypeNames->IntArray },
+                { UsdSkelTokens->primvarsSkelJointWeights, SdfValueTypeNames->FloatArray },
+            };
+            for (const auto& influence : influences)
+            {
+                if (SdfAttributeSpecHandle spec = SdfAttributeSpec::New(meshSpec, influence.first, influence.second))
+                {
+                    spec->SetDefaultValue(VtValue(SdfValueBlock()));
+                }
+            }
+        }
+    }
+    const double authorMs = authorTimer.milliseconds();
+
+    Stopwatch saveTimer;
+    if (bakeLayer && !bakeLayer->Export(layerPath))
+    {
+        OMNI_LOG_ERROR("Could not write the bake layer %s", layerPath.c_str());
+        return EXIT_FAILURE;
+    }
+    const double saveMs = saveTimer.milliseconds();
+
+    const std::string destination = dryRun ? " (dry run, nothing authored)" : (bakeLayer ? ", written to " + layerPath : std::string());
+    OMNI_LOG_INFO(
+        "Baked %zu of %zu skinned meshes over %zu frames (%.1f to %.1f) with %zu skeletons, %zu points in total%s",
+        bakedMeshes,
+        meshes.size(),
+        frameCount,
+        start,
+        frameTime(frameCount - 1).GetValue(),
+        skeletons.size(),
+        bakedPoints,
+        destination.c_str()
+    );
+    for (const auto& entry : skipped)
+    {
+        OMNI_LOG_INFO("  %zu meshes skipped: %s", entry.second, entry.first.c_str());
+    }
+    OMNI_LOG_INFO(
+        "Traverse %.1f ms, skin %.1f ms (%.1f frames/sec, %.0f mesh frames/sec on %u threads), author %.1f ms, save %.1f ms",
+        traverseMs,
+        computeMs,
+        computeMs > 0.0 ? (double)frameCount * 1000.0 / computeMs : 0.0,
+        computeMs > 0.0 ? (double)(meshes.size() * frameCount) * 1000.0 / computeMs : 0.0,
+        WorkGetConcurrencyLimit(),
+        authorMs,
+        saveMs
+    );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,320 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "optimizerCommon.h"
+#include "ParallelSave.h"
+#include "Stopwatch.h"
+
+#include <omni/connect/core/Log.h>
+
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/sdf/fileFormat.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/layerUtils.h>
+#include <pxr/usd/sdf/schema.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/usdaFileFormat.h>
+#include <pxr/usd/usd/usdcFileFormat.h>
+#include <pxr/usd/usd/usdFileFormat.h>
+#include <pxr/usd/usdUtils/dependencies.h>
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Optimizer sample and converts the text (usda)
+// layers of a stage that carry large arrays to binary (usdc) layers.
+//
+// Text layers are found by their file format rather than their extension: a .usd layer
+// may hold either encoding, so text .usd layers are rewritten as crate under the same
+// name and the arcs that point at them stay as they are.
+//
+// Large arrays in usda layers are what the Asset Validator's UsdAsciiPerformanceChecker
+// reports: every element must be parsed from text when the layer opens, while a usdc
+// layer is memory mapped and reads array values on demand.
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct AsciiLayerCandidate
+{
+    SdfLayerRefPtr layer;
+    size_t largestArray = 0;
+    std::string usdcIdentifier;
+    bool inPlace = false;
+    double exportMs = 0.0;
+    double usdaOpenMs = 0.0;
+    double usdcOpenMs = 0.0;
+    bool converted = false;
+};
+
+// Returns the element count of the largest array authored in the layer (defaults and time samples)
+static size_t findLargestArray(const SdfLayerHandle& layer)
+{
+    size_t largest = 0;
+    layer->Traverse(
+        SdfPath::AbsoluteRootPath(),
+        [&layer, &largest](const SdfPath& path)
+        {
+            if (!path.IsPropertyPath())
+            {
+                return;
+            }
+            VtValue value;
+            if (layer->HasField(path, SdfFieldKeys->Default, &value) && value.IsArrayValued())
+            {
+                largest = std::max(largest, value.GetArraySize());
+            }
+            for (double time : layer->ListTimeSamplesForPath(path))
+            {
+                if (layer->QueryTimeSample(path, time, &value) && value.IsArrayValued())
+                {
+                    largest = std::max(largest, value.GetArraySize());
+                }
+            }
+        }
+    );
+    return largest;
+}
+
+// True for .usda layers and for .usd layers whose contents are text
+static bool isTextLayer(const SdfLayerHandle& layer)
+{
+    if (layer->IsAnonymous())
+    {
+        return false;
+    }
+    const TfToken formatId = layer->GetFileFormat()->GetFormatId();
+    if (formatId == UsdUsdaFileFormatTokens->Id)
+    {
+        return true;
+    }
+    return formatId == UsdUsdFileFormatTokens->Id && UsdUsdFileFormat::GetUnderlyingFormatForLayer(*layer) == UsdUsdaFileFormatTokens->Id;
+}
+
+// Convert the text layers of a stage that hold arrays longer than --threshold elements to usdc.
+// A .usda layer is written next to itself as .usdc and every sublayer, reference and payload arc
+// is pointed at the new file; a text .usd layer is rewritten as crate in place.
+static int convertAsciiLayers(const OptimizerArgs& args)
+{
+    const size_t threshold = (size_t)args.getInt("--threshold", 1000);
+    const bool dryRun = args.hasFlag("--dry-run");
+
+    UsdStageRefPtr stage = openStageForCommand(args.stageUrl());
+    if (!stage)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Every layer the stage composes, minus the session layer and anonymous layers
+    SdfLayerHandleVector usedLayers;
+    for (const SdfLayerHandle& layer : stage->GetUsedLayers())
+    {
+        if (layer != stage->GetSessionLayer() && !layer->IsAnonymous())
+        {
+            usedLayers.push_back(layer);
+        }
+    }
+
+    std::vector<AsciiLayerCandidate> scanned(usedLayers.size());
+    Stopwatch scanTimer;
+    WorkParallelForN(
+        usedLayers.size(),
+        [&usedLayers, &scanned](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (isTextLayer(usedLayers[i]))
+                {
+                    scanned[i].layer = usedLayers[i];
+                    scanned[i].largestArray = findLargestArray(usedLayers[i]);
+                }
+            }
+        }
+    );
+
+    std::vector<AsciiLayerCandidate> candidates;
+    for (auto& entry : scanned)
+    {
+        if (entry.layer && entry.largestArray > threshold)
+        {
+            entry.inPlace = entry.layer->GetFileFormat()->GetFormatId() == UsdUsdFileFormatTokens->Id;
+            entry.usdcIdentifier = entry.inPlace ? entry.layer->GetIdentifier() : TfStringGetBeforeSuffix(entry.layer->GetIdentifier()) + ".usdc";
+            candidates.push_back(entry);
+        }
+    }
+    OMNI_LOG_INFO(
+        "Scanned %zu layers in %.1f ms, %zu text layers have arrays longer than %zu elements",
+        usedLayers.size(),
+        scanTimer.milliseconds(),
+        candidates.size(),
+        threshold
+    );
+    for (const auto& candidate : candidates)
+    {
+        OMNI_LOG_INFO(
+            "  %s (largest array: %zu) -> %s",
+            candidate.layer->GetIdentifier().c_str(),
+            candidate.largestArray,
+            candidate.inPlace ? "usdc in place" : candidate.usdcIdentifier.c_str()
+        );
+    }
+    if (candidates.empty() || dryRun)
+    {
+        return EXIT_SUCCESS;
+    }
+
+    // Parse each text layer from scratch before it is exported, in-place conversion overwrites the text.
+    // One layer at a time so the timings don't compete.
+    for (auto& candidate : candidates)
+    {
+        Stopwatch timer;
+        SdfLayerRefPtr usda = SdfLayer::OpenAsAnonymous(candidate.layer->GetIdentifier());
+        candidate.usdaOpenMs = timer.milliseconds();
+    }
+
+    // Each layer exports independently, so the usdc files are written concurrently
+    Stopwatch exportTimer;
+    WorkParallelForN(
+        candidates.size(),
+        [&candidates](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                AsciiLayerCandidate& candidate = candidates[i];
+                SdfLayer::FileFormatArguments formatArgs;
+                if (candidate.inPlace)
+                {
+                    formatArgs[UsdUsdFileFormatTokens->FormatArg] = UsdUsdcFileFormatTokens->Id.GetString();
+                }
+                Stopwatch layerTimer;
+                candidate.converted = candidate.layer->Export(candidate.usdcIdentifier, "Converted from usda by omniStageOptimizer", formatArgs);
+                candidate.exportMs = layerTimer.milliseconds();
+            }
+        }
+    );
+    OMNI_LOG_INFO("Wrote %zu usdc layers in %.1f ms", candidates.size(), exportTimer.milliseconds());
+
+    // Map both the identifier and the resolved path of each layer converted to a new file, asset paths may resolve to either.
+    // Layers converted in place keep their name, so arcs to them need no retargeting. They are reloaded because a .usd layer
+    // saves in the encoding of its in-memory data, and the retargeting save below would otherwise write the text back.
+    std::set<std::string> convertedIds;
+    for (const auto& candidate : candidates)
+    {
+        if (!candidate.converted)
+        {
+            OMNI_LOG_ERROR("Failed to write %s", candidate.usdcIdentifier.c_str());
+        }
+        else if (candidate.inPlace)
+        {
+            if (!candidate.layer->Reload(true))
+            {
+                OMNI_LOG_ERROR("Failed to reload %s after converting it to usdc", candidate.usdcIdentifier.c_str());
+            }
+        }
+        else
+        {
+            convertedIds.insert(candidate.layer->GetIdentifier());
+            convertedIds.insert(candidate.layer->GetRealPath());
+        }
+    }
+
+    // Retarget arcs in the new usdc layers and in every unconverted layer that points at a converted one
+    SdfLayerRefPtrVector usdcLayers;
+    SdfLayerHandleVector layersToFix;
+    for (const auto& candidate : candidates)
+    {
+        if (candidate.converted && !candidate.inPlace)
+        {
+            if (SdfLayerRefPtr usdcLayer = SdfLayer::FindOrOpen(candidate.usdcIdentifier))
+            {
+                usdcLayers.push_back(usdcLayer);
+                layersToFix.push_back(usdcLayer);
+            }
+        }
+    }
+    for (const SdfLayerHandle& layer : usedLayers)
+    {
+        if (convertedIds.count(layer->GetIdentifier()) == 0)
+        {
+            layersToFix.push_back(layer);
+        }
+    }
+
+    size_t rewrittenPaths = 0;
+    for (const SdfLayerHandle& layer : layersToFix)
+    {
+        UsdUtilsModifyAssetPaths(
+            layer,
+            [&layer, &convertedIds, &rewrittenPaths](const std::string& assetPath)
+            {
+                if (assetPath.empty() || !TfStringEndsWith(assetPath, ".usda"))
+                {
+                    return assetPath;
+                }
+                if (convertedIds.count(SdfComputeAssetPathRelativeToLayer(layer, assetPath)) == 0)
+                {
+                    return assetPath;
+                }
+                rewrittenPaths++;
+                return TfStringGetBeforeSuffix(assetPath) + ".usdc";
+            }
+        );
+    }
+    const parallelsave::SaveReport saveReport = parallelsave::saveLayers(layersToFix);
+    for (const parallelsave::LayerTiming& layer : saveReport.layers)
+    {
+        if (!layer.saved)
+        {
+            OMNI_LOG_ERROR("Failed to save retargeted asset paths in %s", layer.identifier.c_str());
+        }
+    }
+    OMNI_LOG_INFO(
+        "Retargeted %zu asset paths, saved %zu layers in parallel in %.1f ms",
+        rewrittenPaths,
+        saveReport.layers.size(),
+        saveReport.totalMs
+    );
+
+    // Parse each converted layer from scratch, to compare against the text parse timed before the export
+    double usdaTotalMs = 0.0;
+    double usdcTotalMs = 0.0;
+    for (auto& candidate : candidates)
+    {
+        if (!candidate.converted)
+        {
+            continue;
+        }
+        Stopwatch timer;
+        SdfLayerRefPtr usdc = SdfLayer::OpenAsAnonymous(candidate.usdcIdentifier);
+        candidate.usdcOpenMs = timer.milliseconds();
+        usdaTotalMs += candidate.usdaOpenMs;
+        usdcTotalMs += candidate.usdcOpenMs;
+        OMNI_LOG_INFO(
+            "  %s: export %.1f ms, open usda %.1f ms -> usdc %.1f ms",
+            candidate.usdcIdentifier.c_str(),
+            candidate.exportMs,
+            candidate.usdaOpenMs,
+            candidate.usdcOpenMs
+        );
+    }
+    OMNI_LOG_INFO(
+        "Layer parse time: usda %.1f ms, usdc %.1f ms (%.1fx faster)",
+        usdaTotalMs,
+        usdcTotalMs,
+        usdcTotalMs > 0.0 ? usdaTotalMs / usdcTotalMs : 0.0
+    );
+
+    if (convertedIds.count(stage->GetRootLayer()->GetIdentifier()))
+    {
+        OMNI_LOG_INFO(
+            "The root layer was converted, open %s to use the optimized stage",
+            (TfStringGetBeforeSuffix(stage->GetRootLayer()->GetIdentifier()) + ".usdc").c_str()
+        );
+    }
+    return EXIT_SUCCESS;
+}
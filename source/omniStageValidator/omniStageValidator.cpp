@@ -0,0 +1,402 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+/*###############################################################################
+#
+# This "omniStageValidator" sample demonstrates how to:
+#  * connect to an Omniverse server
+#  * open an existing stage read-only and traverse it once
+#  * run independent validation rules on every prim in parallel with the USD
+#    work library
+#  * write the results as JSON for other tools to consume
+#
+#  * rules:
+#  *  mesh-index-bounds - faceVertexIndices index the mesh's points
+#  *  mesh-face-counts - faceVertexCounts add up to the faceVertexIndices
+#  *  primvar-sizes - primvars match the element count of their interpolation
+#  *  degenerate-faces - faces do not repeat a point or have no area
+#  *  extents - authored extents match the geometry
+#  *  asset-paths - asset valued attributes resolve
+#  *  layer-asset-paths - sublayers, references and payloads resolve
+#
+###############################################################################*/
+
+#include "Stopwatch.h"
+#include "validationRules.h"
+
+#include <omni/connect/core/Core.h>
+#include <omni/connect/core/Log.h>
+
+#include <omni/core/OmniInit.h>
+#include <omni/log/ILog.h>
+
+#include <OmniClient.h>
+
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Initialize the Omniverse application
+OMNI_APP_GLOBALS("StageValidator", "Omniverse Stage Validator");
+
+constexpr size_t kRuleCount = sizeof(gRules) / sizeof(gRules[0]);
+
+// Startup Omniverse
+static bool startOmniverse(bool verbose)
+{
+    // Check that the core Omniverse frameworks started successfully
+    OMNICONNECTCORE_INIT();
+    if (!omni::connect::core::initialized())
+    {
+        return false;
+    }
+
+    // Set the retry behavior to limit retries so that invalid server addresses fail quickly
+    omniClientSetRetries({ 1000, 500, 0 });
+
+    auto log = omniGetLogWithoutAcquire();
+    log->setLevel(verbose ? omni::log::Level::eVerbose : omni::log::Level::eInfo);
+
+    return true;
+}
+
+// Print the command line arguments help
+static void printCmdLineArgHelp()
+{
+    std::string help =
+        "\nUsage: omniStageValidator <stage_url> [options]\n"
+        "  options:\n"
+        "    -h, --help            Print this help\n"
+        "    -v, --verbose         Show the verbose Omniverse logging\n"
+        "    --rules id[,id...]    Only run these rules (default: all)\n"
+        "    --output file.json    Also write the results as JSON to a local file\n"
+        "  rules:\n";
+    for (const Rule& rule : gRules)
+    {
+        help += std::string("    ") + rule.id + "\n        " + rule.description + "\n";
+    }
+    help +=
+        "\n\nExamples:\n"
+        " * validate a stage on the localhost server and keep the results\n"
+        "    > omniStageValidator omniverse://localhost/Users/test/helloworld.usd --output results.json\n";
+    OMNI_LOG_INFO("%s", help.c_str());
+}
+
+static std::string jsonEscape(const std::string& text)
+{
+    std::string escaped;
+    escaped.reserve(text.size() + 2);
+    for (char c : text)
+    {
+        switch (c)
+        {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default:
+                if ((unsigned char)c < 0x20)
+                {
+                    escaped += TfStringPrintf("\\u%04x", (unsigned char)c);
+                }
+                else
+                {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped;
+}
+
+struct RuleStats
+{
+    bool enabled = true;
+    std::atomic<size_t> checked{ 0 };
+    std::atomic<int64_t> nanoseconds{ 0 };
+    size_t issues = 0;
+};
+
+static bool writeJson(
+    const std::string& path,
+    const std::string& stageUrl,
+    size_t primCount,
+    size_t layerCount,
+    double seconds,
+    const RuleStats* stats,
+    const std::vector<Issue>& issues,
+    size_t errorCount
+)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        OMNI_LOG_ERROR("Could not open %s for writing", path.c_str());
+        return false;
+    }
+    fprintf(file, "{\n  \"stage\": \"%s\",\n", jsonEscape(stageUrl).c_str());
+    fprintf(
+        file,
+        "  \"summary\": { \"prims\": %zu, \"layers\": %zu, \"errors\": %zu, \"warnings\": %zu, \"seconds\": %.3f },\n",
+        primCount,
+        layerCount,
+        errorCount,
+        issues.size() - errorCount,
+        seconds
+    );
+    fprintf(file, "  \"rules\": [");
+    bool first = true;
+    for (size_t r = 0; r < kRuleCount; r++)
+    {
+        if (!stats[r].enabled)
+        {
+            continue;
+        }
+        fprintf(
+            file,
+            "%s\n    { \"id\": \"%s\", \"checked\": %zu, \"issues\": %zu, \"milliseconds\": %.3f }",
+            first ? "" : ",",
+            gRules[r].id,
+            stats[r].checked.load(),
+            stats[r].issues,
+            (double)stats[r].nanoseconds.load() / 1e6
+        );
+        first = false;
+    }
+    fprintf(file, "\n  ],\n  \"issues\": [");
+    for (size_t i = 0; i < issues.size(); i++)
+    {
+        const Issue& issue = issues[i];
+        fprintf(
+            file,
+            "%s\n    { \"severity\": \"%s\", \"rule\": \"%s\", \"location\": \"%s\", \"message\": \"%s\" }",
+            i ? "," : "",
+            severityName(issue.severity),
+            issue.rule,
+            jsonEscape(issue.location).c_str(),
+            jsonEscape(issue.message).c_str()
+        );
+    }
+    fprintf(file, "\n  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+// Main Application
+int main(int argc, char* argv[])
+{
+    bool verbose = false;
+    std::string stageUrl;
+    std::string outputPath;
+    std::string ruleList;
+    for (int x = 1; x < argc; x++)
+    {
+        if (strcmp(argv[x], "-h") == 0 || strcmp(argv[x], "--help") == 0)
+        {
+            startOmniverse(false);
+            printCmdLineArgHelp();
+            return EXIT_SUCCESS;
+        }
+        else if (strcmp(argv[x], "-v") == 0 || strcmp(argv[x], "--verbose") == 0)
+        {
+            verbose = true;
+        }
+        else if (strcmp(argv[x], "--rules") == 0 && x + 1 < argc)
+        {
+            ruleList = argv[++x];
+        }
+        else if (strcmp(argv[x], "--output") == 0 && x + 1 < argc)
+        {
+            outputPath = argv[++x];
+        }
+        else if (argv[x][0] == '-' && argv[x][1] != '\0')
+        {
+            // A misspelled option must not be taken for the stage URL
+            startOmniverse(false);
+            OMNI_LOG_ERROR("ERROR: Unknown option or missing value: %s", argv[x]);
+            printCmdLineArgHelp();
+            return EXIT_FAILURE;
+        }
+        else
+        {
+            stageUrl = argv[x];
+        }
+    }
+
+    if (!startOmniverse(verbose))
+    {
+        return EXIT_FAILURE;
+    }
+    if (stageUrl.empty())
+    {
+        OMNI_LOG_ERROR("ERROR: A stage URL is required.");
+        printCmdLineArgHelp();
+        return EXIT_FAILURE;
+    }
+
+    RuleStats stats[kRuleCount];
+    if (!ruleList.empty())
+    {
+        const std::vector<std::string> ids = TfStringSplit(ruleList, ",");
+        for (size_t r = 0; r < kRuleCount; r++)
+        {
+            stats[r].enabled = std::find(ids.begin(), ids.end(), gRules[r].id) != ids.end();
+        }
+        for (const std::string& id : ids)
+        {
+            if (std::none_of(std::begin(gRules), std::end(gRules), [&id](const Rule& rule) { return id == rule.id; }))
+            {
+                OMNI_LOG_ERROR("ERROR: Unknown rule: %s", id.c_str());
+                printCmdLineArgHelp();
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    Stopwatch totalTimer;
+    UsdStageRefPtr stage = UsdStage::Open(stageUrl);
+    if (!stage)
+    {
+        OMNI_LOG_ERROR("Failure to open stage: %s", stageUrl.c_str());
+        return EXIT_FAILURE;
+    }
+    const double openMs = totalTimer.milliseconds();
+
+    // One traversal gathers every prim, including the prims of instance prototypes (checked once for all instances)
+    Stopwatch traverseTimer;
+    std::vector<UsdPrim> prims;
+    for (const UsdPrim& prim : stage->Traverse())
+    {
+        prims.push_back(prim);
+    }
+    for (const UsdPrim& prototype : stage->GetPrototypes())
+    {
+        for (const UsdPrim& prim : UsdPrimRange(prototype))
+        {
+            prims.push_back(prim);
+        }
+    }
+    const SdfLayerHandleVector layers = stage->GetUsedLayers();
+    const double traverseMs = traverseTimer.milliseconds();
+
+    // Every prim and every layer is a work item. Each task runs the enabled rules on its items and keeps its issues
+    // locally until it is done, so the threads only meet once per task.
+    Stopwatch validateTimer;
+    std::vector<Issue> issues;
+    std::mutex issuesMutex;
+    WorkParallelForN(
+        prims.size() + layers.size(),
+        [&](size_t begin, size_t end)
+        {
+            std::vector<Issue> local;
+            for (size_t i = begin; i < end; ++i)
+            {
+                RuleContext context(i < prims.size() ? prims[i] : UsdPrim(), local);
+                for (size_t r = 0; r < kRuleCount; r++)
+                {
+                    const Rule& rule = gRules[r];
+                    const bool isLayer = rule.target == RuleTarget::eLayers;
+                    if (!stats[r].enabled || isLayer != (i >= prims.size()) || (!isLayer && !ruleAppliesTo(rule, prims[i])))
+                    {
+                        continue;
+                    }
+                    const auto start = std::chrono::steady_clock::now();
+                    if (isLayer)
+                    {
+                        rule.checkLayer(layers[i - prims.size()], rule.id, local);
+                    }
+                    else
+                    {
+                        rule.checkPrim(context, rule.id);
+                    }
+                    stats[r].nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                    stats[r].checked++;
+                }
+            }
+            if (!local.empty())
+            {
+                std::lock_guard<std::mutex> lock(issuesMutex);
+                issues.insert(issues.end(), std::make_move_iterator(local.begin()), std::make_move_iterator(local.end()));
+            }
+        }
+    );
+    const double validateMs = validateTimer.milliseconds();
+
+    // Tasks finish in any order, sort so that every run prints the same report
+    std::sort(
+        issues.begin(),
+        issues.end(),
+        [](const Issue& a, const Issue& b)
+        {
+            const int order = a.location.compare(b.location);
+            return order != 0 ? order < 0 : strcmp(a.rule, b.rule) < 0;
+        }
+    );
+    size_t errorCount = 0;
+    for (const Issue& issue : issues)
+    {
+        errorCount += issue.severity == Severity::eError ? 1 : 0;
+        for (size_t r = 0; r < kRuleCount; r++)
+        {
+            stats[r].issues += strcmp(gRules[r].id, issue.rule) == 0 ? 1 : 0;
+        }
+        // The same "[Error]" lines as omni_asset_validator, so scripts that scan its output work with both
+        printf("[%s] %s <%s>: %s\n", severityName(issue.severity), issue.rule, issue.location.c_str(), issue.message.c_str());
+    }
+    fflush(stdout);
+
+    for (size_t r = 0; r < kRuleCount; r++)
+    {
+        if (stats[r].enabled)
+        {
+            OMNI_LOG_INFO(
+                "  %-18s checked %zu, %zu issues, %.1f ms of thread time",
+                gRules[r].id,
+                stats[r].checked.load(),
+                stats[r].issues,
+                (double)stats[r].nanoseconds.load() / 1e6
+            );
+        }
+    }
+    OMNI_LOG_INFO(
+        "Validated %zu prims and %zu layers: %zu errors, %zu warnings. Open %.1f ms, traverse %.1f ms, validate %.1f ms on %u threads",
+        prims.size(),
+        layers.size(),
+        errorCount,
+        issues.size() - errorCount,
+        openMs,
+        traverseMs,
+        validateMs,
+        WorkGetConcurrencyLimit()
+    );
+
+    if (!outputPath.empty() &&
+        !writeJson(outputPath, stageUrl, prims.size(), layers.size(), totalTimer.milliseconds() / 1000.0, stats, issues, errorCount))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Calling this prior to shutdown ensures that all pending updates complete.
+    omniClientLiveWaitForPendingUpdates();
+
+    return errorCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
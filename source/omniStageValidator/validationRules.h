@@ -0,0 +1,459 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <pxr/base/gf/range3f.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/usd/ar/resolver.h>
+#include <pxr/usd/sdf/assetPath.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/layerUtils.h>
+#include <pxr/usd/sdf/types.h>
+#include <pxr/usd/usd/attribute.h>
+#include <pxr/usd/usd/prim.h>
+#include <pxr/usd/usdGeom/boundable.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/primvarsAPI.h>
+#include <pxr/usd/usdGeom/tokens.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+// This file is paired with the Stage Validator sample and holds its rules.
+//
+// A rule checks one prim (or one layer) at a time and only reads the stage, so the
+// validator can run every rule on every prim in parallel. The mesh rules share one
+// read of the mesh topology through the RuleContext.
+///////////////////////////////////////////////////////////////////////////////////////
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+enum class Severity
+{
+    eWarning,
+    eError,
+};
+
+static const char* severityName(Severity severity)
+{
+    return severity == Severity::eError ? "Error" : "Warning";
+}
+
+struct Issue
+{
+    Severity severity;
+    const char* rule;
+    std::string location;
+    std::string message;
+};
+
+// The topology of a mesh, read once for all of the mesh rules
+struct MeshTopology
+{
+    VtVec3fArray points;
+    VtIntArray faceVertexCounts;
+    VtIntArray faceVertexIndices;
+    size_t cornerCount = 0;
+    bool indicesInRange = true;
+};
+
+// What a rule sees of the prim it checks, and where it reports what it found
+class RuleContext
+{
+public:
+
+    RuleContext(const UsdPrim& prim, std::vector<Issue>& issues) : mPrim(prim), mIssues(issues)
+    {
+    }
+
+    const UsdPrim& prim() const
+    {
+        return mPrim;
+    }
+
+    // Animated data is checked at its first time sample
+    const MeshTopology& mesh()
+    {
+        if (!mMeshLoaded)
+        {
+            mMeshLoaded = true;
+            UsdGeomMesh mesh(mPrim);
+            mesh.GetPointsAttr().Get(&mMesh.points, UsdTimeCode::EarliestTime());
+            mesh.GetFaceVertexCountsAttr().Get(&mMesh.faceVertexCounts, UsdTimeCode::EarliestTime());
+            mesh.GetFaceVertexIndicesAttr().Get(&mMesh.faceVertexIndices, UsdTimeCode::EarliestTime());
+            for (int count : mMesh.faceVertexCounts)
+            {
+                mMesh.cornerCount += (size_t)std::max(count, 0);
+            }
+            for (int index : mMesh.faceVertexIndices)
+            {
+                mMesh.indicesInRange = mMesh.indicesInRange && index >= 0 && (size_t)index < mMesh.points.size();
+            }
+        }
+        return mMesh;
+    }
+
+    void report(Severity severity, const char* rule, const std::string& message)
+    {
+        mIssues.push_back({ severity, rule, mPrim.GetPath().GetString(), message });
+    }
+
+private:
+
+    UsdPrim mPrim;
+    std::vector<Issue>& mIssues;
+    MeshTopology mMesh;
+    bool mMeshLoaded = false;
+};
+
+// "3 faces (0, 5, 9)": a count and the first few offending elements
+static std::string describeElements(const char* noun, const std::vector<size_t>& elements)
+{
+    std::string text = TfStringPrintf("%zu %s (", elements.size(), noun);
+    const size_t shown = std::min<size_t>(elements.size(), 5);
+    for (size_t i = 0; i < shown; i++)
+    {
+        text += (i ? ", " : "") + std::to_string(elements[i]);
+    }
+    return text + (elements.size() > shown ? ", ...)" : ")");
+}
+
+static void checkIndexBounds(RuleContext& context, const char* rule)
+{
+    const MeshTopology& mesh = context.mesh();
+    if (mesh.indicesInRange)
+    {
+        return;
+    }
+    std::vector<size_t> bad;
+    for (size_t i = 0; i < mesh.faceVertexIndices.size(); i++)
+    {
+        const int index = mesh.faceVertexIndices[i];
+        if (index < 0 || (size_t)index >= mesh.points.size())
+        {
+            bad.push_back(i);
+        }
+    }
+    context.report(
+        Severity::eError,
+        rule,
+        "faceVertexIndices has " + describeElements("indices", bad) + " outside of the " + std::to_string(mesh.points.size()) + " points"
+    );
+}
+
+static void checkFaceCounts(RuleContext& context, const char* rule)
+{
+    const MeshTopology& mesh = context.mesh();
+    if (mesh.cornerCount != mesh.faceVertexIndices.size())
+    {
+        context.report(
+            Severity::eError,
+            rule,
+            TfStringPrintf(
+                "faceVertexCounts adds up to %zu corners but faceVertexIndices has %zu",
+                mesh.cornerCount,
+                mesh.faceVertexIndices.size()
+            )
+        );
+    }
+    std::vector<size_t> bad;
+    for (size_t f = 0; f < mesh.faceVertexCounts.size(); f++)
+    {
+        if (mesh.faceVertexCounts[f] < 3)
+        {
+            bad.push_back(f);
+        }
+    }
+    if (!bad.empty())
+    {
+        context.report(Severity::eError, rule, "faceVertexCounts has " + describeElements("faces", bad) + " with fewer than 3 vertices");
+    }
+}
+
+// The number of elements a primvar of this interpolation must have on the mesh, 0 if it is not tied to the topology.
+// Constant array primvars are left out as they are often used for lists of any length.
+static size_t expectedPrimvarSize(const MeshTopology& mesh, const TfToken& interpolation)
+{
+    if (interpolation == UsdGeomTokens->uniform)
+    {
+        return mesh.faceVertexCounts.size();
+    }
+    if (interpolation == UsdGeomTokens->vertex || interpolation == UsdGeomTokens->varying)
+    {
+        return mesh.points.size();
+    }
+    if (interpolation == UsdGeomTokens->faceVarying)
+    {
+        return mesh.faceVertexIndices.size();
+    }
+    return 0;
+}
+
+static void checkPrimvarSizes(RuleContext& context, const char* rule)
+{
+    const MeshTopology& mesh = context.mesh();
+    UsdGeomMesh usdMesh(context.prim());
+    for (const UsdGeomPrimvar& primvar : UsdGeomPrimvarsAPI(context.prim()).GetAuthoredPrimvars())
+    {
+        const TfToken interpolation = primvar.GetInterpolation();
+        const size_t expected = expectedPrimvarSize(mesh, interpolation) * (size_t)std::max(primvar.GetElementSize(), 1);
+        VtValue value;
+        if (expected == 0 || !primvar.Get(&value, UsdTimeCode::EarliestTime()) || !value.IsArrayValued())
+        {
+            continue;
+        }
+        VtIntArray indices;
+        const std::string name = primvar.GetPrimvarName().GetString();
+        if (primvar.GetIndices(&indices, UsdTimeCode::EarliestTime()))
+        {
+            std::vector<size_t> bad;
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                if (indices[i] < 0 || (size_t)indices[i] >= value.GetArraySize())
+                {
+                    bad.push_back(i);
+                }
+            }
+            if (!bad.empty())
+            {
+                context.report(Severity::eError, rule, "primvar " + name + " has " + describeElements("indices", bad) + " outside of its values");
+            }
+            if (indices.size() != expected)
+            {
+                context.report(
+                    Severity::eError,
+                    rule,
+                    TfStringPrintf("indexed %s primvar %s has %zu indices, expected %zu", interpolation.GetText(), name.c_str(), indices.size(), expected)
+                );
+            }
+        }
+        else if (value.GetArraySize() != expected)
+        {
+            context.report(
+                Severity::eError,
+                rule,
+                TfStringPrintf("%s primvar %s has %zu values, expected %zu", interpolation.GetText(), name.c_str(), value.GetArraySize(), expected)
+            );
+        }
+    }
+
+    VtVec3fArray normals;
+    if (usdMesh.GetNormalsAttr().Get(&normals, UsdTimeCode::EarliestTime()))
+    {
+        const TfToken interpolation = usdMesh.GetNormalsInterpolation();
+        const size_t expected = expectedPrimvarSize(mesh, interpolation);
+        if (expected != 0 && normals.size() != expected)
+        {
+            context.report(
+                Severity::eError,
+                rule,
+                TfStringPrintf("%s normals has %zu values, expected %zu", interpolation.GetText(), normals.size(), expected)
+            );
+        }
+    }
+}
+
+// Faces that repeat a point or have no area render as nothing and break normal and tangent generation
+static void checkDegenerateFaces(RuleContext& context, const char* rule)
+{
+    const MeshTopology& mesh = context.mesh();
+    if (!mesh.indicesInRange || mesh.cornerCount != mesh.faceVertexIndices.size())
+    {
+        // The topology rules report these meshes
+        return;
+    }
+    GfRange3f bounds;
+    for (const GfVec3f& point : mesh.points)
+    {
+        bounds.UnionWith(point);
+    }
+    // Areas below this fraction of the mesh size squared are rounding noise
+    const float size = bounds.IsEmpty() ? 0.0f : bounds.GetSize().GetLength();
+    const float minArea = size * size * 1e-12f;
+
+    std::vector<size_t> bad;
+    size_t corner = 0;
+    for (size_t f = 0; f < mesh.faceVertexCounts.size(); f++)
+    {
+        const int count = mesh.faceVertexCounts[f];
+        const int* corners = mesh.faceVertexIndices.cdata() + corner;
+        corner += (size_t)std::max(count, 0);
+        if (count < 3)
+        {
+            continue;
+        }
+        bool repeated = false;
+        GfVec3f normal(0.0f);
+        const GfVec3f& a = mesh.points[corners[0]];
+        for (int k = 0; k < count && !repeated; k++)
+        {
+            repeated = corners[k] == corners[(k + 1) % count];
+            if (k > 0 && k + 1 < count)
+            {
+                normal += GfCross(mesh.points[corners[k]] - a, mesh.points[corners[k + 1]] - a);
+            }
+        }
+        if (repeated || normal.GetLength() * 0.5f <= minArea)
+        {
+            bad.push_back(f);
+        }
+    }
+    if (!bad.empty())
+    {
+        context.report(Severity::eWarning, rule, "has " + describeElements("degenerate faces", bad) + " with repeated points or no area");
+    }
+}
+
+static void checkExtent(RuleContext& context, const char* rule)
+{
+    UsdGeomBoundable boundable(context.prim());
+    VtVec3fArray computed;
+    if (!UsdGeomBoundable::ComputeExtentFromPlugins(boundable, UsdTimeCode::EarliestTime(), &computed) || computed.size() != 2)
+    {
+        // Types without an extent computation (or without geometry) cannot be checked
+        return;
+    }
+    VtVec3fArray authored;
+    if (!boundable.GetExtentAttr().Get(&authored, UsdTimeCode::EarliestTime()))
+    {
+        context.report(Severity::eWarning, rule, "has no authored extent");
+        return;
+    }
+    if (authored.size() != 2)
+    {
+        context.report(Severity::eError, rule, TfStringPrintf("extent has %zu values, expected 2", authored.size()));
+        return;
+    }
+    const float tolerance = 1e-4f * (computed[1] - computed[0]).GetLength() + 1e-6f;
+    bool contains = true;
+    bool tight = true;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        contains = contains && authored[0][axis] <= computed[0][axis] + tolerance && authored[1][axis] >= computed[1][axis] - tolerance;
+        tight = tight && std::abs(authored[0][axis] - computed[0][axis]) <= tolerance && std::abs(authored[1][axis] - computed[1][axis]) <= tolerance;
+    }
+    if (!contains || !tight)
+    {
+        context.report(
+            contains ? Severity::eWarning : Severity::eError,
+            rule,
+            TfStringPrintf(
+                "authored extent [(%g, %g, %g), (%g, %g, %g)] %s the computed extent [(%g, %g, %g), (%g, %g, %g)]",
+                authored[0][0],
+                authored[0][1],
+                authored[0][2],
+                authored[1][0],
+                authored[1][1],
+                authored[1][2],
+                contains ? "is larger than" : "does not contain",
+                computed[0][0],
+                computed[0][1],
+                computed[0][2],
+                computed[1][0],
+                computed[1][1],
+                computed[1][2]
+            )
+        );
+    }
+}
+
+// MDL modules such as "OmniPBR.mdl" are found on the renderer's MDL search paths rather than by the asset resolver
+static bool isMdlSearchPath(const UsdAttribute& attr, const std::string& assetPath)
+{
+    return TfStringEndsWith(attr.GetName().GetString(), ":sourceAsset") && assetPath.find_first_of("/\\:") == std::string::npos;
+}
+
+static void checkAttributeAssetPaths(RuleContext& context, const char* rule)
+{
+    for (const UsdAttribute& attr : context.prim().GetAuthoredAttributes())
+    {
+        const SdfValueTypeName typeName = attr.GetTypeName();
+        if (typeName != SdfValueTypeNames->Asset && typeName != SdfValueTypeNames->AssetArray)
+        {
+            continue;
+        }
+        // Usd resolves asset valued attributes as it reads them
+        VtArray<SdfAssetPath> paths;
+        SdfAssetPath path;
+        if (typeName == SdfValueTypeNames->Asset && attr.Get(&path, UsdTimeCode::EarliestTime()))
+        {
+            paths.push_back(path);
+        }
+        else
+        {
+            attr.Get(&paths, UsdTimeCode::EarliestTime());
+        }
+        for (const SdfAssetPath& assetPath : paths)
+        {
+            if (!assetPath.GetAssetPath().empty() && assetPath.GetResolvedPath().empty() && !isMdlSearchPath(attr, assetPath.GetAssetPath()))
+            {
+                context.report(Severity::eError, rule, attr.GetName().GetString() + " has unresolvable asset path @" + assetPath.GetAssetPath() + "@");
+            }
+        }
+    }
+}
+
+// Sublayers, references and payloads whose layers cannot be found
+static void checkLayerAssetPaths(const SdfLayerHandle& layer, const char* rule, std::vector<Issue>& issues)
+{
+    for (const std::string& dependency : layer->GetCompositionAssetDependencies())
+    {
+        const std::string anchored = SdfComputeAssetPathRelativeToLayer(layer, dependency);
+        if (!ArGetResolver().Resolve(anchored))
+        {
+            issues.push_back({ Severity::eError, rule, layer->GetIdentifier(), "composition arc points at unresolvable layer @" + dependency + "@" });
+        }
+    }
+}
+
+// What a rule runs on
+enum class RuleTarget
+{
+    eMeshes,
+    eBoundables,
+    ePrims,
+    eLayers,
+};
+
+struct Rule
+{
+    const char* id;
+    RuleTarget target;
+    const char* description;
+    void (*checkPrim)(RuleContext& context, const char* rule);
+    void (*checkLayer)(const SdfLayerHandle& layer, const char* rule, std::vector<Issue>& issues);
+};
+
+// clang-format off
+static const Rule gRules[] = {
+    { "mesh-index-bounds", RuleTarget::eMeshes, "faceVertexIndices must index the mesh's points", checkIndexBounds, nullptr },
+    { "mesh-face-counts", RuleTarget::eMeshes, "faceVertexCounts must have 3 or more vertices per face and add up to the number of faceVertexIndices", checkFaceCounts, nullptr },
+    { "primvar-sizes", RuleTarget::eMeshes, "primvars, their indices and normals must have as many elements as their interpolation needs", checkPrimvarSizes, nullptr },
+    { "degenerate-faces", RuleTarget::eMeshes, "faces should not repeat a point or have no area", checkDegenerateFaces, nullptr },
+    { "extents", RuleTarget::eBoundables, "boundable prims should author an extent that matches their geometry", checkExtent, nullptr },
+    { "asset-paths", RuleTarget::ePrims, "asset valued attributes must resolve", checkAttributeAssetPaths, nullptr },
+    { "layer-asset-paths", RuleTarget::eLayers, "sublayers, references and payloads must resolve", nullptr, checkLayerAssetPaths },
+};
+// clang-format on
+
+static bool ruleAppliesTo(const Rule& rule, const UsdPrim& prim)
+{
+    switch (rule.target)
+    {
+        case RuleTarget::eMeshes:
+            return prim.IsA<UsdGeomMesh>();
+        case RuleTarget::eBoundables:
+            return prim.IsA<UsdGeomBoundable>();
+        case RuleTarget::ePrims:
+            return true;
+        default:
+            return false;
+    }
+}
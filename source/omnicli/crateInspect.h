@@ -0,0 +1,458 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <pxr/pxr.h>
+#include <pxr/base/tf/fastCompression.h>
+
+#include <algorithm>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/*
+Reads the parts of a binary (usdc "crate") layer that describe it, without parsing the layer:
+
+* The bootstrap header at offset 0: "PXR-USDC", the file format version and the table of contents offset.
+* The table of contents: a count followed by { char name[16]; int64 start; int64 size; } entries.
+* The first 8 bytes of each section, which hold the token, string, field, field set, path and spec counts.
+* The FIELDS section (version 0.4.0+), which is decompressed to find every array-valued field and its
+    out-of-line payload offset. Only the 8 byte element count at each offset is read.
+
+Everything else in the file (the value data) is never touched, so when the file is memory mapped only a few pages
+are read from disk regardless of the layer size.
+*/
+namespace crate
+{
+
+struct Section
+{
+    char name[16];
+    int64_t start;
+    int64_t size;
+};
+
+struct ArrayField
+{
+    std::string name;
+    uint8_t type;
+    uint64_t count;
+    uint64_t offset;
+    bool compressed;
+};
+
+// Element sizes indexed by the crate TypeEnum, 0 for types that are never stored as plain arrays
+static const uint8_t kElementSize[] = {
+    0,
+    1, 1, 4, 4, 8, 8, 2, 4, 8,              // Bool, UChar, Int, UInt, Int64, UInt64, Half, Float, Double
+    4, 4, 4,                                // String, Token, AssetPath (stored as indices)
+    32, 72, 128,                            // Matrix2d, Matrix3d, Matrix4d
+    32, 16, 8,                              // Quatd, Quatf, Quath
+    16, 8, 4, 8, 24, 12, 6, 12, 32, 16, 8, 16, // Vec2d/f/h/i, Vec3d/f/h/i, Vec4d/f/h/i
+};
+
+static const char* const kTypeNames[] = {
+    "Invalid", "bool", "uchar", "int", "uint", "int64", "uint64", "half", "float", "double", "string", "token", "asset",
+    "matrix2d", "matrix3d", "matrix4d", "quatd", "quatf", "quath", "double2", "float2", "half2", "int2", "double3", "float3",
+    "half3", "int3", "double4", "float4", "half4", "int4",
+};
+
+inline const char* typeName(uint8_t type)
+{
+    return type < sizeof(kTypeNames) / sizeof(kTypeNames[0]) ? kTypeNames[type] : "other";
+}
+
+inline uint64_t elementSize(uint8_t type)
+{
+    return type < sizeof(kElementSize) ? kElementSize[type] : 0;
+}
+
+// A bounds-checked cursor over the mapped file
+class Reader
+{
+public:
+    Reader(uint8_t const* data, size_t size)
+        : m_data(data), m_size(size)
+    {
+    }
+
+    bool seek(uint64_t offset)
+    {
+        m_pos = offset;
+        return offset <= m_size;
+    }
+
+    uint64_t tell() const
+    {
+        return m_pos;
+    }
+
+    template<class T>
+    bool read(T& value)
+    {
+        return readBytes(&value, sizeof(T));
+    }
+
+    bool readBytes(void* out, size_t count)
+    {
+        if (m_pos > m_size || m_size - m_pos < count)
+        {
+            return false;
+        }
+        memcpy(out, m_data + m_pos, count);
+        m_pos += count;
+        return true;
+    }
+
+    uint8_t const* at(uint64_t offset, size_t count) const
+    {
+        return (offset <= m_size && m_size - offset >= count) ? m_data + offset : nullptr;
+    }
+
+private:
+    uint8_t const* m_data;
+    size_t m_size;
+    uint64_t m_pos = 0;
+};
+
+// LZ4 blocks written by TfFastCompression, preceded by the uint64 compressed size
+inline bool readCompressedBlock(Reader& reader, std::vector<char>& out, size_t uncompressedSize)
+{
+    uint64_t compressedSize = 0;
+    if (!reader.read(compressedSize))
+    {
+        return false;
+    }
+    uint8_t const* src = reader.at(reader.tell(), compressedSize);
+    if (!src)
+    {
+        return false;
+    }
+    out.resize(uncompressedSize);
+    size_t decompressed = PXR_NS::TfFastCompression::DecompressFromBuffer((char const*)src, out.data(), compressedSize, uncompressedSize);
+    reader.seek(reader.tell() + compressedSize);
+    return decompressed == uncompressedSize;
+}
+
+// Integers are delta-encoded with 2-bit width codes (common value, int8, int16, int32) and then LZ4 compressed
+inline bool readCompressedInts(Reader& reader, std::vector<uint32_t>& out, size_t count)
+{
+    size_t codesBytes = (count * 2 + 7) / 8;
+    std::vector<char> decoded;
+    uint64_t compressedSize = 0;
+    if (!reader.read(compressedSize))
+    {
+        return false;
+    }
+    uint8_t const* src = reader.at(reader.tell(), compressedSize);
+    if (!src)
+    {
+        return false;
+    }
+    decoded.resize(sizeof(int32_t) + codesBytes + count * sizeof(int32_t));
+    size_t decodedSize = PXR_NS::TfFastCompression::DecompressFromBuffer((char const*)src, decoded.data(), compressedSize, decoded.size());
+    reader.seek(reader.tell() + compressedSize);
+    if (decodedSize < sizeof(int32_t) + codesBytes)
+    {
+        return false;
+    }
+
+    int32_t common;
+    memcpy(&common, decoded.data(), sizeof(common));
+    char const* codes = decoded.data() + sizeof(int32_t);
+    char const* vints = codes + codesBytes;
+    char const* vintsEnd = decoded.data() + decodedSize;
+    out.resize(count);
+    int32_t prev = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        int code = ((uint8_t)codes[i / 4] >> (2 * (i % 4))) & 3;
+        int32_t delta = common;
+        if (code == 1)
+        {
+            int8_t v;
+            if (vints + sizeof(v) > vintsEnd)
+            {
+                return false;
+            }
+            memcpy(&v, vints, sizeof(v));
+            vints += sizeof(v);
+            delta = v;
+        }
+        else if (code == 2)
+        {
+            int16_t v;
+            if (vints + sizeof(v) > vintsEnd)
+            {
+                return false;
+            }
+            memcpy(&v, vints, sizeof(v));
+            vints += sizeof(v);
+            delta = v;
+        }
+        else if (code == 3)
+        {
+            int32_t v;
+            if (vints + sizeof(v) > vintsEnd)
+            {
+                return false;
+            }
+            memcpy(&v, vints, sizeof(v));
+            vints += sizeof(v);
+            delta = v;
+        }
+        prev += delta;
+        out[i] = (uint32_t)prev;
+    }
+    return true;
+}
+
+inline bool versionAtLeast(uint8_t const version[3], int major, int minor)
+{
+    return version[0] > major || (version[0] == major && version[1] >= minor);
+}
+
+inline bool readTokens(Reader& reader, uint8_t const version[3], std::vector<std::string>& tokens)
+{
+    uint64_t numTokens = 0;
+    if (!reader.read(numTokens))
+    {
+        return false;
+    }
+    std::vector<char> chars;
+    if (versionAtLeast(version, 0, 4))
+    {
+        uint64_t uncompressedSize = 0;
+        if (!reader.read(uncompressedSize) || !readCompressedBlock(reader, chars, uncompressedSize))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        uint64_t numBytes = 0;
+        if (!reader.read(numBytes))
+        {
+            return false;
+        }
+        chars.resize(numBytes);
+        if (!reader.readBytes(chars.data(), numBytes))
+        {
+            return false;
+        }
+    }
+    tokens.clear();
+    tokens.reserve(numTokens);
+    for (char const *p = chars.data(), *end = chars.data() + chars.size(); p < end && tokens.size() < numTokens;)
+    {
+        size_t len = strnlen(p, end - p);
+        tokens.emplace_back(p, len);
+        p += len + 1;
+    }
+    return tokens.size() == numTokens;
+}
+
+inline bool readArrayFields(
+    Reader& reader,
+    uint8_t const version[3],
+    std::vector<std::string> const& tokens,
+    std::vector<ArrayField>& arrays)
+{
+    uint64_t numFields = 0;
+    if (!reader.read(numFields))
+    {
+        return false;
+    }
+    std::vector<uint32_t> tokenIndices;
+    if (!readCompressedInts(reader, tokenIndices, numFields))
+    {
+        return false;
+    }
+    std::vector<char> repBytes;
+    if (!readCompressedBlock(reader, repBytes, numFields * sizeof(uint64_t)))
+    {
+        return false;
+    }
+
+    uint64_t const kIsArray = 1ull << 63;
+    uint64_t const kIsInlined = 1ull << 62;
+    uint64_t const kIsCompressed = 1ull << 61;
+    uint64_t const kPayloadMask = (1ull << 48) - 1;
+    for (uint64_t i = 0; i < numFields; i++)
+    {
+        uint64_t rep;
+        memcpy(&rep, repBytes.data() + i * sizeof(rep), sizeof(rep));
+        if (!(rep & kIsArray) || (rep & kIsInlined))
+        {
+            continue;
+        }
+        ArrayField field;
+        field.name = tokenIndices[i] < tokens.size() ? tokens[tokenIndices[i]] : std::string("<bad token>");
+        field.type = (uint8_t)((rep >> 48) & 0xFF);
+        field.offset = rep & kPayloadMask;
+        field.compressed = (rep & kIsCompressed) != 0;
+        field.count = 0;
+
+        // An empty array has a zero payload, otherwise the element count leads the data
+        // (preceded by a uint32 shape rank before 0.5.0, and only 32 bits wide before 0.7.0)
+        if (field.offset != 0)
+        {
+            uint64_t countOffset = field.offset + (versionAtLeast(version, 0, 5) ? 0 : sizeof(uint32_t));
+            if (versionAtLeast(version, 0, 7))
+            {
+                uint8_t const* p = reader.at(countOffset, sizeof(uint64_t));
+                if (p)
+                {
+                    memcpy(&field.count, p, sizeof(uint64_t));
+                }
+            }
+            else
+            {
+                uint8_t const* p = reader.at(countOffset, sizeof(uint32_t));
+                uint32_t count32 = 0;
+                if (p)
+                {
+                    memcpy(&count32, p, sizeof(uint32_t));
+                }
+                field.count = count32;
+            }
+        }
+        arrays.push_back(std::move(field));
+    }
+    return true;
+}
+
+inline void printSize(char const* label, uint64_t bytes)
+{
+    if (bytes > 1000 * 1000)
+    {
+        printf("%s%.2f MB\n", label, bytes / (1000.0 * 1000.0));
+    }
+    else if (bytes > 1000)
+    {
+        printf("%s%.2f KB\n", label, bytes / 1000.0);
+    }
+    else
+    {
+        printf("%s%" PRIu64 " B\n", label, bytes);
+    }
+}
+
+// Print the crate summary, returns false if the buffer is not a readable crate file
+inline bool inspect(uint8_t const* data, size_t size, size_t maxArrays)
+{
+    Reader reader(data, size);
+    char ident[8];
+    uint8_t version[8];
+    int64_t tocOffset = 0;
+    if (!reader.readBytes(ident, sizeof(ident)) || memcmp(ident, "PXR-USDC", sizeof(ident)) != 0)
+    {
+        printf("Not a usdc (crate) file\n");
+        return false;
+    }
+    if (!reader.readBytes(version, sizeof(version)) || !reader.read(tocOffset) || !reader.seek((uint64_t)tocOffset))
+    {
+        printf("Truncated crate bootstrap header\n");
+        return false;
+    }
+
+    uint64_t numSections = 0;
+    if (!reader.read(numSections) || numSections > 64)
+    {
+        printf("Invalid crate table of contents\n");
+        return false;
+    }
+    std::vector<Section> sections(numSections);
+    for (auto&& section : sections)
+    {
+        if (!reader.read(section))
+        {
+            printf("Truncated crate table of contents\n");
+            return false;
+        }
+        section.name[sizeof(section.name) - 1] = '\0';
+    }
+
+    printf("Version: %d.%d.%d\n", version[0], version[1], version[2]);
+    printSize("File size: ", size);
+    int64_t firstSection = tocOffset;
+    for (auto&& section : sections)
+    {
+        firstSection = std::min(firstSection, section.start);
+    }
+    printSize("Value data: ", (uint64_t)std::max<int64_t>(0, firstSection - 88));
+
+    printf("Sections:\n");
+    Section const* tokensSection = nullptr;
+    Section const* fieldsSection = nullptr;
+    for (auto&& section : sections)
+    {
+        uint64_t count = 0;
+        uint8_t const* p = reader.at((uint64_t)section.start, sizeof(count));
+        if (p)
+        {
+            memcpy(&count, p, sizeof(count));
+        }
+        printf("  %-10s offset %12" PRId64 "  size %12" PRId64 "  count %12" PRIu64 "\n", section.name, section.start, section.size, count);
+        if (strcmp(section.name, "TOKENS") == 0)
+        {
+            tokensSection = &section;
+        }
+        else if (strcmp(section.name, "FIELDS") == 0)
+        {
+            fieldsSection = &section;
+        }
+    }
+
+    if (maxArrays == 0 || !tokensSection || !fieldsSection)
+    {
+        return true;
+    }
+    if (!versionAtLeast(version, 0, 4))
+    {
+        printf("Array summary requires crate version 0.4.0 or newer\n");
+        return true;
+    }
+
+    std::vector<std::string> tokens;
+    std::vector<ArrayField> arrays;
+    reader.seek((uint64_t)tokensSection->start);
+    if (!readTokens(reader, version, tokens))
+    {
+        printf("Unable to read the TOKENS section\n");
+        return false;
+    }
+    reader.seek((uint64_t)fieldsSection->start);
+    if (!readArrayFields(reader, version, tokens, arrays))
+    {
+        printf("Unable to read the FIELDS section\n");
+        return false;
+    }
+
+    // Deduplicated identical values share a field, so each entry is one stored array
+    auto bytesOf = [](ArrayField const& f)
+    {
+        return f.count * elementSize(f.type);
+    };
+    size_t shown = std::min(maxArrays, arrays.size());
+    std::partial_sort(arrays.begin(), arrays.begin() + shown, arrays.end(),
+        [&bytesOf](ArrayField const& a, ArrayField const& b)
+        {
+            return bytesOf(a) != bytesOf(b) ? bytesOf(a) > bytesOf(b) : a.count > b.count;
+        });
+    printf("Largest value arrays (%zu of %zu array fields):\n", shown, arrays.size());
+    for (size_t i = 0; i < shown; i++)
+    {
+        auto const& f = arrays[i];
+        printf("  %-32s %-9s[%12" PRIu64 "]  ~%12" PRIu64 " bytes  at %12" PRIu64 "%s\n", f.name.c_str(), typeName(f.type), f.count, bytesOf(f), f.offset,
+            f.compressed ? "  (compressed)" : "");
+    }
+    return true;
+}
+
+}  // namespace crate
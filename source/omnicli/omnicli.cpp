@@ -4,6 +4,16 @@
 
 #define __STDC_FORMAT_MACROS 1
 #define _CRT_NONSTDC_NO_WARNINGS
+#include "ChildNameAllocator.h"
+#include "MappedFile.h"
+#include "ParallelSave.h"
+#include "TransformWriter.h"
+#include "crateInspect.h"
+#include "primIndex.h"
+
+#include <omni/connect/core/PrimAlgo.h>
+#include <omni/connect/core/XformAlgo.h>
+
 #include <OmniClient.h>
 #include <OmniUsdResolver.h>
 #include <ctype.h>
@@ -14,12 +24,17 @@
 #include <string.h>
 #include <time.h>
 #include <algorithm>
+#include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <pxr/pxr.h>
+#include <pxr/base/gf/transform.h>
+#include <pxr/base/tf/stringUtils.h>
 #include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/xform.h>
 
 static const int MAX_URL_SIZE = 2048;
 
@@ -28,6 +43,7 @@ bool g_haveUpdates = false;
 std::mutex g_mutex;
 std::condition_variable g_cv;
 PXR_NS::UsdStageRefPtr g_stage;
+std::unique_ptr<PrimIndex> g_primIndex;
 OmniClientRequestId g_channel = 0;
 
 template<class Mutex>
@@ -605,7 +621,7 @@ int cat(ArgVec const& args)
             }
             if (content->size > 1 * 1000 * 1000)
             {
-                printf("File too large to cat: %zu bytes.\n", content->size);
+                printf("File too large to cat: %zu bytes. Use inspect for usdc files.\n", content->size);
                 return;
             }
             bool isAscii = true;
@@ -639,6 +655,52 @@ int cat(ArgVec const& args)
     return retCode;
 }
 
+int inspect(ArgVec const& args)
+{
+    if (args.size() <= 1)
+    {
+        printf("Not enough arguments\n");
+        return EXIT_FAILURE;
+    }
+    size_t maxArrays = 10;
+    if (args.size() > 2)
+    {
+        maxArrays = strtoul(args[2].data(), nullptr, 10);
+    }
+
+    // Local files map directly, remote files map the client library's cached copy
+    struct LocalFileResult
+    {
+        OmniClientResult result;
+        std::string path;
+    };
+    LocalFileResult localFile{ eOmniClientResult_Error, std::string() };
+    omniClientReconnect(args[1].data());
+    omniClientWait(omniClientGetLocalFile(args[1].data(), true, &localFile,
+        [](void* userData, OmniClientResult result, char const* localFilePath) noexcept
+        {
+            auto& localFileRef = *(LocalFileResult*)userData;
+            localFileRef.result = result;
+            if (localFilePath)
+            {
+                localFileRef.path = localFilePath;
+            }
+        }));
+    if (localFile.result != eOmniClientResult_Ok)
+    {
+        printResult(localFile.result);
+        return EXIT_FAILURE;
+    }
+
+    MappedFile file;
+    if (!file.open(localFile.path))
+    {
+        printf("Unable to map %s\n", localFile.path.c_str());
+        return EXIT_FAILURE;
+    }
+    return crate::inspect(file.data(), file.size(), maxArrays) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int clientVersion(ArgVec const&)
 {
     printf("%s\n", omniClientGetVersionString());
@@ -687,11 +749,14 @@ int loadUsd(ArgVec const& args)
         return EXIT_FAILURE;
     }
     auto lock = make_lock(g_mutex);
+    g_primIndex.reset();
     g_stage = PXR_NS::UsdStage::Open(args[1].data());
     if (!g_stage)
     {
         return EXIT_FAILURE;
     }
+    // The indexes are built by the first query, not here, so loading stays as fast as before
+    g_primIndex = std::make_unique<PrimIndex>(g_stage);
     return EXIT_SUCCESS;
 }
 
@@ -707,7 +772,17 @@ int saveUsd(ArgVec const& args)
     errorMark.SetMark();
     if (args.size() <= 1)
     {
-        g_stage->Save();
+        // The dirty layers are saved concurrently, slowest first in the report
+        const parallelsave::SaveReport report = parallelsave::saveDirtyLayers(g_stage);
+        for (const parallelsave::LayerTiming& layer : report.layers)
+        {
+            printf("  %8.1f ms  %s%s\n", layer.milliseconds, layer.identifier.c_str(), layer.saved ? "" : " (failed)");
+        }
+        printf("Saved %zu layers in %.1f ms (%.1f ms summed per-layer time)\n", report.layers.size(), report.totalMs, report.summedMs());
+        if (!report.ok())
+        {
+            return EXIT_FAILURE;
+        }
     }
     else if (!g_stage->Export(args[1].data()))
     {
@@ -727,10 +802,217 @@ int closeUsd(ArgVec const&)
         printf("No USD loaded\n");
         return EXIT_FAILURE;
     }
+    auto lock = make_lock(g_mutex);
+    g_primIndex.reset();
     g_stage = nullptr;
     return EXIT_SUCCESS;
 }
 
+int queryUsd(ArgVec const& args)
+{
+    if (!g_stage)
+    {
+        printf("No USD loaded\n");
+        return EXIT_FAILURE;
+    }
+    PrimIndex::Query query;
+    std::string under;
+    bool countOnly = false;
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        std::string const& arg = args[i];
+        auto eq = arg.find('=');
+        std::string key = (eq == std::string::npos) ? arg : arg.substr(0, eq);
+        std::string value = (eq == std::string::npos) ? std::string() : arg.substr(eq + 1);
+        if (!arg.empty() && arg[0] == '/')
+        {
+            under = arg;
+        }
+        else if (iequal(key, "under") && !value.empty())
+        {
+            under = value;
+        }
+        else if (iequal(key, "type") && !value.empty())
+        {
+            query.typeName = PXR_NS::TfToken(value);
+        }
+        else if (iequal(key, "kind") && !value.empty())
+        {
+            query.kind = PXR_NS::TfToken(value);
+        }
+        else if (iequal(key, "api") && !value.empty())
+        {
+            query.apiSchemas.emplace_back(value);
+        }
+        else if (iequal(key, "bound"))
+        {
+            query.materialBound = true;
+        }
+        else if (iequal(key, "count"))
+        {
+            countOnly = true;
+        }
+        else
+        {
+            printf("Unknown query filter \"%s\"\n", arg.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+    if (!under.empty())
+    {
+        query.under = PXR_NS::SdfPath(under);
+        if (query.under.IsEmpty() || !query.under.IsAbsolutePath() || !query.under.IsAbsoluteRootOrPrimPath())
+        {
+            printf("Invalid prim path \"%s\"\n", under.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto lock = make_lock(g_mutex);
+    bool rebuilt = g_primIndex->isStale();
+    std::vector<PXR_NS::SdfPath> results;
+    auto start = std::chrono::steady_clock::now();
+    if (!g_primIndex->run(query, results))
+    {
+        printf("No prim at %s\n", query.under.GetText());
+        return EXIT_FAILURE;
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    if (!countOnly)
+    {
+        for (auto&& path : results)
+        {
+            printf("%s\n", path.GetText());
+        }
+    }
+    printf("%zu prims (%.3f ms%s)\n", results.size(), elapsed.count(), rebuilt ? ", indexes rebuilt" : "");
+    return EXIT_SUCCESS;
+}
+
+// Time naming `count` siblings under one parent with getValidChildNames per prim and with a ChildNameAllocator, at a
+// quarter, half and all of `count`, so the quadratic and linear scaling show side by side
+int nameBench(ArgVec const& args)
+{
+    const long count = args.size() > 1 ? std::max(4L, strtol(args[1].data(), nullptr, 10)) : 20000;
+    const std::string baseName = "Prim";
+    printf("%10s %22s %22s\n", "siblings", "getValidChildNames", "ChildNameAllocator");
+    for (long siblings : { count / 4, count / 2, count })
+    {
+        double elapsedMs[2] = { 0.0, 0.0 };
+        for (int mode = 0; mode < 2; mode++)
+        {
+            PXR_NS::UsdStageRefPtr stage = PXR_NS::UsdStage::CreateInMemory();
+            PXR_NS::UsdPrim parent = stage->DefinePrim(PXR_NS::SdfPath("/Parent"));
+            ChildNameAllocator allocator(parent);
+            for (long i = 0; i < siblings; i++)
+            {
+                // Only the naming is timed, defining the prims costs the same either way
+                auto start = std::chrono::steady_clock::now();
+                const PXR_NS::TfToken name = mode == 0 ? omni::connect::core::getValidChildNames(parent, { baseName })[0] : allocator.allocate(baseName);
+                elapsedMs[mode] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                stage->DefinePrim(parent.GetPath().AppendChild(name));
+            }
+        }
+        printf("%10ld %19.1f ms %19.1f ms\n", siblings, elapsedMs[0], elapsedMs[1]);
+    }
+    return EXIT_SUCCESS;
+}
+
+int xformBench(ArgVec const& args)
+{
+    const long count = args.size() > 1 ? std::max(1L, strtol(args[1].data(), nullptr, 10)) : 10000;
+    const long frames = args.size() > 2 ? std::max(1L, strtol(args[2].data(), nullptr, 10)) : 10;
+
+    // The same stage for each writer, with the op stack setLocalTransform authors on every prim
+    auto makeStage = [count](PXR_NS::SdfPathVector& paths)
+    {
+        PXR_NS::UsdStageRefPtr stage = PXR_NS::UsdStage::CreateInMemory();
+        paths.clear();
+        for (long i = 0; i < count; i++)
+        {
+            PXR_NS::UsdGeomXform xform = PXR_NS::UsdGeomXform::Define(stage, PXR_NS::SdfPath(PXR_NS::TfStringPrintf("/Root/Xform_%ld", i)));
+            omni::connect::core::setLocalTransform(xform.GetPrim(), PXR_NS::GfTransform());
+            paths.push_back(xform.GetPath());
+        }
+        return stage;
+    };
+    auto trsAt = [](long i, long frame)
+    {
+        TransformWriter::Trs trs;
+        trs.translate = PXR_NS::GfVec3d((double)i, (double)frame, 0.0);
+        trs.rotate = PXR_NS::GfVec3f(0.0f, (float)(frame * 5 % 360), 0.0f);
+        return trs;
+    };
+
+    PXR_NS::SdfPathVector paths;
+    double setLocalMs = 0.0;
+    {
+        PXR_NS::UsdStageRefPtr stage = makeStage(paths);
+        auto start = std::chrono::steady_clock::now();
+        for (long frame = 0; frame < frames; frame++)
+        {
+            for (long i = 0; i < count; i++)
+            {
+                const TransformWriter::Trs trs = trsAt(i, frame);
+                omni::connect::core::setLocalTransform(
+                    stage->GetPrimAtPath(paths[i]),
+                    trs.translate,
+                    PXR_NS::GfVec3d(0.0),
+                    trs.rotate,
+                    omni::connect::core::RotationOrder::eXyz,
+                    trs.scale
+                );
+            }
+        }
+        setLocalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double trsMs = 0.0;
+    double resolveMs = 0.0;
+    {
+        PXR_NS::UsdStageRefPtr stage = makeStage(paths);
+        auto start = std::chrono::steady_clock::now();
+        TransformWriter writer(stage, paths, TransformWriter::Layout::eTrs);
+        resolveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::vector<TransformWriter::Trs> values(count);
+        start = std::chrono::steady_clock::now();
+        for (long frame = 0; frame < frames; frame++)
+        {
+            for (long i = 0; i < count; i++)
+            {
+                values[i] = trsAt(i, frame);
+            }
+            writer.write(values);
+        }
+        trsMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double matrixMs = 0.0;
+    {
+        PXR_NS::UsdStageRefPtr stage = makeStage(paths);
+        TransformWriter writer(stage, paths, TransformWriter::Layout::eMatrix);
+        std::vector<PXR_NS::GfMatrix4d> matrices(count);
+        auto start = std::chrono::steady_clock::now();
+        for (long frame = 0; frame < frames; frame++)
+        {
+            for (long i = 0; i < count; i++)
+            {
+                matrices[i].SetTranslate(trsAt(i, frame).translate);
+            }
+            writer.write(matrices);
+        }
+        matrixMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const double writes = (double)count * (double)frames;
+    printf("%ld prims x %ld frames\n", count, frames);
+    printf("%-28s %10.1f ms %12.0f prims/s\n", "setLocalTransform", setLocalMs, writes * 1000.0 / std::max(setLocalMs, 1e-3));
+    printf("%-28s %10.1f ms %12.0f prims/s\n", "TransformWriter TRS", trsMs, writes * 1000.0 / std::max(trsMs, 1e-3));
+    printf("%-28s %10.1f ms %12.0f prims/s\n", "TransformWriter matrix", matrixMs, writes * 1000.0 / std::max(matrixMs, 1e-3));
+    printf("%-28s %10.1f ms\n", "TransformWriter resolve once", resolveMs);
+    return EXIT_SUCCESS;
+}
+
 int getacls(ArgVec const& args)
 {
     const char* url = ".";
@@ -1235,12 +1517,16 @@ Command commands[] = {
     { "rm", nullptr, nullptr, del },
     { "mkdir", "<url>", "Create a folder", mkdir },
     { "cat", "<url>", "Print the contents of a file", cat },
+    { "inspect", "<url> [count]", "Print the header, sections and largest arrays of a usdc file\n Only the header and table of contents are read, not the whole layer", inspect },
     { "cver", nullptr, "Print the client version", clientVersion },
     { "rver", nullptr, "Print the USD Resolver Plugin version", resolverVersion },
     { "sver", "<url>", "Print the server version", serverVersion },
     { "load", "<url>", "Load a USD file", loadUsd },
-    { "save", "[url]", "Save a previously loaded USD file (optionally to a different URL)", saveUsd },
+    { "save", "[url]", "Save a previously loaded USD file (optionally to a different URL), its dirty layers in parallel", saveUsd },
     { "close", nullptr, "Close a previously loaded USD file", closeUsd },
+    { "query", "[/path] [type=T] [kind=K] [api=A] [bound] [count]", "Find prims in the loaded USD file, all filters must match\n Indexes are built on first use and refreshed after stage edits", queryUsd },
+    { "namebench", "[count]", "Time naming count siblings (default 20000) with getValidChildNames and with a ChildNameAllocator", nameBench },
+    { "xformbench", "[count] [frames]", "Time setting count transforms (default 10000) for a number of frames (default 10)\n with setLocalTransform and with a TransformWriter", xformBench },
     { "lock", "[url]", "Lock a USD file (defaults to loaded stage root)", lock },
     { "unlock", "[url]", "Unlock a USD file (defaults to loaded stage root)", unlock },
     { "getacls", "<url>", "Print the ACLs for a URL", getacls },
@@ -0,0 +1,361 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <pxr/pxr.h>
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/usd/kind/registry.h>
+#include <pxr/usd/sdf/path.h>
+#include <pxr/usd/sdf/schema.h>
+#include <pxr/usd/usd/modelAPI.h>
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/schemaRegistry.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/tokens.h>
+#include <pxr/usd/usdShade/tokens.h>
+
+#include <algorithm>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+PrimIndex answers "which prims match these filters" for a loaded stage without walking the whole stage per query.
+
+* All prims are stored once in pre-order, so every subtree is a contiguous range of prim indices and a path prefix
+    filter is a pair of binary searches.
+* The type, kind, applied API schema and material binding indexes are each built the first time a query needs them.
+    Each maps a key to a sorted list of prim indices, so filters are combined by intersecting sorted lists.
+* Any UsdNotice::ObjectsChanged from the stage that could change membership (resyncs, kind, apiSchemas or material
+    binding edits) drops every index; the next query rebuilds what it needs.
+*/
+class PrimIndex : public PXR_NS::TfWeakBase
+{
+public:
+    struct Query
+    {
+        PXR_NS::TfToken typeName;
+        PXR_NS::TfToken kind;
+        PXR_NS::TfTokenVector apiSchemas;
+        PXR_NS::SdfPath under;
+        bool materialBound = false;
+    };
+
+    explicit PrimIndex(PXR_NS::UsdStageRefPtr const& stage)
+        : m_stage(stage)
+    {
+        m_noticeKey = PXR_NS::TfNotice::Register(PXR_NS::TfCreateWeakPtr(this), &PrimIndex::onObjectsChanged, PXR_NS::UsdStageWeakPtr(stage));
+    }
+
+    ~PrimIndex()
+    {
+        PXR_NS::TfNotice::Revoke(m_noticeKey);
+    }
+
+    PrimIndex(PrimIndex const&) = delete;
+    PrimIndex& operator=(PrimIndex const&) = delete;
+
+    // Returns false if the query references a prim path that is not on the stage
+    bool run(Query const& query, std::vector<PXR_NS::SdfPath>& results)
+    {
+        results.clear();
+        buildPaths();
+
+        // Restrict everything to the [begin, end) range of the "under" subtree
+        uint32_t begin = 0;
+        uint32_t end = (uint32_t)m_paths.size();
+        if (!query.under.IsEmpty() && query.under != PXR_NS::SdfPath::AbsoluteRootPath())
+        {
+            auto it = m_indexOf.find(query.under);
+            if (it == m_indexOf.end())
+            {
+                return false;
+            }
+            begin = it->second;
+            end = m_subtreeEnd[begin];
+        }
+
+        // Gather one sorted candidate list per filter
+        std::vector<IndexList> lists;
+        if (!query.typeName.IsEmpty())
+        {
+            buildTypes();
+            lists.emplace_back(unionMatching(m_byType, begin, end,
+                [&query](PXR_NS::TfToken const& key)
+                {
+                    if (key == query.typeName)
+                    {
+                        return true;
+                    }
+                    // Allow abstract or base schema names, e.g. "Gprim" or "Boundable"
+                    auto queryType = PXR_NS::UsdSchemaRegistry::GetTypeFromSchemaTypeName(query.typeName);
+                    return !queryType.IsUnknown() && PXR_NS::UsdSchemaRegistry::GetTypeFromSchemaTypeName(key).IsA(queryType);
+                }));
+        }
+        if (!query.kind.IsEmpty())
+        {
+            buildKinds();
+            lists.emplace_back(unionMatching(m_byKind, begin, end,
+                [&query](PXR_NS::TfToken const& key)
+                {
+                    return PXR_NS::KindRegistry::IsA(key, query.kind);
+                }));
+        }
+        for (auto&& api : query.apiSchemas)
+        {
+            buildApiSchemas();
+            lists.emplace_back(unionMatching(m_byApi, begin, end,
+                [&api](PXR_NS::TfToken const& key)
+                {
+                    // Multiple-apply schemas are indexed with their instance name (CollectionAPI:lights)
+                    std::string const& k = key.GetString();
+                    std::string const& a = api.GetString();
+                    return k == a || (k.size() > a.size() && k.compare(0, a.size(), a) == 0 && k[a.size()] == ':');
+                }));
+        }
+        if (query.materialBound)
+        {
+            buildBindings();
+            lists.emplace_back(slice(m_bound, begin, end));
+        }
+
+        if (lists.empty())
+        {
+            results.assign(m_paths.begin() + begin, m_paths.begin() + end);
+            return true;
+        }
+
+        // Intersect, starting with the shortest list
+        std::sort(lists.begin(), lists.end(),
+            [](IndexList const& a, IndexList const& b)
+            {
+                return a.size() < b.size();
+            });
+        for (uint32_t idx : lists[0])
+        {
+            bool inAll = true;
+            for (size_t i = 1; i < lists.size() && inAll; i++)
+            {
+                inAll = std::binary_search(lists[i].begin(), lists[i].end(), idx);
+            }
+            if (inAll)
+            {
+                results.push_back(m_paths[idx]);
+            }
+        }
+        return true;
+    }
+
+    // True until the first query after a load or an invalidating edit
+    bool isStale() const
+    {
+        return !m_pathsValid;
+    }
+
+private:
+    using IndexList = std::vector<uint32_t>;
+    using TokenIndex = std::unordered_map<PXR_NS::TfToken, IndexList, PXR_NS::TfToken::HashFunctor>;
+
+    static IndexList slice(IndexList const& list, uint32_t begin, uint32_t end)
+    {
+        return IndexList(std::lower_bound(list.begin(), list.end(), begin), std::lower_bound(list.begin(), list.end(), end));
+    }
+
+    template<class Predicate>
+    static IndexList unionMatching(TokenIndex const& index, uint32_t begin, uint32_t end, Predicate&& matches)
+    {
+        IndexList merged;
+        size_t matchedKeys = 0;
+        for (auto&& entry : index)
+        {
+            if (!matches(entry.first))
+            {
+                continue;
+            }
+            IndexList range = slice(entry.second, begin, end);
+            merged.insert(merged.end(), range.begin(), range.end());
+            matchedKeys++;
+        }
+        // Each list is sorted, but several keys (e.g. subkinds) need a merge
+        if (matchedKeys > 1)
+        {
+            std::sort(merged.begin(), merged.end());
+            merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+        }
+        return merged;
+    }
+
+    void invalidate()
+    {
+        m_pathsValid = false;
+        m_typesValid = false;
+        m_kindsValid = false;
+        m_apisValid = false;
+        m_boundValid = false;
+    }
+
+    void onObjectsChanged(PXR_NS::UsdNotice::ObjectsChanged const& notice, PXR_NS::UsdStageWeakPtr const& /* sender */)
+    {
+        if (!m_pathsValid)
+        {
+            return;
+        }
+        if (!notice.GetResyncedPaths().empty())
+        {
+            invalidate();
+            return;
+        }
+        for (PXR_NS::SdfPath const& path : notice.GetChangedInfoOnlyPaths())
+        {
+            if (path.IsPrimPath())
+            {
+                for (auto&& field : notice.GetChangedFields(path))
+                {
+                    if (field == PXR_NS::SdfFieldKeys->Kind || field == PXR_NS::UsdTokens->apiSchemas)
+                    {
+                        invalidate();
+                        return;
+                    }
+                }
+            }
+            else if (PXR_NS::TfStringStartsWith(path.GetName(), PXR_NS::UsdShadeTokens->materialBinding.GetString()))
+            {
+                m_boundValid = false;
+            }
+        }
+    }
+
+    void buildPaths()
+    {
+        if (m_pathsValid)
+        {
+            return;
+        }
+        m_paths.clear();
+        m_subtreeEnd.clear();
+        m_parent.clear();
+        m_indexOf.clear();
+        m_typesValid = m_kindsValid = m_apisValid = m_boundValid = false;
+
+        // Pre-order traversal, a stack of open ancestors gives each prim its parent and subtree end
+        std::vector<uint32_t> open;
+        for (auto&& prim : m_stage->Traverse())
+        {
+            uint32_t idx = (uint32_t)m_paths.size();
+            PXR_NS::SdfPath const& path = prim.GetPath();
+            while (!open.empty() && !path.HasPrefix(m_paths[open.back()]))
+            {
+                m_subtreeEnd[open.back()] = idx;
+                open.pop_back();
+            }
+            m_parent.push_back(open.empty() ? UINT32_MAX : open.back());
+            m_paths.push_back(path);
+            m_subtreeEnd.push_back(idx + 1);
+            m_indexOf.emplace(path, idx);
+            open.push_back(idx);
+        }
+        for (uint32_t idx : open)
+        {
+            m_subtreeEnd[idx] = (uint32_t)m_paths.size();
+        }
+        m_pathsValid = true;
+    }
+
+    void buildTypes()
+    {
+        if (m_typesValid)
+        {
+            return;
+        }
+        m_byType.clear();
+        for (uint32_t i = 0; i < m_paths.size(); i++)
+        {
+            auto prim = m_stage->GetPrimAtPath(m_paths[i]);
+            if (!prim.GetTypeName().IsEmpty())
+            {
+                m_byType[prim.GetTypeName()].push_back(i);
+            }
+        }
+        m_typesValid = true;
+    }
+
+    void buildKinds()
+    {
+        if (m_kindsValid)
+        {
+            return;
+        }
+        m_byKind.clear();
+        for (uint32_t i = 0; i < m_paths.size(); i++)
+        {
+            PXR_NS::TfToken kind;
+            if (PXR_NS::UsdModelAPI(m_stage->GetPrimAtPath(m_paths[i])).GetKind(&kind) && !kind.IsEmpty())
+            {
+                m_byKind[kind].push_back(i);
+            }
+        }
+        m_kindsValid = true;
+    }
+
+    void buildApiSchemas()
+    {
+        if (m_apisValid)
+        {
+            return;
+        }
+        m_byApi.clear();
+        for (uint32_t i = 0; i < m_paths.size(); i++)
+        {
+            for (auto&& schema : m_stage->GetPrimAtPath(m_paths[i]).GetAppliedSchemas())
+            {
+                m_byApi[schema].push_back(i);
+            }
+        }
+        m_apisValid = true;
+    }
+
+    // A prim counts as bound if it, or an ancestor, authors a material:binding relationship
+    void buildBindings()
+    {
+        if (m_boundValid)
+        {
+            return;
+        }
+        m_bound.clear();
+        std::vector<bool> bound(m_paths.size(), false);
+        for (uint32_t i = 0; i < m_paths.size(); i++)
+        {
+            auto rel = m_stage->GetPrimAtPath(m_paths[i]).GetRelationship(PXR_NS::UsdShadeTokens->materialBinding);
+            bound[i] = (rel && rel.HasAuthoredTargets()) || (m_parent[i] != UINT32_MAX && bound[m_parent[i]]);
+            if (bound[i])
+            {
+                m_bound.push_back(i);
+            }
+        }
+        m_boundValid = true;
+    }
+
+    PXR_NS::UsdStageRefPtr m_stage;
+    PXR_NS::TfNotice::Key m_noticeKey;
+
+    bool m_pathsValid = false;
+    std::vector<PXR_NS::SdfPath> m_paths;
+    std::vector<uint32_t> m_subtreeEnd;
+    std::vector<uint32_t> m_parent;
+    std::unordered_map<PXR_NS::SdfPath, uint32_t, PXR_NS::SdfPath::Hash> m_indexOf;
+
+    bool m_typesValid = false;
+    TokenIndex m_byType;
+    bool m_kindsValid = false;
+    TokenIndex m_byKind;
+    bool m_apisValid = false;
+    TokenIndex m_byApi;
+    bool m_boundValid = false;
+    IndexList m_bound;
+};
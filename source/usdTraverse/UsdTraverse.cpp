@@ -1,6 +1,11 @@
 // SPDX-FileCopyrightText: Copyright (c) 2021-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
 // SPDX-License-Identifier: MIT
 //
+#include "UsdTraverseBounds.h"
+#include "UsdTraverseExport.h"
+#include "UsdTraverseRayCast.h"
+#include "UsdTraverseSpatial.h"
+
 #include <omni/connect/core/Core.h>
 #include <omni/connect/core/XformAlgo.h>
 
@@ -9,20 +14,38 @@
 #include <pxr/usd/usdGeom/metrics.h>
 #include <pxr/usd/usdGeom/xformable.h>
 
+#include <cstring>
 #include <iostream>
 
 // Declare the Omniverse globals & default log channel
 OMNI_APP_GLOBALS("UsdTraverse", "Getting started guide to using the Connect SDK for USD stage traversal");
 
-// The program expects one argument, a path to a USD file
+// The program expects one argument, a path to a USD file, optionally followed by a mode:
+//   --bounds [pattern]  print the world-space bounds of all prims, or of the prims whose path matches the pattern
+//   --spatial [query]   build a spatial index, run a box/sphere/frustum query and benchmark the index
+//   --raycast [count]   cast random rays against the stage's meshes and report rays/sec (or "ray ox oy oz dx dy dz")
+//   --export file [pattern]  write the world space triangles of all meshes (or those matching the pattern) to .stl or .obj
 int main(int argc, char* argv[])
 {
-    if (argc != 2)
+    // --export needs the file to write to
+    const bool exportWithoutFile = argc == 3 && strcmp(argv[2], "--export") == 0;
+    if (argc < 2 || exportWithoutFile)
     {
-        std::cout << "Please provide an Omniverse URI or local file path to a USD stage to read." << std::endl;
+        std::cout << (exportWithoutFile ? "Please provide the .stl or .obj file to export to."
+                                        : "Please provide an Omniverse URI or local file path to a USD stage to read.")
+                  << std::endl;
+        std::cout << "Usage: UsdTraverse <stage> [--bounds [pattern] | --spatial [box x0 y0 z0 x1 y1 z1 | sphere x y z r | frustum /Camera]"
+                     " | --raycast [count | ray ox oy oz dx dy dz] | --export <file.stl|file.obj> [pattern]]"
+                  << std::endl;
         return -1;
     }
 
+    const bool boundsMode = argc >= 3 && strcmp(argv[2], "--bounds") == 0;
+    const char* boundsPattern = (boundsMode && argc >= 4) ? argv[3] : nullptr;
+    const bool spatialMode = argc >= 3 && strcmp(argv[2], "--spatial") == 0;
+    const bool rayCastMode = argc >= 3 && strcmp(argv[2], "--raycast") == 0;
+    const bool exportMode = argc >= 4 && strcmp(argv[2], "--export") == 0;
+
     std::cout << "Omniverse USD Stage Traversal: " << argv[1] << std::endl;
 
     // Acquire the Carbonite Framework and start the Connect SDK core module
@@ -45,6 +68,23 @@ int main(int argc, char* argv[])
     std::cout << "Stage up-axis: " << pxr::UsdGeomGetStageUpAxis(stage) << std::endl;
     std::cout << "Meters per unit: " << UsdGeomGetStageMetersPerUnit(stage) << std::endl;
 
+    if (boundsMode)
+    {
+        return printWorldBounds(stage, boundsPattern);
+    }
+    if (spatialMode)
+    {
+        return runSpatialQueries(stage, argc - 3, argv + 3);
+    }
+    if (rayCastMode)
+    {
+        return runRayCast(stage, argc - 3, argv + 3);
+    }
+    if (exportMode)
+    {
+        return exportMeshes(stage, argv[3], argc >= 5 ? argv[4] : nullptr);
+    }
+
     // Traverse the stage, print all prim names, print transformable prim positions
     pxr::UsdPrimRange range = stage->Traverse();
     for (const auto& prim : range)
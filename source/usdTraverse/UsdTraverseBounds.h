@@ -0,0 +1,180 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "PathPattern.h"
+
+#include <pxr/base/gf/bbox3d.h>
+#include <pxr/base/gf/range3d.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/bboxCache.h>
+#include <pxr/usd/usdGeom/boundable.h>
+#include <pxr/usd/usdGeom/tokens.h>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Split the stage into disjoint subtrees so each one can be measured by its own bounding box cache.
+// Grouping prims (Xforms, Scopes) near the top of the hierarchy are opened up until there are enough subtrees to
+// keep every thread busy. The opened prims are returned in `splitPrims`, parents before children.
+inline std::vector<pxr::UsdPrim> splitIntoSubtrees(const pxr::UsdStageRefPtr& stage, size_t targetCount, std::vector<pxr::UsdPrim>& splitPrims)
+{
+    std::vector<pxr::UsdPrim> roots;
+    for (const pxr::UsdPrim& child : stage->GetPseudoRoot().GetChildren())
+    {
+        roots.push_back(child);
+    }
+
+    const int maxDepth = 8;
+    for (int depth = 0; depth < maxDepth && roots.size() < targetCount; depth++)
+    {
+        std::vector<pxr::UsdPrim> next;
+        bool opened = false;
+        for (const pxr::UsdPrim& root : roots)
+        {
+            // Never split a boundable, its own extent is part of its bound
+            pxr::UsdPrimSiblingRange children = root.GetChildren();
+            if (root.IsA<pxr::UsdGeomBoundable>() || root.IsInstance() || children.empty())
+            {
+                next.push_back(root);
+                continue;
+            }
+            splitPrims.push_back(root);
+            next.insert(next.end(), children.begin(), children.end());
+            opened = true;
+        }
+        roots.swap(next);
+        if (!opened)
+        {
+            break;
+        }
+    }
+    return roots;
+}
+
+struct BoundsRow
+{
+    pxr::SdfPath path;
+    pxr::GfRange3d range;
+};
+
+// Compute the world-space bounds of every prim (or every prim whose path matches `pattern`) and print them as a table
+inline int printWorldBounds(const pxr::UsdStageRefPtr& stage, const char* pattern)
+{
+    const pxr::TfTokenVector purposes = { pxr::UsdGeomTokens->default_, pxr::UsdGeomTokens->render };
+    const pxr::UsdTimeCode time = pxr::UsdTimeCode::Default();
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<pxr::UsdPrim> splitPrims;
+    std::vector<pxr::UsdPrim> roots = splitIntoSubtrees(stage, 8 * pxr::WorkGetConcurrencyLimit(), splitPrims);
+
+    // Each task owns a UsdGeomBBoxCache and the subtrees it is given, so no cache is shared between threads.
+    // A pre-order walk computes the subtree root first, which fills the cache for all of its descendants.
+    std::vector<std::vector<BoundsRow>> rows(roots.size());
+    std::vector<pxr::GfBBox3d> rootBounds(roots.size());
+    std::vector<size_t> visited(roots.size(), 0);
+    pxr::WorkParallelForN(
+        roots.size(),
+        [&](size_t begin, size_t end)
+        {
+            pxr::UsdGeomBBoxCache cache(time, purposes);
+            for (size_t i = begin; i < end; ++i)
+            {
+                for (const pxr::UsdPrim& prim : pxr::UsdPrimRange(roots[i]))
+                {
+                    pxr::GfBBox3d bound = cache.ComputeWorldBound(prim);
+                    if (prim == roots[i])
+                    {
+                        rootBounds[i] = bound;
+                    }
+                    if (!pattern || matchesPathPattern(prim.GetPath().GetText(), pattern))
+                    {
+                        rows[i].push_back({ prim.GetPath(), bound.ComputeAlignedRange() });
+                    }
+                    visited[i]++;
+                }
+            }
+        },
+        1
+    );
+
+    // The split prims are grouping prims without their own extent, so their bound is the union of their children
+    std::unordered_map<pxr::SdfPath, pxr::GfBBox3d, pxr::SdfPath::Hash> childBounds;
+    for (size_t i = 0; i < roots.size(); i++)
+    {
+        childBounds[roots[i].GetPath()] = rootBounds[i];
+    }
+    std::vector<BoundsRow> splitRows;
+    for (auto it = splitPrims.rbegin(); it != splitPrims.rend(); ++it)
+    {
+        pxr::GfBBox3d bound;
+        for (const pxr::UsdPrim& child : it->GetChildren())
+        {
+            auto found = childBounds.find(child.GetPath());
+            if (found != childBounds.end())
+            {
+                bound = pxr::GfBBox3d::Combine(bound, found->second);
+            }
+        }
+        childBounds[it->GetPath()] = bound;
+        if (!pattern || matchesPathPattern(it->GetPath().GetText(), pattern))
+        {
+            splitRows.insert(splitRows.begin(), { it->GetPath(), bound.ComputeAlignedRange() });
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t primCount = splitPrims.size();
+    for (size_t count : visited)
+    {
+        primCount += count;
+    }
+
+    // Format the table into one buffer, printing a line at a time would cost more than computing the bounds
+    std::string table;
+    char line[1024];
+    snprintf(line, sizeof(line), "%-60s %12s %12s %12s %12s %12s %12s\n", "Prim", "Min X", "Min Y", "Min Z", "Max X", "Max Y", "Max Z");
+    table += line;
+    auto appendRow = [&table, &line](const BoundsRow& row)
+    {
+        if (row.range.IsEmpty())
+        {
+            snprintf(line, sizeof(line), "%-60s %12s\n", row.path.GetText(), "empty");
+        }
+        else
+        {
+            const pxr::GfVec3d& lo = row.range.GetMin();
+            const pxr::GfVec3d& hi = row.range.GetMax();
+            snprintf(line, sizeof(line), "%-60s %12.3f %12.3f %12.3f %12.3f %12.3f %12.3f\n", row.path.GetText(), lo[0], lo[1], lo[2], hi[0], hi[1], hi[2]);
+        }
+        table += line;
+    };
+    size_t rowCount = splitRows.size();
+    for (const BoundsRow& row : splitRows)
+    {
+        appendRow(row);
+    }
+    for (const auto& subtreeRows : rows)
+    {
+        for (const BoundsRow& row : subtreeRows)
+        {
+            appendRow(row);
+        }
+        rowCount += subtreeRows.size();
+    }
+    std::cout << table;
+
+    std::cout << "Computed world bounds for " << primCount << " prims (" << rowCount << " matched) over " << roots.size() << " subtrees in "
+              << seconds * 1000.0 << " ms using " << pxr::WorkGetConcurrencyLimit() << " threads ("
+              << (seconds > 0.0 ? (double)primCount / seconds : 0.0) << " prims/sec)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,291 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "UsdTraverseBounds.h"
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xformCache.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The triangles of one mesh in world space
+struct ExportMesh
+{
+    pxr::UsdPrim prim;
+    std::vector<pxr::GfVec3f> points;
+    std::vector<int> triangles;
+    size_t firstVertex = 0;
+    std::vector<char> bytes;
+};
+
+// Read a mesh, fan-triangulate its faces and bake its world transform into the points.
+// Left handed meshes and mirroring transforms flip the winding so every exported triangle faces outward.
+inline void triangulateMesh(ExportMesh& mesh, pxr::UsdGeomXformCache& xformCache)
+{
+    pxr::UsdGeomMesh usdMesh(mesh.prim);
+    pxr::VtVec3fArray points;
+    pxr::VtIntArray faceVertexCounts;
+    pxr::VtIntArray faceVertexIndices;
+    usdMesh.GetPointsAttr().Get(&points);
+    usdMesh.GetFaceVertexCountsAttr().Get(&faceVertexCounts);
+    usdMesh.GetFaceVertexIndicesAttr().Get(&faceVertexIndices);
+
+    const pxr::GfMatrix4d toWorld = xformCache.GetLocalToWorldTransform(mesh.prim);
+    float m[4][3];
+    for (int r = 0; r < 4; r++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            m[r][c] = (float)toWorld[r][c];
+        }
+    }
+    mesh.points.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const pxr::GfVec3f& p = points[i];
+        mesh.points[i] = pxr::GfVec3f(
+            p[0] * m[0][0] + p[1] * m[1][0] + p[2] * m[2][0] + m[3][0],
+            p[0] * m[0][1] + p[1] * m[1][1] + p[2] * m[2][1] + m[3][1],
+            p[0] * m[0][2] + p[1] * m[1][2] + p[2] * m[2][2] + m[3][2]
+        );
+    }
+
+    pxr::TfToken orientation;
+    usdMesh.GetOrientationAttr().Get(&orientation);
+    const bool flip = (orientation == pxr::UsdGeomTokens->leftHanded) != (toWorld.GetDeterminant3() < 0.0);
+
+    const int pointCount = (int)points.size();
+    size_t corner = 0;
+    mesh.triangles.clear();
+    for (int count : faceVertexCounts)
+    {
+        if (count < 0 || corner + (size_t)count > faceVertexIndices.size())
+        {
+            break;
+        }
+        for (int k = 1; k + 1 < count; k++)
+        {
+            int a = faceVertexIndices[corner];
+            int b = faceVertexIndices[corner + k];
+            int c = faceVertexIndices[corner + k + 1];
+            if (a < 0 || b < 0 || c < 0 || a >= pointCount || b >= pointCount || c >= pointCount)
+            {
+                continue;
+            }
+            if (flip)
+            {
+                std::swap(b, c);
+            }
+            mesh.triangles.push_back(a);
+            mesh.triangles.push_back(b);
+            mesh.triangles.push_back(c);
+        }
+        corner += (size_t)count;
+    }
+}
+
+// 50 byte binary STL records: facet normal, three corners and an unused attribute count
+inline void formatStl(ExportMesh& mesh)
+{
+    const size_t triangleCount = mesh.triangles.size() / 3;
+    mesh.bytes.resize(triangleCount * 50);
+    char* out = mesh.bytes.data();
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const pxr::GfVec3f& a = mesh.points[mesh.triangles[t * 3]];
+        const pxr::GfVec3f& b = mesh.points[mesh.triangles[t * 3 + 1]];
+        const pxr::GfVec3f& c = mesh.points[mesh.triangles[t * 3 + 2]];
+        pxr::GfVec3f normal = pxr::GfCross(b - a, c - a);
+        const float length = normal.GetLength();
+        normal = length > 0.0f ? normal / length : pxr::GfVec3f(0.0f);
+        memcpy(out, normal.data(), 12);
+        memcpy(out + 12, a.data(), 12);
+        memcpy(out + 24, b.data(), 12);
+        memcpy(out + 36, c.data(), 12);
+        memset(out + 48, 0, 2);
+        out += 50;
+    }
+}
+
+// 9 significant digits are enough to read back the exact float
+inline char* appendFloat(char* out, float value)
+{
+    return out + snprintf(out, 16, "%.9g", value);
+}
+
+// "o" per mesh, its world space "v" lines and "f" lines indexing the file-wide vertex list
+inline void formatObj(ExportMesh& mesh)
+{
+    const std::string name = mesh.prim.GetPath().GetString();
+    // Upper bounds: "v", 3 floats of up to 15 characters after a space and a newline per vertex (plus the terminator
+    // snprintf writes), "f", 3 indices of up to 12 digits after a space and a newline per face
+    mesh.bytes.resize(name.size() + 4 + mesh.points.size() * 52 + (mesh.triangles.size() / 3) * 41);
+    char* out = mesh.bytes.data();
+    char* end = out + mesh.bytes.size();
+    *out++ = 'o';
+    *out++ = ' ';
+    memcpy(out, name.data(), name.size());
+    out += name.size();
+    *out++ = '\n';
+    for (const pxr::GfVec3f& p : mesh.points)
+    {
+        *out++ = 'v';
+        for (int c = 0; c < 3; c++)
+        {
+            *out++ = ' ';
+            out = appendFloat(out, p[c]);
+        }
+        *out++ = '\n';
+    }
+    for (size_t i = 0; i < mesh.triangles.size(); i += 3)
+    {
+        *out++ = 'f';
+        for (int c = 0; c < 3; c++)
+        {
+            *out++ = ' ';
+            out = std::to_chars(out, end, mesh.firstVertex + (size_t)mesh.triangles[i + c] + 1).ptr;
+        }
+        *out++ = '\n';
+    }
+    mesh.bytes.resize((size_t)(out - mesh.bytes.data()));
+}
+
+// Write the meshes of the stage (or of the prims matching `pattern`) to a binary STL or OBJ file.
+// Meshes are processed in batches: read, triangulate and transform in parallel, then number the OBJ vertices in
+// file order, format in parallel and append the batch to the file through a large buffer.
+inline int exportMeshes(const pxr::UsdStageRefPtr& stage, const char* outputPath, const char* pattern)
+{
+    std::string extension = outputPath;
+    extension = extension.substr(extension.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    const bool stl = extension == "stl";
+    if (!stl && extension != "obj")
+    {
+        std::cout << "The export file must end in .stl or .obj" << std::endl;
+        return -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ExportMesh> meshes;
+    for (const pxr::UsdPrim& prim : stage->Traverse(pxr::UsdTraverseInstanceProxies()))
+    {
+        if (prim.IsA<pxr::UsdGeomMesh>() && (!pattern || matchesPathPattern(prim.GetPath().GetText(), pattern)) &&
+            pxr::UsdGeomMesh(prim).ComputeVisibility() != pxr::UsdGeomTokens->invisible)
+        {
+            meshes.emplace_back();
+            meshes.back().prim = prim;
+        }
+    }
+
+    FILE* file = fopen(outputPath, "wb");
+    if (!file)
+    {
+        std::cout << "Could not open " << outputPath << " for writing" << std::endl;
+        return -1;
+    }
+    std::vector<char> writeBuffer(16 << 20);
+    setvbuf(file, writeBuffer.data(), _IOFBF, writeBuffer.size());
+    if (stl)
+    {
+        // The triangle count is patched in once it is known
+        char header[84] = {};
+        snprintf(header, 80, "Exported from %s by UsdTraverse", stage->GetRootLayer()->GetDisplayName().c_str());
+        fwrite(header, 1, sizeof(header), file);
+    }
+    else
+    {
+        fprintf(file, "# Exported from %s by UsdTraverse\n", stage->GetRootLayer()->GetIdentifier().c_str());
+    }
+
+    const size_t batchSize = std::max<size_t>(64, pxr::WorkGetConcurrencyLimit() * 16);
+    size_t triangleCount = 0;
+    size_t vertexCount = 0;
+    size_t byteCount = 0;
+    double processSeconds = 0.0;
+    double writeSeconds = 0.0;
+    for (size_t batchStart = 0; batchStart < meshes.size(); batchStart += batchSize)
+    {
+        const size_t batchEnd = std::min(meshes.size(), batchStart + batchSize);
+        auto batchTime = std::chrono::steady_clock::now();
+        pxr::WorkParallelForN(
+            batchEnd - batchStart,
+            [&meshes, batchStart](size_t begin, size_t end)
+            {
+                // UsdGeomXformCache is not thread safe, every task gets its own
+                pxr::UsdGeomXformCache xformCache;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    triangulateMesh(meshes[batchStart + i], xformCache);
+                }
+            }
+        );
+        for (size_t i = batchStart; i < batchEnd; i++)
+        {
+            meshes[i].firstVertex = vertexCount;
+            vertexCount += meshes[i].points.size();
+            triangleCount += meshes[i].triangles.size() / 3;
+        }
+        pxr::WorkParallelForN(
+            batchEnd - batchStart,
+            [&meshes, batchStart, stl](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    if (stl)
+                    {
+                        formatStl(meshes[batchStart + i]);
+                    }
+                    else
+                    {
+                        formatObj(meshes[batchStart + i]);
+                    }
+                }
+            }
+        );
+        auto writeTime = std::chrono::steady_clock::now();
+        processSeconds += std::chrono::duration<double>(writeTime - batchTime).count();
+
+        for (size_t i = batchStart; i < batchEnd; i++)
+        {
+            fwrite(meshes[i].bytes.data(), 1, meshes[i].bytes.size(), file);
+            byteCount += meshes[i].bytes.size();
+            // Release the batch as soon as it is written
+            meshes[i] = ExportMesh();
+        }
+        writeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - writeTime).count();
+    }
+
+    if (stl)
+    {
+        const uint32_t count = (uint32_t)std::min<size_t>(triangleCount, UINT32_MAX);
+        fseek(file, 80, SEEK_SET);
+        fwrite(&count, sizeof(count), 1, file);
+    }
+    const bool ok = fclose(file) == 0;
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Exported " << meshes.size() << " meshes, " << triangleCount << " triangles" << (stl ? "" : ", " + std::to_string(vertexCount) + " vertices")
+              << " to " << outputPath << " (" << byteCount / 1e6 << " MB)" << std::endl;
+    std::cout << "Triangulate and format " << processSeconds * 1000.0 << " ms, write " << writeSeconds * 1000.0 << " ms, total " << seconds * 1000.0
+              << " ms using " << pxr::WorkGetConcurrencyLimit() << " threads (" << (seconds > 0.0 ? triangleCount / seconds : 0.0) << " triangles/sec)"
+              << std::endl;
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "RayCast.h"
+
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/usd/stage.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Cast rays against the triangles of every mesh on the stage.
+//   ray ox oy oz dx dy dz   cast one ray and print the closest hit
+//   [count]                 cast `count` random rays (default 1000000) through the stage bounds and report rays/sec
+inline int runRayCast(const pxr::UsdStageRefPtr& stage, int argc, char* argv[])
+{
+    auto start = std::chrono::steady_clock::now();
+    raycast::RayCastScene scene;
+    scene.build(stage);
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Built ray cast scene: " << scene.meshPaths().size() << " meshes, " << scene.triangleCount() << " triangles in "
+              << buildSeconds * 1000.0 << " ms" << std::endl;
+
+    if (argc >= 7 && strcmp(argv[0], "ray") == 0)
+    {
+        raycast::Ray ray;
+        ray.origin = pxr::GfVec3d(atof(argv[1]), atof(argv[2]), atof(argv[3]));
+        ray.direction = pxr::GfVec3d(atof(argv[4]), atof(argv[5]), atof(argv[6]));
+        raycast::Hit hit = scene.intersect(ray);
+        if (hit.valid())
+        {
+            std::cout << "Hit " << scene.meshPaths()[hit.mesh] << " face " << hit.face << " at " << scene.hitPoint(ray, hit) << " (t = " << hit.t
+                      << ")" << std::endl;
+        }
+        else
+        {
+            std::cout << "No hit" << std::endl;
+        }
+        return 0;
+    }
+
+    pxr::GfRange3d bounds = scene.bounds();
+    if (bounds.IsEmpty())
+    {
+        std::cout << "The stage has no meshes to cast rays against" << std::endl;
+        return 0;
+    }
+
+    // Rays start on a sphere around the stage and aim at random points inside its bounds, like picking from a camera
+    const size_t rayCount = argc >= 1 ? (size_t)std::strtoull(argv[0], nullptr, 10) : 1000000;
+    std::vector<raycast::Ray> rays(rayCount);
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<double> normal;
+    const pxr::GfVec3d center = bounds.GetMidpoint();
+    const pxr::GfVec3d size = bounds.GetSize();
+    const double radius = size.GetLength();
+    for (raycast::Ray& ray : rays)
+    {
+        pxr::GfVec3d onSphere(normal(random), normal(random), normal(random));
+        ray.origin = center + onSphere.GetNormalized() * radius;
+        pxr::GfVec3d target = bounds.GetMin() + pxr::GfCompMult(size, pxr::GfVec3d(unit(random), unit(random), unit(random)));
+        ray.direction = target - ray.origin;
+        ray.tMax = 2.0;
+    }
+
+    std::vector<raycast::Hit> hits;
+    for (bool anyHit : { false, true })
+    {
+        start = std::chrono::steady_clock::now();
+        scene.intersect(rays, hits, anyHit);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t hitCount = 0;
+        for (const raycast::Hit& hit : hits)
+        {
+            hitCount += hit.valid() ? 1 : 0;
+        }
+        std::cout << (anyHit ? "Occlusion" : "Closest hit") << ": " << rayCount << " rays in " << seconds * 1000.0 << " ms using "
+                  << pxr::WorkGetConcurrencyLimit() << " threads (" << (seconds > 0.0 ? rayCount / seconds : 0.0) << " rays/sec, " << hitCount
+                  << " hits)" << std::endl;
+    }
+    return 0;
+}
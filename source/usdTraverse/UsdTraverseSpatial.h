@@ -0,0 +1,183 @@
+// SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+
+#include "SpatialIndex.h"
+
+#include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/range3d.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/bboxCache.h>
+#include <pxr/usd/usdGeom/camera.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xformable.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+inline double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Move up to 1% of the indexed prims (at most 1000) by editing their translate ops, then time the update() the
+// change notice leads to against a full rebuild, and check that queries find the prims where they moved to.
+// Returns false if any moved prim is missing from the query at its new bounds.
+// Only existing ops are edited: adding an op is a resync, which rebuilds the index anyway. The edits are not saved.
+inline bool benchmarkIncrementalUpdate(const pxr::UsdStageRefPtr& stage, StageSpatialIndex& index)
+{
+    const PrimBvh& bvh = index.bvh();
+    const size_t editTarget = std::min<size_t>(1000, std::max<size_t>(1, bvh.size() / 100));
+    const size_t step = std::max<size_t>(1, bvh.size() / editTarget);
+    const pxr::GfVec3d offset(bvh.bounds().GetSize()[0] + 1.0, 0.0, 0.0);
+    std::vector<pxr::SdfPath> edited;
+    {
+        pxr::SdfChangeBlock changeBlock;
+        for (size_t item = 0; item < bvh.size() && edited.size() < editTarget; item += step)
+        {
+            pxr::UsdGeomXformable xformable(stage->GetPrimAtPath(index.path((uint32_t)item)));
+            bool resetsStack = false;
+            for (const pxr::UsdGeomXformOp& op : xformable ? xformable.GetOrderedXformOps(&resetsStack) : std::vector<pxr::UsdGeomXformOp>())
+            {
+                pxr::GfVec3d translate;
+                if (op.GetOpType() == pxr::UsdGeomXformOp::TypeTranslate && !op.IsInverseOp() && op.GetAttr().HasAuthoredValue() &&
+                    op.GetAs(&translate, pxr::UsdTimeCode::Default()))
+                {
+                    op.Set(translate + offset);
+                    edited.push_back(xformable.GetPath());
+                    break;
+                }
+            }
+        }
+    }
+    if (edited.empty())
+    {
+        std::cout << "Benchmark: no indexed prim has a translate op to edit, skipping the incremental update" << std::endl;
+        return true;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    index.update();
+    const double updateMs = millisecondsSince(start);
+
+    // The moved bounds computed from scratch must be found by a query on the updated index
+    pxr::UsdGeomBBoxCache cache(pxr::UsdTimeCode::Default(), { pxr::UsdGeomTokens->default_, pxr::UsdGeomTokens->render });
+    std::vector<pxr::SdfPath> results;
+    size_t missing = 0;
+    for (const pxr::SdfPath& path : edited)
+    {
+        const pxr::GfRange3d moved = cache.ComputeWorldBound(stage->GetPrimAtPath(path)).ComputeAlignedRange();
+        index.queryBox(moved, results);
+        if (moved.IsEmpty() || std::find(results.begin(), results.end(), path) == results.end())
+        {
+            missing++;
+        }
+    }
+
+    start = std::chrono::steady_clock::now();
+    index.rebuild();
+    const double rebuildMs = millisecondsSince(start);
+    std::cout << "Benchmark: moved " << edited.size() << " prims, incremental update in " << updateMs << " ms, full rebuild in "
+              << rebuildMs << " ms (" << (updateMs > 0.0 ? rebuildMs / updateMs : 0.0) << "x)" << std::endl;
+    if (missing > 0)
+    {
+        std::cout << "Benchmark: " << missing << " moved prims were not found at their new bounds after the update" << std::endl;
+        return false;
+    }
+    std::cout << "Benchmark: queries find every moved prim at its new bounds" << std::endl;
+    return true;
+}
+
+// Build a spatial index over the stage, run the region query given on the command line (if any), then benchmark
+// random box queries, a full refit and the incremental update after editing some transforms.
+//   box x0 y0 z0 x1 y1 z1   prims whose bounds overlap the box
+//   sphere x y z r          prims whose bounds overlap the sphere
+//   frustum /Path/To/Camera prims whose bounds overlap the camera's view frustum
+inline int runSpatialQueries(const pxr::UsdStageRefPtr& stage, int argc, char* argv[])
+{
+    auto start = std::chrono::steady_clock::now();
+    StageSpatialIndex index(stage);
+    index.rebuild();
+    const PrimBvh& bvh = index.bvh();
+    std::cout << "Built spatial index over " << bvh.size() << " boundable prims (" << bvh.nodeCount() << " nodes) in "
+              << millisecondsSince(start) << " ms" << std::endl;
+
+    std::vector<pxr::SdfPath> results;
+    if (argc >= 1)
+    {
+        start = std::chrono::steady_clock::now();
+        if (strcmp(argv[0], "box") == 0 && argc >= 7)
+        {
+            pxr::GfVec3d lo(atof(argv[1]), atof(argv[2]), atof(argv[3]));
+            pxr::GfVec3d hi(atof(argv[4]), atof(argv[5]), atof(argv[6]));
+            index.queryBox(pxr::GfRange3d(lo, hi), results);
+        }
+        else if (strcmp(argv[0], "sphere") == 0 && argc >= 5)
+        {
+            index.querySphere(pxr::GfVec3d(atof(argv[1]), atof(argv[2]), atof(argv[3])), atof(argv[4]), results);
+        }
+        else if (strcmp(argv[0], "frustum") == 0 && argc >= 2)
+        {
+            pxr::UsdGeomCamera camera(stage->GetPrimAtPath(pxr::SdfPath(argv[1])));
+            if (!camera)
+            {
+                std::cout << "Not a camera prim: " << argv[1] << std::endl;
+                return -1;
+            }
+            index.queryFrustum(camera.GetCamera(pxr::UsdTimeCode::Default()).GetFrustum(), results);
+        }
+        else
+        {
+            std::cout << "Unknown spatial query, expected: box x0 y0 z0 x1 y1 z1 | sphere x y z r | frustum /Camera" << std::endl;
+            return -1;
+        }
+        double queryMs = millisecondsSince(start);
+        for (const pxr::SdfPath& path : results)
+        {
+            std::cout << path << std::endl;
+        }
+        std::cout << results.size() << " prims in " << queryMs << " ms" << std::endl;
+    }
+
+    // Benchmark: random boxes each spanning 5% of the stage bounds along every axis
+    pxr::GfRange3d stageBounds = bvh.bounds();
+    if (stageBounds.IsEmpty())
+    {
+        return 0;
+    }
+    const int queryCount = 10000;
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    pxr::GfVec3d size = stageBounds.GetSize();
+    std::vector<uint32_t> items;
+    size_t hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < queryCount; q++)
+    {
+        pxr::GfVec3d lo;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            lo[axis] = stageBounds.GetMin()[axis] + unit(random) * size[axis] * 0.95;
+        }
+        bvh.queryBox(pxr::GfRange3d(lo, lo + size * 0.05), items);
+        hits += items.size();
+    }
+    double benchMs = millisecondsSince(start);
+    std::cout << "Benchmark: " << queryCount << " box queries in " << benchMs << " ms (" << benchMs * 1000.0 / queryCount
+              << " us/query, " << (double)hits / queryCount << " prims/query)" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    index.refit();
+    std::cout << "Benchmark: full refit in " << millisecondsSince(start) << " ms" << std::endl;
+
+    return benchmarkIncrementalUpdate(stage, index) ? 0 : -1;
+}
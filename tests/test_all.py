@@ -3,6 +3,7 @@
 #
 
 import argparse
+import json
 import logging
 import os
 import platform
@@ -164,6 +165,11 @@ def test_helloworld_py_extents_failure():
     assert return_code == 0
     return_code, output = run_shell_script("omni_asset_validator", stage_url)
     assert "ExtentsChecker" in output
+    # The stage optimizer authors the missing extent
+    return_code, output = run_shell_script("run_omniStageOptimizer", "extents", stage_url)
+    assert return_code == 0
+    return_code, output = run_shell_script("omni_asset_validator", stage_url)
+    assert "ExtentsChecker" not in output
 
 
 # This test could be watching the live data, currently it's just checking that it exists
@@ -186,6 +192,65 @@ def test_simple_sensor():
             assert False, line
 
 
+def test_stage_optimizer_usdc():
+    base_url = os.getenv(g_base_url_env_key, g_default_base_url) + "/StageOptimizer"
+    stage_url = base_url + "/" + "helloworld.usda"
+    return_code, output = run_shell_script("run_hello_world", "-a", "-p", base_url)
+    assert return_code == 0
+    # The sample's arrays are small, so force the conversion with a low threshold
+    return_code, output = run_shell_script("run_omniStageOptimizer", "usdc", stage_url, "--threshold", "1")
+    assert return_code == 0
+    assert "Layer parse time" in output
+    return_code, output = run_shell_script("omni_asset_validator", base_url + "/" + "helloworld.usdc")
+    assert return_code == 0
+    for line in output.splitlines():
+        if line.startswith("[Error]") or line.startswith("[Fatal]"):
+            if should_ignore_error(line):
+                pass
+            else:
+                assert False, line
+
+
+def test_stage_validator():
+    base_url = os.getenv(g_base_url_env_key, g_default_base_url) + "/StageValidator"
+    stage_url = base_url + "/" + "helloworld.usd"
+    results_path = os.path.join(os.getcwd(), "_build", "stage_validator_results.json")
+    return_code, output = run_shell_script("run_hello_world", "-p", base_url)
+    assert return_code == 0
+    return_code, output = run_shell_script("run_omniStageValidator", stage_url, "--output", results_path)
+    assert return_code == 0, output
+    with open(results_path) as results_file:
+        results = json.load(results_file)
+    assert results["summary"]["errors"] == 0
+    assert results["summary"]["prims"] > 0
+
+    # A mesh that indexes past its 4 points and whose extent no longer covers them must be reported
+    broken_path = os.path.join(os.getcwd(), "_build", "stage_validator_broken.usda")
+    with open(broken_path, "w") as broken_file:
+        broken_file.write(
+            "#usda 1.0\n"
+            'def Mesh "Broken"\n'
+            "{\n"
+            "    float3[] extent = [(0, 0, 0), (0.5, 0.5, 0)]\n"
+            "    int[] faceVertexCounts = [4]\n"
+            "    int[] faceVertexIndices = [0, 1, 2, 7]\n"
+            "    point3f[] points = [(0, 0, 0), (1, 0, 0), (1, 1, 0), (0, 1, 0)]\n"
+            "}\n"
+        )
+    return_code, output = run_shell_script("run_omniStageValidator", broken_path, "--output", results_path)
+    assert return_code != 0, output
+    with open(results_path) as results_file:
+        results = json.load(results_file)
+    assert results["summary"]["errors"] >= 2
+    reported = {(issue["rule"], issue["severity"], issue["location"]) for issue in results["issues"]}
+    assert ("mesh-index-bounds", "Error", "/Broken") in reported, results["issues"]
+    assert ("extents", "Error", "/Broken") in reported, results["issues"]
+
+    # Unknown options are rejected instead of being read as the stage
+    return_code, output = run_shell_script("run_omniStageValidator", "--not-an-option", stage_url)
+    assert return_code != 0, output
+
+
 # This test exercises some copy and move functionality with omnicli (since adding overwrite by default)
 # NOTE: this test can't use textures since interaction with the Nucleus Thumbnail Service can cause issues (OM-80653)
 def test_omnicli_copy_and_move():